@@ -29,6 +29,7 @@ local Engine = import("Engine")
 local pending = {}
 local callbacks = {}
 local do_callback = {}
+local memory_tags = {}
 
 local do_callback_normal = function (cb, p)
 	cb(table.unpack(p.event))
@@ -181,9 +182,17 @@ Event = {
 		while #pending > 0 do
 			local p = table.remove(pending, 1)
 			if callbacks[p.name] then
+				-- what the handlers allocate is put down to the event
+				local tag = memory_tags[p.name]
+				if not tag then
+					tag = Engine.GetLuaMemoryTag("event:" .. p.name)
+					memory_tags[p.name] = tag
+				end
+				local previous = Engine.SetLuaMemoryTag(tag)
 				for cb,_ in pairs(callbacks[p.name]) do
 					do_callback[p.name](cb, p)
 				end
+				Engine.SetLuaMemoryTag(previous)
 			end
 		end
 	end
@@ -765,6 +774,31 @@ Event = {
 --   experimental
 --
 
+--
+-- Event: onGameSaved
+--
+-- Triggered once a save has been written, or has failed to be. With
+-- BackgroundSave enabled this happens some time after <Game.SaveGame>
+-- returned.
+--
+-- > local onGameSaved = function (filename, error) ... end
+-- > Event.Register("onGameSaved", onGameSaved)
+--
+-- Parameters:
+--
+--   filename - the name of the save, as passed to <Game.SaveGame>
+--
+--   error - why the save couldn't be written, or nil if it worked
+--
+-- Availability:
+--
+--   2020
+--
+-- Status:
+--
+--   experimental
+--
+
 --
 -- Event: onGameResumed
 --
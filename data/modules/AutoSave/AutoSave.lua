@@ -2,6 +2,7 @@ local Game = import("Game")
 local Engine = import("Engine")
 local Event = import("Event")
 local FileSystem = import("FileSystem")
+local Timer = import("Timer")
 
 local max_autosaves = 9
 
@@ -33,12 +34,12 @@ local function PickNextAutosave()
 	return '_autosave' .. next_save_number
 end
 
-local function CheckedSave(filename)
+local function CheckedSave(filename, incremental)
 	if not Engine.GetAutosaveEnabled() then
 		return
 	end
 
-	local ok, err = pcall(Game.SaveGame, filename)
+	local ok, err = pcall(Game.SaveGame, filename, incremental)
 	if not ok then
 		print('Error making autosave:')
 		print(err)
@@ -51,3 +52,20 @@ Event.Register('onShipLanded', f)
 Event.Register('onShipUndocked', f)
 Event.Register('onShipTakeOff', f)
 Event.Register('onGameEnd', function() CheckedSave('_exit'); end)
+
+-- on top of the ones above, an incremental save every AutosaveInterval
+-- seconds of real time (so not while paused), which mostly only writes
+-- what has changed since its last full save
+local last_timed_save
+Event.Register('onGameStart', function ()
+	last_timed_save = Engine.ticks
+	Timer:CallEvery(1, function ()
+		local interval = Engine.GetAutosaveInterval()
+		if interval > 0 and Engine.ticks - last_timed_save >= interval * 1000 then
+			last_timed_save = Engine.ticks
+			if Game.player.flightState ~= "HYPERSPACE" then
+				CheckedSave('_autosave', true)
+			end
+		end
+	end)
+end)
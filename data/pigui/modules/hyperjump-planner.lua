@@ -153,11 +153,18 @@ local function showJumpRoute()
 		end)
 		ui.sameLine()
 
-		mainButton(icons.hyperspace, lui.AUTO_ROUTE,
-			function()
-				Engine.SectorMapAutoRoute()
-
-		end)
+		local auto_route_progress = Engine.SectorMapAutoRouteProgress()
+		if auto_route_progress then
+			mainButton(icons.time_accel_stop, lui.CANCEL,
+				function()
+					Engine.SectorMapCancelAutoRoute()
+			end)
+		else
+			mainButton(icons.hyperspace, lui.AUTO_ROUTE,
+				function()
+					Engine.SectorMapAutoRoute()
+			end)
+		end
 		ui.sameLine()
 
 		mainButton(icons.search_lens, lui.CENTER_ON_SYSTEM,
@@ -167,6 +174,10 @@ local function showJumpRoute()
 				end
 		end)
 
+		if auto_route_progress then
+			ui.progressBar(auto_route_progress, Vector2(-1, 0), lui.AUTO_ROUTE)
+		end
+
 		ui.separator()
 
 		local start = current_path
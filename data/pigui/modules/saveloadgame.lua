@@ -80,17 +80,21 @@ local function showSaveFiles()
 		table.sort(files, function(a,b) return (a.mtime.timestamp > b.mtime.timestamp) end)
 		ui.columns(2,"##saved_games",true)
 		for _,f in pairs(files) do
-			if ui.selectable(f.name, f.name == selectedSave, {"SpanAllColumns"}) then
-				selectedSave = f.name
-			end
-			if Engine.pigui.IsItemHovered() then
-				local tooltip = getSaveTooltip(f.name)
-				Engine.pigui.SetTooltip(tooltip)
-			end
+			-- skip saves that are still being written, and the deltas of
+			-- incremental saves (which load along with their base)
+			if not f.name:match("%.tmp$") and not f.name:match("%.delta$") then
+				if ui.selectable(f.name, f.name == selectedSave, {"SpanAllColumns"}) then
+					selectedSave = f.name
+				end
+				if Engine.pigui.IsItemHovered() then
+					local tooltip = getSaveTooltip(f.name)
+					Engine.pigui.SetTooltip(tooltip)
+				end
 
-			ui.nextColumn()
-			ui.text(Format.Date(f.mtime.timestamp))
-			ui.nextColumn()
+				ui.nextColumn()
+				ui.text(Format.Date(f.mtime.timestamp))
+				ui.nextColumn()
+			end
 		end
 		ui.columns(1,"",false)
 	end
@@ -232,6 +232,8 @@ local function updateStation (station, shipsOnSale)
 		end
 		local def = sos.def
 		shipTable:AddRow({shipClassIcon(def.shipClass), def.name, Format.Money(def.basePrice,false), def.capacity.."t"})
+		-- have the model ready by the time the ship is looked at
+		Engine.PrefetchModel(def.modelName)
 	end
 
 	if currentShipOnSale then
@@ -196,9 +196,9 @@ void Beam::UpdateInterpTransform(double alpha)
 	m_interpPos = alpha * GetPosition() + (1.0 - alpha) * oldPos;
 }
 
-void Beam::NotifyRemoved(const Body *const removedBody)
+void Beam::NotifyRemoved(const std::vector<const Body *> &removedBodies)
 {
-	if (m_parent == removedBody)
+	if (IsRemoved(removedBodies, m_parent))
 		m_parent = nullptr;
 }
 
@@ -39,7 +39,7 @@ public:
 	void Render(const Camera *camera, const vector3d &viewCoords, const matrix4x4d &viewTransform) override;
 	void TimeStepUpdate(const float timeStep) override;
 	void StaticUpdate(const float timeStep) override;
-	void NotifyRemoved(const Body *const removedBody) override;
+	void NotifyRemoved(const std::vector<const Body *> &removedBodies) override;
 	void PostLoadFixup(Space *space) override;
 	void UpdateInterpTransform(double alpha) override;
 
@@ -8,6 +8,8 @@
 #include "JsonUtils.h"
 #include "LuaEvent.h"
 
+#include <algorithm>
+
 Body::Body() :
 	PropertiedObject(Lua::manager),
 	m_flags(0),
@@ -54,6 +56,11 @@ Body::Body(const Json &jsonObj, Space *space) :
 	}
 }
 
+bool Body::IsRemoved(const std::vector<const Body *> &removedBodies, const Body *body)
+{
+	return body && std::binary_search(removedBodies.begin(), removedBodies.end(), body);
+}
+
 Body::~Body()
 {
 }
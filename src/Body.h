@@ -12,6 +12,7 @@
 #include "libs/matrix4x4.h"
 #include "libs/vector3.h"
 #include <string>
+#include <vector>
 
 class Space;
 class Camera;
@@ -54,8 +55,10 @@ public:
 	virtual bool OnCollision(Object *o, uint32_t flags, double relVel) { return false; }
 	// Attacker may be null
 	virtual bool OnDamage(Object *attacker, float kgDamage, const CollisionContact &contactData) { return false; }
-	// Override to clear any pointers you hold to the body
-	virtual void NotifyRemoved(const Body *const removedBody) {}
+	// Override to clear any pointers you hold to the bodies, which are sorted
+	// so that IsRemoved can look them up
+	virtual void NotifyRemoved(const std::vector<const Body *> &removedBodies) {}
+	static bool IsRemoved(const std::vector<const Body *> &removedBodies, const Body *body);
 
 	// before all bodies have had TimeStepUpdate (their moving step),
 	// StaticUpdate() is called. Good for special collision testing (Projectiles)
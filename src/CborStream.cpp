@@ -0,0 +1,411 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "CborStream.h"
+
+#include "Json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	enum Major : uint8_t {
+		MAJOR_UINT = 0,
+		MAJOR_NEGATIVE_INT = 1,
+		MAJOR_BYTES = 2,
+		MAJOR_STRING = 3,
+		MAJOR_ARRAY = 4,
+		MAJOR_MAP = 5,
+		MAJOR_TAG = 6,
+		MAJOR_SIMPLE = 7
+	};
+
+	const uint8_t INDEFINITE = 31;
+	const uint8_t BREAK_BYTE = 0xff;
+	const uint8_t FALSE_BYTE = 0xf4;
+	const uint8_t TRUE_BYTE = 0xf5;
+	const uint8_t NULL_BYTE = 0xf6;
+	const uint8_t DOUBLE_BYTE = 0xfb;
+
+	double HalfToDouble(uint16_t half)
+	{
+		const int exponent = (half >> 10) & 0x1f;
+		const int mantissa = half & 0x3ff;
+		double value;
+		if (exponent == 0)
+			value = std::ldexp(mantissa, -24);
+		else if (exponent != 31)
+			value = std::ldexp(mantissa + 1024, exponent - 25);
+		else
+			value = mantissa == 0 ? INFINITY : NAN;
+		return (half & 0x8000) ? -value : value;
+	}
+} // namespace
+
+CborWriter::CborWriter(size_t chunkSize) :
+	m_chunkSize(chunkSize),
+	m_size(0)
+{
+}
+
+void CborWriter::Write(const void *data, size_t length)
+{
+	const char *src = static_cast<const char *>(data);
+	while (length) {
+		if (m_chunks.empty() || m_chunks.back().used == m_chunks.back().capacity) {
+			// each chunk as big as everything before it, up to a point
+			const size_t capacity = std::max(m_chunkSize, std::min(m_size, size_t(16 * 1024 * 1024)));
+			m_chunks.push_back({ std::unique_ptr<char[]>(new char[capacity]), capacity, 0 });
+		}
+		Chunk &chunk = m_chunks.back();
+		const size_t n = std::min(length, chunk.capacity - chunk.used);
+		memcpy(chunk.data.get() + chunk.used, src, n);
+		chunk.used += n;
+		m_size += n;
+		src += n;
+		length -= n;
+	}
+}
+
+void CborWriter::Head(uint8_t major, uint64_t value)
+{
+	uint8_t bytes[9];
+	size_t length;
+	if (value < 24) {
+		bytes[0] = uint8_t(major << 5 | value);
+		length = 1;
+	} else if (value <= 0xff) {
+		bytes[0] = uint8_t(major << 5 | 24);
+		length = 2;
+	} else if (value <= 0xffff) {
+		bytes[0] = uint8_t(major << 5 | 25);
+		length = 3;
+	} else if (value <= 0xffffffff) {
+		bytes[0] = uint8_t(major << 5 | 26);
+		length = 5;
+	} else {
+		bytes[0] = uint8_t(major << 5 | 27);
+		length = 9;
+	}
+	// big endian
+	for (size_t i = length - 1; i > 0; i--) {
+		bytes[i] = uint8_t(value & 0xff);
+		value >>= 8;
+	}
+	Write(bytes, length);
+}
+
+void CborWriter::BeginMap() { Byte(MAJOR_MAP << 5 | INDEFINITE); }
+void CborWriter::BeginMap(size_t size) { Head(MAJOR_MAP, size); }
+void CborWriter::BeginArray() { Byte(MAJOR_ARRAY << 5 | INDEFINITE); }
+void CborWriter::BeginArray(size_t size) { Head(MAJOR_ARRAY, size); }
+void CborWriter::End() { Byte(BREAK_BYTE); }
+
+void CborWriter::String(const char *str, size_t length)
+{
+	Head(MAJOR_STRING, length);
+	Write(str, length);
+}
+
+void CborWriter::Bytes(const char *data, size_t length)
+{
+	Head(MAJOR_BYTES, length);
+	Write(data, length);
+}
+
+void CborWriter::Int(int64_t value)
+{
+	if (value >= 0)
+		Head(MAJOR_UINT, uint64_t(value));
+	else
+		Head(MAJOR_NEGATIVE_INT, uint64_t(-1 - value));
+}
+
+void CborWriter::UInt(uint64_t value)
+{
+	Head(MAJOR_UINT, value);
+}
+
+void CborWriter::Double(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint8_t bytes[9];
+	bytes[0] = DOUBLE_BYTE;
+	for (int i = 8; i > 0; i--) {
+		bytes[i] = uint8_t(bits & 0xff);
+		bits >>= 8;
+	}
+	Write(bytes, sizeof(bytes));
+}
+
+void CborWriter::Bool(bool value) { Byte(value ? TRUE_BYTE : FALSE_BYTE); }
+void CborWriter::Null() { Byte(NULL_BYTE); }
+
+void CborWriter::Value(const Json &value)
+{
+	switch (value.type()) {
+	case Json::value_t::null:
+	case Json::value_t::discarded:
+		Null();
+		break;
+	case Json::value_t::boolean:
+		Bool(value.get<bool>());
+		break;
+	case Json::value_t::number_integer:
+		Int(value.get<int64_t>());
+		break;
+	case Json::value_t::number_unsigned:
+		UInt(value.get<uint64_t>());
+		break;
+	case Json::value_t::number_float:
+		Double(value.get<double>());
+		break;
+	case Json::value_t::string:
+		String(value.get_ref<const std::string &>());
+		break;
+	case Json::value_t::array:
+		BeginArray(value.size());
+		for (const Json &element : value)
+			Value(element);
+		break;
+	case Json::value_t::object:
+		BeginMap(value.size());
+		Entries(value);
+		break;
+	}
+}
+
+void CborWriter::Entries(const Json &object)
+{
+	for (auto it = object.begin(); it != object.end(); ++it) {
+		Key(it.key());
+		Value(it.value());
+	}
+}
+
+std::string CborWriter::TakeData()
+{
+	std::string data;
+	data.reserve(m_size);
+	for (const Chunk &chunk : m_chunks)
+		data.append(chunk.data.get(), chunk.used);
+	m_chunks.clear();
+	m_size = 0;
+	return data;
+}
+
+CborReader::CborReader(const char *data, size_t size) :
+	m_pos(data),
+	m_end(data + size)
+{
+}
+
+uint8_t CborReader::Byte()
+{
+	if (m_pos == m_end)
+		throw CborError("unexpected end of CBOR data");
+	return uint8_t(*m_pos++);
+}
+
+uint64_t CborReader::Number(uint8_t info)
+{
+	if (info < 24)
+		return info;
+	int length;
+	switch (info) {
+	case 24: length = 1; break;
+	case 25: length = 2; break;
+	case 26: length = 4; break;
+	case 27: length = 8; break;
+	default: throw CborError("bad CBOR item head");
+	}
+	uint64_t value = 0;
+	for (int i = 0; i < length; i++)
+		value = value << 8 | Byte();
+	return value;
+}
+
+void CborReader::ReadString(uint8_t major, uint8_t info, std::string &out)
+{
+	out.clear();
+	if (info != INDEFINITE) {
+		const uint64_t length = Number(info);
+		if (uint64_t(m_end - m_pos) < length)
+			throw CborError("unexpected end of CBOR data");
+		out.assign(m_pos, size_t(length));
+		m_pos += length;
+		return;
+	}
+	// chunks of the same type, up to a break
+	for (;;) {
+		const uint8_t head = Byte();
+		if (head == BREAK_BYTE)
+			return;
+		if (head >> 5 != major || (head & 0x1f) == INDEFINITE)
+			throw CborError("bad chunk in CBOR string");
+		const uint64_t length = Number(head & 0x1f);
+		if (uint64_t(m_end - m_pos) < length)
+			throw CborError("unexpected end of CBOR data");
+		out.append(m_pos, size_t(length));
+		m_pos += length;
+	}
+}
+
+void CborReader::Next(Item &item)
+{
+	uint8_t head = Byte();
+	// tags say how to read what follows, which doesn't matter here
+	while (head >> 5 == MAJOR_TAG) {
+		Number(head & 0x1f);
+		head = Byte();
+	}
+
+	const uint8_t major = head >> 5;
+	const uint8_t info = head & 0x1f;
+	item.indefinite = false;
+	item.count = 0;
+	switch (major) {
+	case MAJOR_UINT:
+		item.type = UINT;
+		item.uintValue = Number(info);
+		break;
+	case MAJOR_NEGATIVE_INT:
+		item.type = NEGATIVE_INT;
+		item.uintValue = Number(info);
+		break;
+	case MAJOR_BYTES:
+		item.type = BYTES;
+		ReadString(major, info, item.str);
+		break;
+	case MAJOR_STRING:
+		item.type = STRING;
+		ReadString(major, info, item.str);
+		break;
+	case MAJOR_ARRAY:
+	case MAJOR_MAP:
+		item.type = major == MAJOR_ARRAY ? ARRAY : MAP;
+		item.indefinite = info == INDEFINITE;
+		if (!item.indefinite)
+			item.count = Number(info);
+		break;
+	default: // MAJOR_SIMPLE
+		switch (info) {
+		case 20:
+		case 21:
+			item.type = BOOL;
+			item.boolValue = info == 21;
+			break;
+		case 22:
+		case 23: // undefined
+			item.type = NULL_VALUE;
+			break;
+		case 25:
+			item.type = FLOAT;
+			item.floatValue = HalfToDouble(uint16_t(Number(info)));
+			break;
+		case 26: {
+			item.type = FLOAT;
+			const uint32_t bits = uint32_t(Number(info));
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			item.floatValue = value;
+			break;
+		}
+		case 27: {
+			item.type = FLOAT;
+			const uint64_t bits = Number(info);
+			memcpy(&item.floatValue, &bits, sizeof(item.floatValue));
+			break;
+		}
+		case INDEFINITE:
+			item.type = BREAK;
+			break;
+		default:
+			throw CborError("unsupported CBOR simple value");
+		}
+		break;
+	}
+}
+
+void CborReader::Skip(const Item &item)
+{
+	if (item.type != ARRAY && item.type != MAP)
+		return;
+
+	// counts of the maps and arrays being passed over, items for arrays and
+	// pairs * 2 for maps, or -1 for indefinite ones
+	std::vector<int64_t> open;
+	const int64_t perEntry = item.type == MAP ? 2 : 1;
+	open.push_back(item.indefinite ? -1 : int64_t(item.count) * perEntry);
+	Item inner;
+	while (!open.empty()) {
+		if (open.back() == 0) {
+			open.pop_back();
+			continue;
+		}
+		Next(inner);
+		if (inner.type == BREAK) {
+			if (open.back() != -1)
+				throw CborError("unexpected break in CBOR data");
+			open.pop_back();
+			continue;
+		}
+		if (open.back() > 0)
+			open.back()--;
+		if (inner.type == ARRAY || inner.type == MAP) {
+			if (open.size() >= size_t(MAX_DEPTH))
+				throw CborError("CBOR data nested too deep");
+			open.push_back(inner.indefinite ? -1 : int64_t(inner.count) * (inner.type == MAP ? 2 : 1));
+		}
+	}
+}
+
+Json CborReader::ReadJson(const Item &item)
+{
+	return ReadJson(item, 0);
+}
+
+Json CborReader::ReadJson(const Item &item, int depth)
+{
+	if ((item.type == ARRAY || item.type == MAP) && depth >= MAX_DEPTH)
+		throw CborError("CBOR data nested too deep");
+
+	switch (item.type) {
+	case UINT: return Json(item.uintValue);
+	case NEGATIVE_INT: return Json(item.IntValue());
+	case BYTES:
+	case STRING: return Json(item.str);
+	case FLOAT: return Json(item.floatValue);
+	case BOOL: return Json(item.boolValue);
+	case NULL_VALUE: return Json();
+	case BREAK: throw CborError("unexpected break in CBOR data");
+	case ARRAY: {
+		Json array = Json::array();
+		Item inner;
+		for (uint64_t i = 0; item.indefinite || i < item.count; i++) {
+			Next(inner);
+			if (inner.type == BREAK && item.indefinite)
+				break;
+			array.push_back(ReadJson(inner, depth + 1));
+		}
+		return array;
+	}
+	case MAP: {
+		Json object = Json::object();
+		Item key, value;
+		for (uint64_t i = 0; item.indefinite || i < item.count; i++) {
+			Next(key);
+			if (key.type == BREAK && item.indefinite)
+				break;
+			if (key.type != STRING)
+				throw CborError("CBOR map key is not a string");
+			Next(value);
+			object[key.str] = ReadJson(value, depth + 1);
+		}
+		return object;
+	}
+	}
+	return Json();
+}
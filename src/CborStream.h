@@ -0,0 +1,137 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef CBOR_STREAM_H
+#define CBOR_STREAM_H
+
+#include "JsonFwd.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Streaming CBOR (RFC 7049), for data that is too big to be built as a whole
+// Json tree first: save games. What is written can be read back with
+// Json::from_cbor, and the reader takes anything Json::to_cbor writes.
+
+struct CborError : public std::runtime_error {
+	explicit CborError(const std::string &what) :
+		std::runtime_error(what) {}
+};
+
+// Appends items to a buffer made of chunks, so that it never has to be
+// moved as it grows. Maps and arrays whose size isn't known up front are
+// written with indefinite length, and closed with End.
+class CborWriter {
+public:
+	explicit CborWriter(size_t chunkSize = 256 * 1024);
+
+	void BeginMap(); // indefinite length
+	void BeginMap(size_t size);
+	void BeginArray(); // indefinite length
+	void BeginArray(size_t size);
+	void End(); // closes an indefinite map or array
+
+	void Key(const std::string &key) { String(key); }
+	void String(const std::string &str) { String(str.data(), str.size()); }
+	void String(const char *str, size_t length);
+	void Bytes(const char *data, size_t length);
+	void Int(int64_t value);
+	void UInt(uint64_t value);
+	void Double(double value);
+	void Bool(bool value);
+	void Null();
+
+	// a whole tree, encoded as Json::to_cbor would
+	void Value(const Json &value);
+	// the members of an object, as entries of the map being written
+	void Entries(const Json &object);
+
+	// records the current size as a boundary between pieces of the stream,
+	// which incremental saves compare one by one (see SaveDelta)
+	void Mark() { m_marks.push_back(m_size); }
+
+	size_t Size() const { return m_size; }
+	// the stream so far, in one piece. the writer is left empty
+	std::string TakeData();
+	// the boundaries recorded with Mark, which TakeData leaves alone
+	std::vector<size_t> TakeMarks()
+	{
+		std::vector<size_t> marks;
+		marks.swap(m_marks);
+		return marks;
+	}
+
+private:
+	void Head(uint8_t major, uint64_t value);
+	void Write(const void *data, size_t length);
+	void Byte(uint8_t byte) { Write(&byte, 1); }
+
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		size_t capacity;
+		size_t used;
+	};
+	std::vector<Chunk> m_chunks;
+	std::vector<size_t> m_marks;
+	size_t m_chunkSize;
+	size_t m_size;
+};
+
+// Pulls items out of a CBOR stream one at a time. After Next has read the
+// head of a map or an array its contents come next, and can be read one by
+// one (Skip or ReadJson the values you don't want to walk through), or the
+// whole thing can be passed over with Skip. Throws CborError on bad data.
+class CborReader {
+public:
+	enum Type {
+		UINT,
+		NEGATIVE_INT,
+		BYTES,
+		STRING,
+		ARRAY,
+		MAP,
+		FLOAT,
+		BOOL,
+		NULL_VALUE,
+		BREAK // end of an indefinite map or array
+	};
+
+	struct Item {
+		Type type;
+		bool indefinite; // maps and arrays
+		uint64_t count; // pairs of a map, elements of an array
+		uint64_t uintValue; // UINT, and -1 - the value of a NEGATIVE_INT
+		double floatValue;
+		bool boolValue;
+		std::string str; // BYTES and STRING
+
+		int64_t IntValue() const { return type == UINT ? int64_t(uintValue) : -1 - int64_t(uintValue); }
+	};
+
+	// maps and arrays nested deeper than this are taken to be bad data
+	static const int MAX_DEPTH = 1024;
+
+	CborReader(const char *data, size_t size);
+
+	bool AtEnd() const { return m_pos == m_end; }
+	void Next(Item &item);
+	// passes over the contents of the item just read (nothing to do unless
+	// it is a map or an array)
+	void Skip(const Item &item);
+	// the item just read and its contents
+	Json ReadJson(const Item &item);
+
+private:
+	uint8_t Byte();
+	uint64_t Number(uint8_t info);
+	void ReadString(uint8_t major, uint8_t info, std::string &out);
+	Json ReadJson(const Item &item, int depth);
+
+	const char *m_pos;
+	const char *m_end;
+};
+
+#endif
@@ -14,6 +14,7 @@
 #include "SpaceStation.h"
 #include "collider/Geom.h"
 #include "graphics/Frustum.h"
+#include "graphics/Graphics.h"
 #include "graphics/Renderer.h"
 #include "graphics/RendererLocator.h"
 #include "scenegraph/Animation.h"
@@ -24,6 +25,10 @@
 static const unsigned int DEFAULT_NUM_BUILDINGS = 1000;
 static const double START_SEG_SIZE = CITY_ON_PLANET_RADIUS;
 static const double START_SEG_SIZE_NO_ATMO = CITY_ON_PLANET_RADIUS / 5.0f;
+// most buildings a leaf of the culling tree holds
+static const uint32_t CULL_LEAF_SIZE = 16;
+// buildings whose bounding radius is smaller than this on screen aren't drawn
+static const double MIN_BUILDING_PIXELS = 1.0;
 
 using SceneGraph::Model;
 
@@ -66,6 +71,7 @@ void CityOnPlanet::AddStaticGeomsToCollisionSpace()
 
 	// we know how many building we'll be adding, reserve space up front
 	m_enabledBuildings.reserve(numVisibleBuildings);
+	m_instTransforms.resize(s_buildingList.numBuildings);
 	for (unsigned int i = 0; i < m_buildings.size(); i++) {
 		if (i & skipMask) {
 		} else {
@@ -77,10 +83,66 @@ void CityOnPlanet::AddStaticGeomsToCollisionSpace()
 		}
 	}
 
+	// at most every building of a type is drawn at once
+	for (uint32_t i = 0; i < s_buildingList.numBuildings; i++)
+		m_instTransforms[i].reserve(m_buildingCounts[i]);
+	BuildCullTree();
+
 	// reset the reset flag
 	m_detailLevel = GameConfSingleton::getDetail().cities;
 }
 
+void CityOnPlanet::BuildCullTree()
+{
+	PROFILE_SCOPED()
+	m_cullNodes.clear();
+	if (m_enabledBuildings.empty())
+		return;
+	m_cullNodes.reserve(2 * (m_enabledBuildings.size() / CULL_LEAF_SIZE + 1));
+	BuildCullNode(0, uint32_t(m_enabledBuildings.size()));
+	m_cullStack.reserve(m_cullNodes.size());
+}
+
+// splits the buildings in two at the median along the widest axis of their
+// bounds until there are few enough in a node. returns the index of the node
+uint32_t CityOnPlanet::BuildCullNode(uint32_t first, uint32_t count)
+{
+	Aabb aabb;
+	for (uint32_t i = first; i < first + count; i++)
+		aabb.Update(m_enabledBuildings[i].pos);
+
+	CullNode node;
+	node.centre = aabb.min + (aabb.max - aabb.min) * 0.5;
+	node.radius = 0.0;
+	node.maxClipRadius = 0.0f;
+	node.first = first;
+	node.count = count;
+	node.children[0] = node.children[1] = 0;
+	for (uint32_t i = first; i < first + count; i++) {
+		const BuildingDef &b = m_enabledBuildings[i];
+		node.radius = std::max(node.radius, (b.pos - node.centre).Length() + b.clipRadius);
+		node.maxClipRadius = std::max(node.maxClipRadius, b.clipRadius);
+	}
+
+	const uint32_t index = uint32_t(m_cullNodes.size());
+	m_cullNodes.push_back(node);
+	if (count <= CULL_LEAF_SIZE)
+		return index;
+
+	const vector3d size = aabb.max - aabb.min;
+	const int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+	const uint32_t half = count / 2;
+	auto begin = m_enabledBuildings.begin() + first;
+	std::nth_element(begin, begin + half, begin + count, [axis](const BuildingDef &a, const BuildingDef &b) {
+		return a.pos[axis] < b.pos[axis];
+	});
+	const uint32_t left = BuildCullNode(first, half);
+	const uint32_t right = BuildCullNode(first + half, count - half);
+	m_cullNodes[index].children[0] = left;
+	m_cullNodes[index].children[1] = right;
+	return index;
+}
+
 void CityOnPlanet::RemoveStaticGeomsFromCollisionSpace()
 {
 	m_enabledBuildings.clear();
@@ -355,35 +417,55 @@ void CityOnPlanet::Render(const Graphics::Frustum &frustum, const SpaceStation *
 	}
 
 	uint32_t uCount = 0;
-	std::vector<uint32_t> instCount;
-	std::vector<std::vector<matrix4x4f>> transform;
-	instCount.resize(s_buildingList.numBuildings);
-	transform.resize(s_buildingList.numBuildings);
-	memset(&instCount[0], 0, sizeof(uint32_t) * s_buildingList.numBuildings);
-	for (uint32_t i = 0; i < s_buildingList.numBuildings; i++) {
-		transform[i].reserve(m_buildingCounts[i]);
-	}
-
-	for (std::vector<BuildingDef>::const_iterator iter = m_enabledBuildings.begin(), itEND = m_enabledBuildings.end(); iter != itEND; ++iter) {
-		const vector3d pos = viewTransform * (*iter).pos;
-		const vector3f posf(pos);
-		if (!frustum.TestPoint(pos, (*iter).clipRadius))
+	for (std::vector<matrix4x4f> &transforms : m_instTransforms)
+		transforms.clear();
+
+	// on screen radius in pixels is pixelScale * radius / distance, as in SceneGraph::LOD
+	const double pixelScale = Graphics::GetScreenHeight() / Graphics::GetFovFactor();
+
+	m_cullStack.clear();
+	if (!m_cullNodes.empty())
+		m_cullStack.push_back(0);
+	while (!m_cullStack.empty()) {
+		const CullNode &node = m_cullNodes[m_cullStack.back()];
+		m_cullStack.pop_back();
+
+		const vector3d centre = viewTransform * node.centre;
+		const Graphics::Frustum::Intersection in = frustum.TestSphere(centre, node.radius);
+		if (in == Graphics::Frustum::OUTSIDE)
+			continue;
+		// too far away for even the biggest building in it to show
+		const double nearest = centre.Length() - node.radius;
+		if (nearest > 0.0 && pixelScale * node.maxClipRadius < MIN_BUILDING_PIXELS * nearest)
 			continue;
+		if (in == Graphics::Frustum::INTERSECT && node.children[0]) {
+			m_cullStack.push_back(node.children[0]);
+			m_cullStack.push_back(node.children[1]);
+			continue;
+		}
 
-		matrix4x4f _rot(rotf[(*iter).rotation]);
-		_rot.SetTranslate(posf);
+		// a leaf on the edge of the frustum, or a node entirely within it
+		const bool testEach = in == Graphics::Frustum::INTERSECT;
+		for (uint32_t i = node.first, end = node.first + node.count; i < end; i++) {
+			const BuildingDef &building = m_enabledBuildings[i];
+			const vector3d pos = viewTransform * building.pos;
+			if (testEach && !frustum.TestPoint(pos, building.clipRadius))
+				continue;
+			if (pixelScale * building.clipRadius < MIN_BUILDING_PIXELS * pos.Length())
+				continue;
 
-		// increment the instance count and store the transform
-		instCount[(*iter).instIndex]++;
-		transform[(*iter).instIndex].push_back(_rot);
+			matrix4x4f _rot(rotf[building.rotation]);
+			_rot.SetTranslate(vector3f(pos));
+			m_instTransforms[building.instIndex].push_back(_rot);
 
-		++uCount;
+			++uCount;
+		}
 	}
 
 	// render the building models using instancing
 	for (uint32_t i = 0; i < s_buildingList.numBuildings; i++) {
-		if (!transform[i].empty())
-			s_buildingList.buildings[i].resolvedModel->Render(transform[i]);
+		if (!m_instTransforms[i].empty())
+			s_buildingList.buildings[i].resolvedModel->Render(m_instTransforms[i]);
 	}
 
 	RendererLocator::getRenderer()->GetStats().AddToStatCount(Graphics::Stats::STAT_BUILDINGS, uCount);
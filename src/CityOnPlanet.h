@@ -49,6 +49,8 @@ public:
 private:
 	void AddStaticGeomsToCollisionSpace();
 	void RemoveStaticGeomsFromCollisionSpace();
+	void BuildCullTree();
+	uint32_t BuildCullNode(uint32_t first, uint32_t count);
 
 	struct BuildingDef {
 		uint32_t instIndex;
@@ -58,11 +60,27 @@ private:
 		Geom *geom;
 	};
 
+	// bounding sphere hierarchy over m_enabledBuildings, rebuilt whenever they
+	// change. every node covers a contiguous range of the buildings, which are
+	// reordered to make it so
+	struct CullNode {
+		vector3d centre;
+		double radius;
+		float maxClipRadius; // of the biggest building in the node
+		uint32_t first;
+		uint32_t count;
+		uint32_t children[2]; // both 0 for a leaf
+	};
+
 	Planet *m_planet;
 	FrameId m_frame;
 	std::vector<BuildingDef> m_buildings;
 	std::vector<BuildingDef> m_enabledBuildings;
 	std::vector<uint32_t> m_buildingCounts;
+	std::vector<CullNode> m_cullNodes;
+	// kept between frames so that rendering doesn't allocate
+	std::vector<uint32_t> m_cullStack;
+	std::vector<std::vector<matrix4x4f>> m_instTransforms; // by building type
 	int m_detailLevel;
 	vector3d m_realCentre;
 	float m_clipRadius;
@@ -28,24 +28,32 @@ void CollMesh::Save(Serializer::Writer &wr) const
 	wr.Int32(m_totalTris);
 }
 
-void CollMesh::Load(Serializer::Reader &rd)
+void CollMesh::Load(Serializer::Reader &rd, bool buildTrees)
 {
 	PROFILE_SCOPED()
 	m_aabb.max = rd.Vector3d();
 	m_aabb.min = rd.Vector3d();
 	m_aabb.radius = rd.Double();
 
-	m_geomTree = new GeomTree(rd);
+	m_geomTree = new GeomTree(rd, buildTrees);
 
 	const uint32_t numDynGeomTrees = rd.Int32();
 	m_dynGeomTrees.reserve(numDynGeomTrees);
 	for (uint32_t it = 0; it < numDynGeomTrees; ++it) {
-		m_dynGeomTrees.push_back(new GeomTree(rd));
+		m_dynGeomTrees.push_back(new GeomTree(rd, buildTrees));
 	}
 
 	m_totalTris = rd.Int32();
 }
 
+void CollMesh::BuildTrees()
+{
+	PROFILE_SCOPED()
+	m_geomTree->BuildTrees();
+	for (GeomTree *tree : m_dynGeomTrees)
+		tree->BuildTrees();
+}
+
 CollMesh::~CollMesh()
 {
 	for (auto it = m_dynGeomTrees.begin(); it != m_dynGeomTrees.end(); ++it)
@@ -61,7 +61,9 @@ public:
 	inline void SetNumTriangles(unsigned int i) { m_totalTris = i; }
 
 	void Save(Serializer::Writer &wr) const;
-	void Load(Serializer::Reader &rd);
+	// buildTrees false leaves building the trees of the GeomTrees to BuildTrees
+	void Load(Serializer::Reader &rd, bool buildTrees = true);
+	void BuildTrees();
 
 protected:
 	Aabb m_aabb;
@@ -1,5 +1,6 @@
 #include "DebugInfo.h"
 
+#include <algorithm>
 #include <stddef.h>
 
 #include <imgui/imgui.h>
@@ -8,7 +9,11 @@
 #include "Game.h"
 #include "GameLocator.h"
 #include "Frame.h"
+#include "JobQueue.h"
+#include "LuaAllocator.h"
+#include "Pi.h"
 #include "Player.h"
+#include "collider/CollisionSpace.h"
 #include "galaxy/SystemPath.h"
 #include "galaxy/SystemBody.h"
 #include "graphics/Renderer.h"
@@ -40,6 +45,10 @@ void DebugInfo::Update()
 	const Graphics::Stats::TFrameData &stats = RendererLocator::getRenderer()->GetStats().FrameStatsPrevious();
 	const uint32_t numDrawCalls = stats.m_stats[Graphics::Stats::STAT_DRAWCALL];
 	const uint32_t numBuffersCreated = stats.m_stats[Graphics::Stats::STAT_CREATE_BUFFER];
+	const uint32_t numBuffersOrphaned = stats.m_stats[Graphics::Stats::STAT_ORPHAN_BUFFER];
+	const uint32_t numStreamedKB = stats.m_stats[Graphics::Stats::STAT_STREAMED_BYTES] / 1024;
+	const uint32_t numSortedDraws = stats.m_stats[Graphics::Stats::STAT_SORTED_DRAWS];
+	const uint32_t numStateChangesSaved = stats.m_stats[Graphics::Stats::STAT_STATE_CHANGES_SAVED];
 	const uint32_t numDrawTris = stats.m_stats[Graphics::Stats::STAT_DRAWTRIS];
 	const uint32_t numDrawPointSprites = stats.m_stats[Graphics::Stats::STAT_DRAWPOINTSPRITES];
 	const uint32_t numDrawBuildings = stats.m_stats[Graphics::Stats::STAT_BUILDINGS];
@@ -57,10 +66,44 @@ void DebugInfo::Update()
 	ss << m_frame_stat << " fps (" << (1000.0 / m_frame_stat) << " ms/f) " << m_phys_stat << " phys updates\n" ;
 	ss << numDrawPatchesTris << " triangles, " << numDrawPatchesTris * m_frame_stat * 1e-6 << "M tris/sec," << Text::TextureFont::GetGlyphCount() << " glyphs/sec, " << numDrawPatches << " patches/frame\n";
 	ss << "Lua mem usage: " << lua_memMB << "MB + " << lua_memKB << " KB + " << lua_memB << " bytes (stack top: " << lua_gettop(Lua::manager->GetLuaState()) << ")\n";
+
+	{
+		LuaAllocator::Stats luaStats = Lua::manager->GetAllocator().GetStats();
+		ss << "Lua pool: " << luaStats.smallBytes / 1024 << " KB in " << luaStats.slabs << " slabs (" << luaStats.slabBytes / 1024 << " KB), ";
+		ss << luaStats.largeBytes / 1024 << " KB malloc'd\n";
+		const size_t numTop = std::min(luaStats.tags.size(), size_t(4));
+		std::partial_sort(luaStats.tags.begin(), luaStats.tags.begin() + numTop, luaStats.tags.end(),
+			[](const LuaAllocator::TagStats &a, const LuaAllocator::TagStats &b) { return a.bytes > b.bytes; });
+		ss << "Lua mem by tag:";
+		for (size_t i = 0; i < numTop; i++)
+			ss << (i ? ", " : " ") << luaStats.tags[i].name << " " << luaStats.tags[i].bytes / 1024 << " KB";
+		ss << "\n";
+	}
 	ss << "Draw Calls (" << numDrawCalls << "), of which were:\n Tris (" << numDrawTris << "), Point Sprites (" << numDrawPointSprites << "), Billboards (" << numDrawBillBoards << ")\n";
 	ss << "Buildings (" << numDrawBuildings << "), Cities (" << numDrawCities << "), GroundStations (" << numDrawGroundStations << "), SpaceStations (" << numDrawSpaceStations << "), Atmospheres (" << numDrawAtmospheres << ")\n";
 	ss << "Patches (" << numDrawPatches << "), Planets (" << numDrawPlanets << "), GasGiants (" << numDrawGasGiants << "), Stars (" << numDrawStars << "), Ships (" << numDrawShips << ")\n";
-	ss << "Buffers Created(" << numBuffersCreated << ")\n";
+	ss << "Buffers Created(" << numBuffersCreated << "), Orphaned(" << numBuffersOrphaned << "), Streamed(" << numStreamedKB << " KB)\n";
+	ss << "Sorted Draws (" << numSortedDraws << "), State Changes Saved (" << numStateChangesSaved << ")\n";
+
+	if (const WorkStealingJobQueue *jobQueue = dynamic_cast<const WorkStealingJobQueue *>(Pi::GetAsyncJobQueue())) {
+		const WorkStealingJobQueue::Stats jobStats = jobQueue->GetStats();
+		ss << "Jobs: " << jobStats.queueDepth << " queued, " << (jobStats.steals - m_last_job_steals) << " steals/sec, ";
+		ss << (jobStats.idleMicroseconds - m_last_job_idle) / 1000 << " ms idle/sec\n";
+		m_last_job_steals = jobStats.steals;
+		m_last_job_idle = jobStats.idleMicroseconds;
+	}
+
+	{
+		const CollisionSpace::TreeStats &treeStats = CollisionSpace::GetTreeStats();
+		const double physUpdates = std::max(m_phys_stat, 1);
+		ss << stringf("Collision trees per phys update: %0{f.1} refits, %1{f.1} subtree rebuilds, %2{f.1} rebuilds\n",
+			(treeStats.refits - m_last_tree_refits) / physUpdates,
+			(treeStats.subtreeRebuilds - m_last_tree_subtree_rebuilds) / physUpdates,
+			(treeStats.rebuilds - m_last_tree_rebuilds) / physUpdates);
+		m_last_tree_refits = treeStats.refits;
+		m_last_tree_subtree_rebuilds = treeStats.subtreeRebuilds;
+		m_last_tree_rebuilds = treeStats.rebuilds;
+	}
 
 	if (GameLocator::getGame() && GameLocator::getGame()->GetPlayer()->GetFlightState() != Ship::HYPERSPACE) {
 		vector3d pos = GameLocator::getGame()->GetPlayer()->GetPosition();
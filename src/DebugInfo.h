@@ -24,6 +24,13 @@ private:
 	int m_phys_stat;
 	uint32_t m_last_stats;
 
+	uint64_t m_last_job_steals = 0;
+	uint64_t m_last_job_idle = 0;
+
+	uint64_t m_last_tree_refits = 0;
+	uint64_t m_last_tree_subtree_rebuilds = 0;
+	uint64_t m_last_tree_rebuilds = 0;
+
 	std::string m_dbg_text;
 };
 
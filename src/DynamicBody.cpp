@@ -26,6 +26,7 @@ DynamicBody::DynamicBody() :
 	m_flags = Body::FLAG_CAN_MOVE_FRAME;
 	m_oldPos = GetPosition();
 	m_oldAngDisplacement = vector3d(0.0);
+	m_integrated = false;
 	m_force = vector3d(0.0);
 	m_torque = vector3d(0.0);
 	m_vel = vector3d(0.0);
@@ -237,6 +238,18 @@ void DynamicBody::CalcExternalForce()
 }
 
 void DynamicBody::TimeStepUpdate(const float timeStep)
+{
+	if (m_integrated) {
+		m_integrated = false;
+	} else {
+		PreIntegrate(timeStep);
+		Integrate(timeStep);
+	}
+
+	ModelBody::TimeStepUpdate(timeStep);
+}
+
+void DynamicBody::Integrate(const float timeStep)
 {
 	m_oldPos = GetPosition();
 	if (m_isMoving) {
@@ -268,8 +281,6 @@ void DynamicBody::TimeStepUpdate(const float timeStep)
 	} else {
 		m_oldAngDisplacement = vector3d(0.0);
 	}
-
-	ModelBody::TimeStepUpdate(timeStep);
 }
 
 void DynamicBody::UpdateInterpTransform(double alpha)
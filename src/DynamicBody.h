@@ -36,6 +36,17 @@ public:
 	bool IsMoving() const { return m_isMoving; }
 	double GetMass() const override final { return m_mass; }
 	void TimeStepUpdate(const float timeStep) override;
+	// TimeStepUpdate is PreIntegrate + Integrate + the rest of the update.
+	// Integrate only touches this body (and reads its frame), which lets
+	// Space run it for all moving bodies on the job queue first; see
+	// Space::IntegrateBodies. Forces are applied in PreIntegrate, which
+	// always runs on the main thread
+	virtual void PreIntegrate(const float timeStep) {}
+	void IntegrateAhead(const float timeStep)
+	{
+		Integrate(timeStep);
+		m_integrated = true;
+	}
 	vector3d CalcAtmosphericForce() const;
 	double CalcAtmosphericDrag(double velSqr, double area, double coeff) const;
 	void CalcExternalForce();
@@ -93,6 +104,8 @@ protected:
 	AIError m_aiMessage;
 
 private:
+	void Integrate(const float timeStep);
+
 	vector3d m_oldPos;
 	vector3d m_oldAngDisplacement;
 
@@ -104,6 +117,7 @@ private:
 	double m_massRadius; // set in a mickey-mouse fashion from the collision mesh and used to calculate m_angInertia
 	double m_angInertia; // always sphere mass distribution
 	bool m_isMoving;
+	bool m_integrated; // by IntegrateAhead, for this step
 
 	vector3d m_externalForce;
 	vector3d m_atmosForce;
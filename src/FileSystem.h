@@ -215,6 +215,13 @@ namespace FileSystem {
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output) override;
 
 		bool MakeDirectory(const std::string &path);
+		bool RemoveFile(const std::string &path);
+		// replaces 'to' if it exists
+		bool RenameFile(const std::string &from, const std::string &to);
+
+		// like ReadFile, but the data is mapped into memory rather than
+		// copied, so only the pages that are touched get read
+		RefCountedPtr<FileData> MapFile(const std::string &path);
 
 		enum WriteFlags {
 			WRITE_TEXT = 1
@@ -4,6 +4,7 @@
 #include "Frame.h"
 
 #include "GameSaveError.h"
+#include "JobQueue.h"
 #include "JsonUtils.h"
 #include "Sfx.h"
 #include "Space.h"
@@ -284,13 +285,31 @@ void Frame::PostUnserializeFixup(const FrameId &fId, Space *space)
 		PostUnserializeFixup(kid, space);
 }
 
-void Frame::CollideFrames(CollCallback &callback)
+void Frame::CollideFrames(CollCallback &callback, JobQueue *jobQueue)
 {
 	PROFILE_SCOPED()
 
-	std::for_each(begin(s_collisionSpaces), end(s_collisionSpaces), [&](CollisionSpace &cs) {
-		cs.Collide(callback);
+	if (!jobQueue || !jobQueue->GetNumRunners()) {
+		std::for_each(begin(s_collisionSpaces), end(s_collisionSpaces), [&](CollisionSpace &cs) {
+			cs.Collide(callback);
+		});
+		return;
+	}
+
+	// one work item per geom, across all the spaces
+	std::vector<std::pair<CollisionSpace *, size_t>> items;
+	for (CollisionSpace &cs : s_collisionSpaces) {
+		cs.PrepareCollide();
+		for (size_t i = 0; i < cs.GetNumCollideItems(); i++)
+			items.emplace_back(&cs, i);
+	}
+
+	ParallelFor(jobQueue, items.size(), [&items](uint32_t i) {
+		items[i].first->CollideItem(items[i].second);
 	});
+
+	for (CollisionSpace &cs : s_collisionSpaces)
+		cs.FinishCollide(callback);
 }
 
 void Frame::RemoveChild(const FrameId &fId)
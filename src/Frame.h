@@ -19,6 +19,7 @@
 class Body;
 class CollisionSpace;
 class Geom;
+class JobQueue;
 class SystemBody;
 class SfxManager;
 class Space;
@@ -129,7 +130,10 @@ public:
 	CollisionSpace *GetCollisionSpace() const;
 
 	static void UpdateOrbitRails(double time, double timestep);
-	static void CollideFrames(CollCallback &callback);
+	// if jobQueue is given, the narrow phase of all the frames runs on its
+	// worker threads; the callbacks still fire on this thread, in the same
+	// order and with the same contacts
+	static void CollideFrames(CollCallback &callback, JobQueue *jobQueue = nullptr);
 	void UpdateInterpTransform(double alpha);
 	void ClearMovement();
 
@@ -1,6 +1,7 @@
 #include "GZipFormat.h"
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
 
 #ifdef __GNUC__
@@ -188,6 +189,20 @@ std::string gzip::DecompressRawDeflate(const unsigned char *data, size_t length)
 }
 
 std::string gzip::CompressGZip(const std::string &data, const std::string &inner_file_name)
+{
+	std::string out = GZipHeader(inner_file_name);
+
+	bool success = tdefl_compress_mem_to_output(data.data(), data.size(), &PutBytesToString, static_cast<void *>(&out), TDEFL_DEFAULT_MAX_PROBES);
+	if (!success) {
+		throw gzip::CompressionFailedException();
+	}
+
+	out += GZipFooter(data);
+
+	return out;
+}
+
+std::string gzip::GZipHeader(const std::string &inner_file_name)
 {
 	std::string out;
 
@@ -206,18 +221,34 @@ std::string gzip::CompressGZip(const std::string &data, const std::string &inner
 	};
 	out.append(reinterpret_cast<const char *>(crc_buf), sizeof(crc_buf));
 
-	bool success = tdefl_compress_mem_to_output(data.data(), data.size(), &PutBytesToString, static_cast<void *>(&out), TDEFL_DEFAULT_MAX_PROBES);
-	if (!success) {
-		throw gzip::CompressionFailedException();
-	}
+	return out;
+}
 
+std::string gzip::GZipFooter(const std::string &data)
+{
 	unsigned char footer_bytes[8];
 	uint32_t data_crc = mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const mz_uint8 *>(data.data()), data.size());
 	WriteLE32(footer_bytes + 0, data_crc);
 	// GZip specifies that size is written little-endian, modulo 2^32
 	// (ie, if size is really > 2^32 we just chop off the high bits).
 	WriteLE32(footer_bytes + 4, data.size());
-	out.append(reinterpret_cast<const char *>(footer_bytes), sizeof(footer_bytes));
+
+	return std::string(reinterpret_cast<const char *>(footer_bytes), sizeof(footer_bytes));
+}
+
+std::string gzip::CompressDeflateBlock(const char *data, size_t length, bool last)
+{
+	// The compressor state is a few hundred KB, too big for the stack.
+	std::unique_ptr<tdefl_compressor> compressor(new tdefl_compressor);
+	std::string out;
+	if (tdefl_init(compressor.get(), &PutBytesToString, static_cast<void *>(&out), TDEFL_DEFAULT_MAX_PROBES) != TDEFL_STATUS_OKAY) {
+		throw gzip::CompressionFailedException();
+	}
+
+	// A full flush ends with an empty stored block, which leaves the output byte aligned.
+	if (tdefl_compress_buffer(compressor.get(), data, length, last ? TDEFL_FINISH : TDEFL_FULL_FLUSH) != (last ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY)) {
+		throw gzip::CompressionFailedException();
+	}
 
 	return out;
 }
@@ -34,6 +34,18 @@ namespace gzip {
 	// If compression fails it throws an exception.
 	// Parameter 'inner_file_name' is the name written in the GZip header as the file name of the compressed block.
 	std::string CompressGZip(const std::string &data, const std::string &inner_file_name);
+
+	// The pieces of CompressGZip, for building a GZip file out of DEFLATE blocks compressed separately
+	// (possibly on different threads). A GZip file is the header, the blocks in order, then the footer
+	// computed over all of the uncompressed data.
+	std::string GZipHeader(const std::string &inner_file_name);
+	std::string GZipFooter(const std::string &data);
+
+	// Compresses a block of data as raw DEFLATE, without reference to any data before it.
+	// Blocks other than the last one end byte aligned and without the final block marker, so
+	// the output of consecutive calls can be concatenated into one DEFLATE stream.
+	// If compression fails it throws an exception.
+	std::string CompressDeflateBlock(const char *data, size_t length, bool last);
 } // namespace gzip
 
 #endif
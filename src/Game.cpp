@@ -7,6 +7,7 @@
 
 #include "Background.h"
 #include "Body.h"
+#include "CborStream.h"
 #include "Frame.h"
 #include "GameLocator.h"
 #include "GameLog.h"
@@ -200,7 +201,7 @@ Game::~Game()
 	m_galaxy->FlushCaches();
 }
 
-void Game::ToJson(Json &jsonObj)
+void Game::ToCbor(CborWriter &out)
 {
 	PROFILE_SCOPED()
 	// preparing the lua serializer
@@ -208,6 +209,10 @@ void Game::ToJson(Json &jsonObj)
 
 	luaSerializer->InitTableRefs();
 
+	// the small parts are put together as Json first, the big ones
+	// (space and lua) go straight to the stream
+	Json jsonObj = Json::object();
+
 	// galaxy generator
 	m_galaxy->ToJson(jsonObj);
 
@@ -225,13 +230,16 @@ void Game::ToJson(Json &jsonObj)
 	jsonObj["hyperspace_progress"] = m_hyperspaceProgress;
 	jsonObj["hyperspace_duration"] = m_hyperspaceDuration;
 	jsonObj["hyperspace_end_time"] = m_hyperspaceEndTime;
+	out.Entries(jsonObj);
+	out.Mark();
+	jsonObj = Json::object();
 
 	// Delete camera frame from frame structure:
 	bool have_cam_frame = InGameViewsLocator::getInGameViews()->GetWorldView()->GetCameraContext()->GetCamFrame();
 	if (have_cam_frame)	InGameViewsLocator::getInGameViews()->GetWorldView()->EndCameraFrame();
 
 	// space, all the bodies and things
-	m_space->ToJson(jsonObj);
+	m_space->ToCbor(out);
 	jsonObj["player"] = m_space->GetIndexForBody(m_player.get());
 
 	// hyperspace clouds being brought over from the previous system
@@ -242,8 +250,11 @@ void Game::ToJson(Json &jsonObj)
 	}
 	jsonObj["hyperspace_clouds"] = hyperspaceCloudArray; // Add hyperspace cloud array to supplied object.
 
+	out.Entries(jsonObj);
+	out.Mark();
+
 	// lua
-	luaSerializer->ToJson(jsonObj);
+	luaSerializer->ToCbor(out);
 
 	// Stuff to show in the preview in load game window
 	// some may be redundant, but this won't require loading up a game to get it all
@@ -284,7 +295,9 @@ void Game::ToJson(Json &jsonObj)
 		break;
 	}
 
-	jsonObj["game_info"] = gameInfo;
+	out.Key("game_info");
+	out.Value(gameInfo);
+	out.Mark();
 
 	luaSerializer->UninitTableRefs();
 
@@ -471,7 +484,7 @@ void Game::SwitchToHyperspace()
 		// want the player to have any memory of what they were (we're just
 		// reusing them for convenience). tell the player it was deleted so it
 		// can clean up
-		m_player->NotifyRemoved(cloud);
+		m_player->NotifyRemoved({ cloud });
 
 		// turn the cloud arround
 		cloud->GetShip()->SetHyperspaceDest(m_hyperspaceSource);
@@ -770,6 +783,12 @@ void Game::UpdateStarSystemCache(const SystemPath *here, unsigned int sectorRadi
 
 	const int survivorRadius = sectorRadius * 3;
 
+	// whatever the budgets make the caches drop, keep where we are and both
+	// ends of the jump
+	const StarSystemCache::PathVector pinned = { *here, m_hyperspaceSource, m_hyperspaceDest };
+	m_sectorCache->SetPinned(pinned);
+	m_starSystemCache->SetPinned(pinned);
+
 	m_sectorCache->ShrinkCache(*here, survivorRadius, m_hyperspaceSource);
 	m_starSystemCache->ShrinkCache(*here, survivorRadius, m_hyperspaceSource);
 
@@ -13,6 +13,7 @@
 #include <string>
 #include <list>
 
+class CborWriter;
 class Galaxy;
 class GameLog;
 class HyperspaceCloud;
@@ -41,8 +42,8 @@ class Game {
 
 	~Game();
 
-	// save game
-	void ToJson(Json &jsonObj);
+	// save game, as entries of the map being written
+	void ToCbor(CborWriter &out);
 
 public:
 	// various game states
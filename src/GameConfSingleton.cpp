@@ -12,6 +12,8 @@ DetailLevel GameConfSingleton::m_detail;
 bool GameConfSingleton::navTunnelDisplayed = false;
 bool GameConfSingleton::speedLinesDisplayed = false;
 bool GameConfSingleton::hudTrailsDisplayed = false;
+bool GameConfSingleton::parallelCollisions = false;
+bool GameConfSingleton::parallelPhysics = false;
 bool GameConfSingleton::bRefreshBackgroundStars = true;
 float GameConfSingleton::amountOfBackgroundStarsDisplayed = 1.0f;
 
@@ -31,6 +33,8 @@ void GameConfSingleton::Init(const GameConfig::map_string &override_)
 	navTunnelDisplayed = m_gConfig->Int("DisplayNavTunnel");
 	speedLinesDisplayed = m_gConfig->Int("SpeedLines");
 	hudTrailsDisplayed = m_gConfig->Int("HudTrails");
+	parallelCollisions = m_gConfig->Int("ParallelCollisions");
+	parallelPhysics = m_gConfig->Int("ParallelPhysics");
 }
 
 void GameConfSingleton::SetAmountBackgroundStars(const float amount)
@@ -48,6 +48,8 @@ public:
 	static void SetSpeedLinesDisplayed(bool state);
 	static bool AreHudTrailsDisplayed() { return hudTrailsDisplayed; }
 	static void SetHudTrailsDisplayed(bool state);
+	static bool AreParallelCollisionsEnabled() { return parallelCollisions; }
+	static bool IsParallelPhysicsEnabled() { return parallelPhysics; }
 
 private:
 	static std::unique_ptr<GameConfig> m_gConfig;
@@ -59,6 +61,8 @@ private:
 	static bool navTunnelDisplayed;
 	static bool speedLinesDisplayed;
 	static bool hudTrailsDisplayed;
+	static bool parallelCollisions;
+	static bool parallelPhysics;
 	static bool bRefreshBackgroundStars;
 	static float amountOfBackgroundStarsDisplayed;
 };
@@ -18,6 +18,16 @@ GameConfig::GameConfig(const map_string &override_)
 	map["UIScaleFactor"] = "1";
 	map["DetailCities"] = "1";
 	map["DetailPlanets"] = "1";
+	map["GeoPatchCache"] = "0";
+	map["GeoPatchCacheSize"] = "512"; // MB
+	map["GalaxyDiskCache"] = "1";
+	map["SectorCacheBudget"] = "64"; // MB per slave cache, 0 for no limit
+	map["StarSystemCacheBudget"] = "128"; // MB per slave cache, 0 for no limit
+	map["LazyModelLoading"] = "1";
+	map["BackgroundSave"] = "1";
+	map["SaveCompression"] = "gzip"; // gzip, gzip-parallel or lz4
+	map["AutosaveInterval"] = "60"; // real seconds between incremental autosaves, 0 for none
+	map["ModelCacheBudget"] = "256"; // MB of models loaded on demand, 0 for no limit
 	map["SfxVolume"] = "0.8";
 	map["EnableJoystick"] = "1";
 	map["InvertMouseY"] = "0";
@@ -40,6 +50,9 @@ GameConfig::GameConfig(const map_string &override_)
 	map["VSync"] = "1";
 	map["UseTextureCompression"] = "1";
 	map["WorkerThreads"] = "0";
+	map["WorkStealingJobs"] = "0";
+	map["ParallelCollisions"] = "1";
+	map["ParallelPhysics"] = "0";
 	map["SpeedLines"] = "0";
 	map["EnableCockpit"] = "0";
 	map["HudTrails"] = "0";
@@ -56,6 +69,7 @@ GameConfig::GameConfig(const map_string &override_)
 	map["EnableGLDebug"] = "0";
 	map["EnableGPUJobs"] = "1";
 	map["GL3ForwardCompatible"] = "1";
+	map["SortDraws"] = "1";
 
 	Load();
 
@@ -4,23 +4,424 @@
 
 #include "Json.h"
 #include "JsonUtils.h"
+#include "CborStream.h"
 #include "FileSystem.h"
 #include "Game.h"
 #include "GameConfSingleton.h"
 #include "GameLocator.h"
+#include "GameLog.h"
 #include "GameSaveError.h"
 #include "GZipFormat.h"
 #include "InGameViews.h"
 #include "InGameViewsLocator.h"
+#include "JobQueue.h"
+#include "Lang.h"
+#include "LuaEvent.h"
+#include "LZ4Format.h"
+#include "Pi.h"
 #include "input/Input.h"
 #include "input/InputLocator.h"
 #include "Player.h"
+#include "SaveDelta.h"
 #include "Space.h"
 #include "galaxy/StarSystem.h"
+#include "libs/StringF.h"
 #include "libs/utils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
 static const int s_saveVersion = 90;
 
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double ElapsedMs(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	enum SaveCodec {
+		CODEC_GZIP,
+		CODEC_GZIP_PARALLEL, // gzip made of DEFLATE blocks compressed on the job queue
+		CODEC_LZ4
+	};
+
+	// the uncompressed size of each block of a parallel gzip save. blocks
+	// don't share a dictionary, so smaller ones compress worse
+	const size_t SAVE_BLOCK_SIZE = 1024 * 1024;
+
+	SaveCodec GetSaveCodec()
+	{
+		const std::string name = GameConfSingleton::getInstance().String("SaveCompression");
+		if (name == "gzip-parallel")
+			return CODEC_GZIP_PARALLEL;
+		if (name == "lz4")
+			return CODEC_LZ4;
+		if (name != "gzip")
+			Output("Unknown SaveCompression '%s', using gzip\n", name.c_str());
+		return CODEC_GZIP;
+	}
+
+	const char *GetSaveCodecName(SaveCodec codec)
+	{
+		switch (codec) {
+		case CODEC_GZIP_PARALLEL: return "gzip-parallel";
+		case CODEC_LZ4: return "lz4";
+		default: return "gzip";
+		}
+	}
+
+	uint32_t GetNumSaveBlocks(SaveCodec codec, size_t size)
+	{
+		if (codec != CODEC_GZIP_PARALLEL || size == 0)
+			return 1;
+		return uint32_t((size + SAVE_BLOCK_SIZE - 1) / SAVE_BLOCK_SIZE);
+	}
+
+	// thread safe. compresses one of the blocks a save is split into (the
+	// whole of it, unless the codec is parallel gzip). the last block takes
+	// whatever is left, so a save may be put in fewer blocks than
+	// GetNumSaveBlocks says. throws the codec's CompressionFailedException
+	std::string CompressSaveBlock(SaveCodec codec, const std::string &data, uint32_t block, uint32_t numBlocks, const std::string &innerName)
+	{
+		switch (codec) {
+		case CODEC_GZIP_PARALLEL: {
+			const size_t offset = block * SAVE_BLOCK_SIZE;
+			const size_t length = block + 1 == numBlocks ? data.size() - offset : SAVE_BLOCK_SIZE;
+			return gzip::CompressDeflateBlock(data.data() + offset, length, block + 1 == numBlocks);
+		}
+		case CODEC_LZ4: {
+			size_t outSize;
+			std::unique_ptr<char[]> out = lz4::CompressLZ4(data, 0, outSize);
+			return std::string(out.get(), outSize);
+		}
+		default:
+			return gzip::CompressGZip(data, innerName);
+		}
+	}
+
+	// an incremental save is written in full again once it has had this
+	// many deltas, or once the delta gets to this share of the full size
+	const unsigned MAX_SAVE_DELTAS = 60;
+	const double MAX_SAVE_DELTA_SHARE = 0.25;
+
+	// the base each incremental save's deltas are against. only touched by
+	// the main thread
+	struct DeltaSlot {
+		std::shared_ptr<const SaveDelta::Base> base;
+		unsigned deltas;
+	};
+	std::map<std::string, DeltaSlot> s_deltaSlots;
+
+	// a snapshot of the game on its way to the disk, already encoded as
+	// CBOR. its blocks are claimed one at a time by the save jobs and by the
+	// main thread when it can't wait for the jobs any longer, and whoever
+	// compresses the last of them writes the file
+	struct SaveState {
+		enum Result {
+			SAVED,
+			OPEN_FAILED,
+			WRITE_FAILED
+		};
+
+		SaveState(std::string &&cborData_, std::vector<size_t> &&marks_, const std::string &filename_, SaveCodec codec_, const DeltaSlot *slot, double snapshotMs_) :
+			cborData(std::move(cborData_)),
+			marks(std::move(marks_)),
+			filename(filename_),
+			path(FileSystem::JoinPathBelow(GameConfSingleton::GetSaveDir(), filename_)),
+			codec(codec_),
+			incremental(slot != nullptr),
+			base(slot && slot->deltas < MAX_SAVE_DELTAS ? slot->base : nullptr),
+			isDelta(false),
+			// whether it is written in full isn't known until it's compared
+			// with the base, so incremental saves are one block
+			blocks(slot ? 1 : GetNumSaveBlocks(codec_, cborData.size())),
+			nextBlock(0),
+			blocksDone(0),
+			failed(false),
+			done(false),
+			result(SAVED),
+			size(0),
+			compressStart(Clock::now()),
+			snapshotMs(snapshotMs_),
+			compressMs(0.0),
+			writeMs(0.0),
+			reported(false) {}
+
+		void Wait() const
+		{
+			while (!done.load())
+				std::this_thread::yield();
+		}
+
+		std::string cborData;
+		std::vector<size_t> marks; // between the pieces deltas are made of
+		const std::string filename;
+		const std::string path; // below the user files
+		const SaveCodec codec;
+		const bool incremental;
+		const std::shared_ptr<const SaveDelta::Base> base; // to write a delta against, if any
+		bool isDelta; // rather than in full
+		std::shared_ptr<const SaveDelta::Base> newBase; // when an incremental save is written in full
+		std::vector<std::string> blocks; // compressed
+		std::atomic<uint32_t> nextBlock;
+		std::atomic<uint32_t> blocksDone;
+		std::atomic<bool> failed; // to compress any of the blocks
+		std::atomic<bool> done;
+		Result result;
+		size_t size; // of the file
+		const Clock::time_point compressStart;
+		double snapshotMs, compressMs, writeMs;
+		bool reported; // only touched by the main thread
+	};
+
+	// thread safe. the file is written next to the save and renamed over it
+	// once complete, so a failed save leaves the previous one in place
+	void WriteSave(SaveState &save)
+	{
+		save.compressMs = ElapsedMs(save.compressStart);
+		if (save.failed)
+			save.result = SaveState::WRITE_FAILED;
+		const std::string path = save.isDelta ? SaveDelta::GetDeltaPath(save.path) : save.path;
+
+		// parallel gzip blocks are raw DEFLATE, which the header and the
+		// footer over all of the data turn into a gzip file
+		std::string header, footer;
+		if (save.codec == CODEC_GZIP_PARALLEL) {
+			header = gzip::GZipHeader(save.filename + ".json");
+			footer = gzip::GZipFooter(save.cborData);
+		}
+		save.cborData = std::string();
+
+		Clock::time_point start = Clock::now();
+		if (save.result == SaveState::SAVED) {
+			const std::string tmpPath = path + ".tmp";
+			FILE *f = FileSystem::userFiles.OpenWriteStream(tmpPath);
+			if (!f) {
+				save.result = SaveState::OPEN_FAILED;
+			} else {
+				bool written = fwrite(header.data(), 1, header.size(), f) == header.size();
+				save.size = header.size() + footer.size();
+				for (const std::string &block : save.blocks) {
+					written = written && fwrite(block.data(), 1, block.size(), f) == block.size();
+					save.size += block.size();
+				}
+				written = written && fwrite(footer.data(), 1, footer.size(), f) == footer.size();
+				if (!((fclose(f) == 0) && written && FileSystem::userFiles.RenameFile(tmpPath, path))) {
+					FileSystem::userFiles.RemoveFile(tmpPath);
+					save.result = SaveState::WRITE_FAILED;
+				}
+			}
+		}
+		// any delta next to a save written in full is against an older base
+		if (save.result == SaveState::SAVED && !save.isDelta) {
+			const std::string deltaPath = SaveDelta::GetDeltaPath(save.path);
+			if (FileSystem::userFiles.Lookup(deltaPath).Exists())
+				FileSystem::userFiles.RemoveFile(deltaPath);
+		}
+		save.blocks.clear();
+		save.writeMs = ElapsedMs(start);
+
+		save.done = true;
+	}
+
+	// thread safe. decides whether an incremental save is written as a
+	// delta or in full, before its (only) block is compressed
+	void PrepareIncrementalSave(SaveState &save)
+	{
+		if (save.base) {
+			std::string delta = SaveDelta::MakeDelta(*save.base, save.cborData, save.marks);
+			if (delta.size() <= save.cborData.size() * MAX_SAVE_DELTA_SHARE) {
+				save.cborData = std::move(delta);
+				save.isDelta = true;
+				return;
+			}
+		}
+		// compaction: a new base, which the deltas to come are against
+		save.newBase = SaveDelta::MakeBase(save.cborData, save.marks);
+	}
+
+	// thread safe
+	void CompressBlock(SaveState &save, uint32_t block)
+	{
+		if (save.incremental)
+			PrepareIncrementalSave(save);
+		try {
+			save.blocks[block] = CompressSaveBlock(save.codec, save.cborData, block, uint32_t(save.blocks.size()), save.filename + ".json");
+		} catch (gzip::CompressionFailedException) {
+			save.failed = true;
+		} catch (lz4::CompressionFailedException &) {
+			save.failed = true;
+		}
+	}
+
+	// thread safe. works through the blocks nobody has claimed yet
+	void WorkOnSave(SaveState &save)
+	{
+		const uint32_t numBlocks = uint32_t(save.blocks.size());
+		for (uint32_t i = save.nextBlock.fetch_add(1); i < numBlocks; i = save.nextBlock.fetch_add(1)) {
+			CompressBlock(save, i);
+			if (save.blocksDone.fetch_add(1) + 1 == numBlocks)
+				WriteSave(save);
+		}
+	}
+
+	// onGameSaved(filename, error), error being nil if the save worked
+	class SaveEventArgs : public LuaEvent::ArgsBase {
+	public:
+		SaveEventArgs(const std::string &filename, const char *error) :
+			m_filename(filename),
+			m_error(error) {}
+
+		virtual void PrepareStack() const override
+		{
+			lua_State *l = Lua::manager->GetLuaState();
+			lua_pushlstring(l, m_filename.c_str(), m_filename.size());
+			if (m_error)
+				lua_pushstring(l, m_error);
+			else
+				lua_pushnil(l);
+		}
+
+	private:
+		const std::string &m_filename;
+		const char *m_error;
+	};
+
+	// called on the main thread once an incremental save is done
+	void UpdateDeltaSlot(const SaveState &save)
+	{
+		if (!save.incremental)
+			return;
+		if (save.result != SaveState::SAVED) {
+			// what's on the disk as the base isn't known for sure any more
+			if (!save.isDelta)
+				s_deltaSlots.erase(save.filename);
+		} else if (save.isDelta) {
+			s_deltaSlots[save.filename].deltas++;
+		} else {
+			s_deltaSlots[save.filename] = DeltaSlot{ save.newBase, 0 };
+		}
+	}
+
+	// called on the main thread once the save is done
+	void ReportSave(SaveState &save)
+	{
+		if (save.reported)
+			return;
+		save.reported = true;
+
+		Output("Save '%s' (%.1f KB, %s%s): snapshot %.1f ms, compress %.1f ms, write %.1f ms\n",
+			save.filename.c_str(), save.size / 1024.0, GetSaveCodecName(save.codec), save.isDelta ? ", delta" : "",
+			save.snapshotMs, save.compressMs, save.writeMs);
+		UpdateDeltaSlot(save);
+
+		const char *error = nullptr;
+		std::string message;
+		if (save.result == SaveState::OPEN_FAILED) {
+			message = stringf(Lang::COULD_NOT_OPEN_FILENAME, formatarg("path", save.path));
+			error = message.c_str();
+		} else if (save.result == SaveState::WRITE_FAILED) {
+			error = Lang::GAME_SAVE_CANNOT_WRITE;
+		}
+		if (error)
+			Output("Saving '%s' failed: %s\n", save.filename.c_str(), error);
+
+		// nobody is left to tell if the game has ended in the meantime
+		if (!GameLocator::getGame())
+			return;
+		if (error)
+			GameLocator::getGame()->GetGameLog().Add(error);
+		LuaEvent::Queue("onGameSaved", SaveEventArgs(save.filename, error));
+	}
+
+	struct PendingSave {
+		std::shared_ptr<SaveState> save;
+		std::vector<Job::Handle> jobs;
+	};
+	std::vector<PendingSave> s_pendingSaves;
+
+	void ForgetSave(const SaveState *save)
+	{
+		for (auto it = s_pendingSaves.begin(); it != s_pendingSaves.end(); ++it) {
+			if (it->save.get() == save) {
+				s_pendingSaves.erase(it);
+				return;
+			}
+		}
+	}
+
+	// one per runner that can help with the save. the one that finishes
+	// after the file is written reports it, and the others are cancelled
+	class SaveGameJob : public Job {
+	public:
+		SaveGameJob(std::shared_ptr<SaveState> save) :
+			m_save(save) {}
+
+		virtual void OnRun() override // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+		{
+			WorkOnSave(*m_save);
+		}
+
+		virtual void OnFinish() override
+		{
+			if (!m_save->done)
+				return;
+			ReportSave(*m_save);
+			ForgetSave(m_save.get());
+		}
+
+	private:
+		std::shared_ptr<SaveState> m_save;
+	};
+
+	// the decompressed contents of a file below the user files
+	std::string ReadSaveFile(const std::string &path)
+	{
+		auto file = FileSystem::userFiles.ReadFile(path);
+		if (!file)
+			throw SavedGameCorruptException();
+		try {
+			return JsonUtils::DecompressSaveFile(file->GetData(), file->GetSize());
+		} catch (gzip::DecompressionFailedException) {
+			throw SavedGameCorruptException();
+		} catch (lz4::DecompressionFailedException &) {
+			throw SavedGameCorruptException();
+		}
+	}
+
+	// the data of a save, with its delta (if it has one) applied. a delta
+	// that can't be applied is skipped, leaving the save as its base was
+	std::string ReadSaveData(const std::string &filename)
+	{
+		PROFILE_SCOPED()
+		const std::string path = FileSystem::JoinPathBelow(GameConfSingleton::GetSaveDir(), filename);
+		std::string data = ReadSaveFile(path);
+
+		const std::string deltaPath = SaveDelta::GetDeltaPath(path);
+		if (!FileSystem::userFiles.Lookup(deltaPath).Exists())
+			return data;
+		try {
+			const std::string delta = ReadSaveFile(deltaPath);
+			std::string out;
+			if (SaveDelta::ApplyDelta(data, delta.data(), delta.size(), out))
+				return out;
+			Output("Delta of saved game '%s' is against another base, ignored\n", filename.c_str());
+		} catch (CborError &e) {
+			Output("Delta of saved game '%s' is corrupt, ignored: %s\n", filename.c_str(), e.what());
+		} catch (SavedGameCorruptException) {
+			Output("Delta of saved game '%s' couldn't be read, ignored\n", filename.c_str());
+		}
+		return data;
+	}
+} // namespace
+
 void GameStateStatic::MakeNewGame(const SystemPath &path,
 		const double startDateTime,
 		const unsigned int sectorRadius_)
@@ -45,7 +446,18 @@ void GameStateStatic::MakeNewGame(const SystemPath &path,
 
 Json GameStateStatic::LoadGameToJson(const std::string &filename)
 {
-	Json rootNode = JsonUtils::LoadJsonSaveFile(FileSystem::JoinPathBelow(GameConfSingleton::GetSaveDir(), filename), FileSystem::userFiles);
+	Json rootNode;
+	try {
+		const std::string plain_data = ReadSaveData(filename);
+		// Allow loading files in JSON format as well as CBOR
+		if (!plain_data.empty() && plain_data[0] == '{')
+			rootNode = Json::parse(plain_data);
+		else
+			rootNode = Json::from_cbor(plain_data);
+	} catch (Json::parse_error &e) {
+		Output("Loading saved game '%s' failed: %s\n", filename.c_str(), e.what());
+	} catch (SavedGameCorruptException) {
+	}
 	if (!rootNode.is_object()) {
 		Output("Loading saved game '%s' failed.\n", filename.c_str());
 		throw SavedGameCorruptException();
@@ -57,10 +469,60 @@ Json GameStateStatic::LoadGameToJson(const std::string &filename)
 	return rootNode;
 }
 
+Json GameStateStatic::LoadGameInfoToJson(const std::string &filename)
+{
+	PROFILE_SCOPED()
+	std::string plain_data;
+	try {
+		plain_data = ReadSaveData(filename);
+	} catch (SavedGameCorruptException) {
+		Output("Loading saved game '%s' failed.\n", filename.c_str());
+		throw;
+	}
+
+	// saves written as JSON text have to be parsed whole anyway
+	if (plain_data.empty() || plain_data[0] == '{')
+		return LoadGameToJson(filename);
+
+	Json rootNode = Json::object();
+	try {
+		CborReader reader(plain_data.data(), plain_data.size());
+		CborReader::Item root, key, value;
+		reader.Next(root);
+		if (root.type != CborReader::MAP)
+			throw SavedGameCorruptException();
+		for (uint64_t i = 0; root.indefinite || i < root.count; i++) {
+			reader.Next(key);
+			if (key.type == CborReader::BREAK && root.indefinite)
+				break;
+			reader.Next(value);
+			if (key.str == "version" || key.str == "time" || key.str == "game_info")
+				rootNode[key.str] = reader.ReadJson(value);
+			else
+				reader.Skip(value);
+		}
+	} catch (CborError &e) {
+		Output("Loading saved game '%s' failed: %s\n", filename.c_str(), e.what());
+		throw SavedGameCorruptException();
+	}
+
+	if (!rootNode["version"].is_number_integer() || rootNode["version"].get<int>() != s_saveVersion) {
+		Output("Loading saved game '%s' failed: wrong save file version.\n", filename.c_str());
+		throw SavedGameCorruptException();
+	}
+	// older saves have none, and their info has to be dug out of the rest
+	if (!rootNode["game_info"].is_object())
+		return LoadGameToJson(filename);
+	return rootNode;
+}
+
 void GameStateStatic::LoadGame(const std::string &filename)
 {
 	Output("Game::LoadGame('%s')\n", filename.c_str());
 
+	// it may be the very file that is still being written
+	FinishSaves();
+
 	Json rootNode = LoadGameToJson(filename);
 
 	try {
@@ -103,7 +565,7 @@ bool GameStateStatic::CanLoadGame(const std::string &filename)
 	// file data is freed here
 }
 
-void GameStateStatic::SaveGame(const std::string &filename)
+void GameStateStatic::SaveGame(const std::string &filename, bool incremental)
 {
 	PROFILE_SCOPED()
 
@@ -128,37 +590,176 @@ void GameStateStatic::SaveGame(const std::string &filename)
 	Profiler::reset();
 #endif
 
-	Json rootNode; // Create the root JSON value for receiving the game data.
-
-	// version
-	rootNode["version"] = s_saveVersion;
+	// an earlier save to the same file has to land first
+	FinishSaves(&filename);
 
-	game->ToJson(rootNode); // Encode the game data as JSON and give to the root value.
-	InGameViewsLocator::SaveInGameViews(rootNode);
+	// the game is encoded straight to CBOR, as it is walked, rather than
+	// built up as a Json tree and converted after
+	Clock::time_point start = Clock::now();
+	CborWriter writer;
+	writer.BeginMap();
 
-	std::vector<uint8_t> jsonData;
-	{
-		PROFILE_SCOPED_DESC("json.to_cbor");
-		jsonData = Json::to_cbor(rootNode); // Convert the JSON data to CBOR.
+	// version
+	writer.Key("version");
+	writer.Int(s_saveVersion);
+	writer.Mark();
+
+	game->ToCbor(writer);
+
+	Json viewsNode = Json::object();
+	InGameViewsLocator::SaveInGameViews(viewsNode);
+	writer.Entries(viewsNode);
+
+	writer.End();
+
+	// a save that isn't incremental leaves nothing to make deltas against
+	DeltaSlot slot = { nullptr, 0 };
+	if (incremental) {
+		auto it = s_deltaSlots.find(filename);
+		if (it != s_deltaSlots.end())
+			slot = it->second;
+	} else {
+		s_deltaSlots.erase(filename);
 	}
 
-	FILE *f = FileSystem::userFiles.OpenWriteStream(FileSystem::JoinPathBelow(GameConfSingleton::GetSaveDir(), filename));
-	if (!f) throw CouldNotOpenFileException();
-
-	try {
-		// Compress the CBOR data.
-		const std::string comressed_data = gzip::CompressGZip(
-			std::string(reinterpret_cast<const char *>(jsonData.data()), jsonData.size()),
-			filename + ".json");
-		size_t nwritten = fwrite(comressed_data.data(), comressed_data.size(), 1, f);
-		fclose(f);
-		if (nwritten != 1) throw CouldNotWriteToFileException();
-	} catch (gzip::CompressionFailedException) {
-		fclose(f);
-		throw CouldNotWriteToFileException();
+	std::vector<size_t> marks = writer.TakeMarks();
+	std::shared_ptr<SaveState> save = std::make_shared<SaveState>(writer.TakeData(), std::move(marks), filename, GetSaveCodec(), incremental ? &slot : nullptr, ElapsedMs(start));
+
+	JobQueue *queue = Pi::GetAsyncJobQueue();
+	if (queue && GameConfSingleton::getInstance().Int("BackgroundSave")) {
+		PendingSave pending;
+		pending.save = save;
+		const uint32_t numJobs = std::max(1U, std::min(queue->GetNumRunners(), uint32_t(save->blocks.size())));
+		for (uint32_t i = 0; i < numJobs; i++)
+			pending.jobs.push_back(queue->Queue(new SaveGameJob(save)));
+		s_pendingSaves.push_back(std::move(pending));
+	} else {
+		// the runners can still help with the blocks of a parallel gzip
+		ParallelFor(queue, uint32_t(save->blocks.size()), [&save](uint32_t i) {
+			CompressBlock(*save, i);
+		});
+		WriteSave(*save);
+		// the caller hears about failures right away
+		if (save->result != SaveState::SAVED)
+			UpdateDeltaSlot(*save);
+		if (save->result == SaveState::OPEN_FAILED)
+			throw CouldNotOpenFileException();
+		if (save->result == SaveState::WRITE_FAILED)
+			throw CouldNotWriteToFileException();
+		ReportSave(*save);
 	}
 
 #ifdef PIONEER_PROFILER
 	Profiler::dumphtml(profilerPath.c_str());
 #endif
 }
+
+void GameStateStatic::FinishSaves(const std::string *filename)
+{
+	PROFILE_SCOPED()
+	std::vector<PendingSave> pending;
+	for (auto it = s_pendingSaves.begin(); it != s_pendingSaves.end();) {
+		if (!filename || it->save->filename == *filename) {
+			pending.push_back(std::move(*it));
+			it = s_pendingSaves.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	for (PendingSave &p : pending) {
+		// whatever the jobs haven't started on yet is quicker done here
+		WorkOnSave(*p.save);
+		p.save->Wait();
+		ReportSave(*p.save);
+	}
+}
+
+std::vector<GameStateStatic::CodecBenchmark> GameStateStatic::BenchmarkSaveCompression(const std::string &filename)
+{
+	PROFILE_SCOPED()
+	auto file = FileSystem::userFiles.ReadFile(FileSystem::JoinPathBelow(GameConfSingleton::GetSaveDir(), filename));
+	if (!file)
+		throw CouldNotOpenFileException();
+
+	std::string data;
+	try {
+		data = JsonUtils::DecompressSaveFile(file->GetData(), file->GetSize());
+	} catch (gzip::DecompressionFailedException) {
+		throw SavedGameCorruptException();
+	} catch (lz4::DecompressionFailedException &) {
+		throw SavedGameCorruptException();
+	}
+	file.Reset();
+
+	// what the blocks of a save are written in the file with
+	auto assemble = [&](SaveCodec codec, const std::vector<std::string> &blocks, const std::string &uncompressed) {
+		std::string compressed;
+		if (codec == CODEC_GZIP_PARALLEL)
+			compressed = gzip::GZipHeader(filename + ".json");
+		for (const std::string &block : blocks)
+			compressed += block;
+		if (codec == CODEC_GZIP_PARALLEL)
+			compressed += gzip::GZipFooter(uncompressed);
+		return compressed;
+	};
+
+	std::vector<CodecBenchmark> results;
+	const double megabytes = data.size() / (1024.0 * 1024.0);
+	const SaveCodec codecs[] = { CODEC_GZIP, CODEC_GZIP_PARALLEL, CODEC_LZ4 };
+	for (SaveCodec codec : codecs) {
+		const uint32_t numBlocks = GetNumSaveBlocks(codec, data.size());
+		std::vector<std::string> blocks(numBlocks);
+
+		Clock::time_point start = Clock::now();
+		std::atomic<bool> failed(false);
+		ParallelFor(Pi::GetAsyncJobQueue(), numBlocks, [&](uint32_t i) {
+			try {
+				blocks[i] = CompressSaveBlock(codec, data, i, numBlocks, filename + ".json");
+			} catch (gzip::CompressionFailedException) {
+				failed = true;
+			} catch (lz4::CompressionFailedException &) {
+				failed = true;
+			}
+		});
+		if (failed)
+			throw CouldNotWriteToFileException();
+		const std::string compressed = assemble(codec, blocks, data);
+		const double compressMs = ElapsedMs(start);
+
+		start = Clock::now();
+		const std::string decompressed = JsonUtils::DecompressSaveFile(compressed.data(), compressed.size());
+		const double decompressMs = ElapsedMs(start);
+		if (decompressed != data)
+			Output("Save compression benchmark: %s didn't give back the data\n", GetSaveCodecName(codec));
+
+		CodecBenchmark result;
+		result.codec = GetSaveCodecName(codec);
+		result.compressMBps = megabytes / std::max(compressMs / 1000.0, 1e-6);
+		result.decompressMBps = megabytes / std::max(decompressMs / 1000.0, 1e-6);
+		result.ratio = compressed.empty() ? 0.0 : double(data.size()) / compressed.size();
+		results.push_back(result);
+
+		Output("Save compression benchmark '%s' (%.1f MB): %s compress %.1f MB/s, decompress %.1f MB/s, ratio %.2f\n",
+			filename.c_str(), megabytes, result.codec.c_str(), result.compressMBps, result.decompressMBps, result.ratio);
+
+		// incremental saves are one block whatever their size, in full or
+		// as a delta
+		const std::shared_ptr<SaveDelta::Base> base = SaveDelta::MakeBase(data, std::vector<size_t>());
+		const std::string delta = SaveDelta::MakeDelta(*base, data, std::vector<size_t>());
+		const std::string *payloads[] = { &data, &delta };
+		for (const std::string *payload : payloads) {
+			const std::string compressed = assemble(codec, { CompressSaveBlock(codec, *payload, 0, 1, filename + ".json") }, *payload);
+			std::string restored = JsonUtils::DecompressSaveFile(compressed.data(), compressed.size());
+			if (payload == &delta) {
+				std::string applied;
+				if (!SaveDelta::ApplyDelta(data, restored.data(), restored.size(), applied))
+					applied.clear();
+				restored = std::move(applied);
+			}
+			if (restored != data)
+				Output("Save compression benchmark: incremental %s%s didn't give back the data\n", GetSaveCodecName(codec), payload == &delta ? " delta" : "");
+		}
+	}
+	return results;
+}
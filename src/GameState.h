@@ -3,6 +3,7 @@
 
 #include "JsonFwd.h"
 #include <string>
+#include <vector>
 
 class SystemPath;
 
@@ -18,10 +19,34 @@ public:
 			const unsigned int cacheRadius = sectorRadius);
 
 	static Json LoadGameToJson(const std::string &filename);
+	// only the version, time and game_info of a save, for showing it in a
+	// list. the rest of the file is passed over rather than decoded
+	static Json LoadGameInfoToJson(const std::string &filename);
 	// LoadGame and SaveGame throw exceptions on failure
 	static void LoadGame(const std::string &filename);
 	static bool CanLoadGame(const std::string &filename);
-	static void SaveGame(const std::string &filename);
+	// an incremental save is only written in full now and then, and in
+	// between as a delta against that (see SaveDelta). LoadGame puts the
+	// two back together.
+	// with BackgroundSave in the config only the snapshot of the game is
+	// taken here, and compressing and writing it are left to the async job
+	// queue (as many of its runners as the SaveCompression codec can keep
+	// busy). failures to write are then reported by the
+	// onGameSaved Lua event and the game log rather than by exceptions
+	static void SaveGame(const std::string &filename, bool incremental = false);
+	// waits for the saves (to the file, or all of them) that are still being
+	// written in the background
+	static void FinishSaves(const std::string *filename = nullptr);
+
+	struct CodecBenchmark {
+		std::string codec;
+		double compressMBps; // of uncompressed data
+		double decompressMBps;
+		double ratio; // uncompressed size over compressed
+	};
+	// compresses and decompresses the data of an existing save with each of
+	// the codecs SaveCompression can be set to
+	static std::vector<CodecBenchmark> BenchmarkSaveCompression(const std::string &filename);
 
 protected:
 
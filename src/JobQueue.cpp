@@ -5,6 +5,12 @@
 
 #include "libs/StringF.h"
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "SDL_timer.h"
+
 void Job::UnlinkHandle()
 {
 	if (m_handle)
@@ -90,6 +96,98 @@ Job::Handle::~Handle()
 	}
 }
 
+void Job::Handle::SetPriority(double priority)
+{
+	if (m_job && m_queue)
+		m_queue->SetPriority(m_job, priority);
+}
+
+void JobPriorityQueue::Push(Job *job)
+{
+	job->m_sequence = ++m_sequence;
+	if (job->m_deadline) {
+		job->m_deadline += m_frame;
+		m_deadlines++;
+		m_nextDue = std::min(m_nextDue, job->m_deadline);
+	}
+	m_heap.push_back(job);
+	if (!m_dirty)
+		std::push_heap(m_heap.begin(), m_heap.end(), [this](const Job *a, const Job *b) { return RunsAfter(a, b); });
+}
+
+Job *JobPriorityQueue::Pop()
+{
+	if (m_heap.empty())
+		return nullptr;
+	if (m_dirty)
+		Heapify();
+
+	std::pop_heap(m_heap.begin(), m_heap.end(), [this](const Job *a, const Job *b) { return RunsAfter(a, b); });
+	Job *job = m_heap.back();
+	m_heap.pop_back();
+	if (job->m_deadline)
+		m_deadlines--;
+	return job;
+}
+
+bool JobPriorityQueue::Remove(Job *job)
+{
+	std::vector<Job *>::iterator it = std::find(m_heap.begin(), m_heap.end(), job);
+	if (it == m_heap.end())
+		return false;
+
+	// swap in the last one, the heap gets rebuilt before the next Pop
+	*it = m_heap.back();
+	m_heap.pop_back();
+	if (job->m_deadline)
+		m_deadlines--;
+	m_dirty = true;
+	return true;
+}
+
+void JobPriorityQueue::SetPriority(Job *job, double priority)
+{
+	if (job->m_priority == priority)
+		return;
+	job->m_priority = priority;
+	m_dirty = true;
+}
+
+void JobPriorityQueue::NextFrame()
+{
+	m_frame++;
+	// a job becoming overdue changes the order
+	if (m_deadlines && m_frame >= m_nextDue)
+		m_dirty = true;
+}
+
+bool JobPriorityQueue::RunsAfter(const Job *a, const Job *b) const
+{
+	const bool aOverdue = a->m_deadline && a->m_deadline <= m_frame;
+	const bool bOverdue = b->m_deadline && b->m_deadline <= m_frame;
+	if (aOverdue != bOverdue)
+		return bOverdue;
+	if (aOverdue && a->m_deadline != b->m_deadline)
+		return a->m_deadline > b->m_deadline;
+	if (a->m_priority != b->m_priority)
+		return a->m_priority > b->m_priority;
+	return a->m_sequence > b->m_sequence;
+}
+
+void JobPriorityQueue::Heapify()
+{
+	std::make_heap(m_heap.begin(), m_heap.end(), [this](const Job *a, const Job *b) { return RunsAfter(a, b); });
+	m_dirty = false;
+
+	m_nextDue = UINT32_MAX;
+	if (m_deadlines) {
+		for (const Job *job : m_heap) {
+			if (job->m_deadline > m_frame)
+				m_nextDue = std::min(m_nextDue, job->m_deadline);
+		}
+	}
+}
+
 AsyncJobQueue::AsyncJobQueue(uint32_t numRunners) :
 	m_shutdown(false)
 {
@@ -132,8 +230,8 @@ AsyncJobQueue::~AsyncJobQueue()
 		delete (*i);
 
 	// delete any remaining jobs
-	for (std::deque<Job *>::iterator i = m_queue.begin(); i != m_queue.end(); ++i)
-		delete (*i);
+	while (Job *job = m_queue.Pop())
+		delete job;
 	for (uint32_t threadIdx = 0; threadIdx < numThreads; threadIdx++) {
 		for (std::deque<Job *>::iterator i = m_finished[threadIdx].begin(); i != m_finished[threadIdx].end(); ++i) {
 			delete (*i);
@@ -154,7 +252,7 @@ Job::Handle AsyncJobQueue::Queue(Job *job, JobClient *client)
 
 	// push the job onto the queue
 	SDL_LockMutex(m_queueLock);
-	m_queue.push_back(job);
+	m_queue.Push(job);
 	SDL_UnlockMutex(m_queueLock);
 
 	// and tell a waiting runner that there's one available
@@ -176,14 +274,13 @@ Job *AsyncJobQueue::GetJob()
 			return 0;
 		}
 
-		if (!m_queue.size())
+		if (m_queue.Empty())
 			// no jobs, go to sleep until one arrives
 			SDL_CondWait(m_queueWaitCond, m_queueLock);
 
 		else {
-			// got one, pop it and return it
-			job = m_queue.front();
-			m_queue.pop_front();
+			// got one, pop the most urgent and return it
+			job = m_queue.Pop();
 		}
 	}
 
@@ -206,6 +303,10 @@ uint32_t AsyncJobQueue::FinishJobs()
 	PROFILE_SCOPED()
 	uint32_t finished = 0;
 
+	SDL_LockMutex(m_queueLock);
+	m_queue.NextFrame();
+	SDL_UnlockMutex(m_queueLock);
+
 	const uint32_t numRunners = m_runners.size();
 	for (uint32_t i = 0; i < numRunners; ++i) {
 		SDL_LockMutex(m_finishedLock[i]);
@@ -242,12 +343,9 @@ void AsyncJobQueue::Cancel(Job *job)
 	}
 
 	// check the waiting list. if its there then it hasn't run yet. just forget about it
-	for (std::deque<Job *>::iterator i = m_queue.begin(); i != m_queue.end(); ++i) {
-		if (*i == job) {
-			i = m_queue.erase(i);
-			delete job;
-			goto unlock;
-		}
+	if (m_queue.Remove(job)) {
+		delete job;
+		goto unlock;
 	}
 
 	// check the finshed list. if its there then it can't be cancelled, because
@@ -274,6 +372,13 @@ unlock:
 	SDL_UnlockMutex(m_queueLock);
 }
 
+void AsyncJobQueue::SetPriority(Job *job, double priority)
+{
+	SDL_LockMutex(m_queueLock);
+	m_queue.SetPriority(job, priority);
+	SDL_UnlockMutex(m_queueLock);
+}
+
 AsyncJobQueue::JobRunner::JobRunner(AsyncJobQueue *jq, const uint8_t idx) :
 	m_jobQueue(jq),
 	m_job(0),
@@ -369,10 +474,438 @@ void AsyncJobQueue::JobRunner::SetQueueDestroyed()
 	m_queueDestroyed = true;
 }
 
+WorkStealingJobQueue::WorkDeque::WorkDeque() :
+	m_top(0),
+	m_bottom(0)
+{
+	for (std::atomic<Job *> &slot : m_jobs)
+		slot.store(nullptr, std::memory_order_relaxed);
+}
+
+bool WorkStealingJobQueue::WorkDeque::Push(Job *job)
+{
+	const int64_t b = m_bottom.load(std::memory_order_relaxed);
+	const int64_t t = m_top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY)
+		return false;
+	m_jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job *WorkStealingJobQueue::WorkDeque::Pop()
+{
+	const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = m_top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		// empty
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job *job = m_jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		// last one left, race the thieves for it
+		if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job *WorkStealingJobQueue::WorkDeque::Steal()
+{
+	int64_t t = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t b = m_bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return nullptr;
+
+	Job *job = m_jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+	return job;
+}
+
+uint32_t WorkStealingJobQueue::WorkDeque::Size() const
+{
+	const int64_t size = m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed);
+	return size > 0 ? uint32_t(size) : 0;
+}
+
+WorkStealingJobQueue::WorkStealingJobQueue(uint32_t numRunners) :
+	m_injectionSize(0),
+	m_sleeping(0),
+	m_shutdown(false)
+{
+	numRunners = std::min(std::max(numRunners, 1U), MAX_THREADS);
+
+	m_injectionLock = SDL_CreateMutex();
+	m_injectionWaitCond = SDL_CreateCond();
+
+	// all the runners have to exist before any of them goes looking for a victim
+	for (uint32_t i = 0; i < numRunners; i++)
+		m_finishedLock[i] = SDL_CreateMutex();
+	SDL_LockMutex(m_injectionLock);
+	for (uint32_t i = 0; i < numRunners; i++)
+		m_runners.push_back(new JobRunner(this, i));
+	SDL_UnlockMutex(m_injectionLock);
+}
+
+WorkStealingJobQueue::~WorkStealingJobQueue()
+{
+	// flag shutdown and wake everyone up so they notice
+	SDL_LockMutex(m_injectionLock);
+	m_shutdown = true;
+	SDL_CondBroadcast(m_injectionWaitCond);
+	SDL_UnlockMutex(m_injectionLock);
+
+	// ask the running jobs to return as soon as possible, then wait for the
+	// threads. a runner always returns its last job to its finish queue, so
+	// everything left over can be found below
+	for (JobRunner *runner : m_runners)
+		runner->CancelRunningJob();
+	for (JobRunner *runner : m_runners)
+		runner->Join();
+
+	// delete any remaining jobs
+	while (Job *job = m_injection.Pop())
+		delete job;
+	const uint32_t numThreads = m_runners.size();
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; threadIdx++) {
+		while (Job *job = m_runners[threadIdx]->GetDeque().Pop())
+			delete job;
+		for (Job *job : m_finished[threadIdx])
+			delete job;
+	}
+
+	for (JobRunner *runner : m_runners)
+		delete runner;
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; threadIdx++)
+		SDL_DestroyMutex(m_finishedLock[threadIdx]);
+	SDL_DestroyCond(m_injectionWaitCond);
+	SDL_DestroyMutex(m_injectionLock);
+}
+
+Job::Handle WorkStealingJobQueue::Queue(Job *job, JobClient *client)
+{
+	Job::Handle handle(job, this, client);
+
+	SDL_LockMutex(m_injectionLock);
+	m_injection.Push(job);
+	m_injectionSize.store(m_injection.Size(), std::memory_order_relaxed);
+	// only bother the condition if somebody is actually waiting on it
+	if (m_sleeping)
+		SDL_CondSignal(m_injectionWaitCond);
+	SDL_UnlockMutex(m_injectionLock);
+
+	return handle;
+}
+
+// called by a runner to get its next job. blocks until there is one, returns
+// nullptr when the queue is shutting down
+Job *WorkStealingJobQueue::GetJob(const uint8_t threadIdx, uint32_t &rng)
+{
+	JobRunner *self = m_runners[threadIdx];
+	while (!m_shutdown.load(std::memory_order_relaxed)) {
+		if (Job *job = self->GetDeque().Pop())
+			return job;
+		if (Job *job = TakeInjected(threadIdx))
+			return job;
+		if (Job *job = StealJob(threadIdx, rng))
+			return job;
+
+		// nothing anywhere, sleep until the main thread queues something or
+		// another runner has spare work in its deque. runners only fill their
+		// deques in TakeInjected while holding the injection lock, so a batch
+		// that arrived after our failed steal shows up in the rescan below;
+		// anything later sees us in m_sleeping and signals
+		SDL_LockMutex(m_injectionLock);
+		if (m_injection.Empty() && !AnyDequeHasWork() && !m_shutdown.load(std::memory_order_relaxed)) {
+			const Uint64 start = SDL_GetPerformanceCounter();
+			m_sleeping++;
+			SDL_CondWait(m_injectionWaitCond, m_injectionLock);
+			m_sleeping--;
+			self->m_idleTicks.fetch_add(SDL_GetPerformanceCounter() - start, std::memory_order_relaxed);
+		}
+		SDL_UnlockMutex(m_injectionLock);
+	}
+	return nullptr;
+}
+
+// move a share of the injection queue into the runner's own deque, so the
+// lock is taken once per batch rather than once per job
+Job *WorkStealingJobQueue::TakeInjected(const uint8_t threadIdx)
+{
+	if (!m_injectionSize.load(std::memory_order_relaxed))
+		return nullptr;
+
+	JobRunner *self = m_runners[threadIdx];
+	SDL_LockMutex(m_injectionLock);
+	if (m_injection.Empty()) {
+		SDL_UnlockMutex(m_injectionLock);
+		return nullptr;
+	}
+
+	const size_t share = (m_injection.Size() + m_runners.size() - 1) / m_runners.size();
+	const size_t batch = std::min<size_t>(share, WorkDeque::CAPACITY / 2);
+
+	Job *jobs[WorkDeque::CAPACITY / 2];
+	for (size_t i = 0; i < batch; i++)
+		jobs[i] = m_injection.Pop();
+
+	// the runner pops from the bottom, so push the least urgent first to
+	// keep the queue's order for its own jobs
+	for (size_t i = batch - 1; i > 0; --i) {
+		if (!self->GetDeque().Push(jobs[i]))
+			Error("WorkStealingJobQueue: runner deque overflow\n");
+	}
+	Job *job = jobs[0];
+	m_injectionSize.store(m_injection.Size(), std::memory_order_relaxed);
+
+	// there's now something to steal, let a sleeper have a go
+	if (m_sleeping && (batch > 1 || !m_injection.Empty()))
+		SDL_CondSignal(m_injectionWaitCond);
+	SDL_UnlockMutex(m_injectionLock);
+
+	self->m_injected.fetch_add(batch, std::memory_order_relaxed);
+	return job;
+}
+
+// must be called with the injection lock held
+bool WorkStealingJobQueue::AnyDequeHasWork() const
+{
+	for (const JobRunner *runner : m_runners) {
+		if (runner->GetDeque().Size())
+			return true;
+	}
+	return false;
+}
+
+// try every other runner once, starting from a random one
+Job *WorkStealingJobQueue::StealJob(const uint8_t threadIdx, uint32_t &rng)
+{
+	const uint32_t numRunners = m_runners.size();
+	JobRunner *self = m_runners[threadIdx];
+	if (numRunners < 2)
+		return nullptr;
+
+	// xorshift32, good enough for picking victims
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+
+	const uint32_t first = rng % numRunners;
+	for (uint32_t i = 0; i < numRunners; i++) {
+		const uint32_t victim = (first + i) % numRunners;
+		if (victim == threadIdx)
+			continue;
+		if (Job *job = m_runners[victim]->GetDeque().Steal()) {
+			self->m_steals.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	self->m_failedSteals.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+}
+
+// called by the runner when a job completes (or was found cancelled)
+void WorkStealingJobQueue::Finish(Job *job, const uint8_t threadIdx)
+{
+	SDL_LockMutex(m_finishedLock[threadIdx]);
+	m_finished[threadIdx].push_back(job);
+	SDL_UnlockMutex(m_finishedLock[threadIdx]);
+}
+
+// call OnFinish methods for completed jobs, and clean up
+uint32_t WorkStealingJobQueue::FinishJobs()
+{
+	PROFILE_SCOPED()
+	uint32_t finished = 0;
+
+	SDL_LockMutex(m_injectionLock);
+	m_injection.NextFrame();
+	SDL_UnlockMutex(m_injectionLock);
+
+	const uint32_t numRunners = m_runners.size();
+	for (uint32_t i = 0; i < numRunners; ++i) {
+		SDL_LockMutex(m_finishedLock[i]);
+		if (m_finished[i].empty()) {
+			SDL_UnlockMutex(m_finishedLock[i]);
+			continue;
+		}
+		Job *job = m_finished[i].front();
+		m_finished[i].pop_front();
+		SDL_UnlockMutex(m_finishedLock[i]);
+
+		assert(job);
+
+		// if its already been cancelled then its taken care of, so we just forget about it
+		if (!job->cancelled) {
+			job->UnlinkHandle();
+			job->OnFinish();
+			finished++;
+		}
+
+		delete job;
+	}
+
+	return finished;
+}
+
+void WorkStealingJobQueue::Cancel(Job *job)
+{
+	// lock the injection queue and all the finish queues, so nothing can move
+	// into or out of them while we look
+	SDL_LockMutex(m_injectionLock);
+	const uint32_t numRunners = m_runners.size();
+	for (uint32_t i = 0; i < numRunners; ++i) {
+		SDL_LockMutex(m_finishedLock[i]);
+	}
+
+	// still in the injection queue, just forget about it
+	if (m_injection.Remove(job)) {
+		m_injectionSize.store(m_injection.Size(), std::memory_order_relaxed);
+		delete job;
+		goto unlock;
+	}
+
+	// check the finshed list. if its there then it can't be cancelled, because
+	// its alread finished! we remove it because the caller is saying "I don't care"
+	for (uint32_t iRunner = 0; iRunner < numRunners; ++iRunner) {
+		for (std::deque<Job *>::iterator i = m_finished[iRunner].begin(); i != m_finished[iRunner].end(); ++i) {
+			if (*i == job) {
+				m_finished[iRunner].erase(i);
+				delete job;
+				goto unlock;
+			}
+		}
+	}
+
+	job->cancelled = true;
+	job->UnlinkHandle();
+	if (job->m_claimed.exchange(true)) {
+		// a runner has it, so we have to tell it to cancel
+		job->OnCancel();
+	}
+	// otherwise it's sitting in a runner's deque. the runner will see it was
+	// claimed and pass it straight to its finish queue without running it
+
+unlock:
+	for (uint32_t i = 0; i < numRunners; ++i) {
+		SDL_UnlockMutex(m_finishedLock[i]);
+	}
+	SDL_UnlockMutex(m_injectionLock);
+}
+
+void WorkStealingJobQueue::SetPriority(Job *job, double priority)
+{
+	SDL_LockMutex(m_injectionLock);
+	m_injection.SetPriority(job, priority);
+	SDL_UnlockMutex(m_injectionLock);
+}
+
+WorkStealingJobQueue::Stats WorkStealingJobQueue::GetStats() const
+{
+	Stats stats = {};
+	Uint64 idleTicks = 0;
+	stats.queueDepth = m_injectionSize.load(std::memory_order_relaxed);
+	for (JobRunner *runner : m_runners) {
+		stats.steals += runner->m_steals.load(std::memory_order_relaxed);
+		stats.failedSteals += runner->m_failedSteals.load(std::memory_order_relaxed);
+		stats.injected += runner->m_injected.load(std::memory_order_relaxed);
+		idleTicks += runner->m_idleTicks.load(std::memory_order_relaxed);
+		stats.queueDepth += runner->GetDeque().Size();
+	}
+	stats.idleMicroseconds = idleTicks * 1000000 / SDL_GetPerformanceFrequency();
+	return stats;
+}
+
+WorkStealingJobQueue::JobRunner::JobRunner(WorkStealingJobQueue *jq, const uint8_t idx) :
+	m_steals(0),
+	m_failedSteals(0),
+	m_injected(0),
+	m_idleTicks(0),
+	m_jobQueue(jq),
+	m_job(nullptr),
+	m_threadIdx(idx),
+	m_rng(2654435761U * (idx + 1))
+{
+	m_threadName = stringf("Thread %0{d}", m_threadIdx);
+	m_jobLock = SDL_CreateMutex();
+	m_threadId = SDL_CreateThread(&JobRunner::Trampoline, m_threadName.c_str(), this);
+}
+
+WorkStealingJobQueue::JobRunner::~JobRunner()
+{
+	SDL_DestroyMutex(m_jobLock);
+}
+
+// if we have a job running, cancel it. the runner will still return it to
+// its finish queue, where the queue destructor will delete it
+void WorkStealingJobQueue::JobRunner::CancelRunningJob()
+{
+	SDL_LockMutex(m_jobLock);
+	if (m_job) {
+		m_job->UnlinkHandle();
+		m_job->OnCancel();
+	}
+	SDL_UnlockMutex(m_jobLock);
+}
+
+void WorkStealingJobQueue::JobRunner::Join()
+{
+	SDL_WaitThread(m_threadId, nullptr);
+	m_threadId = nullptr;
+}
+
+// entry point for SDL thread. we simply get back onto a method. convenience mostly
+int WorkStealingJobQueue::JobRunner::Trampoline(void *data)
+{
+	JobRunner *jr = static_cast<JobRunner *>(data);
+	jr->Main();
+	return 0;
+}
+
+void WorkStealingJobQueue::JobRunner::Main()
+{
+	// wait for the queue to finish creating the other runners
+	SDL_LockMutex(m_jobQueue->m_injectionLock);
+	SDL_UnlockMutex(m_jobQueue->m_injectionLock);
+
+	while (Job *job = m_jobQueue->GetJob(m_threadIdx, m_rng)) {
+		// cancelled while it was waiting in a deque, don't run it
+		if (job->m_claimed.exchange(true)) {
+			m_jobQueue->Finish(job, m_threadIdx);
+			continue;
+		}
+
+		// record the job so we can cancel it in case of premature shutdown
+		SDL_LockMutex(m_jobLock);
+		m_job = job;
+		SDL_UnlockMutex(m_jobLock);
+
+		// run the thing
+		job->OnRun();
+
+		// forget it before handing it over, the main thread may delete it
+		// as soon as it's in the finish queue
+		SDL_LockMutex(m_jobLock);
+		m_job = nullptr;
+		SDL_UnlockMutex(m_jobLock);
+
+		m_jobQueue->Finish(job, m_threadIdx);
+	}
+}
+
 SyncJobQueue::~SyncJobQueue()
 {
 	// delete any remaining jobs
-	for (Job *j : m_queue)
+	while (Job *j = m_queue.Pop())
 		delete j;
 	for (Job *j : m_finished)
 		delete j;
@@ -381,7 +914,7 @@ SyncJobQueue::~SyncJobQueue()
 Job::Handle SyncJobQueue::Queue(Job *job, JobClient *client)
 {
 	Job::Handle handle(job, this, client);
-	m_queue.push_back(job);
+	m_queue.Push(job);
 	return handle;
 }
 
@@ -391,6 +924,8 @@ uint32_t SyncJobQueue::FinishJobs()
 	PROFILE_SCOPED()
 	uint32_t finished = 0;
 
+	m_queue.NextFrame();
+
 	while (!m_finished.empty()) {
 		Job *job = m_finished.front();
 		m_finished.pop_front();
@@ -410,12 +945,9 @@ uint32_t SyncJobQueue::FinishJobs()
 void SyncJobQueue::Cancel(Job *job)
 {
 	// check the waiting list. if its there then it hasn't run yet. just forget about it
-	for (std::deque<Job *>::iterator i = m_queue.begin(); i != m_queue.end(); ++i) {
-		if (*i == job) {
-			i = m_queue.erase(i);
-			delete job;
-			return;
-		}
+	if (m_queue.Remove(job)) {
+		delete job;
+		return;
 	}
 
 	// check the finshed list. if its there then it can't be cancelled, because
@@ -434,19 +966,117 @@ void SyncJobQueue::Cancel(Job *job)
 	job->OnCancel();
 }
 
+void SyncJobQueue::SetPriority(Job *job, double priority)
+{
+	m_queue.SetPriority(job, priority);
+}
+
 uint32_t SyncJobQueue::RunJobs(uint32_t count)
 {
 	uint32_t executed = 0;
 	assert(count >= 1);
 	for (uint32_t i = 0; i < count; ++i) {
-		if (m_queue.empty())
+		if (m_queue.Empty())
 			break;
 
-		Job *job = m_queue.front();
-		m_queue.pop_front();
+		Job *job = m_queue.Pop();
 		job->OnRun();
 		executed++;
 		m_finished.push_back(job);
 	}
 	return executed;
 }
+
+namespace {
+	// shared between ParallelFor and its jobs. jobs that only get to run
+	// after ParallelFor has returned find nothing left to do, so they can
+	// outlive the call
+	class ParallelForState {
+	public:
+		ParallelForState(uint32_t count, const std::function<void(uint32_t)> &fn) :
+			m_next(0),
+			m_done(0),
+			m_count(count),
+			m_fn(fn)
+		{
+			m_doneLock = SDL_CreateMutex();
+			m_doneCond = SDL_CreateCond();
+		}
+
+		~ParallelForState()
+		{
+			SDL_DestroyCond(m_doneCond);
+			SDL_DestroyMutex(m_doneLock);
+		}
+
+		void Work()
+		{
+			uint32_t completed = 0;
+			for (uint32_t i = m_next.fetch_add(1); i < m_count; i = m_next.fetch_add(1)) {
+				m_fn(i);
+				completed++;
+			}
+			if (completed && m_done.fetch_add(completed) + completed == m_count) {
+				SDL_LockMutex(m_doneLock);
+				SDL_CondSignal(m_doneCond);
+				SDL_UnlockMutex(m_doneLock);
+			}
+		}
+
+		void Wait()
+		{
+			SDL_LockMutex(m_doneLock);
+			while (m_done.load() < m_count)
+				SDL_CondWait(m_doneCond, m_doneLock);
+			SDL_UnlockMutex(m_doneLock);
+		}
+
+	private:
+		std::atomic<uint32_t> m_next;
+		std::atomic<uint32_t> m_done;
+		const uint32_t m_count;
+		std::function<void(uint32_t)> m_fn;
+		SDL_mutex *m_doneLock;
+		SDL_cond *m_doneCond;
+	};
+
+	class ParallelForJob : public Job {
+	public:
+		ParallelForJob(const std::shared_ptr<ParallelForState> &state) :
+			m_state(state) {}
+
+		virtual void OnRun() override { m_state->Work(); }
+		virtual void OnFinish() override {}
+
+	private:
+		std::shared_ptr<ParallelForState> m_state;
+	};
+} // namespace
+
+void ParallelFor(JobQueue *queue, uint32_t count, const std::function<void(uint32_t)> &fn)
+{
+	PROFILE_SCOPED()
+	const uint32_t numJobs = queue ? std::min(queue->GetNumRunners(), count > 0 ? count - 1 : 0) : 0;
+	if (!numJobs) {
+		for (uint32_t i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state(new ParallelForState(count, fn));
+	std::vector<Job::Handle> handles;
+	handles.reserve(numJobs);
+	for (uint32_t i = 0; i < numJobs; i++) {
+		Job *job = new ParallelForJob(state);
+		// the main thread is waiting on these, so they go ahead of everything
+		job->SetPriority(std::numeric_limits<double>::lowest());
+		handles.push_back(queue->Queue(job));
+	}
+
+	state->Work();
+	state->Wait();
+
+	// dropping the handles takes the jobs that never got to run out of the
+	// queue; the others are done and just get deleted
+	handles.clear();
+}
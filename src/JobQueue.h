@@ -5,8 +5,11 @@
 #define JOBQUEUE_H
 
 #include "SDL_thread.h"
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <deque>
+#include <functional>
 #include <set>
 #include <vector>
 
@@ -52,12 +55,17 @@ public:
 		bool HasJob() const { return m_job != nullptr; }
 		Job *GetJob() const { return m_job; }
 
+		// re-key a job that is still waiting to run (see Job::SetPriority).
+		// does nothing once the job has started
+		void SetPriority(double priority);
+
 		bool operator<(const Handle &other) const { return m_id < other.m_id; }
 
 	private:
 		friend class Job;
 		friend class AsyncJobQueue;
 		friend class SyncJobQueue;
+		friend class WorkStealingJobQueue;
 
 		Handle(Job *job, JobQueue *queue, JobClient *client);
 		void Unlink();
@@ -73,6 +81,10 @@ public:
 public:
 	Job() :
 		cancelled(false),
+		m_claimed(false),
+		m_priority(0.0),
+		m_deadline(0),
+		m_sequence(0),
 		m_handle(nullptr) {}
 	virtual ~Job();
 
@@ -83,9 +95,22 @@ public:
 	virtual void OnFinish() = 0;
 	virtual void OnCancel() {}
 
+	// lower values run first; jobs with the same priority run in the order
+	// they were queued. the default of zero means "as soon as possible", and
+	// the value is meant to be something like the distance to the camera.
+	// call before queuing, or use Job::Handle::SetPriority afterwards
+	void SetPriority(double priority) { m_priority = priority; }
+
+	// ask for the job to be started within the given number of frames (calls
+	// to FinishJobs) of being queued. once that has passed it goes ahead of
+	// every job that isn't overdue. call before queuing
+	void SetDeadline(uint32_t frames) { m_deadline = frames; }
+
 private:
 	friend class AsyncJobQueue;
 	friend class SyncJobQueue;
+	friend class WorkStealingJobQueue;
+	friend class JobPriorityQueue;
 	friend class JobRunner;
 
 	void UnlinkHandle();
@@ -94,9 +119,51 @@ private:
 	void ClearHandle() { m_handle = nullptr; }
 
 	bool cancelled;
+	// set by whoever gets to the job first: a runner about to start it, or
+	// the main thread cancelling it while it still sits in a runner's deque
+	// (only used by WorkStealingJobQueue)
+	std::atomic<bool> m_claimed;
+	double m_priority;
+	uint32_t m_deadline; // frames until due before queuing, frame number after
+	uint64_t m_sequence;
 	Handle *m_handle;
 };
 
+// jobs waiting to run, ordered by deadline, then priority, then the order in
+// which they were queued. not thread-safe, the owning queue guards it
+class JobPriorityQueue {
+public:
+	JobPriorityQueue() :
+		m_frame(0),
+		m_sequence(0),
+		m_deadlines(0),
+		m_nextDue(UINT32_MAX),
+		m_dirty(false) {}
+
+	void Push(Job *job);
+	Job *Pop();
+	// returns false if the job wasn't waiting here
+	bool Remove(Job *job);
+	// the job may or may not be waiting here, the order is fixed up lazily
+	void SetPriority(Job *job, double priority);
+	// called once per frame, from FinishJobs
+	void NextFrame();
+
+	bool Empty() const { return m_heap.empty(); }
+	size_t Size() const { return m_heap.size(); }
+
+private:
+	bool RunsAfter(const Job *a, const Job *b) const;
+	void Heapify();
+
+	std::vector<Job *> m_heap;
+	uint32_t m_frame;
+	uint64_t m_sequence;
+	uint32_t m_deadlines; // number of waiting jobs with a deadline
+	uint32_t m_nextDue; // the frame the next of them becomes overdue, at the earliest
+	bool m_dirty;
+};
+
 // the queue management class. create one from the main thread, and feed your
 // jobs do it. it will take care of the rest
 class JobQueue {
@@ -129,8 +196,21 @@ public:
 	// and then delete all finished and cancelled jobs. returns the number of
 	// finished jobs (not cancelled)
 	virtual uint32_t FinishJobs() = 0;
+
+	// call from the main thread to change the priority of a job that hasn't
+	// started yet. usually called through Job::Handle::SetPriority
+	virtual void SetPriority(Job *job, double priority) = 0;
+
+	// number of threads running jobs, zero if jobs only run when asked to
+	virtual uint32_t GetNumRunners() const = 0;
 };
 
+// runs fn(i) for every i in [0, count) on the queue's runners and on the
+// calling thread, and returns once all of them are done. call from the main
+// thread. the caller works through the items as well, so it never waits for
+// runners that are busy with other jobs. fn must be thread safe
+void ParallelFor(JobQueue *queue, uint32_t count, const std::function<void(uint32_t)> &fn);
+
 // the queue management class. create one from the main thread, and feed your
 // jobs do it. it will take care of the rest
 class AsyncJobQueue : public JobQueue {
@@ -161,6 +241,10 @@ public:
 	// finished jobs (not cancelled)
 	virtual uint32_t FinishJobs() override;
 
+	virtual void SetPriority(Job *job, double priority) override;
+
+	virtual uint32_t GetNumRunners() const override { return m_runners.size(); }
+
 private:
 	// a runner wraps a single thread, and calls into the queue when its ready for
 	// a new job. no user-servicable parts inside!
@@ -191,7 +275,7 @@ private:
 	Job *GetJob();
 	void Finish(Job *job, const uint8_t threadIdx);
 
-	std::deque<Job *> m_queue;
+	JobPriorityQueue m_queue;
 	SDL_mutex *m_queueLock;
 	SDL_cond *m_queueWaitCond;
 
@@ -203,6 +287,126 @@ private:
 	bool m_shutdown;
 };
 
+// job queue where every runner owns a lock-free deque of jobs. jobs queued
+// from the main thread go to a shared injection queue; an idle runner takes
+// a batch from there into its own deque, and runners without work steal from
+// the deques of randomly chosen victims. Job semantics (handles, clients,
+// cancellation, OnFinish on the main thread) are the same as AsyncJobQueue
+class WorkStealingJobQueue : public JobQueue {
+public:
+	struct Stats {
+		uint64_t steals; // jobs taken from another runner's deque
+		uint64_t failedSteals; // steal attempts that found nothing
+		uint64_t injected; // jobs taken from the shared injection queue
+		uint64_t idleMicroseconds; // time runners spent sleeping for work
+		uint32_t queueDepth; // jobs waiting to run (injection queue + deques)
+	};
+
+	WorkStealingJobQueue(uint32_t numRunners);
+	virtual ~WorkStealingJobQueue();
+
+	// call from the main thread to add a job to the queue. the job should be
+	// allocated with new. the queue will delete it once its its completed
+	virtual Job::Handle Queue(Job *job, JobClient *client = nullptr) override;
+
+	// call from the main thread to cancel a job. same rules as
+	// AsyncJobQueue::Cancel, except that a job which is already in a runner's
+	// deque can't be removed from it: it is flagged instead, never run, and
+	// deleted on a later call to FinishJobs
+	virtual void Cancel(Job *job) override;
+
+	// call from the main loop. this will call OnFinish for any finished jobs,
+	// and then delete all finished and cancelled jobs. returns the number of
+	// finished jobs (not cancelled)
+	virtual uint32_t FinishJobs() override;
+
+	// only the order of the injection queue can be changed; jobs that have
+	// already been moved into a runner's deque keep their place
+	virtual void SetPriority(Job *job, double priority) override;
+
+	virtual uint32_t GetNumRunners() const override { return m_runners.size(); }
+
+	// totals since the queue was created, except queueDepth which is a
+	// snapshot (approximate, as runners keep going while it is taken)
+	Stats GetStats() const;
+
+private:
+	// Chase-Lev deque of fixed size. the owning runner pushes and pops at the
+	// bottom, thieves take from the top
+	class WorkDeque {
+	public:
+		static const int64_t CAPACITY = 256;
+
+		WorkDeque();
+
+		// owner only. returns false if the deque is full
+		bool Push(Job *job);
+		// owner only
+		Job *Pop();
+		// any thread. returns nullptr if empty or if it lost a race
+		Job *Steal();
+
+		uint32_t Size() const;
+
+	private:
+		alignas(64) std::atomic<int64_t> m_top;
+		alignas(64) std::atomic<int64_t> m_bottom;
+		alignas(64) std::atomic<Job *> m_jobs[CAPACITY];
+	};
+
+	class JobRunner {
+	public:
+		JobRunner(WorkStealingJobQueue *jq, const uint8_t idx);
+		~JobRunner();
+
+		void CancelRunningJob();
+		void Join();
+
+		WorkDeque &GetDeque() { return m_deque; }
+		const WorkDeque &GetDeque() const { return m_deque; }
+
+		std::atomic<uint64_t> m_steals;
+		std::atomic<uint64_t> m_failedSteals;
+		std::atomic<uint64_t> m_injected;
+		std::atomic<uint64_t> m_idleTicks;
+
+	private:
+		static int Trampoline(void *);
+		void Main();
+
+		WorkStealingJobQueue *m_jobQueue;
+		WorkDeque m_deque;
+
+		Job *m_job;
+		SDL_mutex *m_jobLock;
+
+		SDL_Thread *m_threadId;
+
+		uint8_t m_threadIdx;
+		std::string m_threadName;
+		uint32_t m_rng;
+	};
+
+	Job *GetJob(const uint8_t threadIdx, uint32_t &rng);
+	Job *TakeInjected(const uint8_t threadIdx);
+	Job *StealJob(const uint8_t threadIdx, uint32_t &rng);
+	bool AnyDequeHasWork() const;
+	void Finish(Job *job, const uint8_t threadIdx);
+
+	JobPriorityQueue m_injection;
+	std::atomic<uint32_t> m_injectionSize;
+	SDL_mutex *m_injectionLock;
+	SDL_cond *m_injectionWaitCond;
+	uint32_t m_sleeping;
+
+	std::deque<Job *> m_finished[MAX_THREADS];
+	SDL_mutex *m_finishedLock[MAX_THREADS];
+
+	std::vector<JobRunner *> m_runners;
+
+	std::atomic<bool> m_shutdown;
+};
+
 class SyncJobQueue : public JobQueue {
 public:
 	SyncJobQueue() = default;
@@ -229,10 +433,14 @@ public:
 	// finished jobs (not cancelled)
 	virtual uint32_t FinishJobs() override;
 
+	virtual void SetPriority(Job *job, double priority) override;
+
+	virtual uint32_t GetNumRunners() const override { return 0; }
+
 	uint32_t RunJobs(uint32_t count = 1);
 
 private:
-	std::deque<Job *> m_queue;
+	JobPriorityQueue m_queue;
 	std::deque<Job *> m_finished;
 };
 
@@ -9,6 +9,7 @@
 
 #include "FileSystem.h"
 #include "GZipFormat.h"
+#include "LZ4Format.h"
 #include "base64/base64.hpp"
 #include "libs/utils.h"
 #include "libs/stringUtils.h"
@@ -73,15 +74,8 @@ namespace JsonUtils {
 	{
 		auto file = source.ReadFile(filename);
 		if (!file) return nullptr;
-		const auto file_data = std::string(file->GetData(), file->GetSize());
-		const unsigned char *dataPtr = reinterpret_cast<const unsigned char *>(&file_data[0]);
 		try {
-			std::string plain_data;
-			if (gzip::IsGZipFormat(dataPtr, file_data.size())) {
-				plain_data = gzip::DecompressDeflateOrGZip(dataPtr, file_data.size());
-			} else {
-				plain_data = file_data;
-			}
+			const std::string plain_data = DecompressSaveFile(file->GetData(), file->GetSize());
 
 			Json rootNode;
 			try {
@@ -96,6 +90,28 @@ namespace JsonUtils {
 			}
 		} catch (gzip::DecompressionFailedException) {
 			return nullptr;
+		} catch (lz4::DecompressionFailedException &) {
+			return nullptr;
+		}
+	}
+
+	std::string DecompressSaveFile(const char *data, size_t length)
+	{
+		PROFILE_SCOPED()
+		const unsigned char *dataPtr = reinterpret_cast<const unsigned char *>(data);
+		if (gzip::IsGZipFormat(dataPtr, length))
+			return gzip::DecompressDeflateOrGZip(dataPtr, length);
+		if (lz4::IsLZ4Format(data, length))
+			return lz4::DecompressLZ4(data, length);
+		// uncompressed JSON, or CBOR as SaveGame writes it. an indefinite map
+		// can't be the start of DEFLATE data, but '{' could be
+		if (length && (data[0] == '{' || uint8_t(data[0]) == 0xbf))
+			return std::string(data, length);
+		// raw DEFLATE has no magic bytes to go by
+		try {
+			return gzip::DecompressRawDeflate(dataPtr, length);
+		} catch (gzip::DecompressionFailedException) {
+			return std::string(data, length);
 		}
 	}
 } // namespace JsonUtils
@@ -26,8 +26,12 @@ namespace JsonUtils {
 	// Load a JSON file from the game's data sources, optionally applying all
 	// files with the the name <filename>.patch as Json Merge Patch (RFC 7386) files
 	Json LoadJsonDataFile(const std::string &filename, bool with_merge = true);
-	// Loads an optionally-gzipped, optionally-CBOR encoded JSON file from the specified source.
+	// Loads an optionally-compressed (gzip or LZ4), optionally-CBOR encoded JSON file from the specified source.
 	Json LoadJsonSaveFile(const std::string &filename, FileSystem::FileSource &source);
+	// Decompresses the contents of a save file, going by the format it is in (gzip or LZ4).
+	// Anything else is taken to be raw DEFLATE, as the oldest saves are, and is returned as it is
+	// if it doesn't decompress as such. Throws the codec's DecompressionFailedException.
+	std::string DecompressSaveFile(const char *data, size_t length);
 } // namespace JsonUtils
 
 // To-JSON functions. These are called explicitly, and are passed a reference to the object to fill.
@@ -0,0 +1,321 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "LuaAllocator.h"
+
+#include <lua.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+struct LuaAllocator::Slab {
+	Slab *prev; // in the list of slabs of its class with blocks free
+	Slab *next;
+	void *freeBlocks; // each holds the address of the next
+	char *fresh; // blocks from here on haven't been handed out yet
+	size_t used;
+	size_t sizeClass;
+	// followed by the tag of each block, then the blocks
+};
+
+namespace {
+	// malloc'd blocks are preceded by their tag, and padding to keep them
+	// as aligned as malloc made them
+	const size_t LARGE_HEADER = 16;
+
+	void *AllocAligned(size_t size)
+	{
+#ifdef _WIN32
+		return _aligned_malloc(size, size);
+#else
+		void *ptr;
+		return posix_memalign(&ptr, size, size) == 0 ? ptr : nullptr;
+#endif
+	}
+
+	void FreeAligned(void *ptr)
+	{
+#ifdef _WIN32
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+} // namespace
+
+LuaAllocator::LuaAllocator() :
+	m_currentTag(UNTAGGED),
+	m_smallBytes(0),
+	m_largeBytes(0),
+	m_slabs(0)
+{
+	// 8 bytes apart up to 128, then 16 apart up to 256 and 32 up to 512.
+	// Lua doesn't need more than 8 byte alignment
+	for (size_t i = 0; i < NUM_CLASSES; i++) {
+		SizeClass &sc = m_classes[i];
+		if (i < 16)
+			sc.size = 8 * (i + 1);
+		else if (i < 24)
+			sc.size = 128 + 16 * (i - 15);
+		else
+			sc.size = 256 + 32 * (i - 23);
+		// room for the blocks, a tag each and aligning the first block
+		sc.blocks = (SLAB_SIZE - sizeof(Slab) - 8) / (sc.size + sizeof(Tag));
+		sc.offset = (sizeof(Slab) + sc.blocks * sizeof(Tag) + 7) & ~size_t(7);
+		sc.free = nullptr;
+	}
+	assert(m_classes[NUM_CLASSES - 1].size == MAX_SMALL);
+
+	size_t c = 0;
+	for (size_t units = 0; units <= MAX_SMALL / 8; units++) {
+		while (m_classes[c].size < units * 8)
+			c++;
+		m_classOfSize[units] = uint8_t(c);
+	}
+
+	m_tags.push_back({ "untagged", 0, 0, 0 });
+	m_tagsByName["untagged"] = UNTAGGED;
+}
+
+LuaAllocator::~LuaAllocator()
+{
+	// the Lua state is closed by now, so there are no blocks left in use and
+	// every slab is in the list of its class
+	for (SizeClass &sc : m_classes) {
+		while (sc.free) {
+			Slab *next = sc.free->next;
+			FreeAligned(sc.free);
+			sc.free = next;
+		}
+	}
+}
+
+void *LuaAllocator::Alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	return static_cast<LuaAllocator *>(ud)->Realloc(ptr, osize, nsize);
+}
+
+void *LuaAllocator::Realloc(void *ptr, size_t osize, size_t nsize)
+{
+	// without a block osize is the kind of object it's for, not a size
+	if (!ptr)
+		return nsize == 0 ? nullptr : (nsize <= MAX_SMALL ? AllocSmall(nsize, m_currentTag) : AllocLarge(nsize, m_currentTag));
+
+	if (nsize == 0) {
+		if (osize <= MAX_SMALL)
+			FreeSmall(ptr, osize);
+		else
+			FreeLarge(ptr, osize);
+		return nullptr;
+	}
+
+	// blocks stay charged to the tag they were allocated with
+	Tag tag;
+	if (osize <= MAX_SMALL) {
+		Slab *slab = SlabOf(ptr);
+		tag = TagOf(slab, ptr);
+		if (nsize <= MAX_SMALL && m_classOfSize[(nsize + 7) / 8] == slab->sizeClass) {
+			// still fits where it is
+			m_tags[tag].bytes += nsize - osize;
+			m_smallBytes += nsize - osize;
+			return ptr;
+		}
+	} else {
+		char *header = static_cast<char *>(ptr) - LARGE_HEADER;
+		memcpy(&tag, header, sizeof(tag));
+		if (nsize > MAX_SMALL) {
+			header = static_cast<char *>(realloc(header, nsize + LARGE_HEADER));
+			if (!header)
+				return nullptr;
+			m_tags[tag].bytes += nsize - osize;
+			m_largeBytes += nsize - osize;
+			return header + LARGE_HEADER;
+		}
+	}
+
+	// to another size class, or between the slabs and malloc. if this fails,
+	// Lua collects garbage and tries again before it gives up with LUA_ERRMEM
+	void *block = nsize <= MAX_SMALL ? AllocSmall(nsize, tag) : AllocLarge(nsize, tag);
+	if (!block)
+		return nullptr;
+	memcpy(block, ptr, std::min(osize, nsize));
+	if (osize <= MAX_SMALL)
+		FreeSmall(ptr, osize);
+	else
+		FreeLarge(ptr, osize);
+	return block;
+}
+
+void *LuaAllocator::AllocSmall(size_t size, Tag tag)
+{
+	SizeClass &sc = m_classes[m_classOfSize[(size + 7) / 8]];
+	Slab *slab = sc.free;
+	if (!slab) {
+		slab = static_cast<Slab *>(AllocAligned(SLAB_SIZE));
+		if (!slab)
+			return nullptr;
+		slab->prev = nullptr;
+		slab->next = nullptr;
+		slab->freeBlocks = nullptr;
+		slab->fresh = reinterpret_cast<char *>(slab) + sc.offset;
+		slab->used = 0;
+		slab->sizeClass = size_t(&sc - m_classes);
+		sc.free = slab;
+		m_slabs++;
+	}
+
+	void *block;
+	if (slab->freeBlocks) {
+		block = slab->freeBlocks;
+		slab->freeBlocks = *static_cast<void **>(block);
+	} else {
+		block = slab->fresh;
+		slab->fresh += sc.size;
+	}
+
+	if (++slab->used == sc.blocks) {
+		// full, so out of the list (of which it's the first)
+		sc.free = slab->next;
+		if (sc.free)
+			sc.free->prev = nullptr;
+		slab->next = nullptr;
+	}
+
+	TagOf(slab, block) = tag;
+	Charge(tag, size);
+	m_smallBytes += size;
+	return block;
+}
+
+void LuaAllocator::FreeSmall(void *ptr, size_t size)
+{
+	Slab *slab = SlabOf(ptr);
+	SizeClass &sc = m_classes[slab->sizeClass];
+	Refund(TagOf(slab, ptr), size);
+	m_smallBytes -= size;
+
+	*static_cast<void **>(ptr) = slab->freeBlocks;
+	slab->freeBlocks = ptr;
+
+	if (slab->used-- == sc.blocks) {
+		// was full, and has room again
+		slab->prev = nullptr;
+		slab->next = sc.free;
+		if (sc.free)
+			sc.free->prev = slab;
+		sc.free = slab;
+	} else if (slab->used == 0 && (slab->prev || slab->next)) {
+		// empty, and not the only one with room. keeping one spare stops a
+		// block going back and forth from taking a slab with it every time
+		if (slab->prev)
+			slab->prev->next = slab->next;
+		else
+			sc.free = slab->next;
+		if (slab->next)
+			slab->next->prev = slab->prev;
+		FreeAligned(slab);
+		m_slabs--;
+	}
+}
+
+void *LuaAllocator::AllocLarge(size_t size, Tag tag)
+{
+	char *header = static_cast<char *>(malloc(size + LARGE_HEADER));
+	if (!header)
+		return nullptr;
+	memcpy(header, &tag, sizeof(tag));
+	Charge(tag, size);
+	m_largeBytes += size;
+	return header + LARGE_HEADER;
+}
+
+void LuaAllocator::FreeLarge(void *ptr, size_t size)
+{
+	char *header = static_cast<char *>(ptr) - LARGE_HEADER;
+	Tag tag;
+	memcpy(&tag, header, sizeof(tag));
+	Refund(tag, size);
+	m_largeBytes -= size;
+	free(header);
+}
+
+LuaAllocator::Slab *LuaAllocator::SlabOf(void *ptr)
+{
+	return reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(ptr) & ~uintptr_t(SLAB_SIZE - 1));
+}
+
+LuaAllocator::Tag &LuaAllocator::TagOf(Slab *slab, void *ptr)
+{
+	const SizeClass &sc = m_classes[slab->sizeClass];
+	const size_t index = size_t(static_cast<char *>(ptr) - reinterpret_cast<char *>(slab) - sc.offset) / sc.size;
+	return reinterpret_cast<Tag *>(slab + 1)[index];
+}
+
+void LuaAllocator::Charge(Tag tag, size_t size)
+{
+	TagStats &stats = m_tags[tag];
+	stats.bytes += size;
+	stats.blocks++;
+	stats.allocations++;
+}
+
+void LuaAllocator::Refund(Tag tag, size_t size)
+{
+	TagStats &stats = m_tags[tag];
+	stats.bytes -= size;
+	stats.blocks--;
+}
+
+LuaAllocator::Tag LuaAllocator::GetTag(const std::string &name)
+{
+	auto it = m_tagsByName.find(name);
+	if (it != m_tagsByName.end())
+		return it->second;
+	if (m_tags.size() > 0xffff)
+		return UNTAGGED;
+	const Tag tag = Tag(m_tags.size());
+	m_tags.push_back({ name, 0, 0, 0 });
+	m_tagsByName[name] = tag;
+	return tag;
+}
+
+LuaAllocator *LuaAllocator::Get(lua_State *l)
+{
+	void *ud;
+	if (lua_getallocf(l, &ud) != &LuaAllocator::Alloc)
+		return nullptr;
+	return static_cast<LuaAllocator *>(ud);
+}
+
+LuaAllocator::TagScope::TagScope(lua_State *l, const std::string &name) :
+	m_allocator(Get(l)),
+	m_previous(UNTAGGED)
+{
+	if (m_allocator) {
+		m_previous = m_allocator->GetCurrentTag();
+		m_allocator->SetCurrentTag(m_allocator->GetTag(name));
+	}
+}
+
+LuaAllocator::TagScope::~TagScope()
+{
+	if (m_allocator)
+		m_allocator->SetCurrentTag(m_previous);
+}
+
+LuaAllocator::Stats LuaAllocator::GetStats() const
+{
+	Stats stats;
+	stats.smallBytes = m_smallBytes;
+	stats.slabBytes = m_slabs * SLAB_SIZE;
+	stats.slabs = m_slabs;
+	stats.largeBytes = m_largeBytes;
+	stats.tags = m_tags;
+	return stats;
+}
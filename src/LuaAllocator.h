@@ -0,0 +1,120 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _LUAALLOCATOR_H
+#define _LUAALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct lua_State;
+
+// The allocator behind the Lua state. Most of what Lua allocates is small
+// (strings, tables, closures, the userdata of LuaObject wrappers) and comes
+// and goes all the time, so blocks up to MAX_SMALL bytes are handed out from
+// slabs of same sized blocks instead of by malloc. Bigger ones go to malloc.
+//
+// Every block is also charged to a tag, the one current when it was
+// allocated, so that the memory Lua holds can be put down to the module
+// being loaded, the event being handled and so on. Tags are set with
+// TagScope in C++, and Engine.SetLuaMemoryTag in Lua.
+//
+// Only for the one Lua state of LuaManager, and not thread safe, as Lua
+// isn't either.
+class LuaAllocator {
+public:
+	// there's one for each Lua file loaded and each event handled among
+	// others, which is hundreds already
+	typedef uint16_t Tag;
+	static const Tag UNTAGGED = 0; // also what is left when there are no tags left
+
+	struct TagStats {
+		std::string name;
+		size_t bytes; // in use
+		size_t blocks; // in use
+		uint64_t allocations; // ever
+	};
+
+	struct Stats {
+		size_t smallBytes; // in use, of blocks up to MAX_SMALL bytes
+		size_t slabBytes; // taken from the system for the small blocks
+		size_t slabs;
+		size_t largeBytes; // in use, of bigger blocks
+		std::vector<TagStats> tags; // by tag
+	};
+
+	LuaAllocator();
+	~LuaAllocator();
+
+	LuaAllocator(const LuaAllocator &) = delete;
+	LuaAllocator &operator=(const LuaAllocator &) = delete;
+
+	// a lua_Alloc, ud being the LuaAllocator
+	static void *Alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+	// the tag of the name, which is made if there isn't one yet
+	Tag GetTag(const std::string &name);
+	size_t GetNumTags() const { return m_tags.size(); }
+	const std::string &GetTagName(Tag tag) const { return m_tags[tag].name; }
+	Tag GetCurrentTag() const { return m_currentTag; }
+	void SetCurrentTag(Tag tag) { m_currentTag = tag; }
+
+	Stats GetStats() const;
+
+	// the allocator of the Lua state, or null if it gets its memory elsewhere
+	static LuaAllocator *Get(lua_State *l);
+
+	// sets the current tag for as long as it's around, if l has a
+	// LuaAllocator. the tag it replaced comes back even if a Lua error goes
+	// through
+	class TagScope {
+	public:
+		TagScope(lua_State *l, const std::string &name);
+		~TagScope();
+
+		TagScope(const TagScope &) = delete;
+		TagScope &operator=(const TagScope &) = delete;
+
+	private:
+		LuaAllocator *m_allocator;
+		Tag m_previous;
+	};
+
+private:
+	static const size_t SLAB_SIZE = 64 * 1024; // also what slabs are aligned to
+	static const size_t MAX_SMALL = 512;
+	static const size_t NUM_CLASSES = 32;
+
+	struct Slab;
+
+	struct SizeClass {
+		size_t size;
+		size_t blocks; // per slab
+		size_t offset; // of the first block in a slab
+		Slab *free; // slabs with blocks free, the first one is used first
+	};
+
+	void *Realloc(void *ptr, size_t osize, size_t nsize);
+	void *AllocSmall(size_t size, Tag tag);
+	void FreeSmall(void *ptr, size_t size);
+	void *AllocLarge(size_t size, Tag tag);
+	void FreeLarge(void *ptr, size_t size);
+	static Slab *SlabOf(void *ptr);
+	Tag &TagOf(Slab *slab, void *ptr);
+	void Charge(Tag tag, size_t size);
+	void Refund(Tag tag, size_t size);
+
+	SizeClass m_classes[NUM_CLASSES];
+	uint8_t m_classOfSize[MAX_SMALL / 8 + 1]; // by size in units of 8 bytes, rounded up
+	std::vector<TagStats> m_tags;
+	std::unordered_map<std::string, Tag> m_tagsByName;
+	Tag m_currentTag;
+	size_t m_smallBytes;
+	size_t m_largeBytes;
+	size_t m_slabs;
+};
+
+#endif
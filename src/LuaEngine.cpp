@@ -12,6 +12,7 @@
 #include "GameLocator.h"
 #include "InGameViews.h"
 #include "InGameViewsLocator.h"
+#include "LuaAllocator.h"
 #include "LuaConstants.h"
 #include "LuaManager.h"
 #include "LuaObject.h"
@@ -39,6 +40,8 @@
 
 #include "SDL_timer.h" // <- Here because there's a need to measure time even outside game
 
+#include <algorithm>
+
 /*
  * Interface: Engine
  *
@@ -523,6 +526,131 @@ static int l_engine_set_autosave_enabled(lua_State *l)
 	return 0;
 }
 
+static int l_engine_get_autosave_interval(lua_State *l)
+{
+	lua_pushinteger(l, GameConfSingleton::getInstance().Int("AutosaveInterval"));
+	return 1;
+}
+
+/*
+ * Method: GetLuaMemoryStats
+ *
+ * Get what the memory of the Lua state is used for
+ *
+ * > stats = Engine.GetLuaMemoryStats()
+ *
+ * Return:
+ *
+ *   stats - a table with smallBytes and largeBytes, the bytes in use in
+ *           blocks up to 512 bytes and in bigger ones, slabs and slabBytes,
+ *           what the small blocks are pooled in, and tags, a list of tables
+ *           with the name, bytes and blocks in use and number of allocations
+ *           ever made of each tag, most bytes first
+ *
+ * Availability:
+ *
+ *   2020
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_engine_get_lua_memory_stats(lua_State *l)
+{
+	LUA_DEBUG_START(l);
+
+	LuaAllocator::Stats stats = Lua::manager->GetAllocator().GetStats();
+	std::sort(stats.tags.begin(), stats.tags.end(), [](const LuaAllocator::TagStats &a, const LuaAllocator::TagStats &b) {
+		return a.bytes > b.bytes;
+	});
+
+	lua_createtable(l, 0, 5);
+	pi_lua_settable(l, "smallBytes", double(stats.smallBytes));
+	pi_lua_settable(l, "largeBytes", double(stats.largeBytes));
+	pi_lua_settable(l, "slabs", int(stats.slabs));
+	pi_lua_settable(l, "slabBytes", double(stats.slabBytes));
+
+	lua_createtable(l, int(stats.tags.size()), 0);
+	for (size_t i = 0; i < stats.tags.size(); i++) {
+		const LuaAllocator::TagStats &tag = stats.tags[i];
+		lua_createtable(l, 0, 4);
+		pi_lua_settable(l, "name", tag.name.c_str());
+		pi_lua_settable(l, "bytes", double(tag.bytes));
+		pi_lua_settable(l, "blocks", double(tag.blocks));
+		pi_lua_settable(l, "allocations", double(tag.allocations));
+		lua_rawseti(l, -2, int(i + 1));
+	}
+	lua_setfield(l, -2, "tags");
+
+	LUA_DEBUG_END(l, 1);
+	return 1;
+}
+
+/*
+ * Method: GetLuaMemoryTag
+ *
+ * Get the tag that Lua memory can be put down to, for <SetLuaMemoryTag>
+ *
+ * > tag = Engine.GetLuaMemoryTag(name)
+ *
+ * Parameters:
+ *
+ *   name - what the memory is for. the tag is made the first time the name
+ *          is asked for
+ *
+ * Return:
+ *
+ *   tag - an integer
+ *
+ * Availability:
+ *
+ *   2020
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_engine_get_lua_memory_tag(lua_State *l)
+{
+	const std::string name = luaL_checkstring(l, 1);
+	lua_pushinteger(l, Lua::manager->GetAllocator().GetTag(name));
+	return 1;
+}
+
+/*
+ * Method: SetLuaMemoryTag
+ *
+ * Put the memory Lua allocates from now on down to the tag
+ *
+ * > previous = Engine.SetLuaMemoryTag(tag)
+ *
+ * Parameters:
+ *
+ *   tag - a tag from <GetLuaMemoryTag>
+ *
+ * Return:
+ *
+ *   previous - the tag that was set before, to set back when done
+ *
+ * Availability:
+ *
+ *   2020
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_engine_set_lua_memory_tag(lua_State *l)
+{
+	LuaAllocator &allocator = Lua::manager->GetAllocator();
+	const int tag = luaL_checkinteger(l, 1);
+	if (tag < 0 || size_t(tag) >= allocator.GetNumTags())
+		return luaL_error(l, "SetLuaMemoryTag: no such tag %d", tag);
+	lua_pushinteger(l, allocator.GetCurrentTag());
+	allocator.SetCurrentTag(LuaAllocator::Tag(tag));
+	return 1;
+}
+
 static int l_engine_get_display_hud_trails(lua_State *l)
 {
 	lua_pushboolean(l, GameConfSingleton::getInstance().Int("HudTrails") != 0);
@@ -798,6 +926,12 @@ static int l_engine_get_model(lua_State *l)
 	return 1;
 }
 
+static int l_engine_prefetch_model(lua_State *l)
+{
+	ModelCache::Prefetch(luaL_checkstring(l, 1));
+	return 0;
+}
+
 static int l_engine_sector_map_clear_route(lua_State *l)
 {
 	SectorView *sv = InGameViewsLocator::getInGameViews()->GetSectorView();
@@ -1045,14 +1179,28 @@ static int l_engine_sector_map_auto_route(lua_State *l)
 	SystemPath current_path = sv->GetCurrent();
 	SystemPath target_path = sv->GetSelected();
 
-	std::vector<SystemPath> route;
-	sv->AutoRoute(current_path, target_path, route);
-	sv->ClearRoute();
-	for (auto it = route.begin(); it != route.end(); it++) {
-		sv->AddToRoute(*it);
+	// the route is planned in the background and shows up in SectorMapGetRoute
+	LuaPush<bool>(l, sv->AutoRoute(current_path, target_path));
+	return 1;
+}
+
+static int l_engine_sector_map_auto_route_progress(lua_State *l)
+{
+	SectorView *sv = InGameViewsLocator::getInGameViews()->GetSectorView();
+	if (!sv || !sv->IsAutoRouting()) {
+		lua_pushnil(l);
+		return 1;
 	}
+	LuaPush<float>(l, sv->GetAutoRouteProgress());
+	return 1;
+}
 
-	return l_engine_sector_map_get_route(l);
+static int l_engine_sector_map_cancel_auto_route(lua_State *l)
+{
+	SectorView *sv = InGameViewsLocator::getInGameViews()->GetSectorView();
+	if (sv)
+		sv->CancelAutoRoute();
+	return 0;
 }
 
 static int l_engine_sector_map_move_route_item_up(lua_State *l)
@@ -1267,6 +1415,11 @@ void LuaEngine::Register()
 
 		{ "GetAutosaveEnabled", l_engine_get_autosave_enabled },
 		{ "SetAutosaveEnabled", l_engine_set_autosave_enabled },
+		{ "GetAutosaveInterval", l_engine_get_autosave_interval },
+
+		{ "GetLuaMemoryStats", l_engine_get_lua_memory_stats },
+		{ "GetLuaMemoryTag", l_engine_get_lua_memory_tag },
+		{ "SetLuaMemoryTag", l_engine_set_lua_memory_tag },
 
 		{ "GetDisplayHudTrails", l_engine_get_display_hud_trails },
 		{ "SetDisplayHudTrails", l_engine_set_display_hud_trails },
@@ -1294,6 +1447,7 @@ void LuaEngine::Register()
 		{ "OpenBrowseUserFolder", l_browse_user_folders },
 
 		{ "GetModel", l_engine_get_model },
+		{ "PrefetchModel", l_engine_prefetch_model },
 
 		{ "GetSectorMapZoomLevel", l_engine_get_sector_map_zoom_level },
 		{ "SectorMapZoomIn", l_engine_sector_map_zoom_in },
@@ -1321,6 +1475,8 @@ void LuaEngine::Register()
 		{ "GetSectorMapFactions", l_engine_get_sector_map_factions },
 		{ "SetSectorMapFactionVisible", l_engine_set_sector_map_faction_visible },
 		{ "SectorMapAutoRoute", l_engine_sector_map_auto_route },
+		{ "SectorMapAutoRouteProgress", l_engine_sector_map_auto_route_progress },
+		{ "SectorMapCancelAutoRoute", l_engine_sector_map_cancel_auto_route },
 		{ "SectorMapGetRoute", l_engine_sector_map_get_route },
 		{ "SectorMapGetRouteSize", l_engine_sector_map_get_route_size },
 		{ "SectorMapMoveRouteItemUp", l_engine_sector_map_move_route_item_up },
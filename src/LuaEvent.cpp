@@ -3,6 +3,7 @@
 
 #include "LuaEvent.h"
 
+#include "LuaAllocator.h"
 #include "LuaManager.h"
 #include "LuaObject.h"
 #include "LuaUtils.h"
@@ -46,6 +47,8 @@ namespace LuaEvent {
 	void Emit()
 	{
 		lua_State *l = Lua::manager->GetLuaState();
+		// Event._Emit tags the handlers of each event on their own
+		LuaAllocator::TagScope tagScope(l, "events");
 
 		LUA_DEBUG_START(l);
 		if (!_get_method_onto_stack(l, "_Emit")) return;
@@ -103,7 +103,7 @@ static int l_game_savegame_stats(lua_State *l)
 	std::string filename = LuaPull<std::string>(l, 1);
 
 	try {
-		Json rootNode = GameStateStatic::LoadGameToJson(filename);
+		Json rootNode = GameStateStatic::LoadGameInfoToJson(filename);
 
 		LuaTable t(l, 0, 3);
 
@@ -223,17 +223,25 @@ static int l_game_can_load_game(lua_State *l)
  *
  * Save the current game.
  *
- * > path = Game.SaveGame(filename)
+ * > path = Game.SaveGame(filename, incremental)
  *
  * Parameters:
  *
  *   filename - Filename to save to. The file will be placed the 'savefiles'
  *              directory in the user's game directory.
  *
+ *   incremental - optional. if true, the save is only written in full now
+ *                 and then, and in between as a (much smaller) delta against
+ *                 the last full one, in '<filename>.delta'. meant for saves
+ *                 made often, such as autosaves
+ *
  * Return:
  *
  *   path - the full path to the saved file (so it can be displayed)
  *
+ * With BackgroundSave enabled the file is written after this returns, and
+ * <Event.onGameSaved> tells when it's done or if writing it failed.
+ *
  * Availability:
  *
  *   June 2013
@@ -249,10 +257,11 @@ static int l_game_save_game(lua_State *l)
 	}
 
 	const std::string filename(luaL_checkstring(l, 1));
+	const bool incremental = lua_toboolean(l, 2);
 	const std::string path = FileSystem::JoinPathBelow(GameConfSingleton::GetSaveDir(), filename);
 
 	try {
-		GameStateStatic::SaveGame(filename);
+		GameStateStatic::SaveGame(filename, incremental);
 		lua_pushlstring(l, path.c_str(), path.size());
 		return 1;
 	} catch (CannotSaveInHyperspace) {
@@ -268,6 +277,62 @@ static int l_game_save_game(lua_State *l)
 	}
 }
 
+/*
+ * Function: BenchmarkSaveCompression
+ *
+ * Compress and decompress an existing saved game with each of the codecs
+ * the SaveCompression config option can be set to.
+ *
+ * > results = Game.BenchmarkSaveCompression(filename)
+ *
+ * Parameters:
+ *
+ *   filename - The filename of the saved game to test with, relative to the
+ *              'savefiles' directory.
+ *
+ * Return:
+ *
+ *   results - a table keyed by codec name ("gzip", "gzip-parallel", "lz4").
+ *             each value is a table with compress_mbps and decompress_mbps
+ *             (MB of uncompressed data per second) and ratio (uncompressed
+ *             size over compressed size)
+ *
+ * Availability:
+ *
+ *   2020
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_game_benchmark_save_compression(lua_State *l)
+{
+	const std::string filename = LuaPull<std::string>(l, 1);
+
+	try {
+		const std::vector<GameStateStatic::CodecBenchmark> results = GameStateStatic::BenchmarkSaveCompression(filename);
+
+		LuaTable t(l, 0, results.size());
+		for (const GameStateStatic::CodecBenchmark &result : results) {
+			LuaTable r(l, 0, 3);
+			r.Set("compress_mbps", result.compressMBps);
+			r.Set("decompress_mbps", result.decompressMBps);
+			r.Set("ratio", result.ratio);
+			t.Set(result.codec, r);
+			lua_pop(l, 1);
+		}
+		return 1;
+	} catch (CouldNotOpenFileException) {
+		const std::string message = stringf(Lang::COULD_NOT_OPEN_FILENAME, formatarg("path", filename));
+		lua_pushlstring(l, message.c_str(), message.size());
+		return lua_error(l);
+	} catch (CouldNotWriteToFileException) {
+		return luaL_error(l, "%s", Lang::GAME_SAVE_CANNOT_WRITE);
+	} catch (SavedGameCorruptException) {
+		return luaL_error(l, "%s", Lang::GAME_LOAD_CORRUPT);
+	}
+}
+
 /*
  * Function: EndGame
  *
@@ -631,6 +696,7 @@ void LuaGame::Register()
 		{ "InHyperspace", l_game_in_hyperspace },
 		{ "SetRadarVisible", l_game_set_radar_visible },
 		{ "SaveGameStats", l_game_savegame_stats },
+		{ "BenchmarkSaveCompression", l_game_benchmark_save_compression },
 
 		{ "SwitchView", l_game_switch_view },
 		{ "CurrentView", l_game_current_view },
@@ -17,7 +17,7 @@ LuaManager::LuaManager() :
 		abort();
 	}
 
-	m_lua = luaL_newstate();
+	m_lua = lua_newstate(&LuaAllocator::Alloc, &m_allocator);
 	pi_lua_open_standard_base(m_lua);
 	lua_atpanic(m_lua, pi_lua_panic);
 
@@ -4,6 +4,8 @@
 #ifndef _LUAMANAGER_H
 #define _LUAMANAGER_H
 
+#include "LuaAllocator.h"
+
 #include <lua.hpp>
 
 class LuaManager {
@@ -18,7 +20,11 @@ public:
 	size_t GetMemoryUsage() const;
 	void CollectGarbage();
 
+	// where the memory of the Lua state comes from, and what it's used for
+	LuaAllocator &GetAllocator() { return m_allocator; }
+
 private:
+	LuaAllocator m_allocator; // has to outlive m_lua
 	lua_State *m_lua;
 };
 
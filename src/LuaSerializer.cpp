@@ -3,8 +3,10 @@
 
 #include "LuaSerializer.h"
 
+#include "CborStream.h"
 #include "GameSaveError.h"
 #include "JsonUtils.h"
+#include "LuaAllocator.h"
 #include "LuaObject.h"
 #include "libs/utils.h"
 
@@ -331,6 +333,14 @@ const char *LuaSerializer::unpickle(lua_State *l, const char *pos)
 }
 
 void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const std::string &key)
+{
+	PROFILE_SCOPED()
+	CborWriter writer(4096);
+	pickle_cbor(l, to_serialize, writer, key);
+	out = Json::from_cbor(writer.TakeData());
+}
+
+void LuaSerializer::pickle_cbor(lua_State *l, int to_serialize, CborWriter &out, const std::string &key, bool markEntries)
 {
 	PROFILE_SCOPED()
 	LUA_DEBUG_START(l);
@@ -344,15 +354,16 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 	to_serialize = lua_absindex(l, to_serialize);
 	int idx = to_serialize;
 
+	// nothing can be written before knowing what the value turns into,
+	// so the class name is held on to until then
+	const char *cl = nullptr;
 	if (lua_getmetatable(l, idx)) {
 		lua_getfield(l, -1, "class");
 		if (lua_isnil(l, -1))
 			lua_pop(l, 2);
 
 		else {
-			const char *cl = lua_tostring(l, -1);
-
-			out["lua_class"] = cl;
+			cl = lua_tostring(l, -1);
 
 			lua_getfield(l, LUA_REGISTRYINDEX, "PiSerializerClasses");
 
@@ -370,6 +381,9 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 			idx = lua_gettop(l);
 
 			if (lua_isnil(l, idx)) {
+				out.BeginMap(1);
+				out.Key("lua_class");
+				out.String(cl);
 				lua_pop(l, 5);
 				LUA_DEBUG_END(l, 0);
 				return;
@@ -379,11 +393,11 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 
 	switch (lua_type(l, idx)) {
 	case LUA_TNIL:
-		out = Json();
+		out.Null();
 		break;
 
 	case LUA_TBOOLEAN: {
-		out = Json(static_cast<bool>(lua_toboolean(l, idx)));
+		out.Bool(lua_toboolean(l, idx));
 		break;
 	}
 
@@ -391,13 +405,13 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 		lua_pushvalue(l, idx);
 		size_t len;
 		const char *str = lua_tolstring(l, -1, &len);
-		out = Json(std::string(str, str + len));
+		out.String(str, len);
 		lua_pop(l, 1);
 		break;
 	}
 
 	case LUA_TNUMBER: {
-		out = lua_tonumber(l, idx);
+		out.Double(lua_tonumber(l, idx));
 		break;
 	}
 
@@ -409,9 +423,16 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 		lua_pushvalue(l, -2); // ptr reftable ptr
 		lua_rawget(l, -2); // ptr reftable ???
 
-		out["ref"] = ptr;
+		const bool seen = !lua_isnil(l, -1);
+		out.BeginMap((cl ? 1 : 0) + (seen ? 1 : 2));
+		if (cl) {
+			out.Key("lua_class");
+			out.String(cl);
+		}
+		out.Key("ref");
+		out.Int(ptr);
 
-		if (!lua_isnil(l, -1)) {
+		if (seen) {
 			lua_pop(l, 3); // [empty]
 		} else {
 			lua_pushvalue(l, -3); // ptr reftable nil ptr
@@ -419,7 +440,10 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 			lua_rawset(l, -4); // ptr reftable nil
 			lua_pop(l, 3); // [empty]
 
-			Json inner = Json::array();
+			out.Key("table");
+			out.BeginArray();
+			if (markEntries)
+				out.Mark();
 
 			lua_pushvalue(l, idx);
 			lua_pushnil(l);
@@ -429,20 +453,16 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 				std::string new_key = key + "." + (k ? std::string(k) : "<" + std::string(lua_typename(l, lua_type(l, -1))) + ">");
 				lua_pop(l, 1);
 
-				// Copy the values to pickle, as they might be mutated by the pickling process.
-				Json out_k, out_v;
-
-				pickle_json(l, -2, out_k, new_key);
-				pickle_json(l, -1, out_v, new_key);
-
-				inner.push_back(out_k);
-				inner.push_back(out_v);
+				pickle_cbor(l, -2, out, new_key);
+				pickle_cbor(l, -1, out, new_key);
+				if (markEntries)
+					out.Mark();
 
 				lua_pop(l, 1);
 			}
 			lua_pop(l, 1);
 
-			out["table"] = Json(inner);
+			out.End();
 		}
 
 		break;
@@ -459,7 +479,13 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 
 		Json obj = Json::object();
 		lo->ToJson(obj);
-		out["userdata"] = obj;
+		out.BeginMap(cl ? 2 : 1);
+		if (cl) {
+			out.Key("lua_class");
+			out.String(cl);
+		}
+		out.Key("userdata");
+		out.Value(obj);
 		break;
 	}
 
@@ -623,10 +649,11 @@ void LuaSerializer::UninitTableRefs()
 	lua_setfield(l, LUA_REGISTRYINDEX, "PiLuaRefLoadTable");
 }
 
-void LuaSerializer::ToJson(Json &jsonObj)
+void LuaSerializer::ToCbor(CborWriter &out)
 {
 	PROFILE_SCOPED()
 	lua_State *l = Lua::manager->GetLuaState();
+	LuaAllocator::TagScope tagScope(l, "save");
 
 	LUA_DEBUG_START(l);
 
@@ -654,9 +681,10 @@ void LuaSerializer::ToJson(Json &jsonObj)
 
 	lua_pop(l, 1);
 
-	Json pickled;
-	pickle_json(l, savetable, pickled);
-	jsonObj["lua_modules_json"] = pickled;
+	// each module's data is a piece of its own for incremental saves
+	out.Key("lua_modules_json");
+	pickle_cbor(l, savetable, out, "", true);
+	out.Mark();
 
 	lua_pop(l, 1);
 
@@ -667,6 +695,8 @@ void LuaSerializer::FromJson(const Json &jsonObj)
 {
 	PROFILE_SCOPED()
 	lua_State *l = Lua::manager->GetLuaState();
+	// the module data of the game loaded is put down to this
+	LuaAllocator::TagScope tagScope(l, "load");
 
 	LUA_DEBUG_START(l);
 
@@ -9,13 +9,16 @@
 #include "LuaObject.h"
 #include "LuaRef.h"
 
+class CborWriter;
+
 class LuaSerializer : public DeleteEmitter {
 	friend class LuaObject<LuaSerializer>;
 	friend void LuaRef::SaveToJson(Json &jsonObj);
 	friend void LuaRef::LoadFromJson(const Json &jsonObj);
 
 public:
-	void ToJson(Json &jsonObj);
+	// writes the "lua_modules_json" entry of the map being written
+	void ToCbor(CborWriter &out);
 	void FromJson(const Json &jsonObj);
 
 	void InitTableRefs();
@@ -29,6 +32,9 @@ private:
 	static const char *unpickle(lua_State *l, const char *pos);
 
 	static void pickle_json(lua_State *l, int idx, Json &out, const std::string &key = "");
+	// what pickle_json builds, written straight out as CBOR. markEntries
+	// marks the writer after each entry of the (top level) table
+	static void pickle_cbor(lua_State *l, int idx, CborWriter &out, const std::string &key = "", bool markEntries = false);
 	static void unpickle_json(lua_State *l, const Json &value);
 };
 
@@ -686,6 +686,128 @@ static int l_space_get_bodies(lua_State *l)
 	return 1;
 }
 
+/*
+ * Function: GetNearestBodies
+ *
+ * Get the <Body> objects closest to a body
+ *
+ * bodies = Space.GetNearestBodies(body, count, maxDistance)
+ *
+ * Parameters:
+ *
+ *   body - the <Body> to search around. It isn't included in the results
+ *
+ *   count - the most bodies to return
+ *
+ *   maxDistance - optional. Bodies further away than this, in metres, are
+ *                 left out. Defaults to no limit
+ *
+ * Return:
+ *
+ *   bodies - an array of up to count <Body> objects, nearest first
+ *
+ * Example:
+ *
+ * > -- the three bodies closest to the player within 100km
+ * > local bodies = Space.GetNearestBodies(Game.player, 3, 100000)
+ *
+ * Availability:
+ *
+ *   2020
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_space_get_nearest_bodies(lua_State *l)
+{
+	if (!GameLocator::getGame()) {
+		luaL_error(l, "Game is not started");
+		return 0;
+	}
+
+	LUA_DEBUG_START(l);
+
+	const Body *body = LuaObject<Body>::CheckFromLua(1);
+	const int count = luaL_checkinteger(l, 2);
+	const double maxDist = luaL_optnumber(l, 3, HUGE_VAL);
+
+	lua_newtable(l);
+
+	if (count > 0) {
+		// ask for one more, the body itself is always among the nearest
+		Space::BodyNearList nearby = GameLocator::getGame()->GetSpace()->GetNearestBodies(
+			body->GetPositionRelTo(Frame::GetRootFrameId()), size_t(count) + 1, maxDist);
+		int n = 0;
+		for (Body *b : nearby) {
+			if (b == body) continue;
+			if (n == count) break;
+			lua_pushinteger(l, ++n);
+			LuaObject<Body>::PushToLua(b);
+			lua_rawset(l, -3);
+		}
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
+/*
+ * Function: BenchmarkNearFinder
+ *
+ * Time the spatial index of the bodies in space against the search it
+ * replaced: for a few distances, query around every body with each.
+ * The results are also written to the log.
+ *
+ * > results = Space.BenchmarkNearFinder()
+ *
+ * Return:
+ *
+ *   results - an array with a table for each distance tried, with dist
+ *             (metres), shell_ms and shell_candidates (the old search
+ *             through a shell of distance from the root frame origin),
+ *             grid_ms and grid_bodies (GetBodiesMaybeNear), and nearest_ms
+ *             (the closest 8 bodies with GetNearestBodies)
+ *
+ * Availability:
+ *
+ *   2020
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_space_benchmark_near_finder(lua_State *l)
+{
+	if (!GameLocator::getGame()) {
+		luaL_error(l, "Game is not started");
+		return 0;
+	}
+
+	LUA_DEBUG_START(l);
+
+	const std::vector<Space::NearFinderBenchmark> results = GameLocator::getGame()->GetSpace()->BenchmarkNearFinder();
+
+	lua_newtable(l);
+	int n = 0;
+	for (const Space::NearFinderBenchmark &result : results) {
+		lua_pushinteger(l, ++n);
+		lua_newtable(l);
+		pi_lua_settable(l, "dist", result.dist);
+		pi_lua_settable(l, "shell_ms", result.shellMs);
+		pi_lua_settable(l, "shell_candidates", int(result.shellCandidates));
+		pi_lua_settable(l, "grid_ms", result.gridMs);
+		pi_lua_settable(l, "grid_bodies", int(result.gridBodies));
+		pi_lua_settable(l, "nearest_ms", result.nearestMs);
+		lua_rawset(l, -3);
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
 static int l_space_dump_frames(lua_State *l)
 {
 	if (!GameLocator::getGame()) {
@@ -731,6 +853,8 @@ void LuaSpace::Register()
 
 		{ "GetBody", l_space_get_body },
 		{ "GetBodies", l_space_get_bodies },
+		{ "GetNearestBodies", l_space_get_nearest_bodies },
+		{ "BenchmarkNearFinder", l_space_benchmark_near_finder },
 
 
 		{ "DbgDumpFrames", l_space_dump_frames },
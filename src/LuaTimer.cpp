@@ -4,6 +4,7 @@
 #include "LuaTimer.h"
 
 #include "Lua.h"
+#include "LuaAllocator.h"
 #include "LuaManager.h"
 #include "LuaObject.h"
 #include "LuaUtils.h"
@@ -34,6 +35,7 @@ void LuaTimer::Tick(const double actualTime)
 	m_time = actualTime;
 
 	lua_State *l = Lua::manager->GetLuaState();
+	LuaAllocator::TagScope tagScope(l, "timers");
 
 	LUA_DEBUG_START(l);
 
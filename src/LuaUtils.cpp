@@ -4,6 +4,7 @@
 #include "LuaUtils.h"
 
 #include "FileSystem.h"
+#include "LuaAllocator.h"
 #include "libs/libs.h"
 #include "libs/stringUtils.h"
 #include "libs/StringRange.h"
@@ -886,6 +887,8 @@ int pi_lua_loadfile(lua_State *l, const FileSystem::FileData &code)
 static void pi_lua_dofile(lua_State *l, const FileSystem::FileData &code, int nret)
 {
 	assert(l);
+	// what a module allocates as it's loaded is put down to it
+	LuaAllocator::TagScope tagScope(l, code.GetInfo().GetPath());
 	LUA_DEBUG_START(l);
 
 	if (pi_lua_loadfile(l, code) != LUA_OK) {
@@ -135,13 +135,15 @@ void Missile::StaticUpdate(const float timeStep)
 	}
 }
 
-void Missile::TimeStepUpdate(const float timeStep)
+void Missile::PreIntegrate(const float timeStep)
 {
-
 	const vector3d thrust = GetPropulsion()->GetActualLinThrust();
 	AddRelForce(thrust);
 	AddRelTorque(GetPropulsion()->GetActualAngThrust());
+}
 
+void Missile::TimeStepUpdate(const float timeStep)
+{
 	DynamicBody::TimeStepUpdate(timeStep);
 	GetPropulsion()->UpdateFuel(timeStep);
 
@@ -200,13 +202,13 @@ void Missile::Explode()
 	SfxManager::Add(this, TYPE_EXPLOSION);
 }
 
-void Missile::NotifyRemoved(const Body *const removedBody)
+void Missile::NotifyRemoved(const std::vector<const Body *> &removedBodies)
 {
-	if (m_curAICmd) m_curAICmd->OnDeleted(removedBody);
-	if (m_owner == removedBody) {
+	if (m_curAICmd) m_curAICmd->OnDeleted(removedBodies);
+	if (IsRemoved(removedBodies, m_owner)) {
 		m_owner = 0;
 	}
-	DynamicBody::NotifyRemoved(removedBody);
+	DynamicBody::NotifyRemoved(removedBodies);
 }
 
 void Missile::Arm()
@@ -20,10 +20,11 @@ public:
 	Json SaveToJson(Space *space) override;
 
 	void StaticUpdate(const float timeStep) override;
+	void PreIntegrate(const float timeStep) override;
 	void TimeStepUpdate(const float timeStep) override;
 	bool OnCollision(Object *o, uint32_t flags, double relVel) override;
 	bool OnDamage(Object *attacker, float kgDamage, const CollisionContact &contactData) override;
-	void NotifyRemoved(const Body *const removedBody) override;
+	void NotifyRemoved(const std::vector<const Body *> &removedBodies) override;
 	void PostLoadFixup(Space *space) override;
 	void Render(const Camera *camera, const vector3d &viewCoords, const matrix4x4d &viewTransform) override;
 
@@ -210,7 +210,7 @@ void ModelBody::SetModel(const char *modelName)
 	m_modelName = modelName;
 
 	//create model instance (some modelbodies, like missiles could avoid this)
-	m_model = ModelCache::FindModel(m_modelName)->MakeInstance();
+	m_model = ModelCache::FindModelForInstance(m_modelName)->MakeInstance();
 	m_idleAnimation = m_model->FindAnimation("idle");
 
 	SetClipRadius(m_model->GetDrawClipRadius());
@@ -297,15 +297,16 @@ void ModelBody::MoveGeoms(const matrix4x4d &m, const vector3d &p)
 
 	for (auto it = m_dynGeoms.begin(); it != m_dynGeoms.end(); ++it) {
 		//combine orient & pos
-		static matrix4x4d s_tempMat;
+		// (not static: this may run on several threads, see Space::IntegrateBodies)
+		matrix4x4d tempMat;
 		for (unsigned int i = 0; i < 12; i++)
-			s_tempMat[i] = m[i];
-		s_tempMat[12] = p.x;
-		s_tempMat[13] = p.y;
-		s_tempMat[14] = p.z;
-		s_tempMat[15] = m[15];
+			tempMat[i] = m[i];
+		tempMat[12] = p.x;
+		tempMat[13] = p.y;
+		tempMat[14] = p.z;
+		tempMat[15] = m[15];
 
-		(*it)->MoveTo(s_tempMat * (*it)->m_animTransform);
+		(*it)->MoveTo(tempMat * (*it)->m_animTransform);
 	}
 }
 
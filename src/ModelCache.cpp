@@ -3,64 +3,413 @@
 
 #include "ModelCache.h"
 
+#include "CollMesh.h"
+#include "FileSystem.h"
+#include "GameConfSingleton.h"
+#include "GameConfig.h"
+#include "JobQueue.h"
 #include "Shields.h"
 #include "scenegraph/Loader.h"
 #include "scenegraph/Model.h"
+#include "libs/stringUtils.h"
 #include "libs/utils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// at most this many models read in the background are created per Update,
+// as that has to happen on the main thread
+static const int MAX_CREATED_PER_UPDATE = 2;
+
 ModelCache::ModelMap ModelCache::s_models;
+std::map<std::string, FileSystem::FileInfo> ModelCache::s_files;
+JobQueue *ModelCache::s_queue = nullptr;
+size_t ModelCache::s_budget = 0;
+size_t ModelCache::s_bytes = 0;
+uint64_t ModelCache::s_useCount = 0;
+
+// the stages of a background load. whoever moves a stage from QUEUED_* to
+// its running state, a job or the main thread needing the model right away,
+// does that bit of work; the other side then has nothing to do for it
+struct ModelCache::Load {
+	enum Stage {
+		QUEUED_READ,
+		READING,
+		READ, // the main thread creates the model
+		QUEUED_TREES,
+		BUILDING_TREES,
+		DONE
+	};
+
+	Load(const FileSystem::FileInfo &info_) :
+		info(info_),
+		read(false),
+		stage(QUEUED_READ) {}
+
+	FileSystem::FileInfo info;
+	SceneGraph::BinaryConverter::ModelFile file;
+	bool read;
+	RefCountedPtr<CollMesh> collMesh;
+	std::atomic<int> stage;
+
+	// false if somebody else got to the stage first
+	bool Claim(Stage from, Stage to)
+	{
+		int expected = from;
+		return stage.compare_exchange_strong(expected, to);
+	}
+
+	void WaitWhile(Stage running) const
+	{
+		while (stage.load() == running)
+			std::this_thread::yield();
+	}
+
+	void ReadFile()
+	{
+		read = SceneGraph::BinaryConverter::ReadModelFile(info, file);
+		stage = READ;
+	}
 
-void ModelCache::Init(const ShipType::t_mapTypes &types)
+	void BuildTrees()
+	{
+		collMesh->BuildTrees();
+		stage = DONE;
+	}
+};
+
+namespace {
+	// the main thread picks up the results in ModelCache::Update or when the
+	// model is asked for, so there's nothing to do in OnFinish
+	class ReadModelJob : public Job {
+	public:
+		ReadModelJob(std::shared_ptr<ModelCache::Load> load) :
+			m_load(load) {}
+
+		virtual void OnRun() override // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+		{
+			if (m_load->Claim(ModelCache::Load::QUEUED_READ, ModelCache::Load::READING))
+				m_load->ReadFile();
+		}
+		virtual void OnFinish() override {}
+
+	private:
+		std::shared_ptr<ModelCache::Load> m_load;
+	};
+
+	class BuildTreesJob : public Job {
+	public:
+		BuildTreesJob(std::shared_ptr<ModelCache::Load> load) :
+			m_load(load) {}
+
+		virtual void OnRun() override // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+		{
+			if (m_load->Claim(ModelCache::Load::QUEUED_TREES, ModelCache::Load::BUILDING_TREES))
+				m_load->BuildTrees();
+		}
+		virtual void OnFinish() override {}
+
+	private:
+		std::shared_ptr<ModelCache::Load> m_load;
+	};
+} // namespace
+
+void ModelCache::Init(const ShipType::t_mapTypes &types, JobQueue *queue)
 {
+	PROFILE_SCOPED()
+	typedef std::chrono::steady_clock Clock;
+	auto ms = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	s_queue = queue;
+	s_budget = size_t(std::max(0, GameConfSingleton::getInstance().Int("ModelCacheBudget"))) * 1024 * 1024;
+
+	// find the .sgm of each model once, rather than the loader going
+	// through the whole models directory for every one of them
+	Clock::time_point start = Clock::now();
+	s_files.clear();
+	for (FileSystem::FileEnumerator files(FileSystem::gameDataFiles, "models", FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
+		const FileSystem::FileInfo &info = files.Current();
+		if (info.IsFile() && stringUtils::ends_with_ci(info.GetPath(), ".sgm")) {
+			const std::string name = info.GetName();
+			s_files.insert(std::make_pair(name.substr(0, name.size() - 4), info)); // the first one found wins, like the loader
+		}
+	}
+	const double findTime = ms(start);
+
+	if (GameConfSingleton::getInstance().Int("LazyModelLoading")) {
+		Output("ModelCache: found %u .sgm models in %.1f ms, ships are loaded on demand\n", uint32_t(s_files.size()), findTime);
+		return;
+	}
+
+	std::vector<std::string> names;
 	for (auto const &type : types) {
 		// Skim only ships or it doesn't start as it search a 'missile_guided' which doesn't exist
-		if (type.second.tag == ShipType::Tag::TAG_SHIP) {
-			findmodel(type.first);
+		if (type.second.tag == ShipType::Tag::TAG_SHIP && s_models.find(type.first) == s_models.end())
+			names.push_back(type.first);
+	}
+	if (!queue) {
+		for (const std::string &name : names)
+			lookup(name, false, true);
+		return;
+	}
+
+	struct Pending {
+		std::string name;
+		FileSystem::FileInfo info;
+		SceneGraph::BinaryConverter::ModelFile file;
+		bool read;
+		SceneGraph::Model *model;
+		size_t bytes;
+	};
+	std::vector<Pending> pending;
+	std::vector<std::string> others; // no .sgm, these go through the full loader
+	for (const std::string &name : names) {
+		auto it = s_files.find(name);
+		if (it != s_files.end())
+			pending.push_back({ name, it->second, SceneGraph::BinaryConverter::ModelFile(), false, nullptr, 0 });
+		else
+			others.push_back(name);
+	}
+
+	start = Clock::now();
+	ParallelFor(queue, uint32_t(pending.size()), [&pending](uint32_t i) {
+		pending[i].read = SceneGraph::BinaryConverter::ReadModelFile(pending[i].info, pending[i].file);
+	});
+	const double readTime = ms(start);
+
+	// materials and vertex buffers are created here, so this can't be spread
+	// out. the collision trees are left for later
+	start = Clock::now();
+	for (Pending &p : pending) {
+		if (!p.read)
+			continue;
+		SceneGraph::Loader loader;
+		p.model = loader.LoadModel(p.file, false);
+		p.bytes = p.file.data.size();
+		p.file.data.clear();
+		p.file.data.shrink_to_fit();
+	}
+	const double createTime = ms(start);
+
+	start = Clock::now();
+	ParallelFor(queue, uint32_t(pending.size()), [&pending](uint32_t i) {
+		if (pending[i].model)
+			pending[i].model->GetCollisionMesh()->BuildTrees();
+	});
+	const double treeTime = ms(start);
+
+	start = Clock::now();
+	for (Pending &p : pending) {
+		if (p.model) {
+			Shields::ReparentShieldNodes(p.model);
+			Entry &entry = s_models[p.name];
+			entry.model = p.model;
+			entry.bytes = p.bytes;
+			entry.pinned = true; // loaded up front, so they're meant to stay
+		} else {
+			others.push_back(p.name);
 		}
 	}
+	for (const std::string &name : others)
+		lookup(name, false, true);
+	const double otherTime = ms(start);
+
+	Output("ModelCache: %u models: find %.1f ms, read %.1f ms, create %.1f ms, collision trees %.1f ms, others (%u) %.1f ms\n",
+		uint32_t(names.size()), findTime, readTime, createTime, treeTime, uint32_t(others.size()), otherTime);
 }
 
-SceneGraph::Model *ModelCache::findmodel(const std::string &name)
+ModelCache::Entry *ModelCache::loadmodel(const std::string &name)
 {
-	ModelCache::ModelMap::iterator it = s_models.find(name);
+	try {
+		SceneGraph::Loader loader;
+		SceneGraph::Model *m = loader.LoadModel(name);
+		Shields::ReparentShieldNodes(m);
+		Entry &entry = s_models[name];
+		entry.model = m;
+		entry.lastUse = ++s_useCount;
+		return &entry;
+	} catch (SceneGraph::LoadingError &) {
+		throw ModelNotFoundException(name);
+	}
+}
 
-	if (it == s_models.end()) {
-		try {
+bool ModelCache::startload(const std::string &name)
+{
+	auto it = s_files.find(name);
+	if (it == s_files.end())
+		return false;
+
+	Entry &entry = s_models[name];
+	entry.load = std::make_shared<Load>(it->second);
+	if (s_queue)
+		entry.job = s_queue->Queue(new ReadModelJob(entry.load));
+	return true;
+}
+
+bool ModelCache::advance(Entry &entry, bool wait)
+{
+	PROFILE_SCOPED()
+	Load &load = *entry.load;
+	// without a queue nobody else is going to do the work
+	const bool work = wait || !s_queue;
+
+	if (work && load.Claim(Load::QUEUED_READ, Load::READING))
+		load.ReadFile();
+	if (wait)
+		load.WaitWhile(Load::READING);
+
+	if (load.stage.load() == Load::READ) {
+		if (load.read) {
 			SceneGraph::Loader loader;
-			SceneGraph::Model *m = loader.LoadModel(name);
-			Shields::ReparentShieldNodes(m);
-			s_models[name] = m;
-			return m;
-		} catch (SceneGraph::LoadingError &) {
-			throw ModelNotFoundException(name);
+			entry.model = loader.LoadModel(load.file, false);
+		}
+		entry.bytes = load.file.data.size();
+		load.file.data.clear();
+		load.file.data.shrink_to_fit();
+		if (!entry.model) {
+			entry.load.reset();
+			entry.job = Job::Handle();
+			return true;
 		}
+		load.collMesh = entry.model->GetCollisionMesh();
+		load.stage = Load::QUEUED_TREES;
+		if (!work)
+			entry.job = s_queue->Queue(new BuildTreesJob(entry.load));
 	}
-	return it->second;
+
+	if (work && load.Claim(Load::QUEUED_TREES, Load::BUILDING_TREES))
+		load.BuildTrees();
+	if (wait)
+		load.WaitWhile(Load::BUILDING_TREES);
+
+	if (load.stage.load() != Load::DONE)
+		return false;
+
+	Shields::ReparentShieldNodes(entry.model);
+	entry.load.reset();
+	entry.job = Job::Handle();
+	s_bytes += entry.bytes;
+	return true;
 }
 
-SceneGraph::Model *ModelCache::FindModel(const std::string &name, bool allowPlaceholder)
+ModelCache::Entry *ModelCache::findentry(const std::string &name, bool wait)
+{
+	ModelMap::iterator it = s_models.find(name);
+	if (it == s_models.end()) {
+		// models without a .sgm can only be loaded right here
+		if (!startload(name))
+			return loadmodel(name);
+		it = s_models.find(name);
+	}
+
+	Entry &entry = it->second;
+	entry.lastUse = ++s_useCount;
+	if (entry.load && !advance(entry, wait))
+		return nullptr;
+	if (!entry.model) {
+		s_models.erase(it);
+		return loadmodel(name);
+	}
+	return &entry;
+}
+
+SceneGraph::Model *ModelCache::lookup(const std::string &name, bool allowPlaceholder, bool pin)
 {
-	SceneGraph::Model *m = 0;
+	Entry *entry = nullptr;
 	try {
-		m = findmodel(name);
+		entry = findentry(name, true);
 	} catch (const ModelCache::ModelNotFoundException &) {
 		Output("Could not find model: %s\n", name.c_str());
 		if (allowPlaceholder) {
 			try {
-				m = findmodel("error");
+				entry = findentry("error", true);
+				pin = true;
 			} catch (const ModelCache::ModelNotFoundException &) {
 				Error("Could not find placeholder model");
 			}
 		}
 	}
 
-	return m;
+	if (!entry)
+		return nullptr;
+	if (pin && !entry->pinned) {
+		entry->pinned = true;
+		s_bytes -= entry->bytes;
+	}
+	return entry->model;
+}
+
+SceneGraph::Model *ModelCache::FindModel(const std::string &name, bool allowPlaceholder)
+{
+	return lookup(name, allowPlaceholder, true);
+}
+
+SceneGraph::Model *ModelCache::FindModelForInstance(const std::string &name)
+{
+	return lookup(name, true, false);
+}
+
+SceneGraph::Model *ModelCache::RequestModel(const std::string &name, SceneGraph::Model *placeholder)
+{
+	try {
+		Entry *entry = findentry(name, false);
+		return entry ? entry->model : placeholder;
+	} catch (const ModelCache::ModelNotFoundException &) {
+		return lookup(name, true, false);
+	}
+}
+
+void ModelCache::Prefetch(const std::string &name)
+{
+	// without a queue a prefetch would be a plain load
+	if (!s_queue || s_models.count(name))
+		return;
+	startload(name);
+}
+
+void ModelCache::Update()
+{
+	PROFILE_SCOPED()
+	int created = 0;
+	for (auto &it : s_models) {
+		Entry &entry = it.second;
+		if (!entry.load)
+			continue;
+		if (entry.load->stage.load() == Load::READ && created++ >= MAX_CREATED_PER_UPDATE)
+			continue;
+		if (advance(entry, false) && !entry.model)
+			Output("ModelCache: couldn't load %s in the background\n", it.first.c_str());
+	}
+
+	if (!s_budget || s_bytes <= s_budget)
+		return;
+
+	std::vector<ModelMap::iterator> evictable;
+	for (ModelMap::iterator it = s_models.begin(); it != s_models.end(); ++it) {
+		const Entry &entry = it->second;
+		if (entry.model && !entry.load && !entry.pinned && entry.bytes)
+			evictable.push_back(it);
+	}
+	std::sort(evictable.begin(), evictable.end(), [](ModelMap::iterator a, ModelMap::iterator b) {
+		return a->second.lastUse < b->second.lastUse;
+	});
+	for (ModelMap::iterator it : evictable) {
+		if (s_bytes <= s_budget)
+			break;
+		Output("ModelCache: evicting %s (%.1f KB)\n", it->first.c_str(), it->second.bytes / 1024.f);
+		s_bytes -= it->second.bytes;
+		delete it->second.model;
+		s_models.erase(it);
+	}
 }
 
 void ModelCache::Flush()
 {
 	for (ModelMap::iterator it = s_models.begin(); it != s_models.end(); ++it) {
-		delete it->second;
+		delete it->second.model;
 	}
 	s_models.clear();
+	s_bytes = 0;
 }
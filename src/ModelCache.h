@@ -5,9 +5,12 @@
 #define _MODELCACHE_H
 
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
+#include "FileSystem.h"
+#include "JobQueue.h"
 #include "ShipType.h"
 
 namespace SceneGraph {
@@ -29,16 +32,69 @@ public:
 			std::runtime_error("Could not find model '" + name + "'\n") {}
 	};
 
-	static void Init(const ShipType::t_mapTypes &types);
+	// reading, decompressing and building the collision trees of the .sgm
+	// models run on the queue, only creating the models (and their GPU
+	// resources) is left to the main thread. without a queue it's all serial.
+	// with LazyModelLoading in the config the ship models aren't loaded here
+	// at all, only found, and each one is loaded when it's first asked for
+	static void Init(const ShipType::t_mapTypes &types, JobQueue *queue = nullptr);
+
+	// loads the model if it isn't yet (waiting for it if it's being loaded
+	// in the background). the model is kept for as long as the game runs, as
+	// the caller may hold on to the pointer
 	static SceneGraph::Model *FindModel(const std::string &name, bool allowPlaceholder = true);
+	// for callers that only make instances of the model: the pointer is good
+	// until the next Update, after which the model may be evicted
+	static SceneGraph::Model *FindModelForInstance(const std::string &name);
+	// doesn't wait: if the model isn't ready yet it's loaded in the
+	// background, and the placeholder is returned meanwhile. same rules for
+	// the pointer as FindModelForInstance
+	static SceneGraph::Model *RequestModel(const std::string &name, SceneGraph::Model *placeholder = nullptr);
+	// start loading a model that is likely to be needed soon
+	static void Prefetch(const std::string &name);
+
+	// call once per frame from the main thread. creates the models whose
+	// files have been read in the background, and evicts the least recently
+	// used ones once over ModelCacheBudget. instances share their geometry,
+	// materials and collision mesh by reference, so evicting a model only
+	// frees what no instance of it still uses
+	static void Update();
+
+	struct Load; // a model being loaded in the background, for its jobs
 
 private:
+	struct Entry {
+		Entry() :
+			model(nullptr),
+			bytes(0),
+			lastUse(0),
+			pinned(false) {}
+		SceneGraph::Model *model; // not usable while load is set
+		std::shared_ptr<Load> load;
+		Job::Handle job;
+		size_t bytes; // size of the decompressed .sgm, 0 if unknown
+		uint64_t lastUse;
+		bool pinned; // never evicted
+	};
+
 	static void Flush();
 
-	static SceneGraph::Model *findmodel(const std::string &name);
+	static SceneGraph::Model *lookup(const std::string &name, bool allowPlaceholder, bool pin);
+	// null if the model is still loading and wait is false
+	static Entry *findentry(const std::string &name, bool wait);
+	static Entry *loadmodel(const std::string &name);
+	static bool startload(const std::string &name);
+	// moves a background load on as far as it can go, to the end if wait.
+	// true once the load is over, with entry.model null if it failed
+	static bool advance(Entry &entry, bool wait);
 
-	typedef std::map<std::string, SceneGraph::Model *> ModelMap;
+	typedef std::map<std::string, Entry> ModelMap;
 	static ModelMap s_models;
+	static std::map<std::string, FileSystem::FileInfo> s_files; // .sgm of each model
+	static JobQueue *s_queue;
+	static size_t s_budget;
+	static size_t s_bytes; // of the models that can be evicted
+	static uint64_t s_useCount;
 };
 
 #endif
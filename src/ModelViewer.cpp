@@ -185,6 +185,7 @@ void ModelViewer::Run(const std::string &modelName)
 	videoSettings.vsync = (config->Int("VSync") != 0);
 	videoSettings.useTextureCompression = (config->Int("UseTextureCompression") != 0);
 	videoSettings.useAnisotropicFiltering = (config->Int("UseAnisotropicFiltering") != 0);
+	videoSettings.sortDraws = (config->Int("SortDraws") != 0);
 	videoSettings.iconFile = OS::GetIconFilename();
 	videoSettings.title = "Model viewer";
 		RendererLocator::provideRenderer(Graphics::Init(videoSettings));
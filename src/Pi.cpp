@@ -93,7 +93,7 @@ std::unique_ptr<Graphics::Drawables::TexturedQuad> Pi::m_renderQuad;
 Graphics::RenderState *Pi::m_quadRenderState = nullptr;
 std::vector<Pi::InternalRequests> Pi::m_internalRequests;
 
-std::unique_ptr<AsyncJobQueue> Pi::asyncJobQueue;
+std::unique_ptr<JobQueue> Pi::asyncJobQueue;
 std::unique_ptr<SyncJobQueue> Pi::syncJobQueue;
 
 Pi::Pi(const std::map<std::string, std::string> &options, const SystemPath &startPath, bool no_gui)
@@ -26,7 +26,6 @@ namespace MainState_ {
 	class QuitState;
 }
 
-class AsyncJobQueue;
 class SyncJobQueue;
 class JobQueue;
 
@@ -95,7 +94,7 @@ private:
 	static void TestGPUJobsSupport();
 
 	static std::vector<InternalRequests> m_internalRequests;
-	static std::unique_ptr<AsyncJobQueue> asyncJobQueue;
+	static std::unique_ptr<JobQueue> asyncJobQueue;
 	static std::unique_ptr<SyncJobQueue> syncJobQueue;
 
 	static Graphics::RenderTarget *m_renderTarget;
@@ -6,6 +6,7 @@
 #include "graphics/Renderer.h"
 #include "graphics/RendererLocator.h"
 
+#include "LuaAllocator.h"
 #include "LuaManager.h"
 
 #include "graphics/opengl/TextureGL.h" // nasty, usage of GL is implementation specific
@@ -418,6 +419,7 @@ void PiGui::EndFrame()
 void PiGui::Render(double delta, std::string handler)
 {
 	PROFILE_SCOPED()
+	LuaAllocator::TagScope tagScope(Lua::manager->GetLuaState(), "pigui:" + handler);
 	ScopedTable t(m_handlers);
 	if (t.Get<bool>(handler)) {
 		t.Call<bool>(handler, delta);
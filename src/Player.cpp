@@ -182,19 +182,24 @@ void Player::SetAlertState(Ship::AlertState as)
 	Ship::SetAlertState(as);
 }
 
-void Player::NotifyRemoved(const Body *const removedBody)
+void Player::NotifyRemoved(const std::vector<const Body *> &removedBodies)
 {
-	if (GetNavTarget() == removedBody)
+	if (IsRemoved(removedBodies, GetNavTarget()))
 		SetNavTarget(0);
 
-	if (GetCombatTarget() == removedBody) {
+	const Body *combatTarget = GetCombatTarget();
+	if (IsRemoved(removedBodies, combatTarget)) {
 		SetCombatTarget(0);
 
-		if (!GetNavTarget() && removedBody->IsType(Object::SHIP))
-			SetNavTarget(static_cast<const Ship *>(removedBody)->GetHyperspaceCloud());
+		if (!GetNavTarget() && combatTarget->IsType(Object::SHIP)) {
+			// unless the cloud is going too
+			HyperspaceCloud *cloud = static_cast<const Ship *>(combatTarget)->GetHyperspaceCloud();
+			if (!IsRemoved(removedBodies, cloud))
+				SetNavTarget(cloud);
+		}
 	}
 
-	Ship::NotifyRemoved(removedBody);
+	Ship::NotifyRemoved(removedBodies);
 }
 
 //XXX ui stuff
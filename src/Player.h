@@ -32,7 +32,7 @@ public:
 	bool SetWheelState(bool down) override; // returns success of state change, NOT state itself
 	Missile *SpawnMissile(ShipType::Id missile_type, int power = -1) override;
 	void SetAlertState(Ship::AlertState as) override;
-	void NotifyRemoved(const Body *const removedBody) override;
+	void NotifyRemoved(const std::vector<const Body *> &removedBodies) override;
 
 	void SetShipType(const ShipType::Id &shipId) override;
 
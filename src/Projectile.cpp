@@ -197,9 +197,9 @@ void Projectile::UpdateInterpTransform(double alpha)
 	m_interpPos = alpha * GetPosition() + (1.0 - alpha) * oldPos;
 }
 
-void Projectile::NotifyRemoved(const Body *const removedBody)
+void Projectile::NotifyRemoved(const std::vector<const Body *> &removedBodies)
 {
-	if (m_parent == removedBody) m_parent = 0;
+	if (IsRemoved(removedBodies, m_parent)) m_parent = 0;
 }
 
 void Projectile::TimeStepUpdate(const float timeStep)
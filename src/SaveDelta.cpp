@@ -0,0 +1,195 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SaveDelta.h"
+
+#include "CborStream.h"
+#include "jenkins/lookup3.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+
+namespace {
+	// 2: the hash of the save the delta makes, to check it against
+	const int s_deltaVersion = 2;
+
+	// calls fn(offset, length) for each piece of data between the marks
+	template <typename Fn>
+	void ForEachPiece(const std::string &data, const std::vector<size_t> &marks, Fn fn)
+	{
+		size_t start = 0;
+		for (size_t mark : marks) {
+			if (mark > start && mark <= data.size()) {
+				fn(start, mark - start);
+				start = mark;
+			}
+		}
+		if (start < data.size())
+			fn(start, data.size() - start);
+	}
+
+	uint64_t ReadUInt(CborReader &reader)
+	{
+		CborReader::Item item;
+		reader.Next(item);
+		if (item.type != CborReader::UINT)
+			throw CborError("bad number in save delta");
+		return item.uintValue;
+	}
+} // namespace
+
+std::string SaveDelta::GetDeltaPath(const std::string &savePath)
+{
+	return savePath + ".delta";
+}
+
+uint64_t SaveDelta::Hash(const char *data, size_t length)
+{
+	uint32_t c = 0, b = 0;
+	lookup3_hashlittle2(data, length, &c, &b);
+	return uint64_t(c) << 32 | b;
+}
+
+std::shared_ptr<SaveDelta::Base> SaveDelta::MakeBase(const std::string &data, const std::vector<size_t> &marks)
+{
+	PROFILE_SCOPED()
+	std::shared_ptr<Base> base(new Base);
+	base->hash = Hash(data.data(), data.size());
+	base->size = data.size();
+	ForEachPiece(data, marks, [&](size_t offset, size_t length) {
+		// the first of identical pieces is as good as any other
+		base->pieces.insert({ Hash(data.data() + offset, length), Base::Range{ offset, length } });
+	});
+	return base;
+}
+
+std::string SaveDelta::MakeDelta(const Base &base, const std::string &data, const std::vector<size_t> &marks)
+{
+	PROFILE_SCOPED()
+	CborWriter out(64 * 1024);
+	out.BeginMap(6);
+	out.Key("delta_version");
+	out.Int(s_deltaVersion);
+	out.Key("base_hash");
+	out.UInt(base.hash);
+	out.Key("base_size");
+	out.UInt(base.size);
+	out.Key("size");
+	out.UInt(data.size());
+	// pieces are only matched by their hash and length
+	out.Key("hash");
+	out.UInt(Hash(data.data(), data.size()));
+	out.Key("pieces");
+	out.BeginArray();
+
+	// neighbouring pieces that are new, or that are next to each other in
+	// the base, are written as one
+	Base::Range copy = { 0, 0 };
+	Base::Range added = { 0, 0 };
+	auto flushCopy = [&]() {
+		if (copy.length) {
+			out.BeginArray(2);
+			out.UInt(copy.offset);
+			out.UInt(copy.length);
+		}
+		copy.length = 0;
+	};
+	auto flushAdded = [&]() {
+		if (added.length)
+			out.Bytes(data.data() + added.offset, added.length);
+		added.length = 0;
+	};
+
+	ForEachPiece(data, marks, [&](size_t offset, size_t length) {
+		auto it = base.pieces.find(Hash(data.data() + offset, length));
+		if (it == base.pieces.end() || it->second.length != length) {
+			flushCopy();
+			if (!added.length)
+				added.offset = offset;
+			added.length += length;
+		} else {
+			flushAdded();
+			if (copy.length && copy.offset + copy.length != it->second.offset)
+				flushCopy();
+			if (!copy.length)
+				copy.offset = it->second.offset;
+			copy.length += length;
+		}
+	});
+	flushCopy();
+	flushAdded();
+
+	out.End();
+	return out.TakeData();
+}
+
+bool SaveDelta::ApplyDelta(const std::string &base, const char *delta, size_t length, std::string &out)
+{
+	PROFILE_SCOPED()
+	CborReader reader(delta, length);
+	CborReader::Item root, key, item;
+	reader.Next(root);
+	if (root.type != CborReader::MAP)
+		throw CborError("save delta is not a map");
+
+	uint64_t baseHash = 0, baseSize = 0, size = 0, hash = 0;
+	bool haveHash = false, havePieces = false;
+	out.clear();
+	for (uint64_t i = 0; root.indefinite || i < root.count; i++) {
+		reader.Next(key);
+		if (key.type == CborReader::BREAK && root.indefinite)
+			break;
+		if (key.type != CborReader::STRING)
+			throw CborError("save delta key is not a string");
+
+		if (key.str == "delta_version") {
+			if (ReadUInt(reader) != s_deltaVersion)
+				throw CborError("unknown save delta version");
+		} else if (key.str == "base_hash") {
+			baseHash = ReadUInt(reader);
+		} else if (key.str == "base_size") {
+			baseSize = ReadUInt(reader);
+		} else if (key.str == "size") {
+			size = ReadUInt(reader);
+		} else if (key.str == "hash") {
+			hash = ReadUInt(reader);
+			haveHash = true;
+		} else if (key.str == "pieces") {
+			// written after the base is named, so it can be checked first
+			if (baseSize != base.size() || baseHash != Hash(base.data(), base.size()))
+				return false;
+			out.reserve(size_t(std::min(size, uint64_t(1) << 30))); // don't trust it too far
+
+			reader.Next(item);
+			if (item.type != CborReader::ARRAY)
+				throw CborError("save delta pieces are not an array");
+			CborReader::Item piece;
+			for (uint64_t j = 0; item.indefinite || j < item.count; j++) {
+				reader.Next(piece);
+				if (piece.type == CborReader::BREAK && item.indefinite)
+					break;
+				if (piece.type == CborReader::BYTES) {
+					out += piece.str;
+				} else if (piece.type == CborReader::ARRAY && !piece.indefinite && piece.count == 2) {
+					const uint64_t offset = ReadUInt(reader);
+					const uint64_t count = ReadUInt(reader);
+					if (offset > base.size() || count > base.size() - offset)
+						throw CborError("save delta range is out of the base");
+					out.append(base, size_t(offset), size_t(count));
+				} else {
+					throw CborError("bad save delta piece");
+				}
+			}
+			havePieces = true;
+		} else {
+			reader.Next(item);
+			reader.Skip(item);
+		}
+	}
+
+	if (!havePieces || !haveHash || out.size() != size)
+		throw CborError("save delta is incomplete");
+	if (Hash(out.data(), out.size()) != hash)
+		throw CborError("save delta doesn't give back the save it was made from");
+	return true;
+}
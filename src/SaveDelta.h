@@ -0,0 +1,54 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef SAVEDELTA_H
+#define SAVEDELTA_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Incremental saves. A save is written in full (the base) once in a while,
+// and in between only as a delta: the pieces of the save that aren't in the
+// base verbatim, and the ranges of the base to copy for the rest. Pieces are
+// what CborWriter::Mark separates, each body and each Lua module's data
+// among others, and are looked up in the base by a hash of their content.
+//
+// The delta goes to a file next to the base, "<save>.delta", and is always
+// taken against the base, never against an earlier delta. It names the base
+// by the size and hash of its data, so a delta left over from some other
+// base is known to be stale. It has the hash of the save it was made from
+// too, so that one put back together wrong (from pieces whose hashes
+// collide) is known to be.
+namespace SaveDelta {
+	// what's kept of a base to compute deltas against it
+	struct Base {
+		struct Range {
+			size_t offset;
+			size_t length;
+		};
+		std::unordered_map<uint64_t, Range> pieces; // by hash
+		uint64_t hash; // of the whole of the data
+		size_t size;
+	};
+
+	std::string GetDeltaPath(const std::string &savePath);
+
+	uint64_t Hash(const char *data, size_t length);
+
+	// data is a whole save, marks the boundaries between its pieces
+	std::shared_ptr<Base> MakeBase(const std::string &data, const std::vector<size_t> &marks);
+
+	// the delta that turns base into data (which has to be laid out in
+	// pieces the same way)
+	std::string MakeDelta(const Base &base, const std::string &data, const std::vector<size_t> &marks);
+
+	// the save the delta was made from. false if the delta was made against
+	// some other base. throws CborError if the delta is corrupt or doesn't
+	// give back the save it was made from
+	bool ApplyDelta(const std::string &base, const char *delta, size_t length, std::string &out);
+} // namespace SaveDelta
+
+#endif
@@ -12,11 +12,13 @@
 #include "input/KeyBindings.h"
 #include "LuaConstants.h"
 #include "LuaObject.h"
+#include "Pi.h"
 #include "Player.h"
 #include "Space.h"
 #include "galaxy/Faction.h"
 #include "galaxy/Galaxy.h"
 #include "galaxy/GalaxyCache.h"
+#include "galaxy/RoutePlanner.h"
 #include "galaxy/Sector.h"
 #include "galaxy/StarSystem.h"
 #include "graphics/Frustum.h"
@@ -31,7 +33,6 @@
 #include "libs/StringF.h"
 #include <algorithm>
 #include <sstream>
-#include <unordered_set>
 
 #include <imgui/imgui.h>
 
@@ -791,135 +792,74 @@ std::vector<SystemPath> SectorView::GetRoute()
 	return m_route;
 }
 
-void SectorView::AutoRoute(const SystemPath &start, const SystemPath &target, std::vector<SystemPath> &outRoute) const
+bool SectorView::AutoRoute(const SystemPath &start, const SystemPath &target)
 {
-	const RefCountedPtr<const Sector> start_sec = m_galaxy->GetSector(start);
-	const RefCountedPtr<const Sector> target_sec = m_galaxy->GetSector(target);
-
-	// Get the player's hyperdrive from Lua, later used to calculate the duration between systems
-	const ScopedTable hyperdrive = ScopedTable(LuaObject<Player>::CallMethod<LuaRef>(GameLocator::getGame()->GetPlayer(), "GetEquip", "engine", 1));
-	// Cache max range so it doesn't get recalculated every time we call GetDuration
-	const float max_range = hyperdrive.CallMethod<float>("GetMaximumRange", GameLocator::getGame()->GetPlayer());
-
-	const float dist = Sector::DistanceBetween(start_sec, start.systemIndex, target_sec, target.systemIndex);
+	PROFILE_SCOPED()
+	CancelAutoRoute();
 
-	// nodes[0] is always start
-	std::vector<SystemPath> nodes;
-	nodes.push_back(start);
+	Player *player = GameLocator::getGame()->GetPlayer();
+	// Get the player's hyperdrive from Lua, only to sample how long its jumps take
+	const ScopedTable hyperdrive = ScopedTable(LuaObject<Player>::CallMethod<LuaRef>(player, "GetEquip", "engine", 1));
+	if (!lua_istable(hyperdrive.GetLua(), hyperdrive.GetIndex()))
+		return false;
+	const float max_range = hyperdrive.CallMethod<float>("GetMaximumRange", player);
+	const RoutePlanner::DurationCurve curve(max_range, [&](float dist_ly) {
+		return hyperdrive.CallMethod<float>("GetDuration", player, dist_ly, max_range);
+	});
+
+	// positions are taken relative to the start, see RoutePlanner::System
+	SectorPositionIndex *index = m_galaxy->GetPositionIndex();
+	const vector3f start_pos = index->GetPosition(start);
+	const vector3f target_pos = index->GetPosition(target) - start_pos +
+		Sector::SIZE * vector3f(float(target.sectorX - start.sectorX), float(target.sectorY - start.sectorY), float(target.sectorZ - start.sectorZ));
+	const float dist = target_pos.Length();
 
 	const int32_t minX = std::min(start.sectorX, target.sectorX) - 2, maxX = std::max(start.sectorX, target.sectorX) + 2;
 	const int32_t minY = std::min(start.sectorY, target.sectorY) - 2, maxY = std::max(start.sectorY, target.sectorY) + 2;
 	const int32_t minZ = std::min(start.sectorZ, target.sectorZ) - 2, maxZ = std::max(start.sectorZ, target.sectorZ) + 2;
-	const vector3f start_pos = start_sec->m_systems[start.systemIndex].GetFullPosition();
-	const vector3f target_pos = target_sec->m_systems[target.systemIndex].GetFullPosition();
-
-	// go sector by sector for the minimum cube of sectors and add systems
-	// if they are within 110% of dist of both start and target
-	for (int32_t sx = minX; sx <= maxX; sx++) {
-		for (int32_t sy = minY; sy <= maxY; sy++) {
-			for (int32_t sz = minZ; sz < maxZ; sz++) {
-				const SystemPath sec_path = SystemPath(sx, sy, sz);
-				RefCountedPtr<const Sector> sec = m_galaxy->GetSector(sec_path);
-				for (std::vector<Sector::System>::size_type s = 0; s < sec->m_systems.size(); s++) {
-					if (start.IsSameSystem(sec->m_systems[s].GetPath()))
-						continue; // start is already nodes[0]
-
-					const float lineDist = MathUtil::DistanceFromLine(start_pos, target_pos, sec->m_systems[s].GetFullPosition());
-
-					if (Sector::DistanceBetween(start_sec, start.systemIndex, sec, sec->m_systems[s].idx) <= dist * 1.10 &&
-						Sector::DistanceBetween(target_sec, target.systemIndex, sec, sec->m_systems[s].idx) <= dist * 1.10 &&
-						lineDist < (Sector::SIZE * 3)) {
-						nodes.push_back(sec->m_systems[s].GetPath());
-					}
-				}
-			}
-		}
-	}
-	Output("SectorView::AutoRoute, nodes to search = %lu\n", nodes.size());
-
-	// setup inital values and set everything as unvisited
-	std::vector<float> path_dist; // distance from source to node
-	std::vector<std::vector<SystemPath>::size_type> path_prev; // previous node in optimal path
-	std::unordered_set<std::vector<SystemPath>::size_type> unvisited;
-	for (std::vector<SystemPath>::size_type i = 0; i < nodes.size(); i++) {
-		path_dist.push_back(INFINITY);
-		path_prev.push_back(0);
-		unvisited.insert(i);
-	}
 
-	// distance to the start is 0
-	path_dist[0] = 0.f;
-
-	size_t totalSkipped = 0u;
-	while (unvisited.size() > 0) {
-		// find the closest node (for the first loop this will be start)
-		std::vector<SystemPath>::size_type closest_i = *unvisited.begin();
-		for (auto it : unvisited) {
-			if (path_dist[it] < path_dist[closest_i])
-				closest_i = it;
-		}
-
-		// mark it as visited
-		unvisited.erase(closest_i);
-
-		// if this is the target then we have found the route
-		const SystemPath &closest = nodes[closest_i];
-		if (closest.IsSameSystem(target))
-			break;
-
-		RefCountedPtr<const Sector> closest_sec = m_galaxy->GetSector(closest);
-
-		// if not, loop through all unvisited nodes
-		// since every system is technically reachable from every other system
-		// everything is a neighbor :)
-		for (auto it : unvisited) {
-			const SystemPath &v = nodes[it];
-			// everything is a neighbor isn't quite true as the ship has a max_range for each jump!
-			if ((SystemPath::SectorDistance(closest, v) * Sector::SIZE) > max_range) {
-				++totalSkipped;
-				continue;
-			}
-
-			RefCountedPtr<const Sector> v_sec = m_galaxy->GetSector(v); // this causes it to generate a sector (slooooooow)
-
-			const float v_dist_ly = Sector::DistanceBetween(closest_sec, closest.systemIndex, v_sec, v.systemIndex);
-
-			// in this case, duration is used for the distance since that's what we are optimizing
-			float v_dist = hyperdrive.CallMethod<float>("GetDuration", GameLocator::getGame()->GetPlayer(), v_dist_ly, max_range);
-
-			v_dist += path_dist[closest_i]; // we want the total duration from start to this node
-			if (v_dist < path_dist[it]) {
-				// if our calculated duration is less than a previous value, this path is more efficent
-				// so store/override it
-				path_dist[it] = v_dist;
-				path_prev[it] = closest_i;
-			}
+	// everything in the minimum cube of sectors within 110% of dist of the
+	// start, of which we keep those also within 110% of dist of the target
+	std::vector<SectorPositionIndex::Result> near;
+	index->FindWithin(start, start_pos, dist * 1.10f, minX, maxX, minY, maxY, minZ, maxZ, near);
+
+	// systems[0] is always start
+	std::vector<RoutePlanner::System> systems;
+	systems.reserve(near.size());
+	systems.push_back({ start, vector3f(0.0f) });
+	size_t target_idx = 0;
+	for (const SectorPositionIndex::Result &r : near) {
+		if (start.IsSameSystem(r.path))
+			continue; // start is already systems[0]
+
+		const float lineDist = MathUtil::DistanceFromLine(vector3f(0.0f), target_pos, r.pos);
+		if ((target_pos - r.pos).Length() <= dist * 1.10f && lineDist < (Sector::SIZE * 3)) {
+			if (target.IsSameSystem(r.path))
+				target_idx = systems.size();
+			systems.push_back({ r.path, r.pos });
 		}
 	}
-	Output("SectorView::AutoRoute, total times that nodes were skipped = %lu\n", totalSkipped);
-
-	bool foundRoute = false;
-	std::vector<SystemPath>::size_type u = 0;
+	Output("SectorView::AutoRoute, systems to search = " SIZET_FMT "\n", systems.size());
+
+	m_autoRouteStatus.reset(new RoutePlanner::Status());
+	m_autoRouteJob = Pi::GetAsyncJobQueue()->Queue(new RoutePlanner::RouteJob(std::move(systems), target_idx, curve, m_autoRouteStatus,
+		[this](const std::vector<SystemPath> &route) {
+			// It's posible that there is no valid route, which leaves it empty
+			m_route = route;
+		}));
+	return true;
+}
 
-	// find the index of our target
-	for (std::vector<SystemPath>::size_type i = 0, numNodes = nodes.size(); i < numNodes; i++) {
-		if (target.IsSameSystem(nodes[i])) {
-			u = i;
-			foundRoute = true;
-			break;
-		}
-	}
+float SectorView::GetAutoRouteProgress() const
+{
+	return (IsAutoRouting() && m_autoRouteStatus) ? float(m_autoRouteStatus->progress) : 0.0f;
+}
 
-	// It's posible that there is no valid route
-	if (foundRoute) {
-		outRoute.reserve(nodes.size());
-		// Build the route, in reverse starting with the target
-		while (u != 0) {
-			outRoute.push_back(nodes[u]);
-			u = path_prev[u];
-		}
-		std::reverse(std::begin(outRoute), std::end(outRoute));
-	}
+void SectorView::CancelAutoRoute()
+{
+	// dropping the handle cancels the job
+	m_autoRouteJob = Job::Handle();
+	m_autoRouteStatus.reset();
 }
 
 void SectorView::PrepareRouteLines(const vector3f &playerAbsPos, const matrix4x4f &trans)
@@ -1352,6 +1292,19 @@ void SectorView::ShrinkCache()
 	// we're going to use these to determine if our sectors are within the range that we'll ever render
 	const int drawRadius = (m_zoomClamped <= FAR_THRESHOLD) ? DRAW_RAD : ceilf((m_zoomClamped / FAR_THRESHOLD) * DRAW_RAD);
 
+	// the sectors of the current, selected and target systems and of the
+	// route are drawn wherever the view is, don't let the cache drop them
+	std::vector<SystemPath> pinned;
+	pinned.reserve(m_route.size() + 3);
+	pinned.push_back(m_current);
+	pinned.push_back(m_selected);
+	pinned.push_back(m_hyperspaceTarget);
+	pinned.insert(pinned.end(), m_route.begin(), m_route.end());
+	if (pinned != m_pinnedPaths) {
+		m_pinnedPaths = std::move(pinned);
+		m_sectorCache->SetPinned(m_pinnedPaths);
+	}
+
 	const int xmin = int(floorf(m_pos.x)) - drawRadius;
 	const int xmax = int(floorf(m_pos.x)) + drawRadius;
 	const int ymin = int(floorf(m_pos.y)) - drawRadius;
@@ -1361,9 +1314,6 @@ void SectorView::ShrinkCache()
 
 	if (xmin != m_cacheXMin || xmax != m_cacheXMax || ymin != m_cacheYMin || ymax != m_cacheYMax || zmin != m_cacheZMin || zmax != m_cacheZMax) {
 		SystemPath center(int(floorf(m_pos.x)), int(floorf(m_pos.y)), int(floorf(m_pos.z)));
-		// TODO: Check also for systems in 'm_route':
-		// HINT: build a synced sector only helper vector
-		// with unique sectors and check against it
 		m_sectorCache->ShrinkCache(center, drawRadius, m_current);
 
 		m_cacheXMin = xmin;
@@ -4,11 +4,13 @@
 #ifndef _SECTORVIEW_H
 #define _SECTORVIEW_H
 
+#include "JobQueue.h"
 #include "UIView.h"
 #include "galaxy/Sector.h"
 #include "galaxy/SystemPath.h"
 #include "graphics/Drawables.h"
 #include "input/InputFwd.h"
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -16,6 +18,10 @@
 class Galaxy;
 class InputFrame;
 
+namespace RoutePlanner {
+	struct Status;
+}
+
 namespace Graphics {
 	class RenderState;
 }
@@ -77,7 +83,12 @@ public:
 	bool RemoveRouteItem(const std::vector<SystemPath>::size_type element);
 	void ClearRoute();
 	std::vector<SystemPath> GetRoute();
-	void AutoRoute(const SystemPath &start, const SystemPath &target, std::vector<SystemPath> &outRoute) const;
+	// starts looking for the quickest route on the job queue, the current
+	// route is replaced once one is found. false if there's no hyperdrive
+	bool AutoRoute(const SystemPath &start, const SystemPath &target);
+	bool IsAutoRouting() const { return m_autoRouteJob.HasJob(); }
+	float GetAutoRouteProgress() const;
+	void CancelAutoRoute();
 	void SetDrawRouteLines(bool value) { m_drawRouteLines = value; }
 
 	static void RegisterInputBindings();
@@ -185,7 +196,11 @@ private:
 
 	// HyperJump Route Planner Stuff
 	std::vector<SystemPath> m_route;
+	// what the sector cache was last told to keep, see ShrinkCache
+	std::vector<SystemPath> m_pinnedPaths;
 	bool m_drawRouteLines;
+	Job::Handle m_autoRouteJob;
+	std::shared_ptr<RoutePlanner::Status> m_autoRouteStatus;
 	void PrepareRouteLines(const vector3f &playerAbsPos, const matrix4x4f &trans);
 
 	Graphics::RenderState *m_solidState;
@@ -952,7 +952,7 @@ void Ship::SetFrame(FrameId fId)
 	m_sensors->ResetTrails();
 }
 
-void Ship::TimeStepUpdate(const float timeStep)
+void Ship::PreIntegrate(const float timeStep)
 {
 	// If docked, station is responsible for updating position/orient of ship
 	// but we call this crap anyway and hope it doesn't do anything bad
@@ -967,6 +967,10 @@ void Ship::TimeStepUpdate(const float timeStep)
 	if (m_landingGearAnimation)
 		m_landingGearAnimation->SetProgress(m_wheelState);
 	m_dragCoeff = DynamicBody::DEFAULT_DRAG_COEFF * (1.0 + 0.25 * m_wheelState);
+}
+
+void Ship::TimeStepUpdate(const float timeStep)
+{
 	DynamicBody::TimeStepUpdate(timeStep);
 
 	// fuel use decreases mass, so do this as the last thing in the frame
@@ -1345,9 +1349,9 @@ void Ship::StaticUpdate(const float timeStep)
 	}
 }
 
-void Ship::NotifyRemoved(const Body *const removedBody)
+void Ship::NotifyRemoved(const std::vector<const Body *> &removedBodies)
 {
-	if (m_curAICmd) m_curAICmd->OnDeleted(removedBody);
+	if (m_curAICmd) m_curAICmd->OnDeleted(removedBodies);
 }
 
 bool Ship::Undock()
@@ -101,6 +101,7 @@ public:
 	virtual bool SetWheelState(bool down); // returns success of state change, NOT state itself
 	void Blastoff();
 	bool Undock();
+	virtual void PreIntegrate(const float timeStep) override;
 	virtual void TimeStepUpdate(const float timeStep) override;
 	virtual void StaticUpdate(const float timeStep) override;
 
@@ -108,7 +109,7 @@ public:
 
 	bool IsDecelerating() const { return m_decelerating; }
 
-	virtual void NotifyRemoved(const Body *const removedBody) override;
+	virtual void NotifyRemoved(const std::vector<const Body *> &removedBodies) override;
 	virtual bool OnCollision(Object *o, uint32_t flags, double relVel) override;
 	virtual bool OnDamage(Object *attacker, float kgDamage, const CollisionContact &contactData) override;
 
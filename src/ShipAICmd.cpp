@@ -227,10 +227,10 @@ static void LaunchShip(Ship *ship)
 		ship->Undock();
 }
 
-void AICmdKamikaze::OnDeleted(const Body *body)
+void AICmdKamikaze::OnDeleted(const std::vector<const Body *> &removedBodies)
 {
-	AICommand::OnDeleted(body);
-	if (static_cast<Body *>(m_target) == body) m_target = 0;
+	AICommand::OnDeleted(removedBodies);
+	if (Body::IsRemoved(removedBodies, m_target)) m_target = 0;
 }
 
 AICmdKamikaze::AICmdKamikaze(DynamicBody *dBody, Body *target) :
@@ -322,10 +322,10 @@ bool AICmdKamikaze::TimeStepUpdate()
 	return false;
 }
 
-void AICmdKill::OnDeleted(const Body *body)
+void AICmdKill::OnDeleted(const std::vector<const Body *> &removedBodies)
 {
-	if (static_cast<Body *>(m_target) == body) m_target = 0;
-	AICommand::OnDeleted(body);
+	if (Body::IsRemoved(removedBodies, m_target)) m_target = 0;
+	AICommand::OnDeleted(removedBodies);
 }
 
 AICmdKill::AICmdKill(DynamicBody *dBody, Ship *target) :
@@ -850,10 +850,10 @@ static bool CheckSuicide(DynamicBody *dBody, const vector3d &tandir)
 
 extern double calc_ivel(double dist, double vel, double acc);
 
-void AICmdFlyTo::OnDeleted(const Body *body)
+void AICmdFlyTo::OnDeleted(const std::vector<const Body *> &removedBodies)
 {
-	AICommand::OnDeleted(body);
-	if (m_target == body) m_target = 0;
+	AICommand::OnDeleted(removedBodies);
+	if (Body::IsRemoved(removedBodies, m_target)) m_target = 0;
 }
 
 void AICmdFlyTo::GetStatusText(char *str)
@@ -1154,10 +1154,10 @@ bool AICmdFlyTo::TimeStepUpdate()
 	return false;
 }
 
-void AICmdDock::OnDeleted(const Body *body)
+void AICmdDock::OnDeleted(const std::vector<const Body *> &removedBodies)
 {
-	AICommand::OnDeleted(body);
-	if (static_cast<Body *>(m_target) == body) m_target = nullptr;
+	AICommand::OnDeleted(removedBodies);
+	if (Body::IsRemoved(removedBodies, m_target)) m_target = nullptr;
 }
 
 void AICmdDock::GetStatusText(char *str)
@@ -1577,10 +1577,10 @@ bool AICmdFlyAround::TimeStepUpdate()
 	return false;
 }
 
-void AICmdFormation::OnDeleted(const Body *body)
+void AICmdFormation::OnDeleted(const std::vector<const Body *> &removedBodies)
 {
-	AICommand::OnDeleted(body);
-	if (static_cast<Body *>(m_target) == body) m_target = 0;
+	AICommand::OnDeleted(removedBodies);
+	if (Body::IsRemoved(removedBodies, m_target)) m_target = 0;
 }
 
 void AICmdFormation::GetStatusText(char *str)
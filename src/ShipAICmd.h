@@ -56,9 +56,9 @@ public:
 	virtual void PostLoadFixup(Space *space);
 
 	// Signal functions
-	virtual void OnDeleted(const Body *body)
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies)
 	{
-		if (m_child) m_child->OnDeleted(body);
+		if (m_child) m_child->OnDeleted(removedBodies);
 	}
 
 	CmdName GetType() const { return m_cmdName; }
@@ -85,7 +85,7 @@ public:
 	AICmdDock(const Json &jsonObj);
 	virtual void PostLoadFixup(Space *space);
 
-	virtual void OnDeleted(const Body *body);
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies);
 
 private:
 	enum EDockingStates {
@@ -128,7 +128,7 @@ public:
 	AICmdFlyTo(const Json &jsonObj);
 	virtual void PostLoadFixup(Space *space);
 
-	virtual void OnDeleted(const Body *body);
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies);
 
 private:
 	Body *m_target; // target for vicinity. Either this or targframe is 0
@@ -155,9 +155,9 @@ public:
 	virtual void SaveToJson(Json &jsonObj);
 	AICmdFlyAround(const Json &jsonObj);
 	virtual void PostLoadFixup(Space *space);
-	virtual void OnDeleted(const Body *body)
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies)
 	{
-		AICommand::OnDeleted(body);
+		AICommand::OnDeleted(removedBodies);
 		// check against obstructor?
 	}
 	void SetTargPos(const vector3d &targpos)
@@ -190,7 +190,7 @@ public:
 	virtual void SaveToJson(Json &jsonObj);
 	void PostLoadFixup(Space *space);
 
-	virtual void OnDeleted(const Body *body);
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies);
 
 private:
 	Ship *m_target;
@@ -208,7 +208,7 @@ public:
 	AICmdKamikaze(const Json &jsonObj);
 	virtual void PostLoadFixup(Space *space);
 
-	virtual void OnDeleted(const Body *body);
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies);
 
 private:
 	Body *m_target;
@@ -232,7 +232,7 @@ public:
 	AICmdFormation(const Json &jsonObj);
 	virtual void PostLoadFixup(Space *space);
 
-	virtual void OnDeleted(const Body *body);
+	virtual void OnDeleted(const std::vector<const Body *> &removedBodies);
 
 private:
 	DynamicBody *m_target; // target frame for waypoint
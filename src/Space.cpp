@@ -6,17 +6,22 @@
 #include "Background.h"
 #include "Body.h"
 #include "CargoBody.h"
+#include "CborStream.h"
 #include "CityOnPlanet.h"
+#include "DynamicBody.h"
 #include "Frame.h"
 #include "Game.h"
 #include "GameSaveError.h"
 #include "GameConfSingleton.h"
 #include "GameLocator.h"
 #include "HyperspaceCloud.h"
+#include "JobQueue.h"
 #include "Json.h"
 #include "Lang.h"
 #include "LuaEvent.h"
 #include "Missile.h"
+#include "ModelCache.h"
+#include "Pi.h"
 #include "Planet.h"
 #include "Player.h"
 #include "Projectile.h"
@@ -30,14 +35,123 @@
 #include <algorithm>
 #include <functional>
 
+double Space::BodyNearFinder::CellSize(int level)
+{
+	return MIN_CELL_SIZE * double(int64_t(1) << (level * CELL_SCALE_SHIFT));
+}
+
+Space::BodyNearFinder::Cell Space::BodyNearFinder::CellOf(const vector3d &pos, int level)
+{
+	// derive every level from the finest one, so cells nest exactly
+	const Cell cell = {
+		int64_t(floor(pos.x / MIN_CELL_SIZE)),
+		int64_t(floor(pos.y / MIN_CELL_SIZE)),
+		int64_t(floor(pos.z / MIN_CELL_SIZE))
+	};
+	const int shift = level * CELL_SCALE_SHIFT;
+	return { cell.x >> shift, cell.y >> shift, cell.z >> shift };
+}
+
+uint64_t Space::BodyNearFinder::CellKey(const Cell &cell)
+{
+	return uint64_t(cell.x) * 73856093u ^ uint64_t(cell.y) * 19349663u ^ uint64_t(cell.z) * 83492791u;
+}
+
+void Space::BodyNearFinder::Insert(const Entry *entry, int level)
+{
+	m_grids[level][CellKey(entry->cells[level])].push_back(entry);
+}
+
+void Space::BodyNearFinder::Erase(const Entry *entry, int level)
+{
+	auto bucket = m_grids[level].find(CellKey(entry->cells[level]));
+	assert(bucket != m_grids[level].end());
+	std::vector<const Entry *> &entries = bucket->second;
+	auto it = std::find(entries.begin(), entries.end(), entry);
+	assert(it != entries.end());
+	*it = entries.back();
+	entries.pop_back();
+	// drop empty cells, or the grids keep growing along every flight path
+	if (entries.empty()) m_grids[level].erase(bucket);
+}
+
 void Space::BodyNearFinder::Prepare()
 {
-	m_bodyDist.clear();
+	PROFILE_SCOPED()
+	m_stamp++;
+
+	for (Body *b : m_space->GetBodies()) {
+		const vector3d pos = b->GetPositionRelTo(Frame::GetRootFrameId());
+		auto res = m_entries.emplace(b, Entry());
+		Entry &entry = res.first->second;
+		entry.pos = pos;
+		entry.stamp = m_stamp;
+
+		if (res.second) {
+			entry.body = b;
+			for (int level = 0; level < NUM_LEVELS; level++) {
+				entry.cells[level] = CellOf(pos, level);
+				Insert(&entry, level);
+			}
+		} else if (CellOf(pos, 0) != entry.cells[0]) {
+			// cells nest, so if the finest one didn't change none did
+			for (int level = 0; level < NUM_LEVELS; level++) {
+				const Cell cell = CellOf(pos, level);
+				if (cell == entry.cells[level]) break;
+				Erase(&entry, level);
+				entry.cells[level] = cell;
+				Insert(&entry, level);
+			}
+		}
+	}
 
-	for (Body *b : m_space->GetBodies())
-		m_bodyDist.emplace_back(b, b->GetPositionRelTo(Frame::GetRootFrameId()).Length());
+	// forget the bodies which left
+	for (auto it = m_entries.begin(); it != m_entries.end();) {
+		if (it->second.stamp != m_stamp) {
+			for (int level = 0; level < NUM_LEVELS; level++)
+				Erase(&it->second, level);
+			it = m_entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void Space::BodyNearFinder::Collect(const vector3d &pos, double dist, DistList &out) const
+{
+	const double distSqr = dist * dist;
+
+	// the finest level whose cells are at least as big as the query box,
+	// so it touches at most two cells on each axis
+	int level = 0;
+	while (level < NUM_LEVELS && CellSize(level) < 2.0 * dist)
+		level++;
+
+	if (level == NUM_LEVELS) {
+		for (const auto &it : m_entries) {
+			const double d = (it.second.pos - pos).LengthSqr();
+			if (d <= distSqr) out.emplace_back(d, it.second.body);
+		}
+		return;
+	}
 
-	std::sort(m_bodyDist.begin(), m_bodyDist.end());
+	const Cell lo = CellOf(pos - vector3d(dist), level);
+	const Cell hi = CellOf(pos + vector3d(dist), level);
+	const auto &grid = m_grids[level];
+	Cell cell;
+	for (cell.x = lo.x; cell.x <= hi.x; cell.x++) {
+		for (cell.y = lo.y; cell.y <= hi.y; cell.y++) {
+			for (cell.z = lo.z; cell.z <= hi.z; cell.z++) {
+				auto bucket = grid.find(CellKey(cell));
+				if (bucket == grid.end()) continue;
+				for (const Entry *entry : bucket->second) {
+					if (entry->cells[level] != cell) continue;
+					const double d = (entry->pos - pos).LengthSqr();
+					if (d <= distSqr) out.emplace_back(d, entry->body);
+				}
+			}
+		}
+	}
 }
 
 Space::BodyNearList Space::BodyNearFinder::GetBodiesMaybeNear(const Body *b, double dist)
@@ -47,22 +161,102 @@ Space::BodyNearList Space::BodyNearFinder::GetBodiesMaybeNear(const Body *b, dou
 
 Space::BodyNearList Space::BodyNearFinder::GetBodiesMaybeNear(const vector3d &pos, double dist)
 {
-	if (m_bodyDist.empty()) {
-		m_nearBodies.clear();
-		return std::move(m_nearBodies);
-	}
+	PROFILE_SCOPED()
+	DistList found;
+	Collect(pos, dist, found);
+	std::sort(found.begin(), found.end());
+
+	std::vector<Body *> nearBodies;
+	nearBodies.reserve(found.size());
+	for (const auto &bd : found)
+		nearBodies.push_back(bd.second);
+
+	return nearBodies;
+}
 
-	const double len = pos.Length();
+Space::BodyNearList Space::BodyNearFinder::GetNearestBodies(const vector3d &pos, size_t count, double maxDist)
+{
+	PROFILE_SCOPED()
+	count = std::min(count, m_entries.size());
+	if (!count || maxDist < 0.0) return std::vector<Body *>();
+
+	// widen the search a level at a time until enough bodies turn up. all of
+	// them are within dist, so the nearest count of them are the nearest overall
+	DistList found;
+	double dist = std::min(MIN_CELL_SIZE, maxDist);
+	for (;;) {
+		found.clear();
+		Collect(pos, dist, found);
+		if (found.size() >= count || dist >= maxDist) break;
+		dist = std::min(dist * double(1 << CELL_SCALE_SHIFT), maxDist);
+	}
 
-	std::vector<BodyDist>::const_iterator min = std::lower_bound(m_bodyDist.begin(), m_bodyDist.end(), len - dist);
-	std::vector<BodyDist>::const_iterator max = std::upper_bound(min, m_bodyDist.cend(), len + dist);
+	count = std::min(count, found.size());
+	std::partial_sort(found.begin(), found.begin() + count, found.end());
 
-	m_nearBodies.clear();
-	m_nearBodies.reserve(max - min);
+	std::vector<Body *> nearBodies;
+	nearBodies.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		nearBodies.push_back(found[i].second);
 
-	std::for_each(min, max, [&](BodyDist const &bd) { m_nearBodies.push_back(bd.body); });
+	return nearBodies;
+}
 
-	return std::move(m_nearBodies);
+std::vector<Space::NearFinderBenchmark> Space::BodyNearFinder::Benchmark()
+{
+	PROFILE_SCOPED()
+	Prepare();
+
+	std::vector<vector3d> positions;
+	positions.reserve(m_entries.size());
+	for (const auto &it : m_entries)
+		positions.push_back(it.second.pos);
+
+	// what was done before: sort by distance from the root frame origin and
+	// take everything in the shell [len - dist, len + dist]
+	std::vector<double> radial;
+	radial.reserve(positions.size());
+	for (const vector3d &pos : positions)
+		radial.push_back(pos.Length());
+	std::sort(radial.begin(), radial.end());
+
+	std::vector<NearFinderBenchmark> results;
+	const double dists[] = { 100.0, 4000.0, 100000.0, 10000000.0 };
+	for (const double dist : dists) {
+		NearFinderBenchmark result;
+		result.dist = dist;
+		Profiler::Timer timer;
+
+		result.shellCandidates = 0;
+		timer.Start();
+		for (const vector3d &pos : positions) {
+			const double len = pos.Length();
+			auto min = std::lower_bound(radial.begin(), radial.end(), len - dist);
+			auto max = std::upper_bound(min, radial.end(), len + dist);
+			std::vector<Body *> nearBodies(max - min, nullptr);
+			result.shellCandidates += nearBodies.size();
+		}
+		timer.Stop();
+		result.shellMs = timer.millicycles();
+
+		result.gridBodies = 0;
+		timer.Start();
+		for (const vector3d &pos : positions)
+			result.gridBodies += GetBodiesMaybeNear(pos, dist).size();
+		timer.Stop();
+		result.gridMs = timer.millicycles();
+
+		timer.Start();
+		for (const vector3d &pos : positions)
+			GetNearestBodies(pos, BENCHMARK_NEAREST_COUNT, dist);
+		timer.Stop();
+		result.nearestMs = timer.millicycles();
+
+		Output("BodyNearFinder benchmark, " SIZET_FMT " bodies, %.0f m: shell %.3f ms (" SIZET_FMT " candidates), grid %.3f ms (" SIZET_FMT " bodies), nearest " SIZET_FMT " %.3f ms\n",
+			positions.size(), dist, result.shellMs, result.shellCandidates, result.gridMs, result.gridBodies, BENCHMARK_NEAREST_COUNT, result.nearestMs);
+		results.push_back(result);
+	}
+	return results;
 }
 
 Space::Space() :
@@ -128,6 +322,17 @@ Space::Space(RefCountedPtr<StarSystem> starsystem, const Json &jsonObj, double a
 
 	try {
 		Json bodyArray = spaceObj["bodies"].get<Json::array_t>();
+		// get the models of the ships read in the background while the
+		// bodies are being loaded, they are waited for only once needed
+		for (const Json &bodyArrayEl : bodyArray) {
+			auto bodyData = bodyArrayEl.find("body_data");
+			if (bodyData == bodyArrayEl.end() || !bodyData->is_object()) continue;
+			auto modelBody = bodyData->find("model_body");
+			if (modelBody == bodyData->end() || !modelBody->is_object()) continue;
+			auto modelName = modelBody->find("model_name");
+			if (modelName != modelBody->end() && modelName->is_string())
+				ModelCache::Prefetch(modelName->get<std::string>());
+		}
 		for (uint32_t i = 0; i < bodyArray.size(); i++) {
 			Body *body = nullptr;
 			const Json bodyArrayEl = bodyArray[i];
@@ -173,7 +378,7 @@ Space::Space(RefCountedPtr<StarSystem> starsystem, const Json &jsonObj, double a
 			default:
 				assert(0);
 			}
-		m_bodies.push_back(body);
+		AddBody(body);
 		}
 	} catch (Json::type_error &) {
 		throw SavedGameCorruptException();
@@ -191,35 +396,37 @@ Space::Space(RefCountedPtr<StarSystem> starsystem, const Json &jsonObj, double a
 Space::~Space()
 {
 	UpdateBodies(); // make sure anything waiting to be removed gets removed before we go and kill everything else
-	for (std::list<Body *>::iterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-		KillBody(*i);
+	for (Body *b : m_bodies)
+		KillBody(b);
 	UpdateBodies();
 	Frame::DeleteFrames();
 }
 
-void Space::ToJson(Json &jsonObj)
+void Space::ToCbor(CborWriter &out)
 {
 	PROFILE_SCOPED()
 	RebuildBodyIndex();
 	RebuildSystemBodyIndex();
 
-	Json spaceObj({}); // Create JSON object to contain space data (all the bodies and things).
+	out.Key("space");
+	out.BeginMap(2); // space data (all the bodies and things)
 
 	Json frameObj({});
 	Frame::ToJson(frameObj, m_rootFrameId, this);
-	spaceObj["frame"] = frameObj;
+	out.Key("frame");
+	out.Value(frameObj);
+	out.Mark();
 
-	Json bodyArray = Json::array(); // Create JSON array to contain body data.
+	out.Key("bodies");
+	out.BeginArray(m_bodies.size());
 	for (Body *b : m_bodies) {
 		Json bodyArrayEl({}); // Create JSON object to contain body.
 		bodyArrayEl["body_type"] = int(b->GetType());
 		bodyArrayEl["body_data"] = b->SaveToJson(this);
 
-		bodyArray.push_back(bodyArrayEl); // Append body object to array.
+		out.Value(bodyArrayEl);
+		out.Mark();
 	}
-	spaceObj["bodies"] = bodyArray; // Add body array to space object.
-
-	jsonObj["space"] = spaceObj; // Add space object to supplied object.
 }
 
 void Space::RefreshBackground()
@@ -252,8 +459,8 @@ SystemBody *Space::GetSystemBodyByIndex(uint32_t idx) const
 uint32_t Space::GetIndexForBody(const Body *body) const
 {
 	assert(m_bodyIndexValid);
-	for (uint32_t i = 0; i < m_bodyIndex.size(); i++)
-		if (m_bodyIndex[i] == body) return i;
+	auto it = m_bodyIndexLookup.find(body);
+	if (it != m_bodyIndexLookup.end()) return it->second;
 	assert(0);
 	return uint32_t(-1);
 }
@@ -278,7 +485,7 @@ void Space::AddSystemBodyToIndex(SystemBody *sbody)
 void Space::RebuildBodyIndex()
 {
 	m_bodyIndex.clear();
-	m_bodyIndex.reserve(m_bodies.size());
+	m_bodyIndex.reserve(m_bodies.size() + 1);
 	m_bodyIndex.push_back(nullptr);
 
 	for (Body *b : m_bodies) {
@@ -292,6 +499,10 @@ void Space::RebuildBodyIndex()
 		}
 	}
 
+	m_bodyIndexLookup.clear();
+	for (uint32_t i = 1; i < m_bodyIndex.size(); i++)
+		m_bodyIndexLookup.emplace(m_bodyIndex[i], i);
+
 	m_bodyIndexValid = true;
 }
 
@@ -308,7 +519,9 @@ void Space::RebuildSystemBodyIndex()
 
 void Space::AddBody(Body *b)
 {
-	m_bodies.push_back(b);
+	auto res = m_bodyHandles.emplace(b, SlotMap<Body *>::Handle());
+	assert(res.second);
+	if (res.second) res.first->second = m_bodies.Insert(b);
 }
 
 void Space::RemoveBody(Body *b)
@@ -395,13 +608,13 @@ Body *Space::FindNearestTo(const Body *b, Object::Type t) const
 {
 	Body *nearest = 0;
 	double dist = FLT_MAX;
-	for (std::list<Body *>::const_iterator i = m_bodies.begin(); i != m_bodies.end(); ++i) {
-		if ((*i)->IsDead()) continue;
-		if ((*i)->IsType(t)) {
-			double d = (*i)->GetPositionRelTo(b).Length();
+	for (Body *body : m_bodies) {
+		if (body->IsDead()) continue;
+		if (body->IsType(t)) {
+			double d = body->GetPositionRelTo(b).Length();
 			if (d < dist) {
 				dist = d;
-				nearest = *i;
+				nearest = body;
 			}
 		}
 	}
@@ -866,7 +1079,7 @@ void Space::TimeStep(float step, double total_time)
 	m_bodyIndexValid = m_sbodyIndexValid = false;
 
 	CollCallback hitCallbackFunctor = &hitCallback;
-	Frame::CollideFrames(hitCallbackFunctor);
+	Frame::CollideFrames(hitCallbackFunctor, GameConfSingleton::AreParallelCollisionsEnabled() ? Pi::GetAsyncJobQueue() : nullptr);
 
 	for (Body *b : m_bodies)
 		CollideWithTerrain(b, step);
@@ -881,6 +1094,8 @@ void Space::TimeStep(float step, double total_time)
 
 	Frame::UpdateOrbitRails(total_time, step);
 
+	IntegrateBodies(step);
+
 	for (Body *b : m_bodies)
 		b->TimeStepUpdate(step);
 
@@ -891,26 +1106,88 @@ void Space::TimeStep(float step, double total_time)
 	m_bodyNearFinder.Prepare();
 }
 
+// Moves all the moving dynamic bodies ahead of the TimeStepUpdate loop, so
+// that the integration of many ships can be shared with the worker threads.
+// Only the integration: the AI (StaticUpdate) has run serially by now, and
+// forces are collected on this thread first, as thrusters, atmosphere
+// torque and the gear animation are not safe to run concurrently. The
+// integration of a body only depends on its own state and its (unchanging)
+// frame, so the result is the same however the work is split.
+// TimeStepUpdate then skips the integration and does the rest (fuel,
+// sensors, missile fuses...), seeing every body already moved. This is
+// done whether ParallelPhysics is on or not, which only decides if the
+// loop is handed to the workers, so both give the same results.
+void Space::IntegrateBodies(float step)
+{
+	PROFILE_SCOPED()
+
+	// bodies per work item: integrating one body is cheap compared to
+	// handing out an item
+	static const uint32_t BATCH_SIZE = 16;
+
+	m_integrateBodies.clear();
+	for (Body *b : m_bodies) {
+		if (!b->IsType(Object::DYNAMICBODY)) continue;
+		DynamicBody *db = static_cast<DynamicBody *>(b);
+		if (!db->IsMoving()) continue;
+		m_integrateBodies.push_back(db);
+	}
+
+	for (DynamicBody *db : m_integrateBodies)
+		db->PreIntegrate(step);
+
+	// not worth waking the workers for a single batch
+	if (!GameConfSingleton::IsParallelPhysicsEnabled() || m_integrateBodies.size() <= BATCH_SIZE) {
+		for (DynamicBody *db : m_integrateBodies)
+			db->IntegrateAhead(step);
+		return;
+	}
+
+	const uint32_t numBatches = (uint32_t(m_integrateBodies.size()) + BATCH_SIZE - 1) / BATCH_SIZE;
+	ParallelFor(Pi::GetAsyncJobQueue(), numBatches, [this, step](uint32_t batch) {
+		const size_t end = std::min(m_integrateBodies.size(), size_t(batch + 1) * BATCH_SIZE);
+		for (size_t i = size_t(batch) * BATCH_SIZE; i < end; i++)
+			m_integrateBodies[i]->IntegrateAhead(step);
+	});
+}
+
 void Space::UpdateBodies()
 {
 #ifndef NDEBUG
 	m_processingFinalizationQueue = true;
 #endif
 
-	for (Body *rmb : m_removeBodies) {
+	if (m_removeBodies.empty() && m_killBodies.empty()) {
+#ifndef NDEBUG
+		m_processingFinalizationQueue = false;
+#endif
+		return;
+	}
+
+	for (Body *rmb : m_removeBodies)
 		rmb->SetFrame(FrameId::Invalid);
-		for (Body *b : m_bodies)
-			b->NotifyRemoved(rmb);
-		m_bodies.remove(rmb);
+
+	// tell everyone about the whole batch at once, sorted so each body only
+	// looks up what it holds. the departing ones are still in there, so they
+	// get told about each other
+	std::vector<const Body *> gone;
+	gone.reserve(m_removeBodies.size() + m_killBodies.size());
+	gone.insert(gone.end(), m_removeBodies.begin(), m_removeBodies.end());
+	gone.insert(gone.end(), m_killBodies.begin(), m_killBodies.end());
+	std::sort(gone.begin(), gone.end());
+	for (Body *b : m_bodies)
+		b->NotifyRemoved(gone);
+
+	for (const Body *goneb : gone) {
+		auto it = m_bodyHandles.find(goneb);
+		if (it == m_bodyHandles.end()) continue;
+		m_bodies.Erase(it->second);
+		m_bodyHandles.erase(it);
 	}
 	m_removeBodies.clear();
 
-	for (Body *killb : m_killBodies) {
-		for (Body *b : m_bodies)
-			b->NotifyRemoved(killb);
-		m_bodies.remove(killb);
+	for (Body *killb : m_killBodies)
 		delete killb;
-	}
 	m_killBodies.clear();
 
 #ifndef NDEBUG
@@ -9,11 +9,16 @@
 #include "Object.h"
 #include "libs/IterationProxy.h"
 #include "libs/RefCounted.h"
+#include "libs/SlotMap.h"
 #include "libs/vector3.h"
 #include <list>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 class Body;
+class CborWriter;
+class DynamicBody;
 class Frame;
 class StarSystem;
 class SystemBody;
@@ -36,10 +41,12 @@ public:
 
 	~Space();
 
-	void ToJson(Json &jsonObj);
+	// writes the "space" entry of the map being written. bodies are turned
+	// into Json one at a time, so the whole of space never is
+	void ToCbor(CborWriter &out);
 
 	// body/sbody indexing for save/load. valid after
-	// construction/ToJson(), invalidated by TimeStep(). they will assert
+	// construction/ToCbor(), invalidated by TimeStep(). they will assert
 	// if called while invalid
 	Body *GetBodyByIndex(uint32_t idx) const;
 	SystemBody *GetSystemBodyByIndex(uint32_t idx) const;
@@ -61,8 +68,10 @@ public:
 	Body *FindBodyForPath(const SystemPath &path) const;
 
 	uint32_t GetNumBodies() const { return static_cast<uint32_t>(m_bodies.size()); }
-	IterationProxy<std::list<Body *>> GetBodies() { return MakeIterationProxy(m_bodies); }
-	const IterationProxy<const std::list<Body *>> GetBodies() const { return MakeIterationProxy(m_bodies); }
+	// bodies added while iterating are visited too, but the order changes
+	// as bodies are removed
+	IterationProxy<SlotMap<Body *>> GetBodies() { return MakeIterationProxy(m_bodies); }
+	const IterationProxy<const SlotMap<Body *>> GetBodies() const { return MakeIterationProxy(m_bodies); }
 
 	Background::Container *GetBackground() { return m_background.get(); }
 	void RefreshBackground();
@@ -77,23 +86,45 @@ public:
 	{
 		return std::move(m_bodyNearFinder.GetBodiesMaybeNear(pos, dist));
 	}
+	BodyNearList GetNearestBodies(const vector3d &pos, size_t count, double maxDist)
+	{
+		return std::move(m_bodyNearFinder.GetNearestBodies(pos, count, maxDist));
+	}
+
+	struct NearFinderBenchmark {
+		double dist;
+		double shellMs; // sorting by distance from the root frame origin and taking the shell around each body
+		size_t shellCandidates;
+		double gridMs; // GetBodiesMaybeNear around each body
+		size_t gridBodies;
+		double nearestMs; // GetNearestBodies for the closest BENCHMARK_NEAREST_COUNT around each body
+	};
+	static const size_t BENCHMARK_NEAREST_COUNT = 8;
+	// times a query around every body in space for a few distances, with the
+	// grid and with the old shell search
+	std::vector<NearFinderBenchmark> BenchmarkNearFinder() { return m_bodyNearFinder.Benchmark(); }
 
 	void DebugDumpFrames(bool details);
 private:
 	void GenBody(const double at_time, SystemBody *b, FrameId fId, std::vector<vector3d> &posAccum);
 
 	void UpdateBodies();
+	void IntegrateBodies(float step);
 
 	FrameId m_rootFrameId;
 
 	RefCountedPtr<StarSystem> m_starSystem;
 
 	// all the bodies we know about
-	std::list<Body *> m_bodies;
+	SlotMap<Body *> m_bodies;
+	std::unordered_map<const Body *, SlotMap<Body *>::Handle> m_bodyHandles;
 
 	// bodies that were removed/killed this timestep and need pruning at the end
-	std::list<Body *> m_removeBodies;
-	std::list<Body *> m_killBodies;
+	std::vector<Body *> m_removeBodies;
+	std::vector<Body *> m_killBodies;
+
+	// moving bodies integrated on the job queue this timestep
+	std::vector<DynamicBody *> m_integrateBodies;
 
 	void RebuildBodyIndex();
 	void RebuildSystemBodyIndex();
@@ -102,38 +133,68 @@ private:
 
 	bool m_bodyIndexValid, m_sbodyIndexValid;
 	std::vector<Body *> m_bodyIndex;
+	std::unordered_map<const Body *, uint32_t> m_bodyIndexLookup;
 	std::vector<SystemBody *> m_sbodyIndex;
 
 	//background (elements that are infinitely far away,
 	//e.g. starfield and milky way)
 	std::unique_ptr<Background::Container> m_background;
 
+	// spatial index of the bodies' root frame positions: a hierarchy of
+	// hashed uniform grids, each level with cells CELL_SCALE times bigger
+	// than the one below. every body is in one cell per level, and a query
+	// looks at no more than 8 cells of the level that suits its radius
 	class BodyNearFinder {
 	public:
 		BodyNearFinder(const Space *space) :
-			m_space(space) {}
+			m_space(space),
+			m_stamp(0) {}
+		// bring the index up to date, only bodies that changed cell are touched
 		void Prepare();
 
+		// bodies within dist of the given point, nearest first
 		BodyNearList GetBodiesMaybeNear(const Body *b, double dist);
 		BodyNearList GetBodiesMaybeNear(const vector3d &pos, double dist);
+		// the (up to) count bodies nearest to pos, no further than maxDist, nearest first
+		BodyNearList GetNearestBodies(const vector3d &pos, size_t count, double maxDist);
+
+		std::vector<NearFinderBenchmark> Benchmark();
 
 	private:
-		struct BodyDist {
-			BodyDist(Body *_body, double _dist) :
-				body(_body),
-				dist(_dist) {}
+		static const int NUM_LEVELS = 6;
+		static constexpr double MIN_CELL_SIZE = 1000.0;
+		static const int CELL_SCALE_SHIFT = 4; // cells grow 16 times per level
+
+		struct Cell {
+			int64_t x, y, z;
+			bool operator==(const Cell &o) const { return x == o.x && y == o.y && z == o.z; }
+			bool operator!=(const Cell &o) const { return !(*this == o); }
+		};
+
+		struct Entry {
 			Body *body;
-			double dist;
+			vector3d pos;
+			Cell cells[NUM_LEVELS];
+			uint32_t stamp;
+		};
 
-			bool operator<(const BodyDist &a) const { return dist < a.dist; }
+		typedef std::vector<std::pair<double, Body *>> DistList;
 
-			friend bool operator<(const BodyDist &a, double d) { return a.dist < d; }
-			friend bool operator<(double d, const BodyDist &a) { return d < a.dist; }
-		};
+		static double CellSize(int level);
+		static Cell CellOf(const vector3d &pos, int level);
+		static uint64_t CellKey(const Cell &cell);
+
+		void Insert(const Entry *entry, int level);
+		void Erase(const Entry *entry, int level);
+		// appends the bodies within dist of pos with their squared distances
+		void Collect(const vector3d &pos, double dist, DistList &out) const;
 
 		const Space *m_space;
-		std::vector<BodyDist> m_bodyDist;
-		std::vector<Body *> m_nearBodies;
+		uint32_t m_stamp;
+		std::unordered_map<const Body *, Entry> m_entries;
+		// cell key to the bodies in that cell. keys are hashes, so a bucket
+		// can hold several cells
+		std::unordered_map<uint64_t, std::vector<const Entry *>> m_grids[NUM_LEVELS];
 	};
 
 	BodyNearFinder m_bodyNearFinder;
@@ -240,10 +240,10 @@ SpaceStation::~SpaceStation()
 	if (m_adjacentCity) delete m_adjacentCity;
 }
 
-void SpaceStation::NotifyRemoved(const Body *const removedBody)
+void SpaceStation::NotifyRemoved(const std::vector<const Body *> &removedBodies)
 {
 	for (uint32_t i = 0; i < m_shipDocking.size(); i++) {
-		if (m_shipDocking[i].ship == removedBody) {
+		if (IsRemoved(removedBodies, m_shipDocking[i].ship)) {
 			m_shipDocking[i].ship = 0;
 		}
 	}
@@ -49,7 +49,7 @@ public:
 
 	virtual const SystemBody *GetSystemBody() const override { return m_sbody; }
 	virtual void PostLoadFixup(Space *space) override;
-	virtual void NotifyRemoved(const Body *const removedBody) override;
+	virtual void NotifyRemoved(const std::vector<const Body *> &removedBodies) override;
 
 	virtual void SetLabel(const std::string &label) override;
 
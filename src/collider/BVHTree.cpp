@@ -3,7 +3,68 @@
 
 #include "BVHTree.h"
 
-const int MAX_SPLITPOS_RETRIES = 15;
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// candidate split planes per axis for the surface area heuristic
+	const int SAH_BINS = 16;
+	// nodes with this many objects or fewer become leaves when splitting doesn't pay
+	const uint32_t MAX_LEAF_OBJS = 4;
+	// cost of visiting a node, relative to testing one object
+	const double TRAVERSAL_COST = 1.0;
+
+	struct Bounds {
+		vector3d min, max;
+		Bounds() :
+			min(std::numeric_limits<double>::max()),
+			max(std::numeric_limits<double>::lowest())
+		{}
+		void Grow(const vector3d &p)
+		{
+			min.x = std::min(min.x, p.x);
+			min.y = std::min(min.y, p.y);
+			min.z = std::min(min.z, p.z);
+			max.x = std::max(max.x, p.x);
+			max.y = std::max(max.y, p.y);
+			max.z = std::max(max.z, p.z);
+		}
+		void Grow(const Bounds &b)
+		{
+			min.x = std::min(min.x, b.min.x);
+			min.y = std::min(min.y, b.min.y);
+			min.z = std::min(min.z, b.min.z);
+			max.x = std::max(max.x, b.max.x);
+			max.y = std::max(max.y, b.max.y);
+			max.z = std::max(max.z, b.max.z);
+		}
+		// half the surface area, which is all the heuristic needs
+		double Area() const
+		{
+			if (min.x > max.x) return 0.0;
+			const vector3d d = max - min;
+			return d.x * d.y + d.y * d.z + d.z * d.x;
+		}
+	};
+
+	// single precision bounds must still enclose the double precision ones
+	float RoundDown(double v)
+	{
+		const float f = float(v);
+		return (double(f) > v) ? std::nextafter(f, -std::numeric_limits<float>::max()) : f;
+	}
+	float RoundUp(double v)
+	{
+		const float f = float(v);
+		return (double(f) < v) ? std::nextafter(f, std::numeric_limits<float>::max()) : f;
+	}
+} // namespace
+
+struct BVHTree::BuildObj {
+	Bounds bounds;
+	vector3d centroid;
+	objPtr_t objPtr;
+};
 
 BVHTree::BVHTree(int numObjs, const objPtr_t *objPtrs, const Aabb *objAabbs)
 {
@@ -11,138 +72,143 @@ BVHTree::BVHTree(int numObjs, const objPtr_t *objPtrs, const Aabb *objAabbs)
 	Profiler::Timer timer;
 	timer.Start();
 
-	std::vector<int> activeObjIdxs(numObjs);
-	for (int i = 0; i < numObjs; i++)
-		activeObjIdxs[i] = i;
+	if (numObjs <= 0) Error("BVHTree built with no objects.");
 
-	m_objPtrAlloc = new objPtr_t[numObjs];
-	m_objPtrAllocPos = 0;
-	m_objPtrAllocMax = numObjs;
+	std::vector<BuildObj> objs(numObjs);
+	for (int i = 0; i < numObjs; i++) {
+		objs[i].bounds.min = objAabbs[i].min;
+		objs[i].bounds.max = objAabbs[i].max;
+		objs[i].centroid = 0.5 * (objAabbs[i].min + objAabbs[i].max);
+		objs[i].objPtr = objPtrs[i];
+	}
 
-	m_bvhNodes = new BVHNode[numObjs * 2 + 1];
-	m_nodeAllocPos = 0;
-	m_nodeAllocMax = numObjs * 2 + 1;
+	// a binary tree with at least one object per leaf never needs more
+	m_nodes.reserve(2 * numObjs - 1);
+	m_nodes.emplace_back();
+	BuildNode(0, 0, numObjs, 0, objs);
 
-	m_root = AllocNode();
-	BuildNode(m_root, objPtrs, objAabbs, activeObjIdxs);
+	m_objPtrs.resize(numObjs);
+	for (int i = 0; i < numObjs; i++)
+		m_objPtrs[i] = objs[i].objPtr;
 
 	timer.Stop();
 	//Output(" - - - BVHTree::BVHTree took: %lf milliseconds\n", timer.millicycles());
 }
 
-void BVHTree::MakeLeaf(BVHNode *node, const objPtr_t *objPtrs, std::vector<objPtr_t> &objs)
+void BVHTree::MakeLeaf(uint32_t nodeIdx, uint32_t start, uint32_t end, std::vector<BuildObj> &objs)
 {
-	const size_t numTris = objs.size();
-	if (numTris <= 0) Error("MakeLeaf called with no elements in objs.");
-
-	if (numTris > m_objPtrAllocMax - m_objPtrAllocPos) {
-		Error("Out of space in m_objPtrAlloc. Left: " SIZET_FMT "; required: " SIZET_FMT ".", m_objPtrAllocMax - m_objPtrAllocPos, numTris);
-	}
+	// keep the objects of a leaf in their original order, so that neighbours
+	// (e.g. edges sharing a vertex) stay neighbours
+	std::sort(objs.begin() + start, objs.begin() + end, [](const BuildObj &a, const BuildObj &b) {
+		return a.objPtr < b.objPtr;
+	});
+
+	BVHNode &node = m_nodes[nodeIdx];
+	node.offset = start;
+	node.numObjs = end - start;
+}
 
-	node->numTris = numTris;
-	node->triIndicesStart = &m_objPtrAlloc[m_objPtrAllocPos];
-	//if (objs.size()>3) Output("fat node %d\n", objs.size());
+void BVHTree::BuildNode(uint32_t nodeIdx, uint32_t start, uint32_t end, int depth, std::vector<BuildObj> &objs)
+{
+	const uint32_t numObjs = end - start;
+	assert(numObjs > 0);
 
-	// copy tri indices to the stinking flat array
-	for (int i = numTris - 1; i >= 0; i--) {
-		m_objPtrAlloc[m_objPtrAllocPos++] = objPtrs[objs[i]];
+	Bounds bounds, centroidBounds;
+	for (uint32_t i = start; i < end; i++) {
+		bounds.Grow(objs[i].bounds);
+		centroidBounds.Grow(objs[i].centroid);
 	}
-}
 
-void BVHTree::BuildNode(BVHNode *node,
-	const objPtr_t *objPtrs,
-	const Aabb *objAabbs,
-	std::vector<objPtr_t> &activeObjIdx)
-{
-	const int numTris = activeObjIdx.size();
-	if (numTris <= 0) Error("BuildNode called with no elements in activeObjIndex.");
+	{
+		BVHNode &node = m_nodes[nodeIdx];
+		node.min = vector3f(RoundDown(bounds.min.x), RoundDown(bounds.min.y), RoundDown(bounds.min.z));
+		node.max = vector3f(RoundUp(bounds.max.x), RoundUp(bounds.max.y), RoundUp(bounds.max.z));
+	}
 
-	if (numTris == 1) {
-		MakeLeaf(node, objPtrs, activeObjIdx);
+	if (numObjs == 1 || depth >= MAX_DEPTH) {
+		MakeLeaf(nodeIdx, start, end, objs);
 		return;
 	}
 
-	std::vector<int> splitSides(numTris);
-
-	Aabb aabb;
-	aabb.min = vector3d(FLT_MAX, FLT_MAX, FLT_MAX);
-	aabb.max = vector3d(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	// binned surface area heuristic: try SAH_BINS - 1 planes on each axis
+	// and keep the one with the lowest expected cost
+	const double parentArea = bounds.Area();
+	double bestCost = std::numeric_limits<double>::max();
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for (int axis = 0; axis < 3; axis++) {
+		const double cmin = centroidBounds.min[axis];
+		const double extent = centroidBounds.max[axis] - cmin;
+		if (extent <= 0.0) continue;
+		const double binScale = SAH_BINS / extent;
+
+		Bounds binBounds[SAH_BINS];
+		uint32_t binCounts[SAH_BINS] = {};
+		for (uint32_t i = start; i < end; i++) {
+			const int bin = std::min(SAH_BINS - 1, int((objs[i].centroid[axis] - cmin) * binScale));
+			binBounds[bin].Grow(objs[i].bounds);
+			binCounts[bin]++;
+		}
 
-	for (int i = 0; i < numTris; i++) {
-		const int idx = activeObjIdx[i];
-		aabb.Update(objAabbs[idx].min);
-		aabb.Update(objAabbs[idx].max);
-	}
-	node->numTris = numTris;
-	node->aabb = aabb;
-
-	Aabb splitBox = aabb;
-	double splitPos;
-	int splitAxis;
-	int s1count, s2count;
-	int attempt = 0;
-
-	for (;;) {
-		splitAxis = 0;
-
-		const vector3d boxSize = splitBox.max - splitBox.min;
-
-		if (boxSize[1] > boxSize[0]) splitAxis = 1;
-		if ((boxSize[2] > boxSize[1]) && (boxSize[2] > boxSize[0])) splitAxis = 2;
-
-		// split pos in middle of splitBox
-		splitPos = 0.5f * (splitBox.min[splitAxis] + splitBox.max[splitAxis]);
-		s1count = 0, s2count = 0;
-
-		for (int i = 0; i < numTris; i++) {
-			const int idx = activeObjIdx[i];
-			const double mid = 0.5 * (objAabbs[idx].min[splitAxis] + objAabbs[idx].max[splitAxis]);
-			if (mid < splitPos) {
-				splitSides[i] = 0;
-				s1count++;
-			} else {
-				splitSides[i] = 1;
-				s2count++;
-			}
+		// sweep from the right to get the cost of everything right of each plane
+		double rightArea[SAH_BINS];
+		uint32_t rightCount[SAH_BINS];
+		Bounds acc;
+		uint32_t count = 0;
+		for (int b = SAH_BINS - 1; b > 0; b--) {
+			acc.Grow(binBounds[b]);
+			count += binCounts[b];
+			rightArea[b] = acc.Area();
+			rightCount[b] = count;
 		}
 
-		if (s1count == numTris) {
-			if (attempt < MAX_SPLITPOS_RETRIES) {
-				// try splitting at average point
-				splitBox.max[splitAxis] = splitPos;
-				attempt++;
-				continue;
-			} else {
-				MakeLeaf(node, objPtrs, activeObjIdx);
-				return;
-			}
-		} else if (s2count == numTris) {
-			if (attempt < MAX_SPLITPOS_RETRIES) {
-				// try splitting at average point
-				splitBox.min[splitAxis] = splitPos;
-				attempt++;
-				continue;
-			} else {
-				MakeLeaf(node, objPtrs, activeObjIdx);
-				return;
+		acc = Bounds();
+		count = 0;
+		for (int b = 0; b < SAH_BINS - 1; b++) {
+			acc.Grow(binBounds[b]);
+			count += binCounts[b];
+			if (count == 0 || rightCount[b + 1] == 0) continue;
+			const double cost = acc.Area() * count + rightArea[b + 1] * rightCount[b + 1];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
 			}
 		}
-		break;
 	}
 
-	std::vector<int> side[2];
-	side[0].reserve(numTris);
-	side[1].reserve(numTris);
+	uint32_t mid;
+	if (bestAxis >= 0) {
+		const double leafCost = double(numObjs);
+		const double splitCost = TRAVERSAL_COST + (parentArea > 0.0 ? bestCost / parentArea : 0.0);
+		if (numObjs <= MAX_LEAF_OBJS && splitCost >= leafCost) {
+			MakeLeaf(nodeIdx, start, end, objs);
+			return;
+		}
 
-	for (int i = 0; i < numTris; i++) {
-		side[splitSides[i]].push_back(activeObjIdx[i]);
+		const double cmin = centroidBounds.min[bestAxis];
+		const double binScale = SAH_BINS / (centroidBounds.max[bestAxis] - cmin);
+		const auto it = std::partition(objs.begin() + start, objs.begin() + end, [&](const BuildObj &o) {
+			return std::min(SAH_BINS - 1, int((o.centroid[bestAxis] - cmin) * binScale)) <= bestBin;
+		});
+		mid = uint32_t(it - objs.begin());
+	} else {
+		// all centroids coincide, so no plane separates them
+		if (numObjs <= MAX_LEAF_OBJS) {
+			MakeLeaf(nodeIdx, start, end, objs);
+			return;
+		}
+		mid = start + numObjs / 2;
 	}
 
 	// recurse!
-	node->triIndicesStart = 0;
-	node->kids[0] = AllocNode();
-	node->kids[1] = AllocNode();
-
-	BuildNode(node->kids[0], objPtrs, objAabbs, side[0]);
-	BuildNode(node->kids[1], objPtrs, objAabbs, side[1]);
+	const uint32_t kidIdx = uint32_t(m_nodes.size());
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+	m_nodes[nodeIdx].offset = kidIdx;
+	m_nodes[nodeIdx].numObjs = 0;
+
+	BuildNode(kidIdx, start, mid, depth + 1, objs);
+	BuildNode(kidIdx + 1, mid, end, depth + 1, objs);
 }
@@ -10,59 +10,61 @@
 #include <assert.h>
 #include <vector>
 
-struct BVHNode {
-	Aabb aabb;
+/* Nodes live in one flat array owned by the BVHTree. The two children
+ * of an inner node are stored next to each other, so a node only keeps
+ * the index of the first one. Bounds are single precision and rounded
+ * outwards, which keeps a node at 32 bytes (two siblings per cache line). */
+struct alignas(32) BVHNode {
+	vector3f min;
+	/* leaf: first entry in the tree's object array,
+	 * inner node: index of the first kid */
+	uint32_t offset;
+	vector3f max;
+	/* if numObjs == 0 then not leaf */
+	uint32_t numObjs;
 
-	/* if triIndicesStart == 0 then not leaf,
-	 * kids[] valid */
-	int numTris;
-	int *triIndicesStart;
-
-	BVHNode *kids[2];
-
-	BVHNode() :
-		numTris(0),
-		triIndicesStart(nullptr)
+	bool IsLeaf() const
 	{
-		kids[0] = nullptr;
-		kids[1] = nullptr;
+		return numObjs != 0;
 	}
-	bool IsLeaf() const
+	Aabb GetAabb() const
 	{
-		return triIndicesStart != nullptr;
+		Aabb aabb;
+		aabb.min = vector3d(min);
+		aabb.max = vector3d(max);
+		return aabb;
 	}
 };
+static_assert(sizeof(BVHNode) == 32, "BVHNode should fit half a cache line");
 
 class BVHTree {
 public:
 	typedef int objPtr_t;
+	// deepest a node can be, traversal stacks are sized from this
+	static const int MAX_DEPTH = 48;
+
 	BVHTree(const int numObjs, const objPtr_t *objPtrs, const Aabb *objAabbs);
-	~BVHTree()
+
+	const BVHNode *GetRoot() const { return &m_nodes[0]; }
+	const BVHNode *GetKid(const BVHNode *node, int i) const
 	{
-		delete[] m_objPtrAlloc;
-		delete[] m_bvhNodes;
+		assert(!node->IsLeaf());
+		return &m_nodes[node->offset + i];
 	}
-	BVHNode *GetRoot() { return m_root; }
-
-private:
-	void BuildNode(BVHNode *node,
-		const objPtr_t *objPtrs,
-		const Aabb *objAabbs,
-		std::vector<objPtr_t> &activeObjIdxs);
-	void MakeLeaf(BVHNode *node, const objPtr_t *objPtrs, std::vector<objPtr_t> &objs);
-	BVHNode *AllocNode()
+	const objPtr_t *GetObjs(const BVHNode *node) const
 	{
-		if (m_nodeAllocPos >= m_nodeAllocMax) Error("Out of space in m_bvhNodes.");
-		return &m_bvhNodes[m_nodeAllocPos++];
+		assert(node->IsLeaf());
+		return &m_objPtrs[node->offset];
 	}
-	BVHNode *m_root;
-	objPtr_t *m_objPtrAlloc;
-	size_t m_objPtrAllocPos;
-	size_t m_objPtrAllocMax;
+	size_t GetNumNodes() const { return m_nodes.size(); }
+
+private:
+	struct BuildObj;
+	void BuildNode(uint32_t nodeIdx, uint32_t start, uint32_t end, int depth, std::vector<BuildObj> &objs);
+	void MakeLeaf(uint32_t nodeIdx, uint32_t start, uint32_t end, std::vector<BuildObj> &objs);
 
-	BVHNode *m_bvhNodes;
-	size_t m_nodeAllocPos;
-	size_t m_nodeAllocMax;
+	std::vector<BVHNode> m_nodes;
+	std::vector<objPtr_t> m_objPtrs;
 };
 
 #endif /* _BVHTREE_H */
@@ -8,25 +8,51 @@
 #include "GeomTree.h"
 #include "libs/libs.h"
 
+#include <algorithm>
+
+namespace {
+	// deepest a node can be, traversal stacks are sized from this
+	const int MAX_DEPTH = 32;
+	// a refitted subtree is rebuilt once its box grew this much since it was built
+	const double REBUILD_AREA_RATIO = 2.0;
+	// orphaned nodes from subtree rebuilds are reclaimed by a full rebuild
+	// when the node array grows past this many nodes per geom
+	const size_t MAX_NODES_PER_GEOM = 4;
+
+	// half the surface area
+	double AabbArea(const Aabb &aabb)
+	{
+		const vector3d d = aabb.max - aabb.min;
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+} // namespace
+
 /* volnode!!!!!!!!!!! */
 struct BvhNode {
 	Aabb aabb;
 
-	/* if geomStart == 0 then not leaf,
-	 * kids[] valid */
+	// geoms below this node are m_geoms[geomStart, geomStart + numGeoms)
+	int geomStart;
 	int numGeoms;
-	Geom **geomStart;
 
-	BvhNode *kids[2];
+	/* if kids[0] == 0 then leaf (the root is
+	 * never a kid), else indices of kids */
+	int kids[2];
 
-	BvhNode()
+	// aabb area when the subtree was built, refits compare against it
+	double buildArea;
+
+	BvhNode() :
+		geomStart(0),
+		numGeoms(0),
+		buildArea(0.0)
 	{
-		numGeoms = 0;
-		kids[0] = nullptr;
-		geomStart = nullptr;
+		kids[0] = kids[1] = 0;
 	}
 
-	bool CollideRay(const vector3d &start, const vector3d &invDir, isect_t *isect)
+	bool IsLeaf() const { return kids[0] == 0; }
+
+	bool CollideRay(const vector3d &start, const vector3d &invDir, isect_t *isect) const
 	{
 		PROFILE_SCOPED()
 		double
@@ -51,93 +77,129 @@ struct BvhNode {
 
 /*
  * Tree of objects in collision space (one tree for static objects, one for
- * dynamic)
+ * dynamic). Nodes and geoms live in flat arrays; the geoms below any node
+ * are a contiguous range, so a subtree can be rebuilt on its own
  */
 class BvhTree {
 public:
-	Geom **m_geoms;
-	BvhNode *m_root;
-	BvhNode *m_nodesAlloc;
-	int m_nodesAllocPos;
-	int m_nodesAllocMax;
+	BvhTree(const GeomList &geoms);
 
-	BvhNode *AllocNode()
-	{
-		assert(m_nodesAllocPos < m_nodesAllocMax);
-		return &m_nodesAlloc[m_nodesAllocPos++];
-	}
+	// the set of geoms changed: build from scratch, keeping the allocations
+	void Rebuild(const GeomList &geoms);
+	// same geoms as before but they may have moved: update the boxes
+	// bottom-up and only rebuild subtrees which got too loose
+	void Refit();
 
-	// Avoid re-allocation of memory when m_geoms are less than before,
-	void Refresh(const GeomList &m_geoms);
+	const BvhNode *GetRoot() const { return m_nodes.empty() ? nullptr : &m_nodes[0]; }
+	const BvhNode *GetKid(const BvhNode *node, int i) const { return &m_nodes[node->kids[i]]; }
+	Geom *GetGeom(const BvhNode *node, int i) const { return m_geoms[node->geomStart + i]; }
 
-	BvhTree(const GeomList &geoms);
-	~BvhTree()
-	{
-		FreeAll();
-	}
-	void CollideGeom(Geom *, const Aabb &, int minMailboxValue, CollisionContactVector &);
+	void CollideGeom(Geom *, const Aabb &, int minMailboxValue, CollisionContactVector &) const;
 
 private:
-	void BuildNode(BvhNode *node, const GeomList &a_geoms, int &outGeomPos);
+	void BuildNode(int nodeIdx, int start, int end, int depth);
+	void RefitNode(int nodeIdx);
+	void RebuildLooseNodes(int nodeIdx, int depth);
 
-	void FreeAll() {
-		if (m_geoms) delete[] m_geoms;
-		m_geoms = nullptr;
-		if (m_nodesAlloc) delete[] m_nodesAlloc;
-		m_nodesAlloc = nullptr;
-	}
+	std::vector<Geom *> m_geoms;
+	std::vector<BvhNode> m_nodes;
 };
 
 BvhTree::BvhTree(const GeomList &geoms)
 {
 	PROFILE_SCOPED()
-	m_geoms = nullptr;
-	m_nodesAlloc = nullptr;
-	int numGeoms = geoms.size();
-	if (numGeoms == 0) {
-		m_root = nullptr;
+	Rebuild(geoms);
+}
+
+void BvhTree::Rebuild(const GeomList &geoms)
+{
+	PROFILE_SCOPED()
+	m_geoms.assign(geoms.begin(), geoms.end());
+	m_nodes.clear();
+	if (m_geoms.empty()) return;
+
+	m_nodes.reserve(2 * m_geoms.size());
+	m_nodes.emplace_back();
+	BuildNode(0, 0, int(m_geoms.size()), 0);
+	CollisionSpace::s_treeStats.rebuilds++;
+}
+
+void BvhTree::Refit()
+{
+	PROFILE_SCOPED()
+	if (m_nodes.empty()) return;
+
+	RefitNode(0);
+	RebuildLooseNodes(0, 0);
+
+	if (m_nodes.size() > MAX_NODES_PER_GEOM * m_geoms.size()) {
+		m_nodes.resize(1);
+		BuildNode(0, 0, int(m_geoms.size()), 0);
+		CollisionSpace::s_treeStats.rebuilds++;
+	} else {
+		CollisionSpace::s_treeStats.refits++;
+	}
+}
+
+void BvhTree::RefitNode(int nodeIdx)
+{
+	BvhNode &node = m_nodes[nodeIdx];
+	if (node.IsLeaf()) {
+		node.aabb.min = vector3d(FLT_MAX, FLT_MAX, FLT_MAX);
+		node.aabb.max = vector3d(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (int i = node.geomStart; i < node.geomStart + node.numGeoms; i++) {
+			const vector3d p = m_geoms[i]->GetPosition();
+			const double rad = m_geoms[i]->GetGeomTree()->GetRadius();
+			for (int axis = 0; axis < 3; axis++) {
+				node.aabb.min[axis] = std::min(node.aabb.min[axis], p[axis] - rad);
+				node.aabb.max[axis] = std::max(node.aabb.max[axis], p[axis] + rad);
+			}
+		}
 		return;
 	}
-	m_geoms = new Geom *[numGeoms];
-	int geomPos = 0;
-	m_nodesAllocPos = 0;
-	m_nodesAllocMax = numGeoms * 2;
-	m_nodesAlloc = new BvhNode[m_nodesAllocMax];
-	m_root = AllocNode();
-	BuildNode(m_root, geoms, geomPos);
-	assert(geomPos == numGeoms);
+
+	RefitNode(node.kids[0]);
+	RefitNode(node.kids[1]);
+	// m_nodes doesn't grow while refitting, so node is still valid
+	const Aabb &a = m_nodes[node.kids[0]].aabb;
+	const Aabb &b = m_nodes[node.kids[1]].aabb;
+	for (int axis = 0; axis < 3; axis++) {
+		node.aabb.min[axis] = std::min(a.min[axis], b.min[axis]);
+		node.aabb.max[axis] = std::max(a.max[axis], b.max[axis]);
+	}
 }
 
-void BvhTree::Refresh(const GeomList &geoms)
+void BvhTree::RebuildLooseNodes(int nodeIdx, int depth)
 {
-	PROFILE_SCOPED()
-	int numGeoms = geoms.size();
-	if (numGeoms == 0) {
-		m_root = nullptr;
-		FreeAll();
+	const BvhNode &node = m_nodes[nodeIdx];
+	if (node.IsLeaf()) return;
+
+	if (AabbArea(node.aabb) > REBUILD_AREA_RATIO * node.buildArea) {
+		// the old kids are orphaned, see MAX_NODES_PER_GEOM
+		BuildNode(nodeIdx, node.geomStart, node.geomStart + node.numGeoms, depth);
+		CollisionSpace::s_treeStats.subtreeRebuilds++;
 		return;
 	}
-	int geomPos = 0;
-	m_nodesAllocPos = 0;
-	m_root = AllocNode();
-	BuildNode(m_root, geoms, geomPos);
-	assert(geomPos == numGeoms);
+
+	const int kid0 = node.kids[0], kid1 = node.kids[1];
+	RebuildLooseNodes(kid0, depth + 1);
+	RebuildLooseNodes(kid1, depth + 1);
 }
 
-void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, CollisionContactVector &accumulator)
+void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, CollisionContactVector &accumulator) const
 {
 	PROFILE_SCOPED()
-	if (!m_root) return;
+	if (m_nodes.empty()) return;
 
 	int stackPos = -1;
-	BvhNode *stack[16];
-	BvhNode *node = m_root;
+	const BvhNode *stack[MAX_DEPTH];
+	const BvhNode *node = GetRoot();
 
 	for (;;) {
 		if (geomAabb.Intersects(node->aabb)) {
-			if (node->geomStart) {
+			if (node->IsLeaf()) {
 				for (int i = 0; i < node->numGeoms; i++) {
-					Geom *g2 = node->geomStart[i];
+					Geom *g2 = GetGeom(node, i);
 					if (!g2->IsEnabled()) continue;
 					if (g2->GetMailboxIndex() < minMailboxValue) continue;
 					if (g2 == g) continue;
@@ -155,9 +217,9 @@ void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, Co
 					if (dist_sqr >= ((radius + radius2) * (radius + radius2))) continue;
 					g->Collide(g2, accumulator);
 				}
-			} else if (node->kids[0]) {
-				stack[++stackPos] = node->kids[0];
-				node = node->kids[1];
+			} else {
+				stack[++stackPos] = GetKid(node, 0);
+				node = GetKid(node, 1);
 				continue;
 			}
 		}
@@ -167,10 +229,10 @@ void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, Co
 	}
 }
 
-void BvhTree::BuildNode(BvhNode *node, const GeomList &a_geoms, int &outGeomPos)
+void BvhTree::BuildNode(int nodeIdx, int start, int end, int depth)
 {
 	PROFILE_SCOPED()
-	const int numGeoms = a_geoms.size();
+	const int numGeoms = end - start;
 	// make aabb from spheres
 	// XXX suboptimal for static objects, as they have fixed rotation so
 	// we can use a precise rotated aabb rather than worst case XXX
@@ -178,10 +240,9 @@ void BvhTree::BuildNode(BvhNode *node, const GeomList &a_geoms, int &outGeomPos)
 	aabb.min = vector3d(FLT_MAX, FLT_MAX, FLT_MAX);
 	aabb.max = vector3d(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-	for (GeomList::const_iterator i = a_geoms.begin();
-		 i != a_geoms.end(); ++i) {
-		vector3d p = (*i)->GetPosition();
-		double rad = (*i)->GetGeomTree()->GetRadius();
+	for (int i = start; i < end; i++) {
+		vector3d p = m_geoms[i]->GetPosition();
+		double rad = m_geoms[i]->GetGeomTree()->GetRadius();
 		aabb.Update(p + vector3d(rad, rad, rad));
 		aabb.Update(p - vector3d(rad, rad, rad));
 	}
@@ -197,50 +258,47 @@ void BvhTree::BuildNode(BvhNode *node, const GeomList &a_geoms, int &outGeomPos)
 		axis = 2;
 	const double pivot = 0.5 * (aabb.max[axis] + aabb.min[axis]);
 
-	GeomList side[2];
+	const int mid = int(std::partition(m_geoms.begin() + start, m_geoms.begin() + end, [&](const Geom *g) {
+		return g->GetPosition()[axis] < pivot;
+	}) - m_geoms.begin());
 
-	for (GeomList::const_iterator i = a_geoms.begin();
-		 i != a_geoms.end(); ++i) {
-		if ((*i)->GetPosition()[axis] < pivot) {
-			side[0].push_back(*i);
-		} else {
-			side[1].push_back(*i);
-		}
+	{
+		BvhNode &node = m_nodes[nodeIdx];
+		node.geomStart = start;
+		node.numGeoms = numGeoms;
+		node.aabb = aabb;
+		node.buildArea = AabbArea(aabb);
 	}
 
-	node->numGeoms = numGeoms;
-	node->aabb = aabb;
-
 	// side 1 has all nodes. just make a fucking child
-	if ((side[0].size() == 0) || (side[1].size() == 0)) {
-		node->geomStart = &m_geoms[outGeomPos];
-
-		// copy geoms to the stinking flat array
-		for (GeomList::const_iterator i = a_geoms.begin();
-			 i != a_geoms.end(); ++i) {
-			m_geoms[outGeomPos++] = *i;
-		}
+	if ((mid == start) || (mid == end) || (depth >= MAX_DEPTH - 1)) {
+		m_nodes[nodeIdx].kids[0] = m_nodes[nodeIdx].kids[1] = 0;
 	} else {
 		// recurse!
-		node->geomStart = 0;
-		node->kids[0] = AllocNode();
-		node->kids[1] = AllocNode();
-
-		BuildNode(node->kids[0], side[0], outGeomPos);
-		BuildNode(node->kids[1], side[1], outGeomPos);
+		const int kidIdx = int(m_nodes.size());
+		m_nodes.emplace_back();
+		m_nodes.emplace_back();
+		m_nodes[nodeIdx].kids[0] = kidIdx;
+		m_nodes[nodeIdx].kids[1] = kidIdx + 1;
+
+		BuildNode(kidIdx, start, mid, depth + 1);
+		BuildNode(kidIdx + 1, mid, end, depth + 1);
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////
 
 int CollisionSpace::s_nextHandle = 1;
+CollisionSpace::TreeStats CollisionSpace::s_treeStats;
 
 CollisionSpace::CollisionSpace()
 {
 	PROFILE_SCOPED()
 	sphere.radius = 0;
 	m_needStaticGeomRebuild = true;
-	m_oldGeomsNumber = 0;
+	m_needDynamicGeomRebuild = true;
+	m_version = 0;
+	m_preparedVersion = 0;
 	m_staticObjectTree = nullptr;
 	m_dynamicObjectTree = nullptr;
 }
@@ -256,12 +314,16 @@ void CollisionSpace::AddGeom(Geom *geom)
 {
 	PROFILE_SCOPED()
 	m_geoms.push_back(geom);
+	m_needDynamicGeomRebuild = true;
+	m_version++;
 }
 
 void CollisionSpace::RemoveGeom(Geom *geom)
 {
 	PROFILE_SCOPED()
-	m_geoms.remove(geom);
+	m_geoms.erase(std::remove(m_geoms.begin(), m_geoms.end(), geom), m_geoms.end());
+	m_needDynamicGeomRebuild = true;
+	m_version++;
 }
 
 void CollisionSpace::AddStaticGeom(Geom *geom)
@@ -269,13 +331,15 @@ void CollisionSpace::AddStaticGeom(Geom *geom)
 	PROFILE_SCOPED()
 	m_staticGeoms.push_back(geom);
 	m_needStaticGeomRebuild = true;
+	m_version++;
 }
 
 void CollisionSpace::RemoveStaticGeom(Geom *geom)
 {
 	PROFILE_SCOPED()
-	m_staticGeoms.remove(geom);
+	m_staticGeoms.erase(std::remove(m_staticGeoms.begin(), m_staticGeoms.end(), geom), m_staticGeoms.end());
 	m_needStaticGeomRebuild = true;
+	m_version++;
 }
 
 void CollisionSpace::CollideRaySphere(const vector3d &start, const vector3d &dir, isect_t *isect)
@@ -316,8 +380,8 @@ CollisionContact CollisionSpace::TraceRay(const vector3d &start, const vector3d
 	CollisionContact c;
 	c.distance = len;
 
-	BvhNode *vn_stack[16];
-	BvhNode *node = m_staticObjectTree->m_root;
+	const BvhNode *vn_stack[MAX_DEPTH];
+	const BvhNode *node = m_staticObjectTree ? m_staticObjectTree->GetRoot() : nullptr;
 	int stackPos = -1;
 
 	for (; node;) {
@@ -329,11 +393,11 @@ CollisionContact CollisionSpace::TraceRay(const vector3d &start, const vector3d
 			if (!node->CollideRay(start, invDir, &isect)) goto pop_jizz;
 		}
 
-		if (node->geomStart) {
+		if (node->IsLeaf()) {
 			// it is a leaf node
 			// collide with all geoms
 			for (int i = 0; i < node->numGeoms; i++) {
-				Geom *g = node->geomStart[i];
+				Geom *g = m_staticObjectTree->GetGeom(node, i);
 
 				const matrix4x4d &invTrans = g->GetInvTransform();
 				vector3d ms = invTrans * start;
@@ -360,9 +424,9 @@ CollisionContact CollisionSpace::TraceRay(const vector3d &start, const vector3d
 					c.distance = isect.dist;
 				}
 			}
-		} else if (node->kids[0]) {
-			vn_stack[++stackPos] = node->kids[0];
-			node = node->kids[1];
+		} else {
+			vn_stack[++stackPos] = m_staticObjectTree->GetKid(node, 0);
+			node = m_staticObjectTree->GetKid(node, 1);
 			continue;
 		}
 	pop_jizz:
@@ -422,6 +486,21 @@ CollisionContact CollisionSpace::TraceRay(const vector3d &start, const vector3d
  * Do not collide objects with mailbox value < minMailboxValue
  */
 void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, CollCallback &callback)
+{
+	PROFILE_SCOPED()
+	if (!a->IsEnabled()) return;
+
+	CollisionContactVector accumulator;
+	accumulator.reserve(MAX_CONTACTS);
+
+	CollideGeoms(a, minMailboxValue, accumulator);
+
+	if (!accumulator.empty()) callback(accumulator);
+}
+
+// the part of the above which doesn't change anything. safe to call from
+// several threads at once
+void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, CollisionContactVector &accumulator)
 {
 	PROFILE_SCOPED()
 	if (!a->IsEnabled()) return;
@@ -432,9 +511,6 @@ void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, CollCallback &ca
 	ourAabb.min = pos - vector3d(radius, radius, radius);
 	ourAabb.max = pos + vector3d(radius, radius, radius);
 
-	CollisionContactVector accumulator;
-	accumulator.reserve(MAX_CONTACTS);
-
 	if (m_staticObjectTree) m_staticObjectTree->CollideGeom(a, ourAabb, 0, accumulator);
 	if (m_dynamicObjectTree) m_dynamicObjectTree->CollideGeom(a, ourAabb, minMailboxValue, accumulator);
 
@@ -442,8 +518,6 @@ void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, CollCallback &ca
 	if (sphere.radius > 0.0) {
 		a->CollideSphere(sphere, accumulator);
 	}
-
-	if (!accumulator.empty()) callback(accumulator);
 }
 
 void CollisionSpace::RebuildObjectTrees()
@@ -453,19 +527,17 @@ void CollisionSpace::RebuildObjectTrees()
 		if (m_staticObjectTree) delete m_staticObjectTree;
 		m_staticObjectTree = new BvhTree(m_staticGeoms);
 	}
-	if (m_oldGeomsNumber < m_geoms.size()) {
-		// Have more geoms: rebuild completely (ask more memory)
-		if (m_dynamicObjectTree) delete m_dynamicObjectTree;
+	if (!m_dynamicObjectTree) {
 		m_dynamicObjectTree = new BvhTree(m_geoms);
+	} else if (m_needDynamicGeomRebuild) {
+		m_dynamicObjectTree->Rebuild(m_geoms);
 	} else {
-		// Same number or less (no needs for more memory)
-		if (m_dynamicObjectTree) m_dynamicObjectTree->Refresh(m_geoms);
-		else m_dynamicObjectTree = new BvhTree(m_geoms);
+		// only positions changed since last time
+		m_dynamicObjectTree->Refit();
 	}
 
-	m_oldGeomsNumber = m_geoms.size();
-
 	m_needStaticGeomRebuild = false;
+	m_needDynamicGeomRebuild = false;
 }
 
 void CollisionSpace::Collide(CollCallback &callback)
@@ -473,15 +545,93 @@ void CollisionSpace::Collide(CollCallback &callback)
 	PROFILE_SCOPED()
 	RebuildObjectTrees();
 
+	// callbacks can add and remove geoms (a ship that lands turns static),
+	// so go through the ones there were at the start, skipping any gone since
+	m_iterGeoms.assign(m_geoms.begin(), m_geoms.end());
+	const uint32_t version = m_version;
+
 	int mailboxMin = 0;
-	for (GeomList::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i) {
-		(*i)->SetMailboxIndex(mailboxMin++);
+	for (Geom *g : m_iterGeoms) {
+		g->SetMailboxIndex(mailboxMin++);
 	}
 
 	/* This mailbox nonsense is so: after collision(a,b), we will not
 	 * attempt collision(b,a) */
 	mailboxMin = 1;
-	for (GeomList::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i, mailboxMin++) {
-		CollideGeoms(*i, mailboxMin, callback);
+	for (Geom *g : m_iterGeoms) {
+		if (HasGeom(g, version))
+			CollideGeoms(g, mailboxMin, callback);
+		mailboxMin++;
+	}
+}
+
+bool CollisionSpace::HasGeom(const Geom *g, uint32_t version) const
+{
+	return m_version == version || std::find(m_geoms.begin(), m_geoms.end(), g) != m_geoms.end();
+}
+
+void CollisionSpace::PrepareCollide()
+{
+	PROFILE_SCOPED()
+	RebuildObjectTrees();
+
+	m_collideGeoms.assign(m_geoms.begin(), m_geoms.end());
+	m_geomVersions.clear();
+	int mailboxMin = 0;
+	for (Geom *g : m_collideGeoms) {
+		g->SetMailboxIndex(mailboxMin++);
+		m_geomVersions.push_back(g->GetStateVersion());
+	}
+	for (Geom *g : m_staticGeoms)
+		m_geomVersions.push_back(g->GetStateVersion());
+	m_preparedVersion = m_version;
+
+	// keep the vectors (and their capacity) around between steps
+	if (m_collideContacts.size() < m_collideGeoms.size())
+		m_collideContacts.resize(m_collideGeoms.size());
+	for (size_t i = 0; i < m_collideGeoms.size(); i++)
+		m_collideContacts[i].clear();
+}
+
+void CollisionSpace::CollideItem(size_t idx)
+{
+	PROFILE_SCOPED()
+	// same pairs as Collide: geom idx against those after it
+	CollideGeoms(m_collideGeoms[idx], int(idx) + 1, m_collideContacts[idx]);
+}
+
+bool CollisionSpace::ChangedSincePrepare() const
+{
+	if (m_version != m_preparedVersion)
+		return true;
+
+	std::vector<uint32_t>::const_iterator version = m_geomVersions.begin();
+	for (const Geom *g : m_collideGeoms)
+		if (g->GetStateVersion() != *version++) return true;
+	for (const Geom *g : m_staticGeoms)
+		if (g->GetStateVersion() != *version++) return true;
+	return false;
+}
+
+void CollisionSpace::FinishCollide(CollCallback &callback)
+{
+	PROFILE_SCOPED()
+	// callbacks of other spaces may have moved things in here already
+	if (ChangedSincePrepare()) {
+		Collide(callback);
+		return;
+	}
+
+	// m_geoms is what m_collideGeoms was taken from until a callback
+	// changes it, and then only the latter is safe to go on with
+	bool valid = true;
+	for (size_t idx = 0; idx < m_collideGeoms.size(); idx++) {
+		if (!valid) {
+			if (HasGeom(m_collideGeoms[idx], m_preparedVersion))
+				CollideGeoms(m_collideGeoms[idx], int(idx) + 1, callback);
+		} else if (!m_collideContacts[idx].empty()) {
+			callback(m_collideContacts[idx]);
+			valid = !ChangedSincePrepare();
+		}
 	}
 }
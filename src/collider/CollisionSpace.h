@@ -5,12 +5,13 @@
 #define _COLLISION_SPACE
 
 #include "CollisionCallbackFwd.h"
+#include "CollisionContact.h"
 #include "libs/vector3.h"
-#include <list>
+#include <cstdint>
+#include <vector>
 
 class Geom;
 struct isect_t;
-struct CollisionContact;
 
 struct Sphere {
 	vector3d pos;
@@ -20,7 +21,7 @@ struct Sphere {
 
 class BvhTree;
 
-typedef std::list<Geom *> GeomList;
+typedef std::vector<Geom *> GeomList;
 
 /*
  * Collision spaces have a bunch of geoms and at most one sphere (for a planet).
@@ -35,11 +36,25 @@ public:
 	void RemoveStaticGeom(Geom *);
 	CollisionContact TraceRay(const vector3d &start, const vector3d &dir, double len, const Geom *ignore = nullptr);
 	void Collide(CollCallback &callback);
+
+	// Collide split in three, so the narrow phase of many spaces can run on
+	// worker threads (see Frame::CollideFrames). Prepare and Finish run on the
+	// main thread, CollideItem for every item in [0, GetNumCollideItems())
+	// can run anywhere in between. Callbacks fire from Finish in the same
+	// order and with the same contacts as Collide would give; as soon as a
+	// callback changes anything the precomputed contacts depend on, Finish
+	// falls back to colliding the remaining geoms serially
+	void PrepareCollide();
+	size_t GetNumCollideItems() const { return m_collideGeoms.size(); }
+	void CollideItem(size_t idx);
+	void FinishCollide(CollCallback &callback);
+
 	void SetSphere(const vector3d &pos, double radius, void *user_data)
 	{
 		sphere.pos = pos;
 		sphere.radius = radius;
 		sphere.userData = user_data;
+		m_version++;
 	}
 	void FlagRebuildObjectTrees() { m_needStaticGeomRebuild = true; }
 	inline void RebuildObjectTrees();
@@ -54,19 +69,47 @@ public:
 		return s_nextHandle++;
 	}
 
+	// how the object trees of all spaces were kept up to date, since startup.
+	// moving geoms only need a refit, subtrees which got too loose are rebuilt
+	struct TreeStats {
+		uint64_t refits = 0;
+		uint64_t subtreeRebuilds = 0;
+		uint64_t rebuilds = 0;
+	};
+	static const TreeStats &GetTreeStats() { return s_treeStats; }
+
 private:
+	friend class BvhTree;
+
 	void CollideGeoms(Geom *a, int minMailboxValue, CollCallback &callback);
+	void CollideGeoms(Geom *a, int minMailboxValue, CollisionContactVector &accumulator);
+	bool ChangedSincePrepare() const;
+	// whether g is still one of m_geoms, which it is for sure if nothing was
+	// added or removed since m_version was version
+	bool HasGeom(const Geom *g, uint32_t version) const;
 	void CollideRaySphere(const vector3d &start, const vector3d &dir, isect_t *isect);
 	GeomList m_geoms;
 	GeomList m_staticGeoms;
 	bool m_needStaticGeomRebuild;
+	bool m_needDynamicGeomRebuild;
 	BvhTree *m_staticObjectTree;
 	BvhTree *m_dynamicObjectTree;
 	Sphere sphere;
 
-	size_t m_oldGeomsNumber;
+	// bumped when geoms are added or removed
+	uint32_t m_version;
+
+	// state captured by PrepareCollide
+	uint32_t m_preparedVersion;
+	std::vector<Geom *> m_collideGeoms;
+	std::vector<uint32_t> m_geomVersions; // dynamic geoms, then static ones
+	std::vector<CollisionContactVector> m_collideContacts;
+
+	// what Collide goes through, kept for its capacity
+	GeomList m_iterGeoms;
 
 	static int s_nextHandle;
+	static TreeStats s_treeStats;
 };
 
 #endif /* _COLLISION_SPACE */
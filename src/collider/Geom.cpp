@@ -17,6 +17,7 @@ Geom::Geom(const GeomTree *geomtree, const matrix4x4d &m, const vector3d &pos, v
 	m_data(data),
 	m_group(0),
 	m_mailboxIndex(0),
+	m_stateVersion(0),
 	m_active(true)
 {
 	m_orient.SetTranslate(pos);
@@ -37,6 +38,7 @@ void Geom::MoveTo(const matrix4x4d &m)
 	m_orient = m;
 	m_pos = m_orient.GetTranslate();
 	m_invOrient = m.Inverse();
+	m_stateVersion++;
 }
 
 void Geom::MoveTo(const matrix4x4d &m, const vector3d &pos)
@@ -46,6 +48,7 @@ void Geom::MoveTo(const matrix4x4d &m, const vector3d &pos)
 	m_pos = pos;
 	m_orient.SetTranslate(pos);
 	m_invOrient = m_orient.Inverse();
+	m_stateVersion++;
 }
 
 void Geom::CollideSphere(Sphere &sphere, CollisionContactVector &accum) const
@@ -154,7 +157,7 @@ bool Geom::CheckBoxes(Geom* b, CollisionContactVector &accum)
 	return false;
 }
 
-static bool rotatedAabbIsectsNormalOne(Aabb &a, const matrix4x4d &transA, Aabb &b)
+static bool rotatedAabbIsectsNormalOne(const Aabb &a, const matrix4x4d &transA, const Aabb &b)
 {
 	PROFILE_SCOPED()
 	Aabb arot;
@@ -187,53 +190,58 @@ static bool rotatedAabbIsectsNormalOne(Aabb &a, const matrix4x4d &transA, Aabb &
 void Geom::CollideEdgesWithTrisOf(int &maxContacts, const Geom *b, const matrix4x4d &transTo, CollisionContactVector &accum) const
 {
 	PROFILE_SCOPED()
+	const BVHTree *edgeTree = GetGeomTree()->GetEdgeTree();
+	const BVHTree *triTree = b->GetGeomTree()->GetTriTree();
+
+	// every pop pushes at most one entry more than it took, one level deeper
 	struct stackobj {
-		BVHNode *edgeNode;
-		BVHNode *triNode;
-	} stack[32];
+		const BVHNode *edgeNode;
+		const BVHNode *triNode;
+	} stack[2 * BVHTree::MAX_DEPTH + 1];
 	int stackpos = 0;
 
-	stack[0].edgeNode = GetGeomTree()->GetEdgeTree()->GetRoot();
-	stack[0].triNode = b->GetGeomTree()->GetTriTree()->GetRoot();
+	stack[0].edgeNode = edgeTree->GetRoot();
+	stack[0].triNode = triTree->GetRoot();
 
 	while ((stackpos >= 0) && (maxContacts > 0)) {
-		BVHNode *edgeNode = stack[stackpos].edgeNode;
-		BVHNode *triNode = stack[stackpos].triNode;
+		const BVHNode *edgeNode = stack[stackpos].edgeNode;
+		const BVHNode *triNode = stack[stackpos].triNode;
 		stackpos--;
 
 		// does the edgeNode (with its aabb described in 6 planes transformed and rotated to
 		// b's coordinates) intersect with one or other of b's child nodes?
-		if (triNode->triIndicesStart || edgeNode->triIndicesStart) {
+		if (triNode->IsLeaf() || edgeNode->IsLeaf()) {
 			// reached triangle leaf node or edge leaf node.
 			// Intersect all edges under edgeNode with this leaf
 			CollideEdgesTris(maxContacts, edgeNode, transTo, b, triNode, accum);
 		} else {
-			BVHNode *left = triNode->kids[0];
-			BVHNode *right = triNode->kids[1];
-			bool edgeNodeIsectsLeftChild = rotatedAabbIsectsNormalOne(edgeNode->aabb, transTo, left->aabb);
-			bool edgeNodeIsectsRightChild = rotatedAabbIsectsNormalOne(edgeNode->aabb, transTo, right->aabb);
+			const BVHNode *left = triTree->GetKid(triNode, 0);
+			const BVHNode *right = triTree->GetKid(triNode, 1);
+			const Aabb edgeAabb = edgeNode->GetAabb();
+			bool edgeNodeIsectsLeftChild = rotatedAabbIsectsNormalOne(edgeAabb, transTo, left->GetAabb());
+			bool edgeNodeIsectsRightChild = rotatedAabbIsectsNormalOne(edgeAabb, transTo, right->GetAabb());
 			//edgeNodeIsectsRightChild = edgeNodeIsectsLeftChild = true;
 			if (edgeNodeIsectsRightChild) {
 				if (edgeNodeIsectsLeftChild) {
 					// isects both. split edgeNode and try again
 					++stackpos;
-					stack[stackpos].edgeNode = edgeNode->kids[0];
+					stack[stackpos].edgeNode = edgeTree->GetKid(edgeNode, 0);
 					stack[stackpos].triNode = triNode;
 					++stackpos;
-					stack[stackpos].edgeNode = edgeNode->kids[1];
+					stack[stackpos].edgeNode = edgeTree->GetKid(edgeNode, 1);
 					stack[stackpos].triNode = triNode;
 				} else {
 					// hits only right child. go down into that
 					// side with same edge node
 					++stackpos;
 					stack[stackpos].edgeNode = edgeNode;
-					stack[stackpos].triNode = triNode->kids[1];
+					stack[stackpos].triNode = right;
 				}
 			} else if (edgeNodeIsectsLeftChild) {
 				// hits only left child
 				++stackpos;
 				stack[stackpos].edgeNode = edgeNode;
-				stack[stackpos].triNode = triNode->kids[0];
+				stack[stackpos].triNode = left;
 			} else {
 				// hits none
 			}
@@ -250,45 +258,61 @@ void Geom::CollideEdgesTris(int &maxContacts, const BVHNode *edgeNode, const mat
 {
 	PROFILE_SCOPED()
 	if (maxContacts <= 0) return;
-	if (edgeNode->triIndicesStart) {
+	const BVHTree *edgeTree = GetGeomTree()->GetEdgeTree();
+	if (edgeNode->IsLeaf()) {
 		const GeomTree::Edge *edges = this->GetGeomTree()->GetEdges();
-		vector3f dir;
-		isect_t isect;
+		const BVHTree::objPtr_t *edgeIdxs = edgeTree->GetObjs(edgeNode);
+		const int numEdges = edgeNode->numObjs;
 		const std::vector<vector3f> &rVertices = GetGeomTree()->GetVertices();
-		for (int i = 0; i < edgeNode->numTris; i++) {
-			const int vtxNum = edges[edgeNode->triIndicesStart[i]].v1i;
+
+		vector3f dirs[GeomTree::MAX_PACKET_RAYS];
+		isect_t isects[GeomTree::MAX_PACKET_RAYS];
+		// edges of a leaf are sorted, so the ones starting at the same
+		// vertex are neighbours and get traced together as one packet
+		for (int first = 0; first < numEdges;) {
+			const int vtxNum = edges[edgeIdxs[first]].v1i;
+			int count = 0;
+			while (first + count < numEdges && count < GeomTree::MAX_PACKET_RAYS && edges[edgeIdxs[first + count]].v1i == vtxNum) {
+				const GeomTree::Edge &edge = edges[edgeIdxs[first + count]];
+				vector3d _dir(
+					double(edge.dir.x),
+					double(edge.dir.y),
+					double(edge.dir.z));
+				_dir = transToB.ApplyRotationOnly(_dir);
+				dirs[count] = vector3f(&_dir.x);
+				isects[count].dist = edge.len;
+				isects[count].triIdx = -1;
+				count++;
+			}
+
 			const vector3d v1 = transToB * vector3d(rVertices[vtxNum]);
 			const vector3f _from(float(v1.x), float(v1.y), float(v1.z));
 
-			vector3d _dir(
-				double(edges[edgeNode->triIndicesStart[i]].dir.x),
-				double(edges[edgeNode->triIndicesStart[i]].dir.y),
-				double(edges[edgeNode->triIndicesStart[i]].dir.z));
-			_dir = transToB.ApplyRotationOnly(_dir);
-			dir = vector3f(&_dir.x);
-			isect.dist = edges[edgeNode->triIndicesStart[i]].len;
-			isect.triIdx = -1;
-
-			b->GetGeomTree()->TraceRay(btriNode, _from, dir, &isect);
-
-			if (isect.triIdx == -1) continue;
-			const double depth = edges[edgeNode->triIndicesStart[i]].len - isect.dist;
-			// in world coords
-			vector3d normal = vector3d(b->m_geomtree->GetTriNormal(isect.triIdx));
-
-			accum.emplace_back(b->GetTransform() * (v1 + vector3d(&dir.x) * double(isect.dist)),
-				b->GetTransform().ApplyRotationOnly(normal),
-				depth,
-				isect.triIdx,
-				this->m_data,
-				b->m_data,
-				// contact geomFlag is bitwise OR of triangle's and edge's flags
-				b->m_geomtree->GetTriFlag(isect.triIdx) | edges[edgeNode->triIndicesStart[i]].triFlag);
-			accum.back().distance = isect.dist;
-			if (--maxContacts <= 0) return;
+			b->GetGeomTree()->TraceRays(btriNode, count, _from, dirs, isects);
+
+			for (int i = 0; i < count; i++) {
+				const isect_t &isect = isects[i];
+				if (isect.triIdx == -1) continue;
+				const GeomTree::Edge &edge = edges[edgeIdxs[first + i]];
+				const double depth = edge.len - isect.dist;
+				// in world coords
+				vector3d normal = vector3d(b->m_geomtree->GetTriNormal(isect.triIdx));
+
+				accum.emplace_back(b->GetTransform() * (v1 + vector3d(&dirs[i].x) * double(isect.dist)),
+					b->GetTransform().ApplyRotationOnly(normal),
+					depth,
+					isect.triIdx,
+					this->m_data,
+					b->m_data,
+					// contact geomFlag is bitwise OR of triangle's and edge's flags
+					b->m_geomtree->GetTriFlag(isect.triIdx) | edge.triFlag);
+				accum.back().distance = isect.dist;
+				if (--maxContacts <= 0) return;
+			}
+			first += count;
 		}
 	} else {
-		CollideEdgesTris(maxContacts, edgeNode->kids[0], transToB, b, btriNode, accum);
-		CollideEdgesTris(maxContacts, edgeNode->kids[1], transToB, b, btriNode, accum);
+		CollideEdgesTris(maxContacts, edgeTree->GetKid(edgeNode, 0), transToB, b, btriNode, accum);
+		CollideEdgesTris(maxContacts, edgeTree->GetKid(edgeNode, 1), transToB, b, btriNode, accum);
 	}
 }
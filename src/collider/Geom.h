@@ -31,8 +31,16 @@ public:
 	inline const matrix4x4d &GetTransform() const { return m_orient; }
 	//matrix4x4d GetRotation() const;
 	inline const vector3d &GetPosition() const { return m_pos; }
-	inline void Enable() { m_active = true; }
-	inline void Disable() { m_active = false; }
+	inline void Enable()
+	{
+		m_active = true;
+		m_stateVersion++;
+	}
+	inline void Disable()
+	{
+		m_active = false;
+		m_stateVersion++;
+	}
 	inline bool IsEnabled() const { return m_active; }
 	inline const GeomTree *GetGeomTree() const { return m_geomtree; }
 	void Collide(Geom *b, CollisionContactVector &accum) const;
@@ -42,6 +50,8 @@ public:
 	inline int GetMailboxIndex() const { return m_mailboxIndex; }
 	inline void SetGroup(int g) { m_group = g; }
 	inline int GetGroup() const { return m_group; }
+	// changes whenever the geom moves or is enabled/disabled
+	inline uint32_t GetStateVersion() const { return m_stateVersion; }
 
 	matrix4x4d m_animTransform;
 
@@ -63,6 +73,7 @@ private:
 	void *m_data;
 	int m_group;
 	int m_mailboxIndex; // used to avoid duplicate collisions
+	uint32_t m_stateVersion;
 	bool m_active;
 
 	std::vector<CSG_Box> m_Boxes;
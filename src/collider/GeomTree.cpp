@@ -8,6 +8,11 @@
 #include "libs/libs.h"
 #include "scenegraph/Serializer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GEOMTREE_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
 GeomTree::~GeomTree()
 {
 }
@@ -36,13 +41,6 @@ GeomTree::GeomTree(const int numVerts, const int numTris, const std::vector<vect
 	m_aabb.min = vector3d(std::numeric_limits<double>::max());
 	m_aabb.max = vector3d(std::numeric_limits<double>::lowest());
 
-	// activeTris = tris we are still trying to put into leaves
-	std::vector<int> activeTris;
-	activeTris.reserve(numTris);
-	for (int i = 0; i < numTris; i++) {
-		activeTris.push_back(i * 3);
-	}
-
 	typedef std::map<std::pair<int, int>, int> EdgeType;
 	EdgeType edges;
 #define ADD_EDGE(_i1, _i2, _triflag)                     \
@@ -96,28 +94,8 @@ GeomTree::GeomTree(const int numVerts, const int numTris, const std::vector<vect
 	}
 	m_radius = sqrt(m_radius);
 
-	{
-		Aabb *aabbs = new Aabb[activeTris.size()];
-		for (uint32_t i = 0; i < activeTris.size(); i++) {
-			const vector3d v1 = vector3d(m_vertices[m_indices[activeTris[i] + 0]]);
-			const vector3d v2 = vector3d(m_vertices[m_indices[activeTris[i] + 1]]);
-			const vector3d v3 = vector3d(m_vertices[m_indices[activeTris[i] + 2]]);
-			aabbs[i].min = aabbs[i].max = v1;
-			aabbs[i].Update(v2);
-			aabbs[i].Update(v3);
-		}
-
-		//int t = SDL_GetTicks();
-		m_triTree.reset(new BVHTree(activeTris.size(), &activeTris[0], aabbs));
-		delete[] aabbs;
-	}
-	//Output("Tri tree of %d tris build in %dms\n", activeTris.size(), SDL_GetTicks() - t);
-
 	m_numEdges = edges.size();
 	m_edges.resize(m_numEdges);
-	// to build Edge bvh tree with.
-	m_aabbs.resize(m_numEdges);
-	int *edgeIdxs = new int[m_numEdges];
 
 	int pos = 0;
 	typedef EdgeType::iterator MapPairIter;
@@ -136,22 +114,15 @@ GeomTree::GeomTree(const int numVerts, const int numTris, const std::vector<vect
 		m_edges[pos].triFlag = triflag;
 		m_edges[pos].len = len;
 		m_edges[pos].dir = dir;
-
-		edgeIdxs[pos] = pos;
-		m_aabbs[pos].min = m_aabbs[pos].max = vector3d(v1);
-		m_aabbs[pos].Update(vector3d(v2));
 	}
 
-	//t = SDL_GetTicks();
-	m_edgeTree.reset(new BVHTree(m_numEdges, edgeIdxs, &m_aabbs[0]));
-	delete[] edgeIdxs;
-	//Output("Edge tree of %d edges build in %dms\n", m_numEdges, SDL_GetTicks() - t);
+	BuildTrees();
 
 	timer.Stop();
 	//Output(" - - GeomTree::GeomTree took: %lf milliseconds\n", timer.millicycles());
 }
 
-GeomTree::GeomTree(Serializer::Reader &rd)
+GeomTree::GeomTree(Serializer::Reader &rd, bool buildTrees)
 {
 	PROFILE_SCOPED()
 	m_numVertices = rd.Int32();
@@ -163,12 +134,6 @@ GeomTree::GeomTree(Serializer::Reader &rd)
 	m_aabb.min = rd.Vector3d();
 	m_aabb.radius = rd.Double();
 
-	const uint32_t numAabbs = rd.Int32();
-	m_aabbs.resize(numAabbs);
-	for (uint32_t iAabb = 0; iAabb < numAabbs; ++iAabb) {
-		rd >> m_aabbs[iAabb];
-	}
-
 	{
 		PROFILE_SCOPED_DESC("GeomTree::LoadEdges")
 		m_edges.resize(m_numEdges);
@@ -194,57 +159,142 @@ GeomTree::GeomTree(Serializer::Reader &rd)
 		m_triFlags[iTri] = rd.Int32();
 	}
 
-	// activeTris = tris we are still trying to put into leaves
-	std::vector<int> activeTris;
-	activeTris.reserve(m_numTris);
-	for (int i = 0; i < m_numTris; i++) {
-		activeTris.push_back(i * 3);
-	}
+	if (buildTrees)
+		BuildTrees();
+}
 
-	// regenerate the aabb data
-	Aabb *aabbs = new Aabb[activeTris.size()];
-	for (uint32_t i = 0; i < activeTris.size(); i++) {
-		const vector3d v1 = vector3d(m_vertices[m_indices[activeTris[i] + 0]]);
-		const vector3d v2 = vector3d(m_vertices[m_indices[activeTris[i] + 1]]);
-		const vector3d v3 = vector3d(m_vertices[m_indices[activeTris[i] + 2]]);
-		aabbs[i].min = aabbs[i].max = v1;
-		aabbs[i].Update(v2);
-		aabbs[i].Update(v3);
+// the trees are cheap enough to build that they aren't stored in the .sgm
+void GeomTree::BuildTrees()
+{
+	PROFILE_SCOPED()
+	{
+		std::vector<int> triIdxs(m_numTris);
+		std::vector<Aabb> aabbs(m_numTris);
+		for (int i = 0; i < m_numTris; i++) {
+			triIdxs[i] = i * 3;
+			const vector3d v1 = vector3d(m_vertices[m_indices[i * 3 + 0]]);
+			const vector3d v2 = vector3d(m_vertices[m_indices[i * 3 + 1]]);
+			const vector3d v3 = vector3d(m_vertices[m_indices[i * 3 + 2]]);
+			aabbs[i].min = aabbs[i].max = v1;
+			aabbs[i].Update(v2);
+			aabbs[i].Update(v3);
+		}
+		m_triTree.reset(new BVHTree(m_numTris, &triIdxs[0], &aabbs[0]));
 	}
-	m_triTree.reset(new BVHTree(activeTris.size(), &activeTris[0], aabbs));
-	delete[] aabbs;
-
-	//
-	int *edgeIdxs = new int[m_numEdges];
-	memset(edgeIdxs, 0, sizeof(int) * m_numEdges);
-	for (int i = 0; i < m_numEdges; i++) {
-		edgeIdxs[i] = i;
+
+	{
+		std::vector<int> edgeIdxs(m_numEdges);
+		std::vector<Aabb> aabbs(m_numEdges);
+		for (int i = 0; i < m_numEdges; i++) {
+			edgeIdxs[i] = i;
+			aabbs[i].min = aabbs[i].max = vector3d(m_vertices[m_edges[i].v1i]);
+			aabbs[i].Update(vector3d(m_vertices[m_edges[i].v2i]));
+		}
+		m_edgeTree.reset(new BVHTree(m_numEdges, &edgeIdxs[0], &aabbs[0]));
 	}
-	m_edgeTree.reset(new BVHTree(m_numEdges, edgeIdxs, &m_aabbs[0]));
 }
 
-static bool SlabsRayAabbTest(const BVHNode *n, const vector3f &start, const vector3f &invDir, isect_t *isect)
+namespace {
+	const int SIMD_WIDTH = 4;
+
+	// reciprocal directions of a ray packet, padded with zeroes to a
+	// multiple of SIMD_WIDTH
+	struct RayPacket {
+		alignas(16) float invDir[3][GeomTree::MAX_PACKET_RAYS];
+		int numRays;
+
+		RayPacket(int n, const vector3f *dirs) :
+			invDir(),
+			numRays(n)
+		{
+			for (int i = 0; i < n; i++) {
+				for (int axis = 0; axis < 3; axis++) {
+					// avoid division by zero please
+					invDir[axis][i] = is_zero_exact(dirs[i][axis]) ? 0.0f : (1.0f / dirs[i][axis]);
+				}
+			}
+		}
+	};
+
+#ifdef GEOMTREE_USE_SSE
+	inline __m128 Dot4(const vector3f &v, const __m128 x, const __m128 y, const __m128 z)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.x), x), _mm_mul_ps(_mm_set1_ps(v.y), y)), _mm_mul_ps(_mm_set1_ps(v.z), z));
+	}
+#endif
+} // namespace
+
+static bool SlabsRayAabbTest(const BVHNode *n, const vector3f &start, const vector3f &invDir, const isect_t *isect)
 {
 	PROFILE_SCOPED()
 	float
-		l1 = (n->aabb.min.x - start.x) * invDir.x,
-		l2 = (n->aabb.max.x - start.x) * invDir.x,
+		l1 = (n->min.x - start.x) * invDir.x,
+		l2 = (n->max.x - start.x) * invDir.x,
 		lmin = std::min(l1, l2),
 		lmax = std::max(l1, l2);
 
-	l1 = (n->aabb.min.y - start.y) * invDir.y;
-	l2 = (n->aabb.max.y - start.y) * invDir.y;
+	l1 = (n->min.y - start.y) * invDir.y;
+	l2 = (n->max.y - start.y) * invDir.y;
 	lmin = std::max(std::min(l1, l2), lmin);
 	lmax = std::min(std::max(l1, l2), lmax);
 
-	l1 = (n->aabb.min.z - start.z) * invDir.z;
-	l2 = (n->aabb.max.z - start.z) * invDir.z;
+	l1 = (n->min.z - start.z) * invDir.z;
+	l2 = (n->max.z - start.z) * invDir.z;
 	lmin = std::max(std::min(l1, l2), lmin);
 	lmax = std::min(std::max(l1, l2), lmax);
 
 	return ((lmax >= 0.f) & (lmax >= lmin) & (lmin < isect->dist));
 }
 
+// true if any ray of the packet hits the node
+static bool SlabsRayPacketAabbTest(const BVHNode *n, const vector3f &start, const RayPacket &packet, const isect_t *isects)
+{
+	PROFILE_SCOPED()
+#ifdef GEOMTREE_USE_SSE
+	const __m128 relMin[3] = {
+		_mm_set1_ps(n->min.x - start.x),
+		_mm_set1_ps(n->min.y - start.y),
+		_mm_set1_ps(n->min.z - start.z)
+	};
+	const __m128 relMax[3] = {
+		_mm_set1_ps(n->max.x - start.x),
+		_mm_set1_ps(n->max.y - start.y),
+		_mm_set1_ps(n->max.z - start.z)
+	};
+
+	for (int i = 0; i < packet.numRays; i += SIMD_WIDTH) {
+		const int lanes = std::min(SIMD_WIDTH, packet.numRays - i);
+		alignas(16) float dist[SIMD_WIDTH] = {};
+		for (int k = 0; k < lanes; k++)
+			dist[k] = isects[i + k].dist;
+
+		__m128 inv = _mm_load_ps(&packet.invDir[0][i]);
+		__m128 l1 = _mm_mul_ps(relMin[0], inv);
+		__m128 l2 = _mm_mul_ps(relMax[0], inv);
+		__m128 lmin = _mm_min_ps(l1, l2);
+		__m128 lmax = _mm_max_ps(l1, l2);
+		for (int axis = 1; axis < 3; axis++) {
+			inv = _mm_load_ps(&packet.invDir[axis][i]);
+			l1 = _mm_mul_ps(relMin[axis], inv);
+			l2 = _mm_mul_ps(relMax[axis], inv);
+			lmin = _mm_max_ps(_mm_min_ps(l1, l2), lmin);
+			lmax = _mm_min_ps(_mm_max_ps(l1, l2), lmax);
+		}
+
+		const __m128 hit = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(lmax, _mm_setzero_ps()), _mm_cmpge_ps(lmax, lmin)),
+			_mm_cmplt_ps(lmin, _mm_load_ps(dist)));
+		if (_mm_movemask_ps(hit) & ((1 << lanes) - 1)) return true;
+	}
+	return false;
+#else
+	for (int i = 0; i < packet.numRays; i++) {
+		const vector3f invDir(packet.invDir[0][i], packet.invDir[1][i], packet.invDir[2][i]);
+		if (SlabsRayAabbTest(n, start, invDir, &isects[i])) return true;
+	}
+	return false;
+#endif
+}
+
 void GeomTree::TraceRay(const vector3f &start, const vector3f &dir, isect_t *isect) const
 {
 	PROFILE_SCOPED()
@@ -254,7 +304,7 @@ void GeomTree::TraceRay(const vector3f &start, const vector3f &dir, isect_t *ise
 void GeomTree::TraceRay(const BVHNode *currnode, const vector3f &a_origin, const vector3f &a_dir, isect_t *isect) const
 {
 	PROFILE_SCOPED()
-	BVHNode *stack[32];
+	const BVHNode *stack[BVHTree::MAX_DEPTH];
 	int stackpos = -1;
 	const vector3f invDir( // avoid division by zero please
 		is_zero_exact(a_dir.x) ? 0.0f : (1.0f / a_dir.x),
@@ -266,12 +316,55 @@ void GeomTree::TraceRay(const BVHNode *currnode, const vector3f &a_origin, const
 			if (!SlabsRayAabbTest(currnode, a_origin, invDir, isect)) goto pop_bstack;
 
 			stackpos++;
-			stack[stackpos] = currnode->kids[1];
-			currnode = currnode->kids[0];
+			stack[stackpos] = m_triTree->GetKid(currnode, 1);
+			currnode = m_triTree->GetKid(currnode, 0);
 		}
-		// triangle intersection jizz
-		for (int i = 0; i < currnode->numTris; i++) {
-			RayTriIntersect(1, a_origin, &a_dir, currnode->triIndicesStart[i], isect);
+		{
+			// triangle intersection jizz
+			const BVHTree::objPtr_t *tris = m_triTree->GetObjs(currnode);
+			for (uint32_t i = 0; i < currnode->numObjs; i++) {
+				RayTriIntersect(1, a_origin, &a_dir, tris[i], isect);
+			}
+		}
+	pop_bstack:
+		if (stackpos < 0) break;
+		currnode = stack[stackpos];
+		stackpos--;
+	}
+}
+
+void GeomTree::TraceRays(int numRays, const vector3f &origin, const vector3f *dirs, isect_t *isects) const
+{
+	PROFILE_SCOPED()
+	TraceRays(m_triTree->GetRoot(), numRays, origin, dirs, isects);
+}
+
+void GeomTree::TraceRays(const BVHNode *currnode, int numRays, const vector3f &origin, const vector3f *dirs, isect_t *isects) const
+{
+	PROFILE_SCOPED()
+	assert(numRays > 0 && numRays <= MAX_PACKET_RAYS);
+	if (numRays == 1) {
+		TraceRay(currnode, origin, dirs[0], isects);
+		return;
+	}
+
+	const RayPacket packet(numRays, dirs);
+	const BVHNode *stack[BVHTree::MAX_DEPTH];
+	int stackpos = -1;
+
+	for (;;) {
+		while (!currnode->IsLeaf()) {
+			if (!SlabsRayPacketAabbTest(currnode, origin, packet, isects)) goto pop_bstack;
+
+			stackpos++;
+			stack[stackpos] = m_triTree->GetKid(currnode, 1);
+			currnode = m_triTree->GetKid(currnode, 0);
+		}
+		{
+			const BVHTree::objPtr_t *tris = m_triTree->GetObjs(currnode);
+			for (uint32_t i = 0; i < currnode->numObjs; i++) {
+				RayTriIntersect(numRays, origin, dirs, tris[i], isects);
+			}
 		}
 	pop_bstack:
 		if (stackpos < 0) break;
@@ -294,7 +387,51 @@ void GeomTree::RayTriIntersect(int numRays, const vector3f &origin, const vector
 	const vector3f v1_cross((b - origin).Cross(a - origin));
 	const vector3f v2_cross((a - origin).Cross(c - origin));
 
-	for (int i = 0; i < numRays; i++) {
+	int i = 0;
+#ifdef GEOMTREE_USE_SSE
+	// packets are tested SIMD_WIDTH rays at a time. unused lanes get a
+	// zero direction, which can never pass the edge tests
+	if (numRays > 1) {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 nom = _mm_set1_ps(nominator);
+		for (; i < numRays; i += SIMD_WIDTH) {
+			const int lanes = std::min(SIMD_WIDTH, numRays - i);
+			alignas(16) float dx[SIMD_WIDTH] = {}, dy[SIMD_WIDTH] = {}, dz[SIMD_WIDTH] = {}, dist[SIMD_WIDTH] = {};
+			for (int k = 0; k < lanes; k++) {
+				dx[k] = dirs[i + k].x;
+				dy[k] = dirs[i + k].y;
+				dz[k] = dirs[i + k].z;
+				dist[k] = isects[i + k].dist;
+			}
+			const __m128 x = _mm_load_ps(dx);
+			const __m128 y = _mm_load_ps(dy);
+			const __m128 z = _mm_load_ps(dz);
+
+			const __m128 v0d = Dot4(v0_cross, x, y, z);
+			const __m128 v1d = Dot4(v1_cross, x, y, z);
+			const __m128 v2d = Dot4(v2_cross, x, y, z);
+			const __m128 allPos = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(v0d, zero), _mm_cmpgt_ps(v1d, zero)), _mm_cmpgt_ps(v2d, zero));
+			const __m128 allNeg = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(v0d, zero), _mm_cmplt_ps(v1d, zero)), _mm_cmplt_ps(v2d, zero));
+
+			const __m128 d = _mm_div_ps(nom, Dot4(n, x, y, z));
+			const __m128 hit = _mm_and_ps(_mm_or_ps(allPos, allNeg),
+				_mm_and_ps(_mm_cmpgt_ps(d, zero), _mm_cmplt_ps(d, _mm_load_ps(dist))));
+
+			const int mask = _mm_movemask_ps(hit);
+			if (mask) {
+				_mm_store_ps(dist, d);
+				for (int k = 0; k < lanes; k++) {
+					if (mask & (1 << k)) {
+						isects[i + k].dist = dist[k];
+						isects[i + k].triIdx = triIdx / 3;
+					}
+				}
+			}
+		}
+	}
+#endif
+
+	for (; i < numRays; i++) {
 		const float v0d = v0_cross.Dot(dirs[i]);
 		const float v1d = v1_cross.Dot(dirs[i]);
 		const float v2d = v2_cross.Dot(dirs[i]);
@@ -332,11 +469,6 @@ void GeomTree::Save(Serializer::Writer &wr) const
 	wr.Vector3d(m_aabb.min);
 	wr.Double(m_aabb.radius);
 
-	wr.Int32(m_numEdges);
-	for (int32_t iAabb = 0; iAabb < m_numEdges; ++iAabb) {
-		wr << m_aabbs[iAabb];
-	}
-
 	for (int32_t iEdge = 0; iEdge < m_numEdges; ++iEdge) {
 		auto &ed = m_edges[iEdge];
 		wr << ed.v1i << ed.v2i << ed.len << ed.dir << ed.triFlag;
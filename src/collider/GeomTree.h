@@ -25,8 +25,11 @@ struct BVHNode;
 
 class GeomTree {
 public:
+	static const int MAX_PACKET_RAYS = 8;
+
 	GeomTree(const int numVerts, const int numTris, const std::vector<vector3f> &vertices, const uint32_t *indices, const uint32_t *triflags);
-	GeomTree(Serializer::Reader &rd);
+	// buildTrees false leaves building the BVH trees to a call to BuildTrees
+	GeomTree(Serializer::Reader &rd, bool buildTrees = true);
 	void Save(Serializer::Writer &wr) const;
 
 	~GeomTree();
@@ -37,6 +40,10 @@ public:
 	// isect.triIdx should be -1 unless repeat calls with same isect_t
 	void TraceRay(const vector3f &start, const vector3f &dir, isect_t *isect) const;
 	void TraceRay(const BVHNode *startNode, const vector3f &a_origin, const vector3f &a_dir, isect_t *isect) const;
+	// trace a packet of rays sharing one origin, same rules as TraceRay
+	// for each ray. numRays must not exceed MAX_PACKET_RAYS
+	void TraceRays(int numRays, const vector3f &origin, const vector3f *dirs, isect_t *isects) const;
+	void TraceRays(const BVHNode *startNode, int numRays, const vector3f &origin, const vector3f *dirs, isect_t *isects) const;
 	vector3f GetTriNormal(int triIdx) const;
 	uint32_t GetTriFlag(int triIdx) const { return m_triFlags[triIdx]; }
 	double GetRadius() const { return m_radius; }
@@ -58,14 +65,16 @@ public:
 	}
 	int GetNumEdges() const { return m_numEdges; }
 
-	BVHTree *GetTriTree() const { return m_triTree.get(); }
-	BVHTree *GetEdgeTree() const { return m_edgeTree.get(); }
+	const BVHTree *GetTriTree() const { return m_triTree.get(); }
+	const BVHTree *GetEdgeTree() const { return m_edgeTree.get(); }
 
 	const std::vector<vector3f> &GetVertices() const { return m_vertices; }
 	const std::vector<uint32_t> &GetIndices() const { return m_indices; }
 	const std::vector<uint32_t> &GetTriFlags() const { return m_triFlags; }
 	int GetNumTris() const { return m_numTris; }
 
+	void BuildTrees();
+
 private:
 	void RayTriIntersect(int numRays, const vector3f &origin, const vector3f *dirs, int triIdx, isect_t *isects) const;
 
@@ -75,7 +84,6 @@ private:
 
 	double m_radius;
 	Aabb m_aabb;
-	std::vector<Aabb> m_aabbs;
 
 	std::unique_ptr<BVHTree> m_triTree;
 	std::unique_ptr<BVHTree> m_edgeTree;
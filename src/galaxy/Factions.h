@@ -34,6 +34,7 @@ public:
 
 	const Faction *GetFaction(const uint32_t index) const;
 	const Faction *GetFaction(const std::string &factionName) const;
+	const Faction *GetNoFaction() const { return m_no_faction.get(); }
 	const Faction *GetNearestClaimant(const Sector::System *sys) const;
 	bool IsHomeSystem(const SystemPath &sysPath) const;
 
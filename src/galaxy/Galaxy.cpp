@@ -23,6 +23,7 @@ Galaxy::Galaxy(RefCountedPtr<GalaxyGenerator> galaxyGenerator, float radius, flo
 	m_galaxyGenerator(galaxyGenerator),
 	m_sectorCache(this),
 	m_starSystemCache(this),
+	m_positionIndex(this),
 	m_factions(this, factionsDir),
 	m_customSystems(this, customSysDir)
 {
@@ -47,6 +48,7 @@ void Galaxy::ToJson(Json &jsonObj)
 void Galaxy::SetGalaxyGenerator(RefCountedPtr<GalaxyGenerator> galaxyGenerator)
 {
 	m_galaxyGenerator = galaxyGenerator;
+	m_positionIndex.Clear();
 }
 
 Galaxy::~Galaxy()
@@ -86,6 +88,7 @@ void Galaxy::FlushCaches()
 	m_sectorCache.OutputCacheStatistics();
 	m_sectorCache.ClearCache();
 	assert(m_sectorCache.IsEmpty());
+	m_positionIndex.Clear();
 }
 
 void Galaxy::Dump(FILE *file, int32_t centerX, int32_t centerY, int32_t centerZ, int32_t radius)
@@ -208,7 +211,8 @@ size_t Galaxy::FillStarSystemCache(RefCountedPtr<StarSystemCache::Slave> &ssc, c
 		path.sectorX += center.sectorX;
 		path.sectorY += center.sectorY;
 		path.sectorZ += center.sectorZ;
-		RefCountedPtr<Sector> sec(source->GetIfCached(path));
+		// the sector may have been dropped to keep the source in its budget
+		RefCountedPtr<Sector> sec(source->GetCached(path));
 
 		for (const Sector::System &ss : sec->m_systems)
 			paths.emplace_back(ss.sx, ss.sy, ss.sz, ss.idx);
@@ -232,39 +236,22 @@ size_t Galaxy::FillStarSystemCache(RefCountedPtr<StarSystemCache::Slave> &ssc, c
 
 std::vector<RefCountedPtr<StarSystem>> Galaxy::GetNearStarSystemLy(const SystemPath &center, const double range)
 {
-	std::vector<RefCountedPtr<StarSystem>> ss_vec;
-
-	const int diff_sec = int(ceil(range / Sector::SIZE));
-
-	RefCountedPtr<const Sector> here_sec = GetSector(center);
-
-	int notCached = 0;
-	std::function<bool(SystemPath&)> filter = [this, &ss_vec, &center, &here_sec, &range, &notCached](SystemPath &path) {
-		path.sectorX += center.sectorX;
-		path.sectorY += center.sectorY;
-		path.sectorZ += center.sectorZ;
-
-		RefCountedPtr<const Sector> sec = GetSector(path);
+	PROFILE_SCOPED()
+	std::vector<SectorPositionIndex::Result> near;
+	m_positionIndex.FindWithin(center, float(range), near);
 
-		for (unsigned int idx = 0; idx < sec->m_systems.size(); idx++) {
-			// Skip self
-			if (path.sectorX == center.sectorX && path.sectorY == center.sectorY
-				&& path.sectorZ == center.sectorZ && idx == center.systemIndex)
-				continue;
-
-			if (Sector::DistanceBetween(here_sec, center.systemIndex, sec, idx) > range)
-				continue;
-
-			path.systemIndex = idx;
-			#ifdef DEBUG_CACHE
-				RefCountedPtr<StarSystem> ss = m_starSystemCache.GetIfCached(path);
-				if (!ss.Valid()) notCached++;
-			#endif
-			ss_vec.emplace_back(GetStarSystem(path));
-		}
-		return false;
-	};
-	spiral_3d(diff_sec, filter);
+	std::vector<RefCountedPtr<StarSystem>> ss_vec;
+	ss_vec.reserve(near.size());
+	#ifdef DEBUG_CACHE
+		int notCached = 0;
+	#endif
+	for (const SectorPositionIndex::Result &r : near) {
+		#ifdef DEBUG_CACHE
+			RefCountedPtr<StarSystem> ss = m_starSystemCache.GetIfCached(r.path);
+			if (!ss.Valid()) notCached++;
+		#endif
+		ss_vec.emplace_back(GetStarSystem(r.path));
+	}
 	#ifdef DEBUG_CACHE
 		if (notCached != 0) Output("There were %i StarSystem not cached\n", notCached);
 	#endif // DEBUG_CACHE
@@ -8,6 +8,7 @@
 #include "Factions.h"
 #include "GalaxyCache.h"
 #include "JsonFwd.h"
+#include "SectorPositionIndex.h"
 #include "libs/RefCounted.h"
 #include <cstdio>
 
@@ -54,6 +55,7 @@ public:
 		int sectorRadius, RefCountedPtr<SectorCache::Slave> &source);
 
 	std::vector<RefCountedPtr<StarSystem>> GetNearStarSystemLy(const SystemPath &here, const double light_year);
+	SectorPositionIndex *GetPositionIndex() { return &m_positionIndex; }
 
 	void FlushCaches();
 	void Dump(FILE *file, int32_t centerX, int32_t centerY, int32_t centerZ, int32_t radius);
@@ -67,6 +69,7 @@ private:
 	RefCountedPtr<GalaxyGenerator> m_galaxyGenerator;
 	SectorCache m_sectorCache;
 	StarSystemCache m_starSystemCache;
+	SectorPositionIndex m_positionIndex;
 	FactionsDatabase m_factions;
 	CustomSystemsDatabase m_customSystems;
 };
@@ -5,6 +5,7 @@
 
 #include "Galaxy.h"
 #include "GalaxyGenerator.h"
+#include "GameConfSingleton.h"
 #include "Sector.h"
 #include "StarSystem.h"
 #include "Pi.h"
@@ -38,15 +39,31 @@ template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::AddToCache(std::vector<RefCountedPtr<T>> &objects)
 {
 	for (auto it = objects.begin(), itEnd = objects.end(); it != itEnd; ++it) {
-		auto inserted = m_attic.insert(std::make_pair(it->Get()->GetPath(), it->Get()));
-		if (!inserted.second) {
-			it->Reset(inserted.first->second);
+		auto found = m_attic.find(it->Get()->GetPath());
+		if (found != m_attic.end()) {
+			it->Reset(found->second.object);
 		} else {
+			AddToAttic(it->Get()->GetPath(), it->Get());
 			SetCache(*it, this);
 		}
 	}
 }
 
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::AddToAttic(const SystemPath &path, T *object)
+{
+	const size_t bytes = object->GetMemoryUsage();
+	m_attic.insert(std::make_pair(path, AtticEntry{ object, bytes }));
+	m_atticBytes += bytes;
+}
+
+template <typename T, typename CompareT>
+size_t GalaxyObjectCache<T, CompareT>::GetAtticBytes(const SystemPath &path) const
+{
+	auto i = m_attic.find(path);
+	return i != m_attic.end() ? i->second.bytes : 0;
+}
+
 template <typename T, typename CompareT>
 RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::GetIfCached(const SystemPath &path)
 {
@@ -55,7 +72,7 @@ RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::GetIfCached(const SystemPath &p
 	RefCountedPtr<T> s;
 	typename AtticMap::iterator i = m_attic.find(path);
 	if (i != m_attic.end()) {
-		s.Reset(i->second);
+		s.Reset(i->second.object);
 	}
 
 	return s;
@@ -70,7 +87,7 @@ RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::GetCached(const SystemPath &pat
 	if (!s) {
 		++m_cacheMisses;
 		s = m_galaxy->GetGenerator()->Generate<T, GalaxyObjectCache<T, CompareT>>(RefCountedPtr<Galaxy>(m_galaxy), path, this);
-		m_attic.insert(std::make_pair(path, s.Get()));
+		AddToAttic(path, s.Get());
 	} else {
 		++m_cacheHits;
 	}
@@ -88,7 +105,18 @@ bool GalaxyObjectCache<T, CompareT>::HasCached(const SystemPath &path) const
 template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::RemoveFromAttic(const SystemPath &path)
 {
-	m_attic.erase(path);
+	auto i = m_attic.find(path);
+	if (i != m_attic.end()) {
+		m_atticBytes -= i->second.bytes;
+		m_attic.erase(i);
+	}
+}
+
+template <typename T, typename CompareT>
+size_t GalaxyObjectCache<T, CompareT>::GetBudget() const
+{
+	const int mb = GameConfSingleton::getInstance().Int(CACHE_NAME + "Budget");
+	return mb > 0 ? size_t(mb) * 1024 * 1024 : 0;
 }
 
 template <typename T, typename CompareT>
@@ -101,9 +129,10 @@ void GalaxyObjectCache<T, CompareT>::ClearCache()
 template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::OutputCacheStatistics(bool reset)
 {
-	Output("%s: misses: %llu, slave hits: %llu, master hits: %llu\n", CACHE_NAME.c_str(), m_cacheMisses, m_cacheHitsSlave, m_cacheHits);
+	Output("%s: misses: %llu, slave hits: %llu, master hits: %llu, evictions: %llu, " SIZET_FMT " objects using " SIZET_FMT " KB\n",
+		CACHE_NAME.c_str(), m_cacheMisses.load(), m_cacheHitsSlave.load(), m_cacheHits.load(), m_cacheEvictions.load(), m_attic.size(), m_atticBytes / 1024);
 	if (reset)
-		m_cacheMisses = m_cacheHitsSlave = m_cacheHits = 0;
+		m_cacheMisses = m_cacheHitsSlave = m_cacheHits = m_cacheEvictions = 0ull;
 }
 
 template <typename T, typename CompareT>
@@ -116,6 +145,8 @@ template <typename T, typename CompareT>
 GalaxyObjectCache<T, CompareT>::Slave::Slave(GalaxyObjectCache<T, CompareT> *master, RefCountedPtr<Galaxy> galaxy, JobQueue *jobQueue) :
 	m_master(master),
 	m_galaxy(galaxy),
+	m_bytes(0),
+	m_budget(master->GetBudget()),
 	m_jobs(Pi::GetAsyncJobQueue())
 {
 	m_master->m_slaves.insert(this);
@@ -133,8 +164,10 @@ RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::Slave::GetIfCached(const System
 	PROFILE_SCOPED()
 
 	typename CacheMap::iterator i = m_cache.find(path);
-	if (i != m_cache.end())
-		return (*i).second;
+	if (i != m_cache.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+		return i->second.object;
+	}
 	return RefCountedPtr<T>();
 }
 
@@ -147,24 +180,90 @@ RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::Slave::GetCached(const SystemPa
 	if (i != m_cache.end()) {
 		if (m_master)
 			++m_master->m_cacheHitsSlave;
-		return (*i).second;
+		m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+		return i->second.object;
 	}
 
 	if (m_master) {
-		auto inserted = m_cache.insert(std::make_pair(path, m_master->GetCached(path)));
-		return inserted.first->second;
+		RefCountedPtr<T> s = Insert(path, m_master->GetCached(path));
+		Evict();
+		return s;
 	}
 	return RefCountedPtr<T>();
 }
 
 template <typename T, typename CompareT>
-void GalaxyObjectCache<T, CompareT>::Slave::Erase(const SystemPath &path) { m_cache.erase(path); }
+void GalaxyObjectCache<T, CompareT>::Slave::Erase(const SystemPath &path)
+{
+	typename CacheMap::const_iterator i = m_cache.find(path);
+	if (i != m_cache.end())
+		EraseEntry(i);
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::Erase(const typename CacheMap::const_iterator &it) { EraseEntry(it); }
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::ClearCache()
+{
+	m_cache.clear();
+	m_lru.clear();
+	m_bytes = 0;
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::SetPinned(const PathVector &paths)
+{
+	m_pinned.clear();
+	m_pinned.insert(paths.begin(), paths.end());
+}
+
+// adds the object if it isn't there yet and makes it the most recently used,
+// without looking at the budget
+template <typename T, typename CompareT>
+const RefCountedPtr<T> &GalaxyObjectCache<T, CompareT>::Slave::Insert(const SystemPath &path, const RefCountedPtr<T> &object)
+{
+	typename CacheMap::iterator i = m_cache.find(path);
+	if (i != m_cache.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+		return i->second.object;
+	}
+	m_lru.push_front(path);
+	const size_t bytes = m_master->GetAtticBytes(path);
+	m_bytes += bytes;
+	return m_cache.insert(std::make_pair(path, CacheEntry{ object, bytes, m_lru.begin() })).first->second.object;
+}
 
 template <typename T, typename CompareT>
-void GalaxyObjectCache<T, CompareT>::Slave::Erase(const typename CacheMap::const_iterator &it) { m_cache.erase(it); }
+typename GalaxyObjectCache<T, CompareT>::CacheMap::iterator GalaxyObjectCache<T, CompareT>::Slave::EraseEntry(typename CacheMap::const_iterator it)
+{
+	m_bytes -= it->second.bytes;
+	m_lru.erase(it->second.lru);
+	return m_cache.erase(it);
+}
 
+// drops the least recently used objects that aren't pinned until the slave
+// is within its budget again
 template <typename T, typename CompareT>
-void GalaxyObjectCache<T, CompareT>::Slave::ClearCache() { m_cache.clear(); }
+void GalaxyObjectCache<T, CompareT>::Slave::Evict()
+{
+	if (!m_budget || m_bytes <= m_budget)
+		return;
+
+	PROFILE_SCOPED()
+	auto it = m_lru.end();
+	while (m_bytes > m_budget && it != m_lru.begin()) {
+		--it;
+		if (m_pinned.count(*it))
+			continue;
+		// the path is in the list node that goes away with the entry
+		const SystemPath path = *it;
+		++it;
+		EraseEntry(m_cache.find(path));
+		if (m_master)
+			++m_master->m_cacheEvictions;
+	}
+}
 
 template <typename T, typename CompareT>
 GalaxyObjectCache<T, CompareT>::Slave::~Slave()
@@ -172,7 +271,7 @@ GalaxyObjectCache<T, CompareT>::Slave::~Slave()
 #ifdef DEBUG_CACHE
 	unsigned unique = 0;
 	for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
-		if (it->second->GetRefCount() == 1)
+		if (it->second.object->GetRefCount() == 1)
 			unique++;
 	Output("%s: Discarding slave cache with " SIZET_FMT " entries (%u to be removed)\n", CACHE_NAME.c_str(), m_cache.size(), unique);
 #endif
@@ -185,9 +284,9 @@ void GalaxyObjectCache<T, CompareT>::Slave::AddToCache(std::vector<RefCountedPtr
 {
 	if (m_master) {
 		m_master->AddToCache(objects); // This modifies the vector to the sectors already in the master cache
-		for (auto it = objects.begin(), itEnd = objects.end(); it != itEnd; ++it) {
-			m_cache.insert(std::make_pair(it->Get()->GetPath(), *it));
-		}
+		for (auto it = objects.begin(), itEnd = objects.end(); it != itEnd; ++it)
+			Insert(it->Get()->GetPath(), *it);
+		Evict();
 	}
 }
 
@@ -197,8 +296,8 @@ GalaxyObjectCache<Sector, SystemPath::LessSectorOnly>::PathVector GalaxyObjectCa
 	PathVector result;
 	result.reserve(5); // reserve at least some...
 	for (auto i = Begin(); i != End(); ++i) {
-		for (unsigned int systemIndex = 0; systemIndex < (*i).second->m_systems.size(); systemIndex++) {
-			const Sector::System *ss = &((*i).second->m_systems[systemIndex]);
+		for (unsigned int systemIndex = 0; systemIndex < (*i).second.object->m_systems.size(); systemIndex++) {
+			const Sector::System *ss = &((*i).second.object->m_systems[systemIndex]);
 
 			// compare with the start of the current system
 			if (strncasecmp(pattern.c_str(), ss->GetName().c_str(), pattern.size()) == 0
@@ -234,19 +333,15 @@ size_t GalaxyObjectCache<T, CompareT>::Slave::ShrinkCache(const SystemPath &cent
 	const int zmin = center.sectorZ - radius;
 	const int zmax = center.sectorZ + radius;
 
-	auto iter = Begin();
-	while (iter != End()) {
-		RefCountedPtr<T> s = iter->second;
+	auto iter = m_cache.begin();
+	while (iter != m_cache.end()) {
+		const RefCountedPtr<T> &s = iter->second.object;
 		//check_point_in_box
-		if (!s->WithinBox(xmin, xmax, ymin, ymax, zmin, zmax)) {
-			if (!dontDrop.IsSameSector(s->GetPath())) {
-				Erase(iter++);
-				removed++;
-			} else {
-				iter++;
-			}
+		if (!s->WithinBox(xmin, xmax, ymin, ymax, zmin, zmax) && !dontDrop.IsSameSector(s->GetPath()) && !IsPinned(iter->first)) {
+			iter = EraseEntry(iter);
+			removed++;
 		} else {
-			iter++;
+			++iter;
 		}
 	}
 #ifdef DEBUG_CACHE
@@ -273,7 +368,7 @@ void GalaxyObjectCache<T, CompareT>::Slave::FillCache(const typename GalaxyObjec
 	for (auto it = paths.begin(), itEnd = paths.end(); it != itEnd; ++it) {
 		RefCountedPtr<T> s = m_master->GetIfCached(*it);
 		if (s) {
-			m_cache[*it] = s;
+			Insert(*it, s);
 #ifdef DEBUG_CACHE
 			++masterCached;
 #endif
@@ -293,10 +388,12 @@ void GalaxyObjectCache<T, CompareT>::Slave::FillCache(const typename GalaxyObjec
 	}
 
 	// catch the last loop in case it's got some entries (could be less than the spread width)
-	if (!current_paths->empty()) {
+	if (current_paths && !current_paths->empty()) {
 		vec_paths.push_back(std::move(current_paths));
 	}
 
+	Evict();
+
 #ifdef DEBUG_CACHE
 	Output("%s: FillCache: " SIZET_FMT " cached, %u in master cache, %u to be created, will use " SIZET_FMT " jobs\n", CACHE_NAME.c_str(),
 		alreadyCached, masterCached, toBeCreated, vec_paths.size());
@@ -356,6 +453,8 @@ template <>
 GalaxyObjectCache<StarSystem, SystemPath::LessSystemOnly>::Slave::Slave(GalaxyObjectCache<StarSystem, SystemPath::LessSystemOnly> *master, RefCountedPtr<Galaxy> galaxy, JobQueue *jobQueue) :
 	m_master(master),
 	m_galaxy(galaxy),
+	m_bytes(0),
+	m_budget(master->GetBudget()),
 	m_jobs(Pi::GetSyncJobQueue())
 {
 	m_master->m_slaves.insert(this);
@@ -7,15 +7,35 @@
 #include "JobQueue.h"
 #include "libs/RefCounted.h"
 #include "galaxy/SystemPath.h"
+#include <atomic>
 #include <functional>
-#include <map>
+#include <list>
 #include <memory>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class GalaxyGenerator;
 class Galaxy;
 
+// the hash and equality for the hashed containers of a cache, matching the
+// parts of the path its ordering looks at
+template <typename CompareT>
+struct GalaxyCacheKey;
+
+template <>
+struct GalaxyCacheKey<SystemPath::LessSectorOnly> {
+	typedef SystemPath::HashSectorOnly Hash;
+	typedef SystemPath::EqualSectorOnly Equal;
+};
+
+template <>
+struct GalaxyCacheKey<SystemPath::LessSystemOnly> {
+	typedef SystemPath::HashSystemOnly Hash;
+	typedef SystemPath::EqualSystemOnly Equal;
+};
+
 template <typename T, typename CompareT>
 class GalaxyObjectCache {
 	friend T;
@@ -25,9 +45,11 @@ public:
 
 	GalaxyObjectCache(Galaxy *galaxy) :
 		m_galaxy(galaxy),
+		m_atticBytes(0),
 		m_cacheHits(0),
 		m_cacheHitsSlave(0),
-		m_cacheMisses(0) {}
+		m_cacheMisses(0),
+		m_cacheEvictions(0) {}
 	~GalaxyObjectCache();
 
 	RefCountedPtr<T> GetCached(const SystemPath &path);
@@ -39,10 +61,25 @@ public:
 	void OutputCacheStatistics(bool reset = true);
 
 	typedef std::vector<SystemPath> PathVector;
-	typedef std::map<SystemPath, RefCountedPtr<T>, CompareT> CacheMap;
-	typedef std::map<SystemPath, T *, CompareT> AtticMap;
+	typedef typename GalaxyCacheKey<CompareT>::Hash HashT;
+	typedef typename GalaxyCacheKey<CompareT>::Equal EqualT;
+	typedef std::list<SystemPath> LruList;
+	struct CacheEntry {
+		RefCountedPtr<T> object;
+		size_t bytes;
+		typename LruList::iterator lru;
+	};
+	typedef std::unordered_map<SystemPath, CacheEntry, HashT, EqualT> CacheMap;
+	struct AtticEntry {
+		T *object;
+		size_t bytes; // as given by T::GetMemoryUsage() when it was added
+	};
+	typedef std::unordered_map<SystemPath, AtticEntry, HashT, EqualT> AtticMap;
 	typedef std::function<void()> CacheFilledCallback;
 
+	// Slaves hold on to the objects. Each one keeps what it holds under the
+	// memory budget of the object type ("<CACHE_NAME>Budget" in the config,
+	// in MB) by dropping the least recently used objects, except the pinned ones.
 	class Slave : public RefCounted {
 		friend class GalaxyObjectCache<T, CompareT>;
 
@@ -53,26 +90,41 @@ public:
 		typename CacheMap::const_iterator End() const { return m_cache.end(); }
 
 		void FillCache(const PathVector &paths, CacheFilledCallback callback = CacheFilledCallback());
+		// adds objects made with GalaxyGenerator::Generate without a cache
+		// (e.g. on other threads). objects already in the master cache are
+		// replaced by those in the vector
+		void AddToCache(std::vector<RefCountedPtr<T>> &objects);
 		void Erase(const SystemPath &path);
 		void Erase(const typename CacheMap::const_iterator &it);
 		void ClearCache();
 
+		// pinned paths are never dropped, neither by the budget nor by
+		// ShrinkCache. replaces the previous set
+		void SetPinned(const PathVector &paths);
+		bool IsPinned(const SystemPath &path) const { return m_pinned.count(path) != 0; }
+
 		// TODO: Not templated: Only for Sector because it's searching through Systems)
 		PathVector SearchPattern(std::string pattern);
-		// TODO: Change 'dontDrop' in a vector
 		size_t ShrinkCache(const SystemPath &center, int sectorRadius, const SystemPath &dontDrop);
 		bool IsEmpty() { return m_cache.empty(); }
+		size_t GetMemoryUsage() const { return m_bytes; }
 		~Slave();
 
 	private:
 		GalaxyObjectCache *m_master;
 		RefCountedPtr<Galaxy> m_galaxy;
 		CacheMap m_cache;
+		LruList m_lru; // most recently used at the front
+		std::unordered_set<SystemPath, HashT, EqualT> m_pinned;
+		size_t m_bytes;
+		size_t m_budget; // 0 for no limit
 		JobSet m_jobs;
 
 		Slave(GalaxyObjectCache *master, RefCountedPtr<Galaxy> galaxy, JobQueue *jobQueue);
 		void MasterDeleted();
-		void AddToCache(std::vector<RefCountedPtr<T>> &objects);
+		const RefCountedPtr<T> &Insert(const SystemPath &path, const RefCountedPtr<T> &object);
+		typename CacheMap::iterator EraseEntry(typename CacheMap::const_iterator it);
+		void Evict();
 	};
 
 	RefCountedPtr<Slave> NewSlaveCache();
@@ -81,8 +133,11 @@ private:
 	static const unsigned CACHE_JOB_SIZE = 100;
 
 	void AddToCache(std::vector<RefCountedPtr<T>> &objects);
+	void AddToAttic(const SystemPath &path, T *object);
+	size_t GetAtticBytes(const SystemPath &path) const;
 	bool HasCached(const SystemPath &path) const;
 	void RemoveFromAttic(const SystemPath &path);
+	size_t GetBudget() const;
 
 	// ********************************************************************************
 	// Overloaded Job class to handle generating a collection of sectors
@@ -109,10 +164,14 @@ private:
 	AtticMap m_attic; // Those contains non-refcounted pointers which are kept alive by RefCountedPtrs in slave caches
 		// or elsewhere. The Sector destructor ensures that it is removed from here.
 		// This ensures, that there is only ever one object for each Sector.
-
-	unsigned long long m_cacheHits;
-	unsigned long long m_cacheHitsSlave;
-	unsigned long long m_cacheMisses;
+	size_t m_atticBytes;
+
+	// atomic for GetCached from jobs, which is safe only as long as nothing
+	// is added to or removed from the attic while they run
+	std::atomic<unsigned long long> m_cacheHits;
+	std::atomic<unsigned long long> m_cacheHitsSlave;
+	std::atomic<unsigned long long> m_cacheMisses;
+	std::atomic<unsigned long long> m_cacheEvictions;
 };
 
 class Sector;
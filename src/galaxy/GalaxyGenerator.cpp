@@ -7,10 +7,15 @@
 #include "Galaxy.h"
 #include "GameSaveError.h"
 #include "Json.h"
+#include "Pi.h"
+#include "SectorDiskCache.h"
 #include "SectorGenerator.h"
 #include "StarSystemGenerator.h"
 #include "libs/utils.h"
 
+// compare every system loaded from the disk cache with a freshly generated one
+//#define DEBUG_SECTOR_DISK_CACHE
+
 static const GalaxyGenerator::Version LAST_VERSION_LEGACY = 1;
 
 std::string GalaxyGenerator::s_defaultGenerator = "legacy";
@@ -29,6 +34,8 @@ void GalaxyGenerator::Init(const std::string &name, Version version)
 void GalaxyGenerator::Uninit()
 {
 	s_galaxy->FlushCaches();
+	if (s_galaxy->GetGenerator()->m_sectorDiskCache)
+		s_galaxy->GetGenerator()->m_sectorDiskCache->Write();
 	s_galaxy.Reset();
 }
 
@@ -65,12 +72,16 @@ RefCountedPtr<Galaxy> GalaxyGenerator::Create(const std::string &name, Version v
 	if (galgen) {
 		if (s_galaxy && galgen->m_name == s_galaxy->GetGeneratorName() && galgen->m_version == s_galaxy->GetGeneratorVersion()) {
 			Output("Clearing and re-using previous Galaxy object\n");
+			// same generator, so the same cache file
+			galgen->m_sectorDiskCache = std::move(s_galaxy->GetGenerator()->m_sectorDiskCache);
 			s_galaxy->SetGalaxyGenerator(galgen);
 			s_galaxy->FlushCaches();
 			return s_galaxy;
 		}
 
 		assert(name == "legacy"); // Once whe have have more, this will become an if switch
+		if (SectorDiskCache::IsEnabled())
+			galgen->m_sectorDiskCache.reset(new SectorDiskCache(name, version, { "galaxy_dense.bmp", "factions", "systems", "libs/NameGen.lua" }));
 		// NB : The galaxy density image MUST be in BMP format due to OSX failing to load pngs the same as Linux/Windows
 		s_galaxy = RefCountedPtr<Galaxy>(new DensityMapGalaxy(galgen, "galaxy_dense.bmp", 50000.0, 25000.0, 0.0, "factions", "systems"));
 		s_galaxy->Init();
@@ -151,6 +162,12 @@ void GalaxyGenerator::FromJson(const Json &jsonObj, RefCountedPtr<Galaxy> galaxy
 	}
 }
 
+GalaxyGenerator::GalaxyGenerator(const std::string &name, Version version) :
+	m_name(name),
+	m_version(version)
+{
+}
+
 GalaxyGenerator::~GalaxyGenerator()
 {
 	for (SectorGeneratorStage *secgen : m_sectorStage)
@@ -179,26 +196,87 @@ RefCountedPtr<Sector> GalaxyGenerator::GenerateSector(RefCountedPtr<Galaxy> gala
 	Random rng(_init, 4);
 	SectorConfig config;
 	RefCountedPtr<Sector> sector(new Sector(galaxy, path, cache));
-	for (SectorGeneratorStage *secgen : m_sectorStage)
-		if (!secgen->Apply(rng, galaxy, sector, &config))
-			break;
+
+	// the deterministic stages come first, and what they make may have been
+	// kept from an earlier session. not while the galaxy is being set up, the
+	// factions aren't complete yet
+	auto stage = m_sectorStage.begin();
+	const bool useDiskCache = m_sectorDiskCache && galaxy->IsInitialized();
+	bool finished = true;
+	if (useDiskCache && m_sectorDiskCache->Load(galaxy, sector.Get(), finished)) {
+		while (stage != m_sectorStage.end() && (*stage)->IsDeterministic())
+			++stage;
+	} else {
+		for (; finished && stage != m_sectorStage.end() && (*stage)->IsDeterministic(); ++stage)
+			finished = (*stage)->Apply(rng, galaxy, sector, &config);
+		if (useDiskCache)
+			m_sectorDiskCache->Store(sector.Get(), finished);
+	}
+
+	for (; finished && stage != m_sectorStage.end(); ++stage)
+		finished = (*stage)->Apply(rng, galaxy, sector, &config);
 	return sector;
 }
 
+#ifdef DEBUG_SECTOR_DISK_CACHE
+static std::string DumpSystem(const StarSystem *system)
+{
+	std::string out;
+	if (FILE *f = tmpfile()) {
+		system->Dump(f);
+		rewind(f);
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			out.append(buf, n);
+		fclose(f);
+	}
+	return out;
+}
+#endif // DEBUG_SECTOR_DISK_CACHE
+
 RefCountedPtr<StarSystem> GalaxyGenerator::GenerateStarSystem(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, StarSystemCache *cache)
 {
 	RefCountedPtr<const Sector> sec = galaxy->GetSector(path);
 	assert(path.systemIndex < sec->m_systems.size());
 	const Sector::System &sys = sec->m_systems[path.systemIndex];
+
+	// as for sectors, but not without Lua (the galaxy exporter), which
+	// names the populated bodies
+	const bool useDiskCache = m_sectorDiskCache && galaxy->IsInitialized() && Pi::m_luaNameGen;
+#ifdef DEBUG_SECTOR_DISK_CACHE
+	RefCountedPtr<StarSystem> cached;
+	if (useDiskCache)
+		cached = m_sectorDiskCache->LoadSystem(galaxy, path, nullptr);
+#else
+	if (useDiskCache) {
+		RefCountedPtr<StarSystem> system = m_sectorDiskCache->LoadSystem(galaxy, path, cache);
+		if (system)
+			return system;
+	}
+#endif
+
 	uint32_t seed = sys.GetSeed();
 	uint32_t _init[6] = { path.systemIndex, uint32_t(path.sectorX), uint32_t(path.sectorY), uint32_t(path.sectorZ), UNIVERSE_SEED, uint32_t(seed) };
 	Random rng(_init, 6);
 	StarSystemConfig config;
 	RefCountedPtr<StarSystem> system(new StarSystem(path, galaxy, cache));
+	bool finished = true;
 	for (StarSystemGeneratorStage *sysgen : m_starSystemStage) {
 		if (!sysgen->Apply(rng, galaxy, system, &config)) {
+			finished = false;
 			break;
 		}
 	}
+#ifdef DEBUG_SECTOR_DISK_CACHE
+	if (cached) {
+		if (finished && DumpSystem(cached.Get()) != DumpSystem(system.Get()))
+			Output("SectorDiskCache: system %d,%d,%d,%u differs from the generated one\n",
+				path.sectorX, path.sectorY, path.sectorZ, path.systemIndex);
+		return system;
+	}
+#endif
+	if (useDiskCache && finished)
+		m_sectorDiskCache->StoreSystem(system.Get());
 	return system;
 }
@@ -10,8 +10,10 @@
 #include "SystemPath.h"
 #include "libs/RefCounted.h"
 #include <list>
+#include <memory>
 #include <string>
 
+class SectorDiskCache;
 class SectorGeneratorStage;
 class StarSystemGeneratorStage;
 
@@ -63,9 +65,7 @@ public:
 	};
 
 private:
-	explicit GalaxyGenerator(const std::string &name, Version version = LAST_VERSION) :
-		m_name(name),
-		m_version(version) {}
+	explicit GalaxyGenerator(const std::string &name, Version version = LAST_VERSION);
 
 	virtual RefCountedPtr<Sector> GenerateSector(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, SectorCache *cache);
 	virtual RefCountedPtr<StarSystem> GenerateStarSystem(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, StarSystemCache *cache);
@@ -76,6 +76,8 @@ private:
 	std::list<SectorGeneratorStage *> m_sectorStage;
 	std::list<StarSystemGeneratorStage *> m_starSystemStage;
 
+	std::unique_ptr<SectorDiskCache> m_sectorDiskCache;
+
 	static RefCountedPtr<Galaxy> s_galaxy;
 	static std::string s_defaultGenerator;
 	static Version s_defaultVersion;
@@ -115,6 +117,11 @@ public:
 	virtual ~SectorGeneratorStage() {}
 
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config) = 0;
+
+	// false for stages that apply state which changes between sessions (like
+	// what has been explored). the deterministic stages have to come first,
+	// their output may come from the SectorDiskCache instead
+	virtual bool IsDeterministic() const { return true; }
 };
 
 class StarSystemGeneratorStage : public GalaxyGeneratorStage {
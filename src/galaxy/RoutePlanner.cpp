@@ -0,0 +1,215 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "RoutePlanner.h"
+
+#include "libs/utils.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+	// how often (in nodes) the search reports progress and looks for a cancel
+	const uint32_t PROGRESS_INTERVAL = 64;
+
+	struct Edge {
+		uint32_t to;
+		float duration;
+	};
+
+	// the systems that can be reached from each system in one jump, with
+	// the edges of system i at edges[offsets[i]] up to edges[offsets[i + 1]]
+	struct JumpGraph {
+		std::vector<uint32_t> offsets;
+		std::vector<Edge> edges;
+		// the lowest duration per light year of any jump, for the heuristic
+		float minRate;
+	};
+
+	// false if cancelled
+	bool BuildJumpGraph(const std::vector<RoutePlanner::System> &systems, const RoutePlanner::DurationCurve &curve, RoutePlanner::Status *status, JumpGraph &graph)
+	{
+		PROFILE_SCOPED()
+		const uint32_t numSystems = uint32_t(systems.size());
+		const float maxRange = curve.GetMaxRange();
+		const float maxRangeSqr = maxRange * maxRange;
+		const float cellScale = 1.0f / maxRange;
+
+		// cells are as wide as the longest jump, so everything in range of a
+		// system is in its own cell or one of the 26 around it. they are
+		// keyed as sectors are
+		std::vector<int32_t> cells(numSystems * 3);
+		std::unordered_map<uint64_t, std::vector<uint32_t>> grid;
+		for (uint32_t i = 0; i < numSystems; i++) {
+			const vector3f &p = systems[i].pos;
+			int32_t *c = &cells[i * 3];
+			c[0] = int32_t(std::floor(p.x * cellScale));
+			c[1] = int32_t(std::floor(p.y * cellScale));
+			c[2] = int32_t(std::floor(p.z * cellScale));
+			grid[SystemPath::PackSector(c[0], c[1], c[2])].push_back(i);
+		}
+
+		graph.offsets.resize(numSystems + 1);
+		graph.edges.clear();
+		graph.minRate = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < numSystems; i++) {
+			if (i % PROGRESS_INTERVAL == 0) {
+				if (status->cancelled) return false;
+				status->progress = 0.5f * float(i) / float(numSystems);
+			}
+
+			graph.offsets[i] = uint32_t(graph.edges.size());
+			const vector3f &p = systems[i].pos;
+			const int32_t *c = &cells[i * 3];
+			for (int32_t dx = -1; dx <= 1; dx++) {
+				for (int32_t dy = -1; dy <= 1; dy++) {
+					for (int32_t dz = -1; dz <= 1; dz++) {
+						const auto cell = grid.find(SystemPath::PackSector(c[0] + dx, c[1] + dy, c[2] + dz));
+						if (cell == grid.end()) continue;
+						for (uint32_t j : cell->second) {
+							if (j == i) continue;
+							const float distSqr = (systems[j].pos - p).LengthSqr();
+							if (distSqr > maxRangeSqr) continue;
+							const float dist = std::sqrt(distSqr);
+							const float duration = curve.GetDuration(dist);
+							graph.edges.push_back({ j, duration });
+							if (dist > 0.0f)
+								graph.minRate = std::min(graph.minRate, duration / dist);
+						}
+					}
+				}
+			}
+		}
+		graph.offsets[numSystems] = uint32_t(graph.edges.size());
+		if (graph.minRate == std::numeric_limits<float>::max())
+			graph.minRate = 0.0f;
+		return true;
+	}
+
+	struct OpenNode {
+		float estimate; // duration so far plus the heuristic
+		uint32_t system;
+		bool operator>(const OpenNode &o) const { return estimate > o.estimate; }
+	};
+} // namespace
+
+namespace RoutePlanner {
+
+	DurationCurve::DurationCurve(float maxRange, const std::function<float(float)> &duration) :
+		m_maxRange(maxRange),
+		m_scale(maxRange > 0.0f ? float(NUM_SAMPLES - 1) / maxRange : 0.0f)
+	{
+		m_samples.resize(NUM_SAMPLES);
+		for (int i = 0; i < NUM_SAMPLES; i++)
+			m_samples[i] = duration(maxRange * float(i) / float(NUM_SAMPLES - 1));
+	}
+
+	float DurationCurve::GetDuration(float dist) const
+	{
+		if (m_samples.empty()) return 0.0f;
+		const float x = Clamp(dist * m_scale, 0.0f, float(NUM_SAMPLES - 1));
+		const int i = std::min(int(x), NUM_SAMPLES - 2);
+		const float t = x - float(i);
+		return m_samples[i] + t * (m_samples[i + 1] - m_samples[i]);
+	}
+
+	std::vector<SystemPath> FindRoute(const std::vector<System> &systems, size_t target, const DurationCurve &curve, Status *status)
+	{
+		PROFILE_SCOPED()
+		std::vector<SystemPath> route;
+		if (target == 0 || target >= systems.size() || curve.GetMaxRange() <= 0.0f)
+			return route;
+
+		JumpGraph graph;
+		if (!BuildJumpGraph(systems, curve, status, graph))
+			return route;
+
+		// A*. every jump takes at least minRate per light year and the jumps
+		// add up to at least the straight line, so the heuristic (the straight
+		// line at that rate) never overestimates and the route is the quickest
+		const uint32_t numSystems = uint32_t(systems.size());
+		const vector3f &targetPos = systems[target].pos;
+		const float minRate = graph.minRate;
+
+		std::vector<float> duration(numSystems, std::numeric_limits<float>::max());
+		std::vector<uint32_t> prev(numSystems, 0);
+		std::vector<bool> closed(numSystems, false);
+		std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+
+		duration[0] = 0.0f;
+		open.push({ minRate * (targetPos - systems[0].pos).Length(), 0 });
+		uint32_t numClosed = 0;
+		bool found = false;
+		while (!open.empty()) {
+			const uint32_t u = open.top().system;
+			open.pop();
+			// stale entry for a system that got a shorter duration later
+			if (closed[u]) continue;
+			closed[u] = true;
+
+			if (u == target) {
+				found = true;
+				break;
+			}
+
+			if (++numClosed % PROGRESS_INTERVAL == 0) {
+				if (status->cancelled) return route;
+				status->progress = 0.5f + 0.5f * float(numClosed) / float(numSystems);
+			}
+
+			for (uint32_t e = graph.offsets[u], end = graph.offsets[u + 1]; e < end; e++) {
+				const Edge &edge = graph.edges[e];
+				if (closed[edge.to]) continue;
+				const float d = duration[u] + edge.duration;
+				if (d < duration[edge.to]) {
+					duration[edge.to] = d;
+					prev[edge.to] = u;
+					open.push({ d + minRate * (targetPos - systems[edge.to].pos).Length(), edge.to });
+				}
+			}
+		}
+
+		if (found) {
+			for (size_t u = target; u != 0; u = prev[u])
+				route.push_back(systems[u].path);
+			std::reverse(route.begin(), route.end());
+		}
+		status->progress = 1.0f;
+		return route;
+	}
+
+	RouteJob::RouteJob(std::vector<System> &&systems, size_t target, const DurationCurve &curve, std::shared_ptr<Status> status, FinishedCallback callback) :
+		m_systems(std::move(systems)),
+		m_target(target),
+		m_curve(curve),
+		m_status(status),
+		m_callback(callback)
+	{
+	}
+
+	void RouteJob::OnRun()
+	{
+		PROFILE_SCOPED()
+		Profiler::Timer timer;
+		timer.Start();
+		m_route = FindRoute(m_systems, m_target, m_curve, m_status.get());
+		timer.Stop();
+		Output("RoutePlanner: " SIZET_FMT " systems searched, " SIZET_FMT " jumps, %.2f ms\n", m_systems.size(), m_route.size(), timer.millicycles());
+	}
+
+	void RouteJob::OnFinish()
+	{
+		if (m_callback)
+			m_callback(m_route);
+	}
+
+	void RouteJob::OnCancel()
+	{
+		m_status->cancelled = true;
+	}
+
+} // namespace RoutePlanner
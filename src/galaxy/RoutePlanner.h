@@ -0,0 +1,87 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _ROUTEPLANNER_H
+#define _ROUTEPLANNER_H
+
+#include "JobQueue.h"
+#include "galaxy/SystemPath.h"
+#include "libs/vector3.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Finds the quickest chain of hyperjumps between two systems. Everything the
+// search needs (the candidate systems and the drive's jump durations) is
+// gathered on the main thread beforehand, so the search itself can run on a
+// worker without touching Lua or the galaxy caches.
+namespace RoutePlanner {
+
+	// how long a jump takes against its length, sampled from the hyperdrive
+	// once and interpolated, instead of asking Lua for every candidate jump
+	class DurationCurve {
+	public:
+		DurationCurve() :
+			m_maxRange(0.0f),
+			m_scale(0.0f) {}
+		DurationCurve(float maxRange, const std::function<float(float)> &duration);
+
+		float GetMaxRange() const { return m_maxRange; }
+		// dist should be within [0, GetMaxRange()]
+		float GetDuration(float dist) const;
+
+	private:
+		static const int NUM_SAMPLES = 64;
+
+		float m_maxRange;
+		float m_scale; // samples per light year
+		std::vector<float> m_samples;
+	};
+
+	struct System {
+		SystemPath path;
+		// in light years, relative to the start of the route so that
+		// distances don't lose precision far from the core
+		vector3f pos;
+	};
+
+	// shared between a running search and whoever is waiting for it
+	struct Status {
+		Status() :
+			progress(0.0f),
+			cancelled(false) {}
+		std::atomic<float> progress; // 0..1
+		std::atomic<bool> cancelled;
+	};
+
+	// systems[0] is the start. returns the systems to jump to in order (the
+	// start not included), or nothing if the target can't be reached or the
+	// search was cancelled
+	std::vector<SystemPath> FindRoute(const std::vector<System> &systems, size_t target, const DurationCurve &curve, Status *status);
+
+	// runs FindRoute on a job queue and hands the route to the callback on
+	// the main thread. the callback isn't called if the job is cancelled
+	class RouteJob : public Job {
+	public:
+		typedef std::function<void(const std::vector<SystemPath> &route)> FinishedCallback;
+
+		RouteJob(std::vector<System> &&systems, size_t target, const DurationCurve &curve, std::shared_ptr<Status> status, FinishedCallback callback);
+
+		virtual void OnRun() override; // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+		virtual void OnFinish() override;
+		virtual void OnCancel() override;
+
+	private:
+		std::vector<System> m_systems;
+		size_t m_target;
+		DurationCurve m_curve;
+		std::shared_ptr<Status> m_status;
+		FinishedCallback m_callback;
+		std::vector<SystemPath> m_route;
+	};
+
+} // namespace RoutePlanner
+
+#endif /* _ROUTEPLANNER_H */
@@ -50,6 +50,18 @@ bool Sector::WithinBox(const int Xmin, const int Xmax, const int Ymin, const int
 	return false;
 }
 
+size_t Sector::GetMemoryUsage() const
+{
+	size_t bytes = sizeof(Sector) + m_systems.capacity() * sizeof(System);
+	for (const System &sys : m_systems) {
+		bytes += sys.m_name.capacity();
+		bytes += sys.m_other_names.capacity() * sizeof(std::string);
+		for (const std::string &name : sys.m_other_names)
+			bytes += name.capacity();
+	}
+	return bytes;
+}
+
 /*	answer whether the system path is in this sector
 */
 bool Sector::Contains(const SystemPath &sysPath) const
@@ -39,6 +39,8 @@ public:
 	// Sector is within a bounding rectangle - used for SectorView m_sectorCache pruning.
 	bool WithinBox(const int Xmin, const int Xmax, const int Ymin, const int Ymax, const int Zmin, const int Zmax) const;
 	bool Contains(const SystemPath &sysPath) const;
+	// roughly, in bytes, for the cache budget
+	size_t GetMemoryUsage() const;
 
 	// get the SystemPath for this sector
 	SystemPath GetPath() const { return SystemPath(sx, sy, sz); }
@@ -48,6 +50,7 @@ public:
 		friend class SectorCustomSystemsGenerator;
 		friend class SectorRandomSystemsGenerator;
 		friend class SectorPersistenceGenerator;
+		friend class SectorDiskCache;
 
 	public:
 		System(Sector *sector, int x, int y, int z, uint32_t si) :
@@ -0,0 +1,591 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SectorDiskCache.h"
+
+#include "CustomSystem.h"
+#include "Faction.h"
+#include "Factions.h"
+#include "Galaxy.h"
+#include "GameConfSingleton.h"
+#include "GameConfig.h"
+#include "LZ4Format.h"
+#include "Sector.h"
+#include "StarSystem.h"
+#include "StarSystemWriter.h"
+#include "jenkins/lookup3.h"
+#include "libs/utils.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+	const char CACHE_DIR[] = "sectors";
+
+	const uint32_t MAGIC = 0x43455347; // "GSEC"
+	// bump when the layout of the file, of a sector or of a system changes
+	const uint32_t VERSION = 2;
+
+	// what was generated this session is always kept, older entries only
+	// as long as the file stays under this
+	const uint64_t MAX_FILE_SIZE = uint64_t(64) << 20;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t fingerprint;
+		uint32_t numEntries;
+		uint32_t pad[3];
+	};
+
+	enum SystemFlags {
+		SYSTEM_CUSTOM = 1 << 0,
+		SYSTEM_CUSTOM_BODIES = 1 << 1
+	};
+
+	const uint32_t NO_BODY = ~0u;
+
+	// these are kept as they are in memory
+	static_assert(std::is_trivially_copyable<Orbit>::value, "Orbit has to be trivially copyable");
+	static_assert(std::is_trivially_copyable<Color>::value, "Color has to be trivially copyable");
+
+	class Writer {
+	public:
+		template <typename T>
+		void Put(const T &v) { m_data.append(reinterpret_cast<const char *>(&v), sizeof(T)); }
+		void PutString(const std::string &s)
+		{
+			Put(uint32_t(s.size()));
+			m_data.append(s);
+		}
+		const std::string &GetData() const { return m_data; }
+
+	private:
+		std::string m_data;
+	};
+
+	class Reader {
+	public:
+		Reader(const std::string &data) :
+			m_pos(data.data()),
+			m_end(data.data() + data.size()) {}
+		template <typename T>
+		T Get()
+		{
+			T v;
+			Need(sizeof(T));
+			memcpy(&v, m_pos, sizeof(T));
+			m_pos += sizeof(T);
+			return v;
+		}
+		std::string GetString()
+		{
+			const uint32_t len = Get<uint32_t>();
+			Need(len);
+			std::string s(m_pos, len);
+			m_pos += len;
+			return s;
+		}
+		fixed GetFixed() { return fixed(Get<int64_t>()); }
+		bool AtEnd() const { return m_pos == m_end; }
+		size_t GetRemaining() const { return size_t(m_end - m_pos); }
+
+	private:
+		void Need(size_t n)
+		{
+			if (size_t(m_end - m_pos) < n) throw std::out_of_range("SectorDiskCache: truncated sector");
+		}
+
+		const char *m_pos;
+		const char *m_end;
+	};
+
+	// hash of everything under the given paths in the game data (mods included)
+	void HashDataPath(const std::string &path, uint32_t &c, uint32_t &b)
+	{
+		std::vector<std::string> files;
+		const FileSystem::FileInfo info = FileSystem::gameDataFiles.Lookup(path);
+		if (info.IsFile()) {
+			files.push_back(info.GetPath());
+		} else if (info.IsDir()) {
+			for (FileSystem::FileEnumerator e(FileSystem::gameDataFiles, path, FileSystem::FileEnumerator::Recurse); !e.Finished(); e.Next())
+				files.push_back(e.Current().GetPath());
+			std::sort(files.begin(), files.end());
+		}
+
+		for (const std::string &file : files) {
+			lookup3_hashlittle2(file.data(), file.size(), &c, &b);
+			RefCountedPtr<FileSystem::FileData> data = FileSystem::gameDataFiles.ReadFile(file);
+			if (data)
+				lookup3_hashlittle2(data->GetData(), data->GetSize(), &c, &b);
+		}
+	}
+} // namespace
+
+SectorDiskCache::SectorDiskCache(const std::string &generatorName, int generatorVersion, const std::vector<std::string> &dataPaths) :
+	m_fingerprint(0),
+	m_index(nullptr),
+	m_numEntries(0),
+	m_hits(0),
+	m_misses(0)
+{
+	PROFILE_SCOPED()
+	m_path = FileSystem::JoinPath(CACHE_DIR, generatorName + "-" + std::to_string(generatorVersion) + ".cache");
+
+	uint32_t c = 0, b = 0;
+	for (const std::string &path : dataPaths)
+		HashDataPath(path, c, b);
+	m_fingerprint = (uint64_t(b) << 32) | c;
+
+	if (!FileSystem::userFiles.MakeDirectory(CACHE_DIR)) {
+		Output("SectorDiskCache: couldn't create '%s'\n", CACHE_DIR);
+		return;
+	}
+
+	m_file = FileSystem::userFiles.MapFile(m_path);
+	if (!m_file) return;
+
+	FileHeader header;
+	if (m_file->GetSize() < sizeof(header)) {
+		m_file.Reset();
+		return;
+	}
+	memcpy(&header, m_file->GetData(), sizeof(header));
+	if (header.magic != MAGIC || header.version != VERSION || header.fingerprint != m_fingerprint ||
+		m_file->GetSize() < sizeof(header) + uint64_t(header.numEntries) * sizeof(IndexEntry)) {
+		Output("SectorDiskCache: '%s' is out of date, starting over\n", m_path.c_str());
+		m_file.Reset();
+		return;
+	}
+	m_index = reinterpret_cast<const IndexEntry *>(m_file->GetData() + sizeof(header));
+	m_numEntries = header.numEntries;
+	Output("SectorDiskCache: %u sectors and systems in '%s'\n", m_numEntries, m_path.c_str());
+}
+
+SectorDiskCache::~SectorDiskCache()
+{
+	Write();
+	Output("SectorDiskCache: %u hits, %u misses\n", uint32_t(m_hits), uint32_t(m_misses));
+}
+
+//static
+bool SectorDiskCache::IsEnabled()
+{
+	return GameConfSingleton::getInstance().Int("GalaxyDiskCache") != 0;
+}
+
+const SectorDiskCache::IndexEntry *SectorDiskCache::FindMapped(const Key &key) const
+{
+	const IndexEntry *end = m_index + m_numEntries;
+	const IndexEntry *it = std::lower_bound(m_index, end, key, [](const IndexEntry &e, const Key &k) { return Key(e.key, e.system) < k; });
+	if (it == end || Key(it->key, it->system) != key || it->offset + it->size > m_file->GetSize()) return nullptr;
+	return it;
+}
+
+bool SectorDiskCache::Find(const Key &key, std::string &compressed) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto added = m_added.find(key);
+	if (added != m_added.end()) {
+		compressed = added->second;
+	} else if (const IndexEntry *entry = m_index ? FindMapped(key) : nullptr) {
+		compressed.assign(m_file->GetData() + entry->offset, entry->size);
+	} else {
+		++m_misses;
+		return false;
+	}
+	return true;
+}
+
+void SectorDiskCache::Add(const Key &key, const std::string &data)
+{
+	size_t compressedSize = 0;
+	std::unique_ptr<char[]> compressed;
+	try {
+		compressed = lz4::CompressLZ4(data, 0, compressedSize);
+	} catch (lz4::CompressionFailedException &) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_added[key].assign(compressed.get(), compressedSize);
+}
+
+bool SectorDiskCache::Load(RefCountedPtr<Galaxy> galaxy, Sector *sector, bool &finished) const
+{
+	PROFILE_SCOPED()
+	std::string compressed;
+	if (!Find(Key(SystemPath::PackSector(sector->sx, sector->sy, sector->sz), NO_SYSTEM), compressed))
+		return false;
+
+	try {
+		const std::string data = lz4::DecompressLZ4(compressed.data(), compressed.size());
+		Reader r(data);
+		finished = r.Get<uint8_t>() != 0;
+		const uint32_t numSystems = r.Get<uint32_t>();
+		const std::vector<const CustomSystem *> &customs = galaxy->GetCustomSystems()->GetCustomSystemsForSector(sector->sx, sector->sy, sector->sz);
+		sector->m_systems.reserve(numSystems);
+		for (uint32_t i = 0; i < numSystems; i++) {
+			Sector::System s(sector, sector->sx, sector->sy, sector->sz, i);
+			const uint8_t flags = r.Get<uint8_t>();
+			if (flags & SYSTEM_CUSTOM) {
+				// custom systems come first and in the order of the database
+				if (i >= customs.size()) throw std::out_of_range("SectorDiskCache: custom system went missing");
+				s.m_customSys = customs[i];
+			}
+			s.m_name = r.GetString();
+			s.m_other_names.resize(r.Get<uint32_t>());
+			for (std::string &name : s.m_other_names)
+				name = r.GetString();
+			s.m_pos.x = r.Get<float>();
+			s.m_pos.y = r.Get<float>();
+			s.m_pos.z = r.Get<float>();
+			s.m_numStars = r.Get<uint32_t>();
+			for (GalaxyEnums::BodyType &type : s.m_starType)
+				type = GalaxyEnums::BodyType(r.Get<int32_t>());
+			s.m_seed = r.Get<uint32_t>();
+			s.m_population = fixed(r.Get<int64_t>());
+			s.m_explored = ExplorationState(r.Get<int32_t>());
+			s.m_exploredTime = r.Get<double>();
+			sector->m_systems.push_back(s);
+		}
+		if (!r.AtEnd()) throw std::out_of_range("SectorDiskCache: sector too long");
+	} catch (std::exception &e) {
+		// lz4::DecompressionFailedException or a bad sector, regenerate it
+		Output("%s (sector %d,%d,%d)\n", e.what(), sector->sx, sector->sy, sector->sz);
+		sector->m_systems.clear();
+		++m_misses;
+		return false;
+	}
+	++m_hits;
+	return true;
+}
+
+void SectorDiskCache::Store(const Sector *sector, bool finished)
+{
+	PROFILE_SCOPED()
+	Writer w;
+	w.Put(uint8_t(finished ? 1 : 0));
+	w.Put(uint32_t(sector->m_systems.size()));
+	for (const Sector::System &s : sector->m_systems) {
+		w.Put(uint8_t(s.m_customSys ? SYSTEM_CUSTOM : 0));
+		w.PutString(s.m_name);
+		w.Put(uint32_t(s.m_other_names.size()));
+		for (const std::string &name : s.m_other_names)
+			w.PutString(name);
+		w.Put(s.m_pos.x);
+		w.Put(s.m_pos.y);
+		w.Put(s.m_pos.z);
+		w.Put(uint32_t(s.m_numStars));
+		for (GalaxyEnums::BodyType type : s.m_starType)
+			w.Put(int32_t(type));
+		w.Put(s.m_seed);
+		w.Put(s.m_population.v);
+		w.Put(int32_t(s.m_explored));
+		w.Put(s.m_exploredTime);
+	}
+	Add(Key(SystemPath::PackSector(sector->sx, sector->sy, sector->sz), NO_SYSTEM), w.GetData());
+}
+// everything but what the sector has already (names, seed, exploration
+// state) and what depends on the exploration state or the language (the
+// descriptions, made again when loading). bodies are referred to by their
+// index in m_bodies, which is also the one in their SystemPath
+void SectorDiskCache::StoreSystem(const StarSystem *system)
+{
+	PROFILE_SCOPED()
+	if (!system->m_rootBody) return;
+	auto indexOf = [](const SystemBody *body) { return body ? body->GetPath().bodyIndex : NO_BODY; };
+
+	Writer w;
+	w.Put(int32_t(system->m_explored));
+	w.Put(system->m_faction ? system->m_faction->idx : Faction::BAD_FACTION_IDX);
+	w.Put(uint8_t((system->m_isCustom ? SYSTEM_CUSTOM : 0) | (system->m_hasCustomBodies ? SYSTEM_CUSTOM_BODIES : 0)));
+	w.Put(uint32_t(system->m_numStars));
+	w.Put(int32_t(system->m_polit.govType));
+	w.Put(system->m_polit.lawlessness.v);
+	w.Put(int32_t(system->m_econType));
+	w.Put(system->m_metallicity.v);
+	w.Put(system->m_industrial.v);
+	w.Put(system->m_agricultural.v);
+	w.Put(system->m_humanProx.v);
+	w.Put(system->m_totalPop.v);
+	for (int i = 0; i < GalacticEconomy::COMMODITY_COUNT; i++) {
+		w.Put(int32_t(system->m_tradeLevel[i]));
+		w.Put(uint8_t(system->m_commodityLegal[i] ? 1 : 0));
+	}
+
+	w.Put(uint32_t(system->m_bodies.size()));
+	for (const RefCountedPtr<SystemBody> &body : system->m_bodies) {
+		const SystemBody *b = body.Get();
+		w.Put(indexOf(b->m_parent));
+		w.Put(uint32_t(b->m_children.size()));
+		for (const SystemBody *kid : b->m_children)
+			w.Put(indexOf(kid));
+		w.Put(b->m_orbit);
+		w.Put(b->m_seed);
+		w.PutString(b->m_name);
+		w.Put(b->m_radius.v);
+		w.Put(b->m_aspectRatio.v);
+		w.Put(b->m_mass.v);
+		w.Put(b->m_orbMin.v);
+		w.Put(b->m_orbMax.v);
+		w.Put(b->m_rotationPeriod.v);
+		w.Put(b->m_rotationalPhaseAtStart.v);
+		w.Put(b->m_humanActivity.v);
+		w.Put(b->m_semiMajorAxis.v);
+		w.Put(b->m_eccentricity.v);
+		w.Put(b->m_orbitalOffset.v);
+		w.Put(b->m_orbitalPhaseAtStart.v);
+		w.Put(b->m_axialTilt.v);
+		w.Put(b->m_inclination.v);
+		w.Put(int32_t(b->m_averageTemp));
+		w.Put(int32_t(b->m_type));
+		w.Put(uint8_t(b->m_isCustomBody ? 1 : 0));
+		w.Put(b->m_metallicity.v);
+		w.Put(b->m_volatileGas.v);
+		w.Put(b->m_volatileLiquid.v);
+		w.Put(b->m_volatileIces.v);
+		w.Put(b->m_volcanicity.v);
+		w.Put(b->m_atmosOxidizing.v);
+		w.Put(b->m_life.v);
+		w.Put(b->m_rings.minRadius.v);
+		w.Put(b->m_rings.maxRadius.v);
+		w.Put(b->m_rings.baseColor);
+		w.Put(b->m_population.v);
+		w.Put(b->m_agricultural.v);
+		w.PutString(b->m_heightMapFilename);
+		w.Put(uint32_t(b->m_heightMapFractal));
+		w.Put(b->m_atmosColor);
+		w.Put(b->m_atmosDensity);
+		w.PutString(b->m_space_station_type);
+	}
+	w.Put(indexOf(system->m_rootBody.Get()));
+	w.Put(uint32_t(system->m_spaceStations.size()));
+	for (const SystemBody *station : system->m_spaceStations)
+		w.Put(indexOf(station));
+	w.Put(uint32_t(system->m_stars.size()));
+	for (const SystemBody *star : system->m_stars)
+		w.Put(indexOf(star));
+
+	const SystemPath &path = system->GetPath();
+	Add(Key(SystemPath::PackSector(path.sectorX, path.sectorY, path.sectorZ), path.systemIndex), w.GetData());
+}
+
+RefCountedPtr<StarSystem> SectorDiskCache::LoadSystem(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, StarSystemCache *cache) const
+{
+	PROFILE_SCOPED()
+	std::string compressed;
+	if (!Find(Key(SystemPath::PackSector(path.sectorX, path.sectorY, path.sectorZ), path.systemIndex), compressed))
+		return RefCountedPtr<StarSystem>();
+
+	RefCountedPtr<const Sector> sec = galaxy->GetSector(path);
+	assert(path.systemIndex < sec->m_systems.size());
+	const Sector::System &secSys = sec->m_systems[path.systemIndex];
+	FactionsDatabase *factions = galaxy->GetFactions();
+
+	// not in the cache until it's complete, a system that fails to load
+	// mustn't take anything with it when it goes
+	RefCountedPtr<StarSystem> system(new StarSystem(path, galaxy, nullptr));
+	StarSystemWriter syswrt(system);
+	try {
+		const std::string data = lz4::DecompressLZ4(compressed.data(), compressed.size());
+		Reader r(data);
+		// unexplored systems aren't populated, so it has to be made again
+		if (ExplorationState(r.Get<int32_t>()) != secSys.GetExplored()) {
+			++m_misses;
+			return RefCountedPtr<StarSystem>();
+		}
+		syswrt.SetSeed(secSys.GetSeed());
+		syswrt.SetName(secSys.GetName());
+		syswrt.SetOtherNames(secSys.GetOtherNames());
+		syswrt.SetExplored(secSys.GetExplored(), secSys.GetExploredTime());
+
+		const uint32_t factionIdx = r.Get<uint32_t>();
+		if (factionIdx == Faction::BAD_FACTION_IDX)
+			syswrt.SetFaction(factions->GetNoFaction());
+		else if (factionIdx < factions->GetNumFactions())
+			syswrt.SetFaction(factions->GetFaction(factionIdx));
+		else
+			throw std::out_of_range("SectorDiskCache: faction went missing");
+		const uint8_t flags = r.Get<uint8_t>();
+		syswrt.SetCustom(flags & SYSTEM_CUSTOM, flags & SYSTEM_CUSTOM_BODIES);
+		syswrt.SetNumStars(r.Get<uint32_t>());
+		SysPolit polit;
+		polit.govType = Polit::GovType(r.Get<int32_t>());
+		polit.lawlessness = r.GetFixed();
+		syswrt.SetSysPolit(polit);
+		syswrt.SetEconType(GalacticEconomy::EconType(r.Get<int32_t>()));
+		syswrt.SetMetallicity(r.GetFixed());
+		syswrt.SetIndustrial(r.GetFixed());
+		syswrt.SetAgricultural(r.GetFixed());
+		syswrt.SetHumanProx(r.GetFixed());
+		syswrt.SetTotalPop(r.GetFixed());
+		for (int i = 0; i < GalacticEconomy::COMMODITY_COUNT; i++) {
+			syswrt.SetTradeLevel(GalacticEconomy::Commodity(i), r.Get<int32_t>());
+			syswrt.SetCommodityLegal(GalacticEconomy::Commodity(i), r.Get<uint8_t>() != 0);
+		}
+
+		// each body takes more than its orbit, so a bad count is caught
+		// before making all of them
+		const uint32_t numBodies = r.Get<uint32_t>();
+		if (numBodies > r.GetRemaining() / sizeof(Orbit)) throw std::out_of_range("SectorDiskCache: truncated system");
+		std::vector<SystemBody *> bodies;
+		for (uint32_t i = 0; i < numBodies; i++)
+			bodies.push_back(syswrt.NewBody());
+		auto bodyAt = [&bodies](uint32_t index) {
+			if (index >= bodies.size()) throw std::out_of_range("SectorDiskCache: bad body index");
+			return bodies[index];
+		};
+		for (SystemBody *b : bodies) {
+			const uint32_t parent = r.Get<uint32_t>();
+			b->m_parent = parent == NO_BODY ? nullptr : bodyAt(parent);
+			for (uint32_t numChildren = r.Get<uint32_t>(); numChildren > 0; numChildren--)
+				b->m_children.push_back(bodyAt(r.Get<uint32_t>()));
+			b->m_orbit = r.Get<Orbit>();
+			b->m_seed = r.Get<uint32_t>();
+			b->m_name = r.GetString();
+			b->m_radius = r.GetFixed();
+			b->m_aspectRatio = r.GetFixed();
+			b->m_mass = r.GetFixed();
+			b->m_orbMin = r.GetFixed();
+			b->m_orbMax = r.GetFixed();
+			b->m_rotationPeriod = r.GetFixed();
+			b->m_rotationalPhaseAtStart = r.GetFixed();
+			b->m_humanActivity = r.GetFixed();
+			b->m_semiMajorAxis = r.GetFixed();
+			b->m_eccentricity = r.GetFixed();
+			b->m_orbitalOffset = r.GetFixed();
+			b->m_orbitalPhaseAtStart = r.GetFixed();
+			b->m_axialTilt = r.GetFixed();
+			b->m_inclination = r.GetFixed();
+			b->m_averageTemp = r.Get<int32_t>();
+			b->m_type = GalaxyEnums::BodyType(r.Get<int32_t>());
+			b->m_isCustomBody = r.Get<uint8_t>() != 0;
+			b->m_metallicity = r.GetFixed();
+			b->m_volatileGas = r.GetFixed();
+			b->m_volatileLiquid = r.GetFixed();
+			b->m_volatileIces = r.GetFixed();
+			b->m_volcanicity = r.GetFixed();
+			b->m_atmosOxidizing = r.GetFixed();
+			b->m_life = r.GetFixed();
+			b->m_rings.minRadius = r.GetFixed();
+			b->m_rings.maxRadius = r.GetFixed();
+			b->m_rings.baseColor = r.Get<Color>();
+			b->m_population = r.GetFixed();
+			b->m_agricultural = r.GetFixed();
+			b->m_heightMapFilename = r.GetString();
+			b->m_heightMapFractal = r.Get<uint32_t>();
+			b->m_atmosColor = r.Get<Color>();
+			b->m_atmosDensity = r.Get<double>();
+			b->m_space_station_type = r.GetString();
+		}
+		syswrt.SetRootBody(bodyAt(r.Get<uint32_t>()));
+		for (uint32_t numStations = r.Get<uint32_t>(); numStations > 0; numStations--)
+			syswrt.AddSpaceStation(bodyAt(r.Get<uint32_t>()));
+		for (uint32_t numStars = r.Get<uint32_t>(); numStars > 0; numStars--)
+			syswrt.AddStar(bodyAt(r.Get<uint32_t>()));
+		if (!r.AtEnd()) throw std::out_of_range("SectorDiskCache: system too long");
+	} catch (std::exception &e) {
+		// lz4::DecompressionFailedException or a bad system, regenerate it
+		Output("%s (system %d,%d,%d,%u)\n", e.what(), path.sectorX, path.sectorY, path.sectorZ, path.systemIndex);
+		++m_misses;
+		return RefCountedPtr<StarSystem>();
+	}
+
+	// the descriptions come from the custom system, or are made like
+	// PopulateStarSystemGenerator does
+	const CustomSystem *customSys = secSys.GetCustomSystem();
+	if (customSys && customSys->longDesc.length() > 0)
+		syswrt.SetLongDesc(customSys->longDesc);
+	if (customSys && customSys->shortDesc.length() > 0)
+		syswrt.SetShortDesc(customSys->shortDesc);
+	else
+		syswrt.MakeShortDescription();
+
+	system->m_cache = cache;
+	++m_hits;
+	return system;
+}
+
+void SectorDiskCache::Write()
+{
+	PROFILE_SCOPED()
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_added.empty()) return;
+
+	// what was generated this session, then as many of the old ones as fit
+	std::vector<IndexEntry> index;
+	std::vector<const char *> data;
+	uint64_t size = sizeof(FileHeader);
+	for (const auto &added : m_added) {
+		index.push_back({ added.first.first, 0, uint32_t(added.second.size()), added.first.second });
+		data.push_back(added.second.data());
+		size += sizeof(IndexEntry) + added.second.size();
+	}
+	for (uint32_t i = 0; i < m_numEntries; i++) {
+		const IndexEntry &e = m_index[i];
+		if (m_added.count(Key(e.key, e.system)) || e.offset + e.size > m_file->GetSize()) continue;
+		if (size + sizeof(IndexEntry) + e.size > MAX_FILE_SIZE) break;
+		index.push_back({ e.key, 0, e.size, e.system });
+		data.push_back(m_file->GetData() + e.offset);
+		size += sizeof(IndexEntry) + e.size;
+	}
+
+	// sort both by key, and lay the data out after the index
+	std::vector<uint32_t> order(index.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return Key(index[a].key, index[a].system) < Key(index[b].key, index[b].system);
+	});
+	std::vector<IndexEntry> sortedIndex(index.size());
+	uint64_t offset = sizeof(FileHeader) + index.size() * sizeof(IndexEntry);
+	for (uint32_t i = 0; i < order.size(); i++) {
+		sortedIndex[i] = index[order[i]];
+		sortedIndex[i].offset = offset;
+		offset += sortedIndex[i].size;
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.fingerprint = m_fingerprint;
+	header.numEntries = uint32_t(sortedIndex.size());
+
+	// written to a temporary first, a crash mid-write mustn't leave half a cache
+	const std::string tmpPath = m_path + ".tmp";
+	FILE *f = FileSystem::userFiles.OpenWriteStream(tmpPath);
+	if (!f) {
+		Output("SectorDiskCache: couldn't write '%s'\n", tmpPath.c_str());
+		return;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		fwrite(sortedIndex.data(), sizeof(IndexEntry), sortedIndex.size(), f) == sortedIndex.size();
+	for (uint32_t i = 0; written && i < order.size(); i++)
+		written = fwrite(data[order[i]], 1, sortedIndex[i].size, f) == sortedIndex[i].size;
+	written = (fclose(f) == 0) && written;
+
+	// the old file has to be unmapped before it can be replaced
+	m_index = nullptr;
+	m_numEntries = 0;
+	m_file.Reset();
+	m_added.clear();
+	if (!written || !FileSystem::userFiles.RenameFile(tmpPath, m_path)) {
+		Output("SectorDiskCache: couldn't write '%s'\n", m_path.c_str());
+		FileSystem::userFiles.RemoveFile(tmpPath);
+		return;
+	}
+	Output("SectorDiskCache: wrote %u sectors and systems to '%s'\n", header.numEntries, m_path.c_str());
+
+	m_file = FileSystem::userFiles.MapFile(m_path);
+	if (m_file && m_file->GetSize() >= offset) {
+		m_index = reinterpret_cast<const IndexEntry *>(m_file->GetData() + sizeof(header));
+		m_numEntries = header.numEntries;
+	} else {
+		m_file.Reset();
+	}
+}
@@ -0,0 +1,91 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SECTORDISKCACHE_H
+#define _SECTORDISKCACHE_H
+
+#include "FileSystem.h"
+#include "GalaxyCache.h"
+#include "libs/RefCounted.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Galaxy;
+class Sector;
+class StarSystem;
+
+// Keeps generated sectors, and the star systems in them, on disk between
+// sessions, one file per galaxy generator name and version. The file is
+// memory-mapped when the generator is created, what is generated during the
+// session is added when it is destroyed. Each sector and each system is LZ4
+// compressed on its own.
+//
+// Only the output of the deterministic sector stages is kept (see
+// SectorGeneratorStage::IsDeterministic). Systems are kept whole, except for
+// what depends on the exploration state. The file also records a hash of the
+// data the generator reads (custom systems, factions, the density map, the
+// name generator), so that changing those, or installing a mod that does,
+// throws it away.
+//
+// Load and Store are thread safe, they are called from the cache jobs.
+class SectorDiskCache {
+public:
+	SectorDiskCache(const std::string &generatorName, int generatorVersion, const std::vector<std::string> &dataPaths);
+	~SectorDiskCache();
+
+	static bool IsEnabled();
+
+	// fills in the systems of an empty sector. finished is what the last
+	// stage that ran returned. false if the sector isn't cached
+	bool Load(RefCountedPtr<Galaxy> galaxy, Sector *sector, bool &finished) const;
+	void Store(const Sector *sector, bool finished);
+
+	// a new system for the cache, or null if the system isn't cached or was
+	// cached in another exploration state (which decides whether it's
+	// populated)
+	RefCountedPtr<StarSystem> LoadSystem(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, StarSystemCache *cache) const;
+	void StoreSystem(const StarSystem *system);
+
+	// writes the sectors added since the last time out to disk
+	void Write();
+
+private:
+	// by SystemPath::PackSector, and the index of the system in the sector
+	// (NO_SYSTEM for the sector itself)
+	typedef std::pair<uint64_t, uint32_t> Key;
+	static const uint32_t NO_SYSTEM = ~0u;
+
+	// the index is sorted by key, the data follows it
+	struct IndexEntry {
+		uint64_t key;
+		uint64_t offset; // from the start of the file
+		uint32_t size;
+		uint32_t system;
+	};
+
+	const IndexEntry *FindMapped(const Key &key) const;
+	bool Find(const Key &key, std::string &compressed) const;
+	void Add(const Key &key, const std::string &data);
+
+	std::string m_path;
+	uint64_t m_fingerprint;
+
+	// the file as it was when the cache was opened
+	RefCountedPtr<FileSystem::FileData> m_file;
+	const IndexEntry *m_index;
+	uint32_t m_numEntries;
+
+	// compressed sectors and systems generated this session
+	mutable std::mutex m_mutex;
+	std::map<Key, std::string> m_added;
+	mutable std::atomic<uint32_t> m_hits;
+	mutable std::atomic<uint32_t> m_misses;
+};
+
+#endif /* _SECTORDISKCACHE_H */
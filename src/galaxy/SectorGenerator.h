@@ -33,6 +33,7 @@ public:
 	SectorPersistenceGenerator(GalaxyGenerator::Version version) :
 		m_version(version) {}
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config);
+	virtual bool IsDeterministic() const { return false; }
 	virtual void FromJson(const Json &jsonObj, RefCountedPtr<Galaxy> galaxy);
 	virtual void ToJson(Json &jsonObj, RefCountedPtr<Galaxy> galaxy);
 
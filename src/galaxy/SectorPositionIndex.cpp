@@ -0,0 +1,153 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SectorPositionIndex.h"
+
+#include "Galaxy.h"
+#include "Sector.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POSINDEX_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// where the padding systems are, so far away that they never match
+	const float FAR_AWAY = 1e18f;
+
+	// squared distance from p to the box [min, min + size] on every axis
+	float DistanceSqrToBox(const vector3f &p, const vector3f &min, float size)
+	{
+		float d = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			const float v = p[i] < min[i] ? min[i] - p[i] : (p[i] > min[i] + size ? p[i] - min[i] - size : 0.0f);
+			d += v * v;
+		}
+		return d;
+	}
+} // namespace
+
+void SectorPositionIndex::FindWithin(const SystemPath &center, float range, std::vector<Result> &out)
+{
+	PROFILE_SCOPED()
+	const vector3f pos = GetPosition(center);
+	const int32_t diff = int32_t(std::ceil(range / Sector::SIZE));
+	const size_t first = out.size();
+	FindWithin(center, pos, range,
+		center.sectorX - diff, center.sectorX + diff,
+		center.sectorY - diff, center.sectorY + diff,
+		center.sectorZ - diff, center.sectorZ + diff, out);
+
+	// leave out the centre itself
+	for (size_t i = first; i < out.size(); i++) {
+		if (out[i].path.IsSameSystem(center)) {
+			out.erase(out.begin() + i);
+			break;
+		}
+	}
+}
+
+void SectorPositionIndex::FindWithin(const SystemPath &origin, const vector3f &pos, float range,
+	int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, int32_t minZ, int32_t maxZ, std::vector<Result> &out)
+{
+	PROFILE_SCOPED()
+	const float rangeSqr = range * range;
+	for (int32_t sx = minX; sx <= maxX; sx++) {
+		for (int32_t sy = minY; sy <= maxY; sy++) {
+			for (int32_t sz = minZ; sz <= maxZ; sz++) {
+				const vector3f secMin = Sector::SIZE * vector3f(float(sx - origin.sectorX), float(sy - origin.sectorY), float(sz - origin.sectorZ));
+				// don't even generate sectors that are entirely out of range
+				if (DistanceSqrToBox(pos, secMin, Sector::SIZE) > rangeSqr)
+					continue;
+				Scan(GetEntry(sx, sy, sz), sx, sy, sz, pos - secMin, range, out);
+			}
+		}
+	}
+}
+
+vector3f SectorPositionIndex::GetPosition(const SystemPath &path)
+{
+	const Entry &entry = GetEntry(path.sectorX, path.sectorY, path.sectorZ);
+	assert(path.systemIndex < entry.numSystems);
+	const uint32_t i = path.systemIndex;
+	return vector3f(entry.pos[i], entry.pos[entry.stride + i], entry.pos[2 * entry.stride + i]);
+}
+
+void SectorPositionIndex::Clear()
+{
+	m_lru.clear();
+	m_entries.clear();
+}
+
+const SectorPositionIndex::Entry &SectorPositionIndex::GetEntry(int32_t sx, int32_t sy, int32_t sz)
+{
+	const uint64_t key = SystemPath::PackSector(sx, sy, sz);
+	const auto it = m_entries.find(key);
+	if (it != m_entries.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		return *it->second;
+	}
+
+	PROFILE_SCOPED()
+	RefCountedPtr<const Sector> sec = m_galaxy->GetSector(SystemPath(sx, sy, sz));
+	m_lru.emplace_front();
+	Entry &entry = m_lru.front();
+	entry.key = key;
+	entry.numSystems = uint32_t(sec->m_systems.size());
+	entry.stride = (entry.numSystems + 3) & ~3u;
+	entry.pos.assign(3 * entry.stride, FAR_AWAY);
+	for (uint32_t i = 0; i < entry.numSystems; i++) {
+		const vector3f &p = sec->m_systems[i].GetPosition();
+		entry.pos[i] = p.x;
+		entry.pos[entry.stride + i] = p.y;
+		entry.pos[2 * entry.stride + i] = p.z;
+	}
+	m_entries[key] = m_lru.begin();
+
+	while (m_lru.size() > MAX_SECTORS) {
+		m_entries.erase(m_lru.back().key);
+		m_lru.pop_back();
+	}
+	return entry;
+}
+
+void SectorPositionIndex::Scan(const Entry &entry, int32_t sx, int32_t sy, int32_t sz, const vector3f &pos, float range, std::vector<Result> &out) const
+{
+	const float rangeSqr = range * range;
+	const float *xs = entry.pos.data();
+	const float *ys = xs + entry.stride;
+	const float *zs = ys + entry.stride;
+
+	auto add = [&](uint32_t i) {
+		out.push_back({ SystemPath(sx, sy, sz, i), vector3f(xs[i], ys[i], zs[i]) - pos });
+	};
+
+#ifdef POSINDEX_USE_SSE2
+	const __m128 px = _mm_set1_ps(pos.x);
+	const __m128 py = _mm_set1_ps(pos.y);
+	const __m128 pz = _mm_set1_ps(pos.z);
+	const __m128 r2 = _mm_set1_ps(rangeSqr);
+	for (uint32_t i = 0; i < entry.stride; i += 4) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), px);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), py);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(zs + i), pz);
+		const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+		while (mask) {
+			const int bit = mask & -mask;
+			add(i + (bit == 1 ? 0 : bit == 2 ? 1 : bit == 4 ? 2 : 3));
+			mask &= mask - 1;
+		}
+	}
+#else
+	for (uint32_t i = 0; i < entry.numSystems; i++) {
+		const float dx = xs[i] - pos.x, dy = ys[i] - pos.y, dz = zs[i] - pos.z;
+		if (dx * dx + dy * dy + dz * dz <= rangeSqr)
+			add(i);
+	}
+#endif
+}
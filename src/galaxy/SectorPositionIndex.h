@@ -0,0 +1,72 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SECTORPOSITIONINDEX_H
+#define _SECTORPOSITIONINDEX_H
+
+#include "galaxy/SystemPath.h"
+#include "libs/vector3.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class Galaxy;
+
+// Where the systems of each sector are, packed as structure-of-arrays so that
+// range queries are a straight scan over floats rather than a walk through
+// Sector::System objects. Kept by the Galaxy next to its SectorCache: a sector
+// is indexed the first time a query needs it, and as positions never change
+// the entries outlive the Sectors they were copied from.
+//
+// Not thread safe, use from the main thread like the SectorCache.
+class SectorPositionIndex {
+public:
+	struct Result {
+		SystemPath path;
+		// in light years, relative to the centre of the query
+		vector3f pos;
+	};
+
+	SectorPositionIndex(Galaxy *galaxy) :
+		m_galaxy(galaxy) {}
+
+	// every system within range light years of the centre system, which
+	// itself is left out. appends to out
+	void FindWithin(const SystemPath &center, float range, std::vector<Result> &out);
+	// every system in the given box of sectors that is within range light
+	// years of pos (in light years, relative to the sector of origin)
+	void FindWithin(const SystemPath &origin, const vector3f &pos, float range,
+		int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, int32_t minZ, int32_t maxZ, std::vector<Result> &out);
+
+	// position of a system within its sector
+	vector3f GetPosition(const SystemPath &path);
+
+	void Clear();
+
+private:
+	// sectors to keep before the least recently used are dropped
+	static const size_t MAX_SECTORS = 8192;
+
+	struct Entry {
+		uint64_t key;
+		uint32_t numSystems;
+		// numSystems rounded up to a multiple of 4, the padding is far away
+		uint32_t stride;
+		// all x, then all y, then all z, in light years within the sector.
+		// systems are in the order of Sector::m_systems, so the position in
+		// the array is the system index
+		std::vector<float> pos;
+	};
+
+	const Entry &GetEntry(int32_t sx, int32_t sy, int32_t sz);
+	void Scan(const Entry &entry, int32_t sx, int32_t sy, int32_t sz, const vector3f &pos, float range, std::vector<Result> &out) const;
+
+	Galaxy *m_galaxy;
+	// most recently used at the front
+	std::list<Entry> m_lru;
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> m_entries;
+};
+
+#endif /* _SECTORPOSITIONINDEX_H */
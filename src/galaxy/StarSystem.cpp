@@ -44,8 +44,10 @@ StarSystem::~StarSystem()
 {
 	PROFILE_SCOPED()
 	// clear parent and children pointers. someone (Lua) might still have a
-	// reference to things that are about to be deleted
-	m_rootBody->ClearParentAndChildPointers();
+	// reference to things that are about to be deleted. there's no root if
+	// it never got that far (see SectorDiskCache::LoadSystem)
+	if (m_rootBody)
+		m_rootBody->ClearParentAndChildPointers();
 	if (m_cache)
 		m_cache->RemoveFromAttic(m_path);
 }
@@ -320,6 +322,22 @@ bool StarSystem::WithinBox(const int Xmin, const int Xmax, const int Ymin, const
 	return false;
 }
 
+size_t StarSystem::GetMemoryUsage() const
+{
+	size_t bytes = sizeof(StarSystem) + m_name.capacity() + m_shortDesc.capacity() + m_longDesc.capacity();
+	bytes += m_other_names.capacity() * sizeof(std::string);
+	for (const std::string &name : m_other_names)
+		bytes += name.capacity();
+	bytes += m_bodies.capacity() * sizeof(RefCountedPtr<SystemBody>);
+	bytes += (m_spaceStations.capacity() + m_stars.capacity()) * sizeof(SystemBody *);
+	bytes += m_commodityLegal.capacity() / 8;
+	for (const RefCountedPtr<SystemBody> &body : m_bodies) {
+		bytes += sizeof(SystemBody) + body->m_children.capacity() * sizeof(SystemBody *);
+		bytes += body->m_name.capacity() + body->m_heightMapFilename.capacity() + body->m_space_station_type.capacity();
+	}
+	return bytes;
+}
+
 const RefCountedPtr<Galaxy> StarSystem::GetGalaxy() const
 {
 	return m_galaxy;
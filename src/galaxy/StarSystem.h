@@ -27,6 +27,7 @@ class Galaxy;
 
 class StarSystem : public RefCounted {
 	friend class StarSystemWriter;
+	friend class SectorDiskCache;
 	friend void SetCache(RefCountedPtr<StarSystem> ssys, StarSystemCache *cache);
 public:
 	StarSystem(const SystemPath &path, RefCountedPtr<Galaxy> galaxy, StarSystemCache *cache);
@@ -83,6 +84,8 @@ public:
 	fixed GetTotalPop() const { return m_totalPop; }
 
 	bool WithinBox(const int Xmin, const int Xmax, const int Ymin, const int Ymax, const int Zmin, const int Zmax) const;
+	// roughly, in bytes, for the cache budget
+	size_t GetMemoryUsage() const;
 
 	void Dump(FILE *file, const char *indent = "", bool suppressSectorData = false) const;
 
@@ -1449,7 +1449,8 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem *
 		}
 	}
 
-	if (!syswrt.HasCustomBodies() && sbody->GetPopulationAsFixed() > 0)
+	// without Lua (the galaxy exporter) populated bodies keep their catalogue names
+	if (!syswrt.HasCustomBodies() && sbody->GetPopulationAsFixed() > 0 && Pi::m_luaNameGen)
 		sbody->m_name = Pi::m_luaNameGen->BodyName(sbody, namerand);
 
 	// Add a bunch of things people consume
@@ -1491,6 +1492,14 @@ static std::string gen_unique_station_name(SystemBody *sp, const StarSystem *sys
 {
 	PROFILE_SCOPED()
 	std::string name;
+	if (!Pi::m_luaNameGen) {
+		// no Lua to ask (the galaxy exporter), number them after what they orbit
+		for (int i = 1;; i++) {
+			name = sp->GetParent()->GetName() + " Station " + std::to_string(i);
+			if (check_unique_station_name(name, system))
+				return name;
+		}
+	}
 	do {
 		name = Pi::m_luaNameGen->BodyName(sp, namerand);
 	} while (!check_unique_station_name(name, system));
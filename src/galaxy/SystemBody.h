@@ -26,6 +26,7 @@ class SystemBody : public RefCounted {
 	friend class StarSystemCustomGenerator;
 	friend class StarSystemRandomGenerator;
 	friend class PopulateStarSystemGenerator;
+	friend class SectorDiskCache;
 
 public:
 	SystemBody(const SystemPath &path, StarSystem *system);
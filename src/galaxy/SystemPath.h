@@ -86,6 +86,13 @@ public:
 		return (x * x + y * y + z * z); // return the square of the distance
 	}
 
+	// sector coordinates in one integer, 21 bits each, for keys and hashes.
+	// coordinates more than 2^20 apart share a key
+	static inline uint64_t PackSector(int32_t x, int32_t y, int32_t z)
+	{
+		return (uint64_t(uint32_t(x) & 0x1fffff) << 42) | (uint64_t(uint32_t(y) & 0x1fffff) << 21) | uint64_t(uint32_t(z) & 0x1fffff);
+	}
+
 	class LessSectorOnly {
 	public:
 		bool operator()(const SystemPath &a, const SystemPath &b) const
@@ -107,6 +114,38 @@ public:
 		}
 	};
 
+	// for hashed containers, equal and hash the same parts as the orderings above
+	class EqualSectorOnly {
+	public:
+		bool operator()(const SystemPath &a, const SystemPath &b) const { return a.IsSameSector(b); }
+	};
+
+	class EqualSystemOnly {
+	public:
+		bool operator()(const SystemPath &a, const SystemPath &b) const
+		{
+			return a.IsSameSector(b) && a.systemIndex == b.systemIndex;
+		}
+	};
+
+	class HashSectorOnly {
+	public:
+		size_t operator()(const SystemPath &p) const
+		{
+			const uint64_t key = PackSector(p.sectorX, p.sectorY, p.sectorZ);
+			// spread the bits about, the low ones (z) alone make poor buckets
+			return size_t((key ^ (key >> 29)) * 0x9e3779b97f4a7c15ull);
+		}
+	};
+
+	class HashSystemOnly {
+	public:
+		size_t operator()(const SystemPath &p) const
+		{
+			return HashSectorOnly()(p) ^ size_t(uint64_t(p.systemIndex) * 0xff51afd7ed558ccdull);
+		}
+	};
+
 	bool IsSectorPath() const
 	{
 		return (systemIndex == std::numeric_limits<uint32_t>::max() && bodyIndex == std::numeric_limits<uint32_t>::max());
@@ -0,0 +1,519 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+// Headless batch exporter for the galaxy: generates sectors and (unless told
+// not to) full star systems in parallel on a job queue and streams them out.
+//
+// The output is a columnar binary file, one row per system, written in
+// blocks of one batch of sectors each so memory stays bounded whatever the
+// radius. All values are little-endian:
+//
+//   header:  "PGXP", uint32 version, uint32 generator version,
+//            uint8 length + generator name, uint32 number of columns,
+//            and for each column uint8 type, uint8 length + name
+//   block:   uint32 number of rows (0 ends the file), then for each column
+//            uint32 size in bytes followed by the values of all the rows.
+//            strings are all the uint32 lengths, then all the characters
+//
+// Optionally every system is also written as one JSON object per line.
+//
+// Without Lua, populated bodies keep their catalogue names and stations are
+// numbered after what they orbit, everything else matches the game.
+
+#include "buildopts.h"
+
+#include "FileSystem.h"
+#include "GameConfSingleton.h"
+#include "JobQueue.h"
+#include "Json.h"
+#include "ModManager.h"
+#include "OS.h"
+#include "galaxy/Faction.h"
+#include "galaxy/Galaxy.h"
+#include "galaxy/GalaxyGenerator.h"
+#include "galaxy/Sector.h"
+#include "galaxy/StarSystem.h"
+#include "libs/utils.h"
+
+#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	const uint32_t FORMAT_VERSION = 1;
+
+	enum ColumnType : uint8_t {
+		COLUMN_INT32 = 0,
+		COLUMN_UINT32 = 1,
+		COLUMN_UINT16 = 2,
+		COLUMN_UINT8 = 3,
+		COLUMN_FLOAT = 4,
+		COLUMN_STRING = 5
+	};
+
+	// everything exported about one system. the fields after population are
+	// only filled in when star systems are generated
+	struct SystemRow {
+		SystemPath path;
+		vector3f pos; // in light years from the centre of the galaxy's sector 0,0,0
+		std::string name;
+		uint32_t seed;
+		uint8_t numStars;
+		uint8_t starType;
+		std::string faction;
+		float population;
+		uint8_t explored;
+
+		uint16_t numBodies;
+		uint16_t numStations;
+		uint8_t govType;
+		uint8_t econType;
+		float lawlessness;
+		float metallicity;
+		float industrial;
+		float agricultural;
+		float humanProx;
+	};
+
+	// collects the rows of a block column by column, then writes them out
+	class ColumnWriter {
+	public:
+		ColumnWriter(FILE *file) :
+			m_file(file),
+			m_numRows(0) {}
+
+		void AddColumn(const std::string &name, ColumnType type)
+		{
+			m_columns.push_back({ name, type, std::string(), std::string() });
+		}
+
+		void WriteHeader(const std::string &generatorName, uint32_t generatorVersion)
+		{
+			std::string out("PGXP");
+			Put(out, FORMAT_VERSION);
+			Put(out, generatorVersion);
+			PutName(out, generatorName);
+			Put(out, uint32_t(m_columns.size()));
+			for (const Column &col : m_columns) {
+				Put(out, uint8_t(col.type));
+				PutName(out, col.name);
+			}
+			Write(out);
+		}
+
+		void AddRow(const SystemRow &row, bool full)
+		{
+			size_t c = 0;
+			Put(m_columns[c++].data, int32_t(row.path.sectorX));
+			Put(m_columns[c++].data, int32_t(row.path.sectorY));
+			Put(m_columns[c++].data, int32_t(row.path.sectorZ));
+			Put(m_columns[c++].data, uint32_t(row.path.systemIndex));
+			Put(m_columns[c++].data, row.pos.x);
+			Put(m_columns[c++].data, row.pos.y);
+			Put(m_columns[c++].data, row.pos.z);
+			PutString(m_columns[c++], row.name);
+			Put(m_columns[c++].data, row.seed);
+			Put(m_columns[c++].data, row.numStars);
+			Put(m_columns[c++].data, row.starType);
+			PutString(m_columns[c++], row.faction);
+			Put(m_columns[c++].data, row.population);
+			Put(m_columns[c++].data, row.explored);
+			if (full) {
+				Put(m_columns[c++].data, row.numBodies);
+				Put(m_columns[c++].data, row.numStations);
+				Put(m_columns[c++].data, row.govType);
+				Put(m_columns[c++].data, row.econType);
+				Put(m_columns[c++].data, row.lawlessness);
+				Put(m_columns[c++].data, row.metallicity);
+				Put(m_columns[c++].data, row.industrial);
+				Put(m_columns[c++].data, row.agricultural);
+				Put(m_columns[c++].data, row.humanProx);
+			}
+			assert(c == m_columns.size());
+			m_numRows++;
+		}
+
+		// the rows added since the last block. nothing if there are none, as
+		// an empty block would end the file
+		void WriteBlock()
+		{
+			if (!m_numRows)
+				return;
+			std::string out;
+			Put(out, m_numRows);
+			Write(out);
+			for (Column &col : m_columns) {
+				out.clear();
+				Put(out, uint32_t(col.data.size() + col.chars.size()));
+				Write(out);
+				Write(col.data);
+				Write(col.chars);
+				col.data.clear();
+				col.chars.clear();
+			}
+			m_numRows = 0;
+		}
+
+		void WriteEnd()
+		{
+			std::string out;
+			Put(out, uint32_t(0));
+			Write(out);
+		}
+
+		uint32_t GetNumRows() const { return m_numRows; }
+		bool HasFailed() const { return ferror(m_file) != 0; }
+
+	private:
+		struct Column {
+			std::string name;
+			ColumnType type;
+			std::string data;
+			std::string chars; // of strings, after their lengths
+		};
+
+		template <typename T>
+		static void Put(std::string &out, T value)
+		{
+			out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+		}
+
+		static void PutName(std::string &out, const std::string &name)
+		{
+			const size_t len = std::min<size_t>(name.size(), 255);
+			Put(out, uint8_t(len));
+			out.append(name, 0, len);
+		}
+
+		static void PutString(Column &col, const std::string &str)
+		{
+			Put(col.data, uint32_t(str.size()));
+			col.chars.append(str);
+		}
+
+		void Write(const std::string &data)
+		{
+			if (!data.empty())
+				fwrite(data.data(), 1, data.size(), m_file);
+		}
+
+		FILE *m_file;
+		std::vector<Column> m_columns;
+		uint32_t m_numRows;
+	};
+
+	void AddColumns(ColumnWriter &writer, bool full)
+	{
+		writer.AddColumn("sectorX", COLUMN_INT32);
+		writer.AddColumn("sectorY", COLUMN_INT32);
+		writer.AddColumn("sectorZ", COLUMN_INT32);
+		writer.AddColumn("systemIndex", COLUMN_UINT32);
+		writer.AddColumn("x", COLUMN_FLOAT);
+		writer.AddColumn("y", COLUMN_FLOAT);
+		writer.AddColumn("z", COLUMN_FLOAT);
+		writer.AddColumn("name", COLUMN_STRING);
+		writer.AddColumn("seed", COLUMN_UINT32);
+		writer.AddColumn("numStars", COLUMN_UINT8);
+		writer.AddColumn("starType", COLUMN_UINT8);
+		writer.AddColumn("faction", COLUMN_STRING);
+		writer.AddColumn("population", COLUMN_FLOAT);
+		writer.AddColumn("explored", COLUMN_UINT8);
+		if (full) {
+			writer.AddColumn("numBodies", COLUMN_UINT16);
+			writer.AddColumn("numStations", COLUMN_UINT16);
+			writer.AddColumn("govType", COLUMN_UINT8);
+			writer.AddColumn("econType", COLUMN_UINT8);
+			writer.AddColumn("lawlessness", COLUMN_FLOAT);
+			writer.AddColumn("metallicity", COLUMN_FLOAT);
+			writer.AddColumn("industrial", COLUMN_FLOAT);
+			writer.AddColumn("agricultural", COLUMN_FLOAT);
+			writer.AddColumn("humanProx", COLUMN_FLOAT);
+		}
+	}
+
+	std::string RowToJson(const SystemRow &row, bool full)
+	{
+		Json obj;
+		obj["path"] = { row.path.sectorX, row.path.sectorY, row.path.sectorZ, row.path.systemIndex };
+		obj["pos"] = { row.pos.x, row.pos.y, row.pos.z };
+		obj["name"] = row.name;
+		obj["seed"] = row.seed;
+		obj["numStars"] = row.numStars;
+		obj["starType"] = row.starType;
+		obj["faction"] = row.faction;
+		obj["population"] = row.population;
+		obj["explored"] = row.explored;
+		if (full) {
+			obj["numBodies"] = row.numBodies;
+			obj["numStations"] = row.numStations;
+			obj["govType"] = row.govType;
+			obj["econType"] = row.econType;
+			obj["lawlessness"] = row.lawlessness;
+			obj["metallicity"] = row.metallicity;
+			obj["industrial"] = row.industrial;
+			obj["agricultural"] = row.agricultural;
+			obj["humanProx"] = row.humanProx;
+		}
+		return obj.dump() + "\n";
+	}
+
+	// the rows of one sector. each sector is worked on by a single job, which
+	// matters because Sector::System works out its faction lazily
+	struct SectorOutput {
+		std::vector<SystemRow> rows;
+		std::string json;
+	};
+
+	void ExportSector(RefCountedPtr<Galaxy> galaxy, const Sector *sector, bool full, bool json, SectorOutput &out)
+	{
+		PROFILE_SCOPED()
+		out.rows.resize(sector->m_systems.size());
+		for (size_t i = 0; i < sector->m_systems.size(); i++) {
+			const Sector::System &sys = sector->m_systems[i];
+			SystemRow &row = out.rows[i];
+			row = SystemRow();
+			row.path = sys.GetPath();
+			row.pos = sys.GetFullPosition();
+			row.name = sys.GetName();
+			row.seed = sys.GetSeed();
+			row.numStars = uint8_t(sys.GetNumStars());
+			row.starType = sys.GetNumStars() ? uint8_t(sys.GetStarType(0)) : 0;
+			const Faction *faction = sys.GetFaction();
+			row.faction = faction ? faction->name : std::string();
+			row.population = sys.GetPopulation().ToFloat();
+			row.explored = uint8_t(sys.GetExplored());
+
+			if (full) {
+				// the sector is in the galaxy's cache, which is all that
+				// generating a star system looks up
+				RefCountedPtr<StarSystem> ssys = galaxy->GetGenerator()->Generate<StarSystem, StarSystemCache>(galaxy, row.path, nullptr);
+				row.population = ssys->GetTotalPop().ToFloat();
+				row.numBodies = uint16_t(ssys->GetNumBodies());
+				row.numStations = uint16_t(ssys->GetNumSpaceStations());
+				row.govType = uint8_t(ssys->GetSysPolit().govType);
+				row.econType = uint8_t(ssys->GetEconType());
+				row.lawlessness = ssys->GetSysPolit().lawlessness.ToFloat();
+				row.metallicity = ssys->GetMetallicity().ToFloat();
+				row.industrial = ssys->GetIndustrial().ToFloat();
+				row.agricultural = ssys->GetAgricultural().ToFloat();
+				row.humanProx = ssys->GetHumanProx().ToFloat();
+			}
+
+			if (json)
+				out.json += RowToJson(row, full);
+		}
+	}
+
+	struct Options {
+		std::string outFile;
+		std::string jsonFile;
+		SystemPath center = SystemPath(0, 0, 0);
+		int radius = 4;
+		bool full = true;
+		uint32_t threads = 0;
+		uint32_t batchSize = 1024;
+	};
+
+	void Usage()
+	{
+		Output(
+			"usage: galaxyexport [options...] <output file>\n"
+			"options:\n"
+			"    -radius    [-r] n       sectors around the centre to export (default 4)\n"
+			"    -center    [-c] x,y,z   sector at the centre (default 0,0,0)\n"
+			"    -json      [-j] file    also write one JSON object per system to file\n"
+			"    -sectors   [-s]         sectors only, don't generate star systems\n"
+			"    -threads   [-t] n       worker threads (default all cores)\n"
+			"    -batch     [-b] n       sectors per block, bounds memory use (default 1024)\n"
+			"    -help      [-h,-?]      this help\n");
+	}
+
+	bool ParseInt(const char *arg, long min, long max, long &value)
+	{
+		char *end = nullptr;
+		value = std::strtol(arg, &end, 0);
+		return end != arg && *end == 0 && value >= min && value <= max;
+	}
+
+	// false if the arguments don't make sense
+	bool ParseOptions(int argc, char **argv, Options &opts)
+	{
+		for (int i = 1; i < argc; i++) {
+			const std::string arg(argv[i]);
+			const bool hasValue = i + 1 < argc;
+			long value;
+			if (arg == "-radius" || arg == "-r") {
+				if (!hasValue || !ParseInt(argv[++i], 0, 10000, value)) return false;
+				opts.radius = int(value);
+			} else if (arg == "-center" || arg == "-c") {
+				if (!hasValue) return false;
+				int x, y, z;
+				if (sscanf(argv[++i], "%d,%d,%d", &x, &y, &z) != 3) return false;
+				opts.center = SystemPath(x, y, z);
+			} else if (arg == "-json" || arg == "-j") {
+				if (!hasValue) return false;
+				opts.jsonFile = argv[++i];
+			} else if (arg == "-sectors" || arg == "-s") {
+				opts.full = false;
+			} else if (arg == "-threads" || arg == "-t") {
+				if (!hasValue || !ParseInt(argv[++i], 1, 256, value)) return false;
+				opts.threads = uint32_t(value);
+			} else if (arg == "-batch" || arg == "-b") {
+				if (!hasValue || !ParseInt(argv[++i], 1, 1 << 20, value)) return false;
+				opts.batchSize = uint32_t(value);
+			} else if (arg[0] == '-' && arg.size() > 1) {
+				return false;
+			} else {
+				opts.outFile = arg;
+			}
+		}
+		return !opts.outFile.empty();
+	}
+
+	// returns the number of systems written, or -1 on a write error
+	int64_t Export(RefCountedPtr<Galaxy> galaxy, JobQueue *queue, const Options &opts, FILE *out, FILE *json)
+	{
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point start = Clock::now();
+
+		ColumnWriter writer(out);
+		AddColumns(writer, opts.full);
+		writer.WriteHeader(galaxy->GetGeneratorName(), uint32_t(galaxy->GetGeneratorVersion()));
+
+		// sectors stay in the galaxy's cache for as long as their batch
+		// is being worked on, so the star system jobs find them there
+		RefCountedPtr<SectorCache::Slave> sectorCache = galaxy->NewSectorSlaveCache();
+
+		const int64_t side = 2 * int64_t(opts.radius) + 1;
+		const int64_t numSectors = side * side * side;
+		std::vector<SystemPath> paths;
+		std::vector<RefCountedPtr<Sector>> sectors;
+		std::vector<SectorOutput> outputs;
+		int64_t numSystems = 0;
+
+		for (int64_t first = 0; first < numSectors; first += opts.batchSize) {
+			const uint32_t count = uint32_t(std::min<int64_t>(opts.batchSize, numSectors - first));
+			paths.resize(count);
+			for (uint32_t i = 0; i < count; i++) {
+				const int64_t n = first + i;
+				paths[i] = SystemPath(
+					opts.center.sectorX - opts.radius + int32_t(n / (side * side)),
+					opts.center.sectorY - opts.radius + int32_t((n / side) % side),
+					opts.center.sectorZ - opts.radius + int32_t(n % side));
+			}
+
+			sectors.resize(count);
+			RefCountedPtr<GalaxyGenerator> generator = galaxy->GetGenerator();
+			ParallelFor(queue, count, [&](uint32_t i) {
+				sectors[i] = generator->Generate<Sector, SectorCache>(galaxy, paths[i], nullptr);
+			});
+			sectorCache->AddToCache(sectors);
+
+			outputs.resize(count);
+			ParallelFor(queue, count, [&](uint32_t i) {
+				ExportSector(galaxy, sectors[i].Get(), opts.full, json != nullptr, outputs[i]);
+			});
+
+			for (SectorOutput &o : outputs) {
+				for (const SystemRow &row : o.rows)
+					writer.AddRow(row, opts.full);
+				if (json && !o.json.empty())
+					fwrite(o.json.data(), 1, o.json.size(), json);
+				o.rows.clear();
+				o.json.clear();
+			}
+			numSystems += writer.GetNumRows();
+			writer.WriteBlock();
+			if (writer.HasFailed() || (json && ferror(json)))
+				return -1;
+
+			sectorCache->ClearCache();
+			sectors.clear();
+
+			const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			Output("galaxyexport: %" PRId64 "/%" PRId64 " sectors, %" PRId64 " systems, %.0f systems/s\n",
+				first + count, numSectors, numSystems, seconds > 0.0 ? double(numSystems) / seconds : 0.0);
+		}
+		writer.WriteEnd();
+		return writer.HasFailed() ? -1 : numSystems;
+	}
+} // namespace
+
+extern "C" int main(int argc, char **argv)
+{
+#ifdef PIONEER_PROFILER
+	Profiler::detect(argc, argv);
+#endif
+
+	Options opts;
+	if (!ParseOptions(argc, argv, opts)) {
+		Usage();
+		return 1;
+	}
+
+	FileSystem::Init();
+	FileSystem::userFiles.MakeDirectory(""); // ensure the config directory exists
+	GameConfSingleton::Init();
+
+	static const uint32_t sdl_init_nothing = 0;
+	if (SDL_Init(sdl_init_nothing) < 0) {
+		Output("galaxyexport: SDL initialization failed: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	// mods can change the custom systems and factions, which is one of the
+	// reasons to export the galaxy in the first place
+	ModManager::Init();
+
+	uint32_t numThreads = opts.threads;
+	if (numThreads == 0)
+		numThreads = std::max(uint32_t(OS::GetNumCores()), 1U); // this is a tool, we can use all of the cores
+	std::unique_ptr<AsyncJobQueue> queue(new AsyncJobQueue(numThreads));
+	Output("galaxyexport: started %u worker threads\n", numThreads);
+
+	RefCountedPtr<Galaxy> galaxy;
+	if (GameConfSingleton::getInstance().HasEntry("GalaxyGenerator"))
+		galaxy = GalaxyGenerator::Create(GameConfSingleton::getInstance().String("GalaxyGenerator"),
+			GameConfSingleton::getInstance().Int("GalaxyGeneratorVersion", GalaxyGenerator::LAST_VERSION));
+	else
+		galaxy = GalaxyGenerator::Create();
+	if (!galaxy) {
+		SDL_Quit();
+		FileSystem::Uninit();
+		return 1;
+	}
+
+	int result = 0;
+	FILE *out = fopen(opts.outFile.c_str(), "wb");
+	FILE *json = opts.jsonFile.empty() ? nullptr : fopen(opts.jsonFile.c_str(), "w");
+	if (!out || (!opts.jsonFile.empty() && !json)) {
+		Output("galaxyexport: could not open \"%s\" for writing: %s\n", out ? opts.jsonFile.c_str() : opts.outFile.c_str(), strerror(errno));
+		result = 1;
+	} else {
+		const auto start = std::chrono::steady_clock::now();
+		const int64_t numSystems = Export(galaxy, queue.get(), opts, out, json);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (numSystems < 0) {
+			Output("galaxyexport: writing the export failed: %s\n", strerror(errno));
+			result = 1;
+		} else {
+			Output("galaxyexport: exported %" PRId64 " %s in %.2f s, %.0f systems/s\n", numSystems,
+				opts.full ? "star systems" : "systems", seconds, seconds > 0.0 ? double(numSystems) / seconds : 0.0);
+		}
+	}
+	if (out && fclose(out) != 0)
+		result = 1;
+	if (json && fclose(json) != 0)
+		result = 1;
+
+	galaxy.Reset();
+	GalaxyGenerator::Uninit(); // writes out the sector disk cache
+	queue.reset();
+	SDL_Quit();
+	FileSystem::Uninit();
+	return result;
+}
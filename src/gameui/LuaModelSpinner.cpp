@@ -23,7 +23,7 @@ namespace GameUI {
 			unsigned int pattern = 0;
 			if (lua_gettop(l) > 3 && !lua_isnoneornil(l, 4))
 				pattern = luaL_checkinteger(l, 4) - 1; // Lua counts from 1
-			SceneGraph::Model *model = ModelCache::FindModel(name);
+			SceneGraph::Model *model = ModelCache::FindModelForInstance(name);
 			LuaObject<ModelSpinner>::PushToLua(new ModelSpinner(c, model, *skin, pattern));
 			return 1;
 		}
@@ -0,0 +1,110 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "DrawList.h"
+
+#include "Material.h"
+#include "RenderState.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Graphics {
+
+	namespace {
+		// bits of each part of the sort key
+		const uint32_t TARGET_BITS = 4;
+		const uint32_t BLEND_BITS = 3;
+		const uint32_t STATE_BITS = 5;
+		const uint32_t PROGRAM_BITS = 10;
+		const uint32_t MATERIAL_BITS = 14;
+		const uint32_t TEXTURE_BITS = 12;
+		const uint32_t DEPTH_BITS = 16;
+
+		// distance along the view direction, the top bits of a positive
+		// float sort the same way as the float
+		uint64_t GetDepth(const matrix4x4f &modelView)
+		{
+			const float distance = std::max(-modelView[14], 0.0f);
+			uint32_t bits;
+			memcpy(&bits, &distance, sizeof(bits));
+			return bits >> (32 - DEPTH_BITS);
+		}
+	} // namespace
+
+	DrawList::DrawList() :
+		m_recording(false),
+		m_changesRecorded(0),
+		m_changesSorted(0)
+	{
+	}
+
+	void DrawList::Begin()
+	{
+		m_recording = true;
+		m_commands.clear();
+		m_order.clear();
+		for (auto &ids : m_ids)
+			ids.clear();
+		m_changesRecorded = 0;
+		m_changesSorted = 0;
+	}
+
+	void DrawList::Add(const matrix4x4f &modelView, const matrix4x4f &projection, RenderTarget *target, RenderState *state,
+		Material *material, VertexBuffer *vertices, IndexBuffer *indices, InstanceBuffer *instances, PrimitiveType primitive)
+	{
+		assert(m_recording);
+		const BlendMode blend = state->GetDesc().blendMode;
+		const uint64_t depth = GetDepth(modelView);
+
+		uint64_t key = GetId(ID_TARGET, target, TARGET_BITS);
+		key = (key << BLEND_BITS) | uint64_t(std::min<uint32_t>(blend, (1U << BLEND_BITS) - 1));
+		key = (key << STATE_BITS) | GetId(ID_STATE, state, STATE_BITS);
+		if (blend != BLEND_SOLID)
+			key = (key << DEPTH_BITS) | (((1U << DEPTH_BITS) - 1) - depth);
+		key = (key << PROGRAM_BITS) | GetId(ID_PROGRAM, material->GetProgramKey(), PROGRAM_BITS);
+		key = (key << MATERIAL_BITS) | GetId(ID_MATERIAL, material, MATERIAL_BITS);
+		key = (key << TEXTURE_BITS) | GetId(ID_TEXTURE, material->texture0, TEXTURE_BITS);
+		if (blend == BLEND_SOLID)
+			key = (key << DEPTH_BITS) | depth;
+
+		m_order.emplace_back(key, uint32_t(m_commands.size()));
+		m_commands.push_back({ key, modelView, projection, target, state, material, vertices, indices, instances, primitive });
+	}
+
+	void DrawList::End()
+	{
+		PROFILE_SCOPED()
+		assert(m_recording);
+		m_recording = false;
+
+		// ties keep the order they were recorded in
+		std::sort(m_order.begin(), m_order.end());
+
+		for (size_t i = 1; i < m_commands.size(); i++) {
+			m_changesRecorded += CountStateChanges(m_commands[i - 1], m_commands[i]);
+			m_changesSorted += CountStateChanges(GetCommand(i - 1), GetCommand(i));
+		}
+	}
+
+	uint64_t DrawList::GetId(IdType type, const void *p, uint32_t bits)
+	{
+		std::unordered_map<const void *, uint32_t> &ids = m_ids[type];
+		const auto it = ids.insert(std::make_pair(p, uint32_t(ids.size()))).first;
+		return std::min<uint32_t>(it->second, (1U << bits) - 1);
+	}
+
+	//static
+	uint32_t DrawList::CountStateChanges(const Command &a, const Command &b)
+	{
+		uint32_t changes = 0;
+		if (a.target != b.target) changes++;
+		if (a.state != b.state) changes++;
+		if (a.material->GetProgramKey() != b.material->GetProgramKey()) changes++;
+		if (a.material != b.material) changes++;
+		if (a.material->texture0 != b.material->texture0) changes++;
+		return changes;
+	}
+
+} // namespace Graphics
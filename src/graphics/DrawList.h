@@ -0,0 +1,92 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GRAPHICS_DRAWLIST_H
+#define _GRAPHICS_DRAWLIST_H
+
+#include "Types.h"
+#include "libs/matrix4x4.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Graphics {
+
+	class IndexBuffer;
+	class InstanceBuffer;
+	class Material;
+	class RenderState;
+	class RenderTarget;
+	class VertexBuffer;
+
+	// Buffer draws recorded rather than submitted right away (see
+	// Renderer::BeginDrawList), so that they can be put in an order that
+	// needs fewer state changes. Each draw gets a sort key of, from the most
+	// significant end: render target, blend mode, render state, then for
+	// solid geometry program, material, texture and depth front to back, and
+	// for blended geometry depth back to front before the rest.
+	class DrawList {
+	public:
+		struct Command {
+			uint64_t key;
+			matrix4x4f modelView;
+			matrix4x4f projection;
+			RenderTarget *target;
+			RenderState *state;
+			Material *material;
+			VertexBuffer *vertices;
+			IndexBuffer *indices; // null for unindexed draws
+			InstanceBuffer *instances; // null unless instanced
+			PrimitiveType primitive;
+		};
+
+		DrawList();
+
+		bool IsRecording() const { return m_recording; }
+
+		// forgets the last list and starts a new one
+		void Begin();
+		void Add(const matrix4x4f &modelView, const matrix4x4f &projection, RenderTarget *target, RenderState *state,
+			Material *material, VertexBuffer *vertices, IndexBuffer *indices, InstanceBuffer *instances, PrimitiveType primitive);
+		// stops recording and sorts the commands
+		void End();
+
+		size_t GetNumCommands() const { return m_commands.size(); }
+		// in the sorted order once the list has ended
+		const Command &GetCommand(size_t i) const { return m_commands[m_order[i].second]; }
+
+		// changes of render target, render state, program, material or texture
+		// between one draw and the next, in the order they were recorded and
+		// in the sorted order
+		uint32_t GetStateChangesRecorded() const { return m_changesRecorded; }
+		uint32_t GetStateChangesSorted() const { return m_changesSorted; }
+
+	private:
+		enum IdType {
+			ID_TARGET,
+			ID_STATE,
+			ID_PROGRAM,
+			ID_MATERIAL,
+			ID_TEXTURE,
+			ID_MAX
+		};
+
+		// small numbers in the order things were first seen, clamped to
+		// what fits into their part of the key
+		uint64_t GetId(IdType type, const void *p, uint32_t bits);
+		static uint32_t CountStateChanges(const Command &a, const Command &b);
+
+		bool m_recording;
+		std::vector<Command> m_commands;
+		// sort key and index of each command
+		std::vector<std::pair<uint64_t, uint32_t>> m_order;
+		std::unordered_map<const void *, uint32_t> m_ids[ID_MAX];
+		uint32_t m_changesRecorded;
+		uint32_t m_changesSorted;
+	};
+
+} // namespace Graphics
+
+#endif
@@ -109,6 +109,19 @@ namespace Graphics {
 		return true;
 	}
 
+	Frustum::Intersection Frustum::TestSphere(const vector3d &p, double radius) const
+	{
+		Intersection result = INSIDE;
+		for (int i = 0; i < 6; i++) {
+			const double d = m_planes[i].DistanceToPoint(p);
+			if (d + radius < 0)
+				return OUTSIDE;
+			if (d - radius < 0)
+				result = INTERSECT;
+		}
+		return result;
+	}
+
 	bool Frustum::ProjectPoint(const vector3d &in, vector3d &out) const
 	{
 		// see the OpenGL documentation
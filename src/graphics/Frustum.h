@@ -17,6 +17,12 @@ namespace Graphics {
 	// the one used for rendering
 	class Frustum {
 	public:
+		enum Intersection {
+			OUTSIDE,
+			INTERSECT,
+			INSIDE
+		};
+
 		Frustum() = delete;
 		// create for specified values
 		Frustum(float width, float height, float fovAng, float nearClip, float farClip);
@@ -26,6 +32,9 @@ namespace Graphics {
 		bool TestPoint(const vector3d &p, double radius) const;
 		// test if point (sphere) is in the frustum, ignoring the far plane
 		bool TestPointInfinite(const vector3d &p, double radius) const;
+		// like TestPoint, but also tells whether the sphere is entirely inside,
+		// so that whatever is within it needs no testing of its own
+		Intersection TestSphere(const vector3d &p, double radius) const;
 
 		// project a point onto the near plane (typically the screen)
 		bool ProjectPoint(const vector3d &in, vector3d &out) const;
@@ -100,6 +100,7 @@ namespace Graphics {
 		}
 
 		Output("Initialized %s\n", renderer->GetName());
+		renderer->SetSortDraws(vs.sortDraws);
 
 		{
 			std::ostringstream buf;
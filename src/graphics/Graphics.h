@@ -31,6 +31,7 @@ namespace Graphics {
 		bool useAnisotropicFiltering;
 		bool enableDebugMessages;
 		bool gl3ForwardCompatible;
+		bool sortDraws; // see Renderer::BeginDrawList
 		int vsync;
 		int requestedSamples;
 		int height;
@@ -102,6 +102,9 @@ namespace Graphics {
 
 		virtual void SetCommonUniforms(const matrix4x4f &mv, const matrix4x4f &proj) = 0;
 
+		// the same for materials that share a shader program, to sort draws by
+		virtual const void *GetProgramKey() const { return nullptr; }
+
 		void *specialParameter0; //this can be whatever. Bit of a hack.
 
 		//XXX may not be necessary. Used by newmodel to check if a material uses patterns
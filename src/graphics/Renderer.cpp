@@ -4,6 +4,7 @@
 #include "Renderer.h"
 
 #include "Texture.h"
+#include "profiler/Profiler.h"
 #include <SDL_video.h>
 #include <SDL_mouse.h>
 
@@ -13,7 +14,8 @@ namespace Graphics {
 		m_width(w),
 		m_height(h),
 		m_ambient(Color::BLACK),
-		m_window(window)
+		m_window(window),
+		m_sortDraws(true)
 	{
 	}
 
@@ -51,6 +53,62 @@ namespace Graphics {
 		m_textures.clear();
 	}
 
+	bool Renderer::BeginDrawList()
+	{
+		if (!m_sortDraws || m_drawList.IsRecording())
+			return false;
+		m_drawList.Begin();
+		return true;
+	}
+
+	void Renderer::FlushDrawList()
+	{
+		PROFILE_SCOPED()
+		if (!m_drawList.IsRecording())
+			return;
+		m_drawList.End();
+		if (m_drawList.GetNumCommands() == 0)
+			return;
+
+		m_stats.AddToStatCount(Stats::STAT_SORTED_DRAWS, m_drawList.GetNumCommands());
+		const uint32_t recorded = m_drawList.GetStateChangesRecorded();
+		const uint32_t sorted = m_drawList.GetStateChangesSorted();
+		m_stats.AddToStatCount(Stats::STAT_STATE_CHANGES_SAVED, recorded > sorted ? recorded - sorted : 0);
+
+		// the commands bring their own transforms and render target
+		const matrix4x4f modelView = GetCurrentModelView();
+		const matrix4x4f projection = GetCurrentProjection();
+		RenderTarget *target = GetRenderTarget();
+		SubmitDrawList(m_drawList);
+		if (GetRenderTarget() != target)
+			SetRenderTarget(target);
+		SetProjection(projection);
+		SetTransform(modelView);
+	}
+
+	void Renderer::SubmitDrawList(const DrawList &list)
+	{
+		RenderTarget *target = GetRenderTarget();
+		for (size_t i = 0; i < list.GetNumCommands(); i++) {
+			const DrawList::Command &cmd = list.GetCommand(i);
+			if (cmd.target != target) {
+				target = cmd.target;
+				SetRenderTarget(target);
+			}
+			SetProjection(cmd.projection);
+			SetTransform(cmd.modelView);
+			if (cmd.instances) {
+				if (cmd.indices)
+					DrawBufferIndexedInstanced(cmd.vertices, cmd.indices, cmd.state, cmd.material, cmd.instances, cmd.primitive);
+				else
+					DrawBufferInstanced(cmd.vertices, cmd.state, cmd.material, cmd.instances, cmd.primitive);
+			} else if (cmd.indices)
+				DrawBufferIndexed(cmd.vertices, cmd.indices, cmd.state, cmd.material, cmd.primitive);
+			else
+				DrawBuffer(cmd.vertices, cmd.state, cmd.material, cmd.primitive);
+		}
+	}
+
 	void Renderer::SetGrab(const bool grabbed)
 	{
 		SDL_SetWindowGrab(m_window, SDL_bool(grabbed));
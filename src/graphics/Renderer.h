@@ -4,6 +4,7 @@
 #ifndef _RENDERER_H
 #define _RENDERER_H
 
+#include "DrawList.h"
 #include "Graphics.h"
 #include "Light.h"
 #include "Stats.h"
@@ -127,6 +128,17 @@ namespace Graphics {
 		virtual bool DrawBufferInstanced(VertexBuffer *, RenderState *, Material *, InstanceBuffer *, PrimitiveType type = TRIANGLES) = 0;
 		virtual bool DrawBufferIndexedInstanced(VertexBuffer *, IndexBuffer *, RenderState *, Material *, InstanceBuffer *, PrimitiveType = TRIANGLES) = 0;
 
+		// between BeginDrawList and FlushDrawList the DrawBuffer* calls are
+		// recorded with the current transforms rather than drawn, and then
+		// sorted to need fewer state changes (see DrawList). Buffers,
+		// materials and render states must stay alive and unchanged until the
+		// flush. false, and draws stay immediate, if sorting is switched off
+		// or a list is already being recorded
+		bool BeginDrawList();
+		void FlushDrawList();
+		bool IsRecordingDrawList() const { return m_drawList.IsRecording(); }
+		void SetSortDraws(bool enabled) { m_sortDraws = enabled; }
+
 		//creates a unique material based on the descriptor. It will not be deleted automatically.
 		virtual Material *CreateMaterial(const MaterialDescriptor &descriptor) = 0;
 		virtual Texture *CreateTexture(const TextureDescriptor &descriptor) = 0;
@@ -216,7 +228,24 @@ namespace Graphics {
 		virtual void PushState() = 0;
 		virtual void PopState() = 0;
 
+		// for the DrawBuffer* implementations, true if the draw was recorded
+		// into the draw list instead of having to be drawn
+		bool RecordDraw(VertexBuffer *vb, IndexBuffer *ib, InstanceBuffer *instb, RenderState *state, Material *mat, PrimitiveType pt)
+		{
+			if (!m_drawList.IsRecording())
+				return false;
+			m_drawList.Add(GetCurrentModelView(), GetCurrentProjection(), GetRenderTarget(), state, mat, vb, ib, instb, pt);
+			return true;
+		}
+		virtual RenderTarget *GetRenderTarget() const { return nullptr; }
+		// draws the commands of an ended list in order. by default through
+		// the DrawBuffer* calls
+		virtual void SubmitDrawList(const DrawList &list);
+
 	private:
+		DrawList m_drawList;
+		bool m_sortDraws;
+
 		typedef std::pair<std::string, std::string> TextureCacheKey;
 		typedef std::map<TextureCacheKey, RefCountedPtr<Texture> *> TextureCacheMap;
 		TextureCacheMap m_textures;
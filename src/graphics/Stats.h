@@ -21,6 +21,12 @@ namespace Graphics {
 			// buffers
 			STAT_CREATE_BUFFER,
 			STAT_DESTROY_BUFFER,
+			STAT_ORPHAN_BUFFER,
+			STAT_STREAMED_BYTES,
+
+			// draw lists
+			STAT_SORTED_DRAWS,
+			STAT_STATE_CHANGES_SAVED,
 
 			// objects
 			STAT_BUILDINGS,
@@ -62,10 +62,27 @@ namespace Graphics {
 		virtual bool DrawTriangles(const VertexArray *vertices, RenderState *state, Material *material, PrimitiveType type = TRIANGLES) override final { return true; }
 		virtual bool DrawPointSprites(const uint32_t count, const vector3f *positions, RenderState *rs, Material *material, float size) override final { return true; }
 		virtual bool DrawPointSprites(const uint32_t count, const vector3f *positions, const vector2f *offsets, const float *sizes, RenderState *rs, Material *material) override final { return true; }
-		virtual bool DrawBuffer(VertexBuffer *, RenderState *, Material *, PrimitiveType) override final { return true; }
-		virtual bool DrawBufferIndexed(VertexBuffer *, IndexBuffer *, RenderState *, Material *, PrimitiveType) override final { return true; }
-		virtual bool DrawBufferInstanced(VertexBuffer *, RenderState *, Material *, InstanceBuffer *, PrimitiveType type = TRIANGLES) override final { return true; }
-		virtual bool DrawBufferIndexedInstanced(VertexBuffer *, IndexBuffer *, RenderState *, Material *, InstanceBuffer *, PrimitiveType = TRIANGLES) override final { return true; }
+		// draws are recorded into draw lists so that their sorting works headless
+		virtual bool DrawBuffer(VertexBuffer *vb, RenderState *rs, Material *m, PrimitiveType pt) override final
+		{
+			RecordDraw(vb, nullptr, nullptr, rs, m, pt);
+			return true;
+		}
+		virtual bool DrawBufferIndexed(VertexBuffer *vb, IndexBuffer *ib, RenderState *rs, Material *m, PrimitiveType pt) override final
+		{
+			RecordDraw(vb, ib, nullptr, rs, m, pt);
+			return true;
+		}
+		virtual bool DrawBufferInstanced(VertexBuffer *vb, RenderState *rs, Material *m, InstanceBuffer *instb, PrimitiveType pt = TRIANGLES) override final
+		{
+			RecordDraw(vb, nullptr, instb, rs, m, pt);
+			return true;
+		}
+		virtual bool DrawBufferIndexedInstanced(VertexBuffer *vb, IndexBuffer *ib, RenderState *rs, Material *m, InstanceBuffer *instb, PrimitiveType pt = TRIANGLES) override final
+		{
+			RecordDraw(vb, ib, instb, rs, m, pt);
+			return true;
+		}
 
 		virtual Material *CreateMaterial(const MaterialDescriptor &d) override final { return new Graphics::Dummy::Material(); }
 		virtual Texture *CreateTexture(const TextureDescriptor &d) override final { return new Graphics::TextureDummy(d); }
@@ -37,6 +37,7 @@ namespace Graphics {
 			virtual bool IsProgramLoaded() const override final;
 			virtual void SetProgram(Program *p) { m_program = p; }
 			virtual void SetCommonUniforms(const matrix4x4f &mv, const matrix4x4f &proj) override;
+			virtual const void *GetProgramKey() const override final { return m_program; }
 
 		protected:
 			friend class Graphics::RendererOGL;
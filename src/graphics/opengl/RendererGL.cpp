@@ -141,7 +141,6 @@ namespace Graphics {
 
 	// static member instantiations
 	bool RendererOGL::initted = false;
-	RendererOGL::AttribBufferMap RendererOGL::s_AttribBufferMap;
 
 	// typedefs
 	typedef std::vector<std::pair<MaterialDescriptor, OGL::Program *>>::const_iterator ProgramIterator;
@@ -250,6 +249,7 @@ namespace Graphics {
 		//while (!m_programs.empty()) delete m_programs.back().second, m_programs.pop_back();
 		for (auto state : m_renderStates)
 			delete state.second;
+		m_streamBuffers.clear();
 
 		SDL_GL_DeleteContext(m_glContext);
 	}
@@ -479,6 +479,9 @@ namespace Graphics {
 		PROFILE_SCOPED()
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 
+		for (auto &stream : m_streamBuffers)
+			stream.second->EndFrame();
+
 		SDL_GL_SwapWindow(m_window);
 		m_stats.NextFrame();
 		return true;
@@ -663,63 +666,74 @@ namespace Graphics {
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 	}
 
-	bool RendererOGL::DrawTriangles(const VertexArray *v, RenderState *rs, Material *m, PrimitiveType t)
+	OGL::StreamBuffer *RendererOGL::GetStreamBuffer(AttributeSet attribs)
 	{
-		PROFILE_SCOPED()
-		if (!v || v->position.size() < 3) return false;
-
-		const AttributeSet attribs = v->GetAttributeSet();
-		RefCountedPtr<VertexBuffer> drawVB;
-
-		// see if we have a buffer to re-use
-		AttribBufferIter iter = s_AttribBufferMap.find(std::make_pair(attribs, v->position.size()));
-		if (iter == s_AttribBufferMap.end()) {
-			// not found a buffer so create a new one
-			VertexBufferDesc vbd;
-			uint32_t attribIdx = 0;
-			assert(v->HasAttrib(ATTRIB_POSITION));
-			vbd.attrib[attribIdx].semantic = ATTRIB_POSITION;
+		auto iter = m_streamBuffers.find(attribs);
+		if (iter != m_streamBuffers.end())
+			return iter->second.get();
+
+		VertexBufferDesc vbd;
+		uint32_t attribIdx = 0;
+		assert(attribs & ATTRIB_POSITION);
+		vbd.attrib[attribIdx].semantic = ATTRIB_POSITION;
+		vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT3;
+		++attribIdx;
+
+		if (attribs & ATTRIB_NORMAL) {
+			vbd.attrib[attribIdx].semantic = ATTRIB_NORMAL;
+			vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT3;
+			++attribIdx;
+		}
+		if (attribs & ATTRIB_DIFFUSE) {
+			vbd.attrib[attribIdx].semantic = ATTRIB_DIFFUSE;
+			vbd.attrib[attribIdx].format = ATTRIB_FORMAT_UBYTE4;
+			++attribIdx;
+		}
+		if (attribs & ATTRIB_UV0) {
+			vbd.attrib[attribIdx].semantic = ATTRIB_UV0;
+			vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT2;
+			++attribIdx;
+		}
+		if (attribs & ATTRIB_TANGENT) {
+			vbd.attrib[attribIdx].semantic = ATTRIB_TANGENT;
 			vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT3;
 			++attribIdx;
+		}
 
-			if (v->HasAttrib(ATTRIB_NORMAL)) {
-				vbd.attrib[attribIdx].semantic = ATTRIB_NORMAL;
-				vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT3;
-				++attribIdx;
-			}
-			if (v->HasAttrib(ATTRIB_DIFFUSE)) {
-				vbd.attrib[attribIdx].semantic = ATTRIB_DIFFUSE;
-				vbd.attrib[attribIdx].format = ATTRIB_FORMAT_UBYTE4;
-				++attribIdx;
-			}
-			if (v->HasAttrib(ATTRIB_UV0)) {
-				vbd.attrib[attribIdx].semantic = ATTRIB_UV0;
-				vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT2;
-				++attribIdx;
-			}
-			if (v->HasAttrib(ATTRIB_TANGENT)) {
-				vbd.attrib[attribIdx].semantic = ATTRIB_TANGENT;
-				vbd.attrib[attribIdx].format = ATTRIB_FORMAT_FLOAT3;
-				++attribIdx;
-			}
-			vbd.numVertices = static_cast<uint32_t>(v->position.size());
-			vbd.usage = BUFFER_USAGE_DYNAMIC; // dynamic since we'll be reusing these buffers if possible
+		OGL::StreamBuffer *stream = new OGL::StreamBuffer(vbd, m_stats);
+		m_streamBuffers[attribs].reset(stream);
+		return stream;
+	}
 
-			// VertexBuffer
-			RefCountedPtr<VertexBuffer> vb;
-			vb.Reset(CreateVertexBuffer(vbd));
-			vb->Populate(*v);
+	bool RendererOGL::DrawStream(OGL::StreamBuffer *stream, uint32_t firstVertex, uint32_t numVertices, RenderState *state, Material *mat, PrimitiveType pt)
+	{
+		PROFILE_SCOPED()
+		SetRenderState(state);
+		mat->Apply();
 
-			// add to map
-			s_AttribBufferMap[std::make_pair(attribs, v->position.size())] = vb;
-			drawVB = vb;
-		} else {
-			// got a buffer so use it and fill it with newest data
-			drawVB = iter->second;
-			drawVB->Populate(*v);
-		}
+		SetMaterialShaderTransforms(mat);
 
-		const bool res = DrawBuffer(drawVB.Get(), rs, m, t);
+		stream->Bind();
+		glDrawArrays(pt, firstVertex, numVertices);
+		stream->Release();
+		CheckRenderErrors(__FUNCTION__, __LINE__);
+
+		m_stats.AddToStatCount(Stats::STAT_DRAWCALL, 1);
+
+		return true;
+	}
+
+	bool RendererOGL::DrawTriangles(const VertexArray *v, RenderState *rs, Material *m, PrimitiveType t)
+	{
+		PROFILE_SCOPED()
+		if (!v || v->position.size() < 3) return false;
+
+		// written to the next free range of the buffer for its layout
+		OGL::StreamBuffer *stream = GetStreamBuffer(v->GetAttributeSet());
+		uint32_t firstVertex;
+		stream->Populate(*v, firstVertex);
+
+		const bool res = DrawStream(stream, firstVertex, v->GetNumVerts(), rs, m, t);
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 
 		m_stats.AddToStatCount(Stats::STAT_DRAWTRIS, 1);
@@ -742,40 +756,19 @@ namespace Graphics {
 		};
 #pragma pack(pop)
 
-		RefCountedPtr<VertexBuffer> drawVB;
-		AttribBufferIter iter = s_AttribBufferMap.find(std::make_pair(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL, count));
-		if (iter == s_AttribBufferMap.end()) {
-			// NB - we're (ab)using the normal type to hold (uv coordinate offset value + point size)
-			Graphics::VertexBufferDesc vbd;
-			vbd.attrib[0].semantic = Graphics::ATTRIB_POSITION;
-			vbd.attrib[0].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			vbd.attrib[1].semantic = Graphics::ATTRIB_NORMAL;
-			vbd.attrib[1].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			vbd.numVertices = count;
-			vbd.usage = Graphics::BUFFER_USAGE_DYNAMIC; // we could be updating this per-frame
-
-			// VertexBuffer
-			RefCountedPtr<VertexBuffer> vb;
-			vb.Reset(CreateVertexBuffer(vbd));
-
-			// add to map
-			s_AttribBufferMap[std::make_pair(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL, count)] = vb;
-			drawVB = vb;
-		} else {
-			drawVB = iter->second;
-		}
-
-		// got a buffer so use it and fill it with newest data
-		PosNormVert *vtxPtr = drawVB->Map<PosNormVert>(Graphics::BUFFER_MAP_WRITE);
-		assert(drawVB->GetDesc().stride == sizeof(PosNormVert));
+		// NB - we're (ab)using the normal type to hold (uv coordinate offset value + point size)
+		OGL::StreamBuffer *stream = GetStreamBuffer(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL);
+		assert(stream->GetDesc().stride == sizeof(PosNormVert));
+		uint32_t firstVertex;
+		PosNormVert *vtxPtr = reinterpret_cast<PosNormVert *>(stream->Map(count, firstVertex));
 		for (uint32_t i = 0; i < count; i++) {
 			vtxPtr[i].pos = positions[i];
 			vtxPtr[i].norm = vector3f(0.0f, 0.0f, size);
 		}
-		drawVB->Unmap();
+		stream->Unmap();
 
 		SetTransform(matrix4x4f::Identity());
-		DrawBuffer(drawVB.Get(), rs, material, Graphics::POINTS);
+		DrawStream(stream, firstVertex, count, rs, material, Graphics::POINTS);
 		GetStats().AddToStatCount(Graphics::Stats::STAT_DRAWPOINTSPRITES, 1);
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 
@@ -795,40 +788,19 @@ namespace Graphics {
 		};
 #pragma pack(pop)
 
-		RefCountedPtr<VertexBuffer> drawVB;
-		AttribBufferIter iter = s_AttribBufferMap.find(std::make_pair(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL, count));
-		if (iter == s_AttribBufferMap.end()) {
-			// NB - we're (ab)using the normal type to hold (uv coordinate offset value + point size)
-			Graphics::VertexBufferDesc vbd;
-			vbd.attrib[0].semantic = Graphics::ATTRIB_POSITION;
-			vbd.attrib[0].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			vbd.attrib[1].semantic = Graphics::ATTRIB_NORMAL;
-			vbd.attrib[1].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			vbd.numVertices = count;
-			vbd.usage = Graphics::BUFFER_USAGE_DYNAMIC; // we could be updating this per-frame
-
-			// VertexBuffer
-			RefCountedPtr<VertexBuffer> vb;
-			vb.Reset(CreateVertexBuffer(vbd));
-
-			// add to map
-			s_AttribBufferMap[std::make_pair(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL, count)] = vb;
-			drawVB = vb;
-		} else {
-			drawVB = iter->second;
-		}
-
-		// got a buffer so use it and fill it with newest data
-		PosNormVert *vtxPtr = drawVB->Map<PosNormVert>(Graphics::BUFFER_MAP_WRITE);
-		assert(drawVB->GetDesc().stride == sizeof(PosNormVert));
+		// NB - we're (ab)using the normal type to hold (uv coordinate offset value + point size)
+		OGL::StreamBuffer *stream = GetStreamBuffer(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL);
+		assert(stream->GetDesc().stride == sizeof(PosNormVert));
+		uint32_t firstVertex;
+		PosNormVert *vtxPtr = reinterpret_cast<PosNormVert *>(stream->Map(count, firstVertex));
 		for (uint32_t i = 0; i < count; i++) {
 			vtxPtr[i].pos = positions[i];
 			vtxPtr[i].norm = vector3f(offsets[i], Clamp(sizes[i], 0.1f, FLT_MAX));
 		}
-		drawVB->Unmap();
+		stream->Unmap();
 
 		SetTransform(matrix4x4f::Identity());
-		DrawBuffer(drawVB.Get(), rs, material, Graphics::POINTS);
+		DrawStream(stream, firstVertex, count, rs, material, Graphics::POINTS);
 		GetStats().AddToStatCount(Graphics::Stats::STAT_DRAWPOINTSPRITES, 1);
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 
@@ -838,6 +810,9 @@ namespace Graphics {
 	bool RendererOGL::DrawBuffer(VertexBuffer *vb, RenderState *state, Material *mat, PrimitiveType pt)
 	{
 		PROFILE_SCOPED()
+		if (RecordDraw(vb, nullptr, nullptr, state, mat, pt))
+			return true;
+
 		SetRenderState(state);
 		mat->Apply();
 
@@ -856,6 +831,9 @@ namespace Graphics {
 	bool RendererOGL::DrawBufferIndexed(VertexBuffer *vb, IndexBuffer *ib, RenderState *state, Material *mat, PrimitiveType pt)
 	{
 		PROFILE_SCOPED()
+		if (RecordDraw(vb, ib, nullptr, state, mat, pt))
+			return true;
+
 		SetRenderState(state);
 		mat->Apply();
 
@@ -876,6 +854,9 @@ namespace Graphics {
 	bool RendererOGL::DrawBufferInstanced(VertexBuffer *vb, RenderState *state, Material *mat, InstanceBuffer *instb, PrimitiveType pt)
 	{
 		PROFILE_SCOPED()
+		if (RecordDraw(vb, nullptr, instb, state, mat, pt))
+			return true;
+
 		SetRenderState(state);
 		mat->Apply();
 
@@ -896,6 +877,9 @@ namespace Graphics {
 	bool RendererOGL::DrawBufferIndexedInstanced(VertexBuffer *vb, IndexBuffer *ib, RenderState *state, Material *mat, InstanceBuffer *instb, PrimitiveType pt)
 	{
 		PROFILE_SCOPED()
+		if (RecordDraw(vb, ib, instb, state, mat, pt))
+			return true;
+
 		SetRenderState(state);
 		mat->Apply();
 
@@ -915,6 +899,55 @@ namespace Graphics {
 		return true;
 	}
 
+	RenderTarget *RendererOGL::GetRenderTarget() const
+	{
+		return m_activeRenderTarget;
+	}
+
+	void RendererOGL::SubmitDrawList(const DrawList &list)
+	{
+		PROFILE_SCOPED()
+		// a material applied for the previous draw is still good, only the
+		// transforms need setting
+		Material *applied = nullptr;
+		for (size_t i = 0; i < list.GetNumCommands(); i++) {
+			const DrawList::Command &cmd = list.GetCommand(i);
+			if (cmd.target != m_activeRenderTarget) {
+				SetRenderTarget(cmd.target);
+				applied = nullptr;
+			}
+			SetRenderState(cmd.state);
+			if (cmd.material != applied) {
+				cmd.material->Apply();
+				applied = cmd.material;
+			}
+			m_modelViewStack.top() = cmd.modelView;
+			m_projectionStack.top() = cmd.projection;
+			SetMaterialShaderTransforms(cmd.material);
+
+			cmd.vertices->Bind();
+			if (cmd.indices)
+				cmd.indices->Bind();
+			if (cmd.instances) {
+				cmd.instances->Bind();
+				if (cmd.indices)
+					glDrawElementsInstanced(cmd.primitive, cmd.indices->GetIndexCount(), GL_UNSIGNED_INT, 0, cmd.instances->GetInstanceCount());
+				else
+					glDrawArraysInstanced(cmd.primitive, 0, cmd.vertices->GetSize(), cmd.instances->GetInstanceCount());
+				cmd.instances->Release();
+			} else if (cmd.indices)
+				glDrawElements(cmd.primitive, cmd.indices->GetIndexCount(), GL_UNSIGNED_INT, 0);
+			else
+				glDrawArrays(cmd.primitive, 0, cmd.vertices->GetSize());
+			if (cmd.indices)
+				cmd.indices->Release();
+			cmd.vertices->Release();
+			CheckRenderErrors(__FUNCTION__, __LINE__);
+
+			m_stats.AddToStatCount(Stats::STAT_DRAWCALL, 1);
+		}
+	}
+
 	Material *RendererOGL::CreateMaterial(const MaterialDescriptor &d)
 	{
 		PROFILE_SCOPED()
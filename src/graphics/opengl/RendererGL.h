@@ -15,6 +15,8 @@
  */
 #include "OpenGLLibs.h"
 #include "graphics/Renderer.h"
+#include <map>
+#include <memory>
 #include <stack>
 #include <unordered_map>
 #include <SDL_video.h>
@@ -39,6 +41,7 @@ namespace Graphics {
 		class RingMaterial;
 		class FresnelColourMaterial;
 		class ShieldMaterial;
+		class StreamBuffer;
 		class UIMaterial;
 		class BillboardMaterial;
 	} // namespace OGL
@@ -134,6 +137,8 @@ namespace Graphics {
 	protected:
 		virtual void PushState() override final;
 		virtual void PopState() override final;
+		virtual RenderTarget *GetRenderTarget() const override final;
+		virtual void SubmitDrawList(const DrawList &list) override final;
 
 		uint32_t m_numLights;
 		uint32_t m_numDirLights;
@@ -184,9 +189,11 @@ namespace Graphics {
 	private:
 		static bool initted;
 
-		typedef std::map<std::pair<AttributeSet, size_t>, RefCountedPtr<VertexBuffer>> AttribBufferMap;
-		typedef AttribBufferMap::iterator AttribBufferIter;
-		static AttribBufferMap s_AttribBufferMap;
+		OGL::StreamBuffer *GetStreamBuffer(AttributeSet attribs);
+		bool DrawStream(OGL::StreamBuffer *stream, uint32_t firstVertex, uint32_t numVertices, RenderState *, Material *, PrimitiveType);
+
+		// for the immediate mode draws, by vertex layout
+		std::map<AttributeSet, std::unique_ptr<OGL::StreamBuffer>> m_streamBuffers;
 
 		SDL_GLContext m_glContext;
 	};
@@ -2,9 +2,12 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "graphics/opengl/VertexBufferGL.h"
+#include "graphics/Stats.h"
 #include "graphics/VertexArray.h"
 #include "libs/utils.h"
 
+#include <algorithm>
+
 namespace Graphics {
 	namespace OGL {
 
@@ -37,47 +40,34 @@ namespace Graphics {
 			}
 		}
 
-		VertexBuffer::VertexBuffer(const VertexBufferDesc &desc) :
-			Graphics::VertexBuffer(desc)
+		// fills in the offsets and stride left at zero
+		static void CompleteDesc(VertexBufferDesc &desc)
 		{
-			PROFILE_SCOPED()
 			//update offsets in desc
 			for (uint32_t i = 0; i < MAX_ATTRIBS; i++) {
-				if (m_desc.attrib[i].offset == 0)
-					m_desc.attrib[i].offset = VertexBufferDesc::CalculateOffset(m_desc, m_desc.attrib[i].semantic);
+				if (desc.attrib[i].offset == 0)
+					desc.attrib[i].offset = VertexBufferDesc::CalculateOffset(desc, desc.attrib[i].semantic);
 			}
 
 			//update stride in desc (respecting offsets)
-			if (m_desc.stride == 0) {
+			if (desc.stride == 0) {
 				uint32_t lastAttrib = 0;
 				while (lastAttrib < MAX_ATTRIBS) {
-					if (m_desc.attrib[lastAttrib].semantic == ATTRIB_NONE)
+					if (desc.attrib[lastAttrib].semantic == ATTRIB_NONE)
 						break;
 					lastAttrib++;
 				}
 
-				m_desc.stride = m_desc.attrib[lastAttrib].offset + VertexBufferDesc::GetAttribSize(m_desc.attrib[lastAttrib].format);
+				desc.stride = desc.attrib[lastAttrib].offset + VertexBufferDesc::GetAttribSize(desc.attrib[lastAttrib].format);
 			}
-			assert(m_desc.stride > 0);
-			assert(m_desc.numVertices > 0);
-
-			//SetVertexCount(m_desc.numVertices);
-
-			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
-
-			glGenBuffers(1, &m_buffer);
-
-			//Allocate GL buffer with undefined contents
-			//Critical optimisation for some architectures in cases where buffer is created and written in the same frame
-			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-			const uint32_t dataSize = m_desc.numVertices * m_desc.stride;
-			const GLenum usage = (m_desc.usage == BUFFER_USAGE_STATIC) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
-			glBufferData(GL_ARRAY_BUFFER, dataSize, 0, usage);
+			assert(desc.stride > 0);
+		}
 
-			//Setup the VAO pointers
+		// for the VAO and GL_ARRAY_BUFFER that are bound
+		static void SetupAttribPointers(const VertexBufferDesc &desc)
+		{
 			for (uint8_t i = 0; i < MAX_ATTRIBS; i++) {
-				const auto &attr = m_desc.attrib[i];
+				const auto &attr = desc.attrib[i];
 				if (attr.semantic == ATTRIB_NONE)
 					break;
 
@@ -86,29 +76,54 @@ namespace Graphics {
 				switch (attr.semantic) {
 				case ATTRIB_POSITION:
 					glEnableVertexAttribArray(0); // Enable the attribute at that location
-					glVertexAttribPointer(0, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, m_desc.stride, offset);
+					glVertexAttribPointer(0, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, desc.stride, offset);
 					break;
 				case ATTRIB_NORMAL:
 					glEnableVertexAttribArray(1); // Enable the attribute at that location
-					glVertexAttribPointer(1, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, m_desc.stride, offset);
+					glVertexAttribPointer(1, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, desc.stride, offset);
 					break;
 				case ATTRIB_DIFFUSE:
 					glEnableVertexAttribArray(2); // Enable the attribute at that location
-					glVertexAttribPointer(2, get_num_components(attr.format), get_component_type(attr.format), GL_TRUE, m_desc.stride, offset); // only normalise the colours
+					glVertexAttribPointer(2, get_num_components(attr.format), get_component_type(attr.format), GL_TRUE, desc.stride, offset); // only normalise the colours
 					break;
 				case ATTRIB_UV0:
 					glEnableVertexAttribArray(3); // Enable the attribute at that location
-					glVertexAttribPointer(3, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, m_desc.stride, offset);
+					glVertexAttribPointer(3, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, desc.stride, offset);
 					break;
 				case ATTRIB_TANGENT:
 					glEnableVertexAttribArray(4); // Enable the attribute at that location
-					glVertexAttribPointer(4, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, m_desc.stride, offset);
+					glVertexAttribPointer(4, get_num_components(attr.format), get_component_type(attr.format), GL_FALSE, desc.stride, offset);
 					break;
 				case ATTRIB_NONE:
 				default:
 					break;
 				}
 			}
+		}
+
+		VertexBuffer::VertexBuffer(const VertexBufferDesc &desc) :
+			Graphics::VertexBuffer(desc)
+		{
+			PROFILE_SCOPED()
+			CompleteDesc(m_desc);
+			assert(m_desc.numVertices > 0);
+
+			//SetVertexCount(m_desc.numVertices);
+
+			glGenVertexArrays(1, &m_vao);
+			glBindVertexArray(m_vao);
+
+			glGenBuffers(1, &m_buffer);
+
+			//Allocate GL buffer with undefined contents
+			//Critical optimisation for some architectures in cases where buffer is created and written in the same frame
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			const uint32_t dataSize = m_desc.numVertices * m_desc.stride;
+			const GLenum usage = (m_desc.usage == BUFFER_USAGE_STATIC) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+			glBufferData(GL_ARRAY_BUFFER, dataSize, 0, usage);
+
+			//Setup the VAO pointers
+			SetupAttribPointers(m_desc);
 
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 			glBindVertexArray(0);
@@ -208,123 +223,126 @@ namespace Graphics {
 		};
 #pragma pack(pop)
 
-		static inline void CopyPosNorm(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPosNorm(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosNormVert *vtxPtr = vb->Map<PosNormVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosNormVert));
+			PosNormVert *vtxPtr = reinterpret_cast<PosNormVert *>(data);
+			assert(stride == sizeof(PosNormVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 				vtxPtr[i].norm = va.normal[i];
 			}
-			vb->Unmap();
 		}
 
-		static inline void CopyPosUV0(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPosUV0(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosUVVert *vtxPtr = vb->Map<PosUVVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosUVVert));
+			PosUVVert *vtxPtr = reinterpret_cast<PosUVVert *>(data);
+			assert(stride == sizeof(PosUVVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 				vtxPtr[i].uv = va.uv0[i];
 			}
-			vb->Unmap();
 		}
 
-		static inline void CopyPosCol(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPosCol(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosColVert *vtxPtr = vb->Map<PosColVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosColVert));
+			PosColVert *vtxPtr = reinterpret_cast<PosColVert *>(data);
+			assert(stride == sizeof(PosColVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 				vtxPtr[i].col = va.diffuse[i];
 			}
-			vb->Unmap();
 		}
 
-		static inline void CopyPos(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPos(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosVert *vtxPtr = vb->Map<PosVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosVert));
+			PosVert *vtxPtr = reinterpret_cast<PosVert *>(data);
+			assert(stride == sizeof(PosVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 			}
-			vb->Unmap();
 		}
 
-		static inline void CopyPosColUV0(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPosColUV0(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosColUVVert *vtxPtr = vb->Map<PosColUVVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosColUVVert));
+			PosColUVVert *vtxPtr = reinterpret_cast<PosColUVVert *>(data);
+			assert(stride == sizeof(PosColUVVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 				vtxPtr[i].col = va.diffuse[i];
 				vtxPtr[i].uv = va.uv0[i];
 			}
-			vb->Unmap();
 		}
 
-		static inline void CopyPosNormUV0(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPosNormUV0(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosNormUVVert *vtxPtr = vb->Map<PosNormUVVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosNormUVVert));
+			PosNormUVVert *vtxPtr = reinterpret_cast<PosNormUVVert *>(data);
+			assert(stride == sizeof(PosNormUVVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 				vtxPtr[i].norm = va.normal[i];
 				vtxPtr[i].uv = va.uv0[i];
 			}
-			vb->Unmap();
 		}
 
-		static inline void CopyPosNormCol(Graphics::VertexBuffer *vb, const Graphics::VertexArray &va)
+		static inline void CopyPosNormCol(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PosNormColVert *vtxPtr = vb->Map<PosNormColVert>(Graphics::BUFFER_MAP_WRITE);
-			assert(vb->GetDesc().stride == sizeof(PosNormColVert));
+			PosNormColVert *vtxPtr = reinterpret_cast<PosNormColVert *>(data);
+			assert(stride == sizeof(PosNormColVert));
 			for (uint32_t i = 0; i < va.GetNumVerts(); i++) {
 				vtxPtr[i].pos = va.position[i];
 				vtxPtr[i].norm = va.normal[i];
 				vtxPtr[i].col = va.diffuse[i];
 			}
-			vb->Unmap();
 		}
 
-		// copies the contents of the VertexArray into the buffer
-		bool VertexBuffer::Populate(const VertexArray &va)
+		// writes the VertexArray as vertices of the given stride, false if
+		// there is no layout for its attributes
+		static bool CopyVertexArray(uint8_t *data, uint32_t stride, const Graphics::VertexArray &va)
 		{
-			PROFILE_SCOPED()
-			assert(va.GetNumVerts() > 0);
-			assert(va.GetNumVerts() <= m_capacity);
 			bool result = false;
 			const Graphics::AttributeSet as = va.GetAttributeSet();
 			switch (as) {
 			case Graphics::ATTRIB_POSITION:
-				CopyPos(this, va);
+				CopyPos(data, stride, va);
 				result = true;
 				break;
 			case Graphics::ATTRIB_POSITION | Graphics::ATTRIB_DIFFUSE:
-				CopyPosCol(this, va);
+				CopyPosCol(data, stride, va);
 				result = true;
 				break;
 			case Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL:
-				CopyPosNorm(this, va);
+				CopyPosNorm(data, stride, va);
 				result = true;
 				break;
 			case Graphics::ATTRIB_POSITION | Graphics::ATTRIB_UV0:
-				CopyPosUV0(this, va);
+				CopyPosUV0(data, stride, va);
 				result = true;
 				break;
 			case Graphics::ATTRIB_POSITION | Graphics::ATTRIB_DIFFUSE | Graphics::ATTRIB_UV0:
-				CopyPosColUV0(this, va);
+				CopyPosColUV0(data, stride, va);
 				result = true;
 				break;
 			case Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL | Graphics::ATTRIB_UV0:
-				CopyPosNormUV0(this, va);
+				CopyPosNormUV0(data, stride, va);
 				result = true;
 				break;
 			case Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL | Graphics::ATTRIB_DIFFUSE:
-				CopyPosNormCol(this, va);
+				CopyPosNormCol(data, stride, va);
 				result = true;
 				break;
 			}
+			return result;
+		}
+
+		// copies the contents of the VertexArray into the buffer
+		bool VertexBuffer::Populate(const VertexArray &va)
+		{
+			PROFILE_SCOPED()
+			assert(va.GetNumVerts() > 0);
+			assert(va.GetNumVerts() <= m_capacity);
+			uint8_t *data = Map<uint8_t>(Graphics::BUFFER_MAP_WRITE);
+			const bool result = CopyVertexArray(data, m_desc.stride, va);
+			Unmap();
 			SetVertexCount(va.GetNumVerts());
 			return result;
 		}
@@ -381,6 +399,176 @@ namespace Graphics {
 			glBindVertexArray(0);
 		}
 
+		// ------------------------------------------------------------
+		StreamBuffer::StreamBuffer(const VertexBufferDesc &desc, Stats &stats) :
+			m_desc(desc),
+			m_stats(stats),
+			m_buffer(0),
+			m_vao(0),
+			m_useFences(GLEW_VERSION_3_2 || GLEW_ARB_sync),
+			m_capacity(0),
+			m_head(0),
+			m_position(0),
+			m_fenced(0),
+			m_completed(0)
+		{
+			PROFILE_SCOPED()
+			for (uint32_t i = 0; i < MAX_ATTRIBS; i++)
+				m_desc.attrib[i].offset = 0;
+			m_desc.stride = 0;
+			CompleteDesc(m_desc);
+			m_desc.usage = BUFFER_USAGE_DYNAMIC;
+
+			glGenVertexArrays(1, &m_vao);
+			glBindVertexArray(m_vao);
+			glGenBuffers(1, &m_buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			SetupAttribPointers(m_desc);
+			glBindVertexArray(0);
+
+			Allocate(INITIAL_CAPACITY);
+		}
+
+		StreamBuffer::~StreamBuffer()
+		{
+			ClearFences();
+			glDeleteBuffers(1, &m_buffer);
+			glDeleteVertexArrays(1, &m_vao);
+		}
+
+		uint8_t *StreamBuffer::Map(uint32_t numVertices, uint32_t &firstVertex)
+		{
+			PROFILE_SCOPED()
+			assert(numVertices > 0);
+			const uint32_t stride = m_desc.stride;
+			const uint32_t size = numVertices * stride;
+			if (size > m_capacity)
+				Allocate(std::max(size, std::min(m_capacity * 2, MAX_CAPACITY)));
+
+			// vertices start on a multiple of the stride so they can be drawn
+			// from a first vertex
+			uint32_t start = ((m_head + stride - 1) / stride) * stride;
+			uint64_t position = m_position + (start - m_head);
+			if (uint64_t(start) + size > m_capacity) {
+				position = m_position + (m_capacity - m_head);
+				start = 0;
+			}
+
+			// the range was last written a lap ago, the draws reading it have
+			// to be done
+			if (position + size > m_capacity && !WaitFor(position + size - m_capacity)) {
+				// a frame needs more than the whole ring, so grow it
+				const bool grow = m_useFences && position + size - m_capacity > m_fenced;
+				Allocate(grow ? std::max(size, std::min(m_capacity * 2, MAX_CAPACITY)) : m_capacity);
+				start = 0;
+				position = 0;
+			}
+			m_head = start + size;
+			m_position = position + size;
+			firstVertex = start / stride;
+
+			m_stats.AddToStatCount(Stats::STAT_STREAMED_BYTES, size);
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			return reinterpret_cast<uint8_t *>(glMapBufferRange(GL_ARRAY_BUFFER, start, size,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		}
+
+		void StreamBuffer::Unmap()
+		{
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		bool StreamBuffer::Populate(const VertexArray &va, uint32_t &firstVertex)
+		{
+			PROFILE_SCOPED()
+			assert(va.GetNumVerts() > 0);
+			uint8_t *data = Map(va.GetNumVerts(), firstVertex);
+			const bool result = CopyVertexArray(data, m_desc.stride, va);
+			Unmap();
+			return result;
+		}
+
+		void StreamBuffer::Bind()
+		{
+			glBindVertexArray(m_vao);
+		}
+
+		void StreamBuffer::Release()
+		{
+			glBindVertexArray(0);
+		}
+
+		void StreamBuffer::EndFrame()
+		{
+			if (!m_useFences)
+				return;
+
+			// forget the fences already passed, without waiting
+			while (!m_fences.empty()) {
+				const GLenum state = glClientWaitSync(m_fences.front().sync, 0, 0);
+				if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+					break;
+				m_completed = m_fences.front().position;
+				glDeleteSync(m_fences.front().sync);
+				m_fences.pop_front();
+			}
+
+			if (m_position != m_fenced) {
+				m_fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_position });
+				m_fenced = m_position;
+			}
+		}
+
+		void StreamBuffer::Allocate(uint32_t capacity)
+		{
+			PROFILE_SCOPED()
+			ClearFences();
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			m_stats.AddToStatCount(capacity == m_capacity ? Stats::STAT_ORPHAN_BUFFER : Stats::STAT_CREATE_BUFFER, 1);
+			m_capacity = capacity;
+			m_head = 0;
+			m_position = 0;
+			m_fenced = 0;
+			m_completed = 0;
+		}
+
+		bool StreamBuffer::WaitFor(uint64_t position)
+		{
+			if (position <= m_completed)
+				return true;
+
+			// the oldest fence at or after position, it covers all of the
+			// draws before it
+			while (!m_fences.empty() && m_fences.front().position < position) {
+				glDeleteSync(m_fences.front().sync);
+				m_fences.pop_front();
+			}
+			if (m_fences.empty())
+				return false;
+
+			PROFILE_SCOPED()
+			const Fence fence = m_fences.front();
+			m_fences.pop_front();
+			GLenum state = glClientWaitSync(fence.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+			while (state == GL_TIMEOUT_EXPIRED)
+				state = glClientWaitSync(fence.sync, 0, 1000000000ULL);
+			glDeleteSync(fence.sync);
+			if (state == GL_WAIT_FAILED)
+				return false;
+			m_completed = fence.position;
+			return true;
+		}
+
+		void StreamBuffer::ClearFences()
+		{
+			for (const Fence &fence : m_fences)
+				glDeleteSync(fence.sync);
+			m_fences.clear();
+		}
+
 		// ------------------------------------------------------------
 		IndexBuffer::IndexBuffer(uint32_t size, BufferUsage hint) :
 			Graphics::IndexBuffer(size, hint)
@@ -6,9 +6,12 @@
 #include "OpenGLLibs.h"
 #include "graphics/VertexBuffer.h"
 
+#include <deque>
 #include <memory>
 
 namespace Graphics {
+	class Stats;
+
 	namespace OGL {
 
 		class GLBufferBase {
@@ -47,6 +50,67 @@ namespace Graphics {
 			uint8_t *m_data;
 		};
 
+		// Vertices for the immediate mode draws (Renderer::DrawTriangles and
+		// DrawPointSprites), one per vertex layout. Each draw gets the next
+		// free range of one big buffer, written through an unsynchronised
+		// map, and is drawn from its first vertex. The ring is fenced at the
+		// end of every frame, so that once it wraps around only ranges the GPU
+		// is finished with get written over. When it isn't (or sync objects
+		// aren't supported) the storage is orphaned instead.
+		class StreamBuffer {
+		public:
+			StreamBuffer(const VertexBufferDesc &desc, Stats &stats);
+			~StreamBuffer();
+
+			const VertexBufferDesc &GetDesc() const { return m_desc; }
+
+			// room for numVertices, written until Unmap. firstVertex is where
+			// they start when drawing
+			uint8_t *Map(uint32_t numVertices, uint32_t &firstVertex);
+			void Unmap();
+
+			// copies the contents of the VertexArray into the next free range
+			bool Populate(const VertexArray &, uint32_t &firstVertex);
+
+			void Bind();
+			void Release();
+
+			// after the last draw of the frame
+			void EndFrame();
+
+		private:
+			static const uint32_t INITIAL_CAPACITY = 256 * 1024;
+			static const uint32_t MAX_CAPACITY = 16 * 1024 * 1024;
+
+			struct Fence {
+				GLsync sync;
+				uint64_t position;
+			};
+
+			// new storage, the old one is left to the driver
+			void Allocate(uint32_t capacity);
+			// false if there is no fence covering position yet
+			bool WaitFor(uint64_t position);
+			void ClearFences();
+
+			VertexBufferDesc m_desc;
+			Stats &m_stats;
+			GLuint m_buffer;
+			GLuint m_vao;
+			bool m_useFences;
+			// in bytes
+			uint32_t m_capacity;
+			uint32_t m_head;
+			// bytes used (or skipped at wraps) since the storage was
+			// allocated, so that m_position % m_capacity == m_head
+			uint64_t m_position;
+			// m_position at the last fence, and of the last one known to
+			// have been passed
+			uint64_t m_fenced;
+			uint64_t m_completed;
+			std::deque<Fence> m_fences;
+		};
+
 		class IndexBuffer : public Graphics::IndexBuffer, public GLBufferBase {
 		public:
 			IndexBuffer(uint32_t size, BufferUsage);
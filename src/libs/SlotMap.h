@@ -0,0 +1,180 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SLOTMAP_H
+#define _SLOTMAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Values are kept packed in one vector, so walking them is a plain array
+// walk, while Handles stay valid until their own value is erased. A handle
+// carries the generation of its slot, so one left over from an erased value
+// is recognised rather than finding whatever reused the slot.
+//
+// Insert and Erase are O(1). Erase moves the last value into the hole, so
+// the order of iteration is not the order of insertion.
+//
+// Iterators are positions, not pointers: values inserted while iterating
+// don't invalidate them and are visited by the same loop (like std::list),
+// but erasing while iterating is not allowed.
+template <typename T>
+class SlotMap {
+public:
+	struct Handle {
+		uint32_t index = std::numeric_limits<uint32_t>::max();
+		uint32_t generation = 0;
+
+		bool operator==(const Handle &o) const { return index == o.index && generation == o.generation; }
+		bool operator!=(const Handle &o) const { return !(*this == o); }
+	};
+
+	template <typename Map, typename Value>
+	class Iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef Value *pointer;
+		typedef Value &reference;
+
+		Iterator(Map *map, size_t pos) :
+			m_map(map),
+			m_pos(pos) {}
+		// iterator to const_iterator
+		template <typename OtherMap, typename OtherValue>
+		Iterator(const Iterator<OtherMap, OtherValue> &o) :
+			m_map(o.m_map),
+			m_pos(o.m_pos) {}
+
+		reference operator*() const { return m_map->m_values[m_pos]; }
+		pointer operator->() const { return &m_map->m_values[m_pos]; }
+		Iterator &operator++()
+		{
+			++m_pos;
+			return *this;
+		}
+		Iterator operator++(int)
+		{
+			Iterator it = *this;
+			++m_pos;
+			return it;
+		}
+		// end() is a sentinel past any size, so it follows values added during the loop
+		bool operator==(const Iterator &o) const { return Pos() == o.Pos(); }
+		bool operator!=(const Iterator &o) const { return Pos() != o.Pos(); }
+
+	private:
+		template <typename, typename>
+		friend class Iterator;
+
+		size_t Pos() const { return std::min(m_pos, m_map->m_values.size()); }
+
+		Map *m_map;
+		size_t m_pos;
+	};
+
+	typedef Iterator<SlotMap, T> iterator;
+	typedef Iterator<const SlotMap, const T> const_iterator;
+	typedef T value_type;
+	typedef T &reference;
+	typedef const T &const_reference;
+
+	Handle Insert(const T &value)
+	{
+		uint32_t index;
+		if (m_freeHead != NONE) {
+			index = m_freeHead;
+			m_freeHead = m_slots[index].denseIndex;
+		} else {
+			index = uint32_t(m_slots.size());
+			m_slots.emplace_back();
+		}
+		Slot &slot = m_slots[index];
+		slot.denseIndex = uint32_t(m_values.size());
+		m_values.push_back(value);
+		m_valueSlots.push_back(index);
+		return { index, slot.generation };
+	}
+
+	// false if the handle was stale
+	bool Erase(Handle h)
+	{
+		if (!Contains(h)) return false;
+		Slot &slot = m_slots[h.index];
+		const uint32_t dense = slot.denseIndex;
+		const uint32_t last = uint32_t(m_values.size() - 1);
+		if (dense != last) {
+			m_values[dense] = std::move(m_values[last]);
+			m_valueSlots[dense] = m_valueSlots[last];
+			m_slots[m_valueSlots[dense]].denseIndex = dense;
+		}
+		m_values.pop_back();
+		m_valueSlots.pop_back();
+
+		slot.generation++;
+		slot.denseIndex = m_freeHead;
+		m_freeHead = h.index;
+		return true;
+	}
+
+	bool Contains(Handle h) const
+	{
+		// erasing bumps the generation, so a free slot never matches
+		return h.index < m_slots.size() && m_slots[h.index].generation == h.generation;
+	}
+
+	T *Get(Handle h) { return Contains(h) ? &m_values[m_slots[h.index].denseIndex] : nullptr; }
+	const T *Get(Handle h) const { return Contains(h) ? &m_values[m_slots[h.index].denseIndex] : nullptr; }
+
+	void Clear()
+	{
+		// bump every live slot, so that no handle survives
+		for (uint32_t index : m_valueSlots) {
+			m_slots[index].generation++;
+			m_slots[index].denseIndex = m_freeHead;
+			m_freeHead = index;
+		}
+		m_values.clear();
+		m_valueSlots.clear();
+	}
+
+	void Reserve(size_t n)
+	{
+		m_values.reserve(n);
+		m_valueSlots.reserve(n);
+		m_slots.reserve(n);
+	}
+
+	size_t size() const { return m_values.size(); }
+	bool empty() const { return m_values.empty(); }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, END); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, END); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+private:
+	static const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	static const size_t END = std::numeric_limits<size_t>::max();
+
+	struct Slot {
+		// index into m_values, or the next free slot while unused
+		uint32_t denseIndex = 0;
+		uint32_t generation = 0;
+	};
+
+	std::vector<T> m_values;
+	std::vector<uint32_t> m_valueSlots; // slot of each value
+	std::vector<Slot> m_slots;
+	uint32_t m_freeHead = NONE;
+};
+
+#endif /* _SLOTMAP_H */
@@ -17,6 +17,7 @@
 #include "InGameViewsLocator.h"
 #include "LuaConsole.h"
 #include "LuaEvent.h"
+#include "ModelCache.h"
 #include "Pi.h"
 #include "Player.h"
 #include "ShipCpanel.h"
@@ -301,6 +302,7 @@ namespace MainState_ {
 			Pi::syncJobQueue->RunJobs(SYNC_JOBS_PER_LOOP);
 			Pi::asyncJobQueue->FinishJobs();
 			Pi::syncJobQueue->FinishJobs();
+			ModelCache::Update();
 
 			MainState have_new_state = MainState::GAME_LOOP;
 			Pi::HandleRequests(have_new_state);
@@ -61,6 +61,9 @@
 
 #include "versioningInfo.h"
 
+#include <chrono>
+#include <vector>
+
 #if ENABLE_SERVER_AGENT
 #include "ServerAgent.h"
 #endif
@@ -86,6 +89,44 @@ namespace MainState_ {
 		RendererLocator::getRenderer()->SwapBuffers();
 	}
 
+	// wall clock time of each phase of the start up, for the report at the end
+	class StartupPhases {
+	public:
+		void Begin(const char *name)
+		{
+			End();
+			Output("%s\n", name);
+			m_phases.push_back({ name, 0.0 });
+			m_start = Clock::now();
+			m_running = true;
+		}
+
+		void End()
+		{
+			if (m_running)
+				m_phases.back().ms = std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+			m_running = false;
+		}
+
+		void Report()
+		{
+			End();
+			Output("\nStartup phases:\n");
+			for (const Phase &phase : m_phases)
+				Output("  %-24s %9.1f ms\n", phase.name, phase.ms);
+		}
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+		struct Phase {
+			const char *name;
+			double ms;
+		};
+		std::vector<Phase> m_phases;
+		Clock::time_point m_start;
+		bool m_running = false;
+	};
+
 	InitState::InitState(const std::map<std::string, std::string> &options, bool no_gui):
 		PiState(),
 		m_options(options),
@@ -103,6 +144,7 @@ namespace MainState_ {
 
 		Profiler::Timer timer;
 		timer.Start();
+		StartupPhases phases;
 
 		OS::EnableBreakpad();
 		OS::NotifyLoadBegin();
@@ -165,6 +207,7 @@ namespace MainState_ {
 		videoSettings.useAnisotropicFiltering = (GameConfSingleton::getInstance().Int("UseAnisotropicFiltering") != 0);
 		videoSettings.enableDebugMessages = (GameConfSingleton::getInstance().Int("EnableGLDebug") != 0);
 		videoSettings.gl3ForwardCompatible = (GameConfSingleton::getInstance().Int("GL3ForwardCompatible") != 0);
+		videoSettings.sortDraws = (GameConfSingleton::getInstance().Int("SortDraws") != 0);
 		videoSettings.iconFile = OS::GetIconFilename();
 		videoSettings.title = "Pioneer";
 
@@ -173,7 +216,7 @@ namespace MainState_ {
 		Pi::CreateRenderTarget(videoSettings.width, videoSettings.height);
 		RandomSingleton::Init(time(0));
 
-		Output("Initialize Input\n");
+		phases.Begin("Initialize Input");
 		InputLocator::provideInput(new Input());
 		std::vector<std::function<void(void)>> input_binding_registerer = {
 			RadarWidget::RegisterInputBindings,
@@ -200,17 +243,22 @@ namespace MainState_ {
 		const int numCores = OS::GetNumCores();
 		assert(numCores > 0);
 		if (numThreads == 0) numThreads = std::max(uint32_t(numCores) - 1, 1U);
-		Pi::asyncJobQueue.reset(new AsyncJobQueue(numThreads));
-		Output("started %d worker threads\n", numThreads);
+		if (GameConfSingleton::getInstance().Int("WorkStealingJobs")) {
+			Pi::asyncJobQueue.reset(new WorkStealingJobQueue(numThreads));
+			Output("started %d work-stealing worker threads\n", numThreads);
+		} else {
+			Pi::asyncJobQueue.reset(new AsyncJobQueue(numThreads));
+			Output("started %d worker threads\n", numThreads);
+		}
 		Pi::syncJobQueue.reset(new SyncJobQueue);
 
-		Output("ShipType::Init()\n");
+		phases.Begin("ShipType::Init()");
 		// XXX early, Lua init needs it
 		ShipType::Init();
 
 		// XXX UI requires Lua  but Pi::ui must exist before we start loading
 		// templates. so now we have crap everywhere :/
-		Output("Lua::Init()\n");
+		phases.Begin("Lua::Init()");
 		Lua::Init();
 
 		Pi::pigui.Reset(new PiGui(RendererLocator::getRenderer()->GetSDLWindow()));
@@ -248,7 +296,7 @@ namespace MainState_ {
 		draw_progress(0.01f);
 		draw_progress(0.01f);
 
-		Output("GalaxyGenerator::Init()\n");
+		phases.Begin("GalaxyGenerator::Init()");
 		if (GameConfSingleton::getInstance().HasEntry("GalaxyGenerator"))
 			GalaxyGenerator::Init(GameConfSingleton::getInstance().String("GalaxyGenerator"),
 				GameConfSingleton::getInstance().Int("GalaxyGeneratorVersion", GalaxyGenerator::LAST_VERSION));
@@ -257,16 +305,16 @@ namespace MainState_ {
 
 		draw_progress(0.1f);
 
-		Output("FaceParts::Init()\n");
+		phases.Begin("FaceParts::Init()");
 		FaceParts::Init();
 		draw_progress(0.2f);
 
-		Output("Shields::Init()\n");
+		phases.Begin("Shields::Init()");
 		Shields::Init();
 		draw_progress(0.3f);
 
-		Output("ModelCache::Init()\n");
-		ModelCache::Init(ShipType::types);
+		phases.Begin("ModelCache::Init()");
+		ModelCache::Init(ShipType::types, Pi::GetAsyncJobQueue());
 		draw_progress(0.4f);
 
 		//unsigned int control_word;
@@ -274,28 +322,28 @@ namespace MainState_ {
 		//_controlfp_s(&control_word, _EM_INEXACT | _EM_UNDERFLOW | _EM_ZERODIVIDE, _MCW_EM);
 		//double fpexcept = Pi::timeAccelRates[1] / Pi::timeAccelRates[0];
 
-		Output("BaseSphere::Init()\n");
+		phases.Begin("BaseSphere::Init()");
 		BaseSphere::Init(GameConfSingleton::getDetail().planets);
 		draw_progress(0.5f);
 
-		Output("CityOnPlanet::Init()\n");
+		phases.Begin("CityOnPlanet::Init()");
 		CityOnPlanet::Init();
 		draw_progress(0.6f);
 
-		Output("SpaceStation::Init()\n");
+		phases.Begin("SpaceStation::Init()");
 		SpaceStation::Init();
 		draw_progress(0.7f);
 
-		Output("NavLights::Init()\n");
+		phases.Begin("NavLights::Init()");
 		NavLights::Init();
 		draw_progress(0.75f);
 
-		Output("Sfx::Init()\n");
+		phases.Begin("Sfx::Init()");
 		SfxManager::Init();
 		draw_progress(0.8f);
 
+		phases.Begin("Sound::Init()");
 		if (!m_no_gui && !GameConfSingleton::getInstance().Int("DisableSound")) {
-			Output("Sound::Init\n");
 			Sound::Init();
 			Sound::SetMasterVolume(GameConfSingleton::getInstance().Float("MasterVolume"));
 			Sound::SetSfxVolume(GameConfSingleton::getInstance().Float("SfxVolume"));
@@ -358,6 +406,7 @@ namespace MainState_ {
 		}
 	#endif
 
+		phases.Begin("LuaConsole");
 		Pi::m_luaConsole.reset(new LuaConsole());
 
 		draw_progress(1.0f);
@@ -366,6 +415,7 @@ namespace MainState_ {
 	#ifdef PIONEER_PROFILER
 		Profiler::dumphtml(m_statelessVars.profilerPath.c_str());
 	#endif
+		phases.Report();
 		Output("\n\nLoading took: %lf milliseconds\n", timer.millicycles());
 		delete this;
 		return new MainMenuState();
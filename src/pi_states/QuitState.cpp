@@ -1,6 +1,8 @@
 #include "QuitState.h"
 
 #include "Pi.h"
+#include "GameState.h"
+#include "../GameState.h"
 #include "LuaManager.h"
 #include "LuaNameGen.h"
 #include "Projectile.h"
@@ -38,6 +40,9 @@ namespace MainState_ {
 	PiState *QuitState::Update()
 	{
 		Output("Shutting down...\n");
+		// the saves still being written need the job queue, and the game
+		// would otherwise be lost
+		GameStateStatic::FinishSaves();
 		Projectile::FreeModel();
 		Beam::FreeModel();
 		NavLights::Uninit();
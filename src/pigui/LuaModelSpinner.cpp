@@ -3,7 +3,6 @@
 #include "LuaPushPull.h"
 #include "LuaVector.h"
 #include "LuaVector2.h"
-#include "ModelCache.h"
 #include "ShipType.h"
 #include "pigui/ModelSpinner.h"
 
@@ -19,7 +18,6 @@ namespace PiGUI {
 		{
 			auto *obj = LuaObject<ModelSpinner>::CheckFromLua(1);
 			const std::string name(luaL_checkstring(l, 2));
-			SceneGraph::Model *model = ModelCache::FindModel(name);
 
 			SceneGraph::ModelSkin *skin = nullptr;
 			if (lua_gettop(l) > 2 && !lua_isnoneornil(l, 3)) {
@@ -29,7 +27,7 @@ namespace PiGUI {
 			if (lua_gettop(l) > 3 && !lua_isnoneornil(l, 4)) {
 				pattern = luaL_checkinteger(l, 4) - 1; // Lua counts from 1
 			}
-			obj->SetModel(model, skin, pattern);
+			obj->SetModel(name, skin, pattern);
 
 			return 0;
 		}
@@ -39,11 +37,7 @@ namespace PiGUI {
 			auto *obj = LuaObject<ModelSpinner>::CheckFromLua(1);
 
 			const std::string &name = ShipType::GetRandom();
-			SceneGraph::Model *model = ModelCache::FindModel(name);
-
-			SceneGraph::ModelSkin *skin = nullptr;
-			unsigned int pattern = 0;
-			obj->SetModel(model, skin, pattern);
+			obj->SetModel(name, nullptr, 0);
 
 			LuaPush(l, name);
 			return 1;
@@ -3,6 +3,7 @@
 
 #include "pigui/ModelSpinner.h"
 
+#include "ModelCache.h"
 #include "PiGui.h"
 #include "RandomSingleton.h"
 #include "graphics/RenderTarget.h"
@@ -18,6 +19,7 @@
 using namespace PiGUI;
 
 ModelSpinner::ModelSpinner() :
+	m_pendingPattern(0),
 	m_needsResize(true),
 	m_pauseTime(0.),
 	m_rot(vector2f(DEG2RAD(-15.0), DEG2RAD(180.0)))
@@ -66,9 +68,26 @@ void ModelSpinner::SetModel(SceneGraph::Model *model, SceneGraph::ModelSkin *ski
 	m_shields.reset(new Shields(model));
 }
 
+void ModelSpinner::SetModel(const std::string &name, const SceneGraph::ModelSkin *skin, unsigned int pattern)
+{
+	m_pendingModel = name;
+	m_pendingSkin.reset(skin ? new SceneGraph::ModelSkin(*skin) : nullptr);
+	m_pendingPattern = pattern;
+	ModelCache::Prefetch(name);
+}
+
 void ModelSpinner::Render()
 {
 	PROFILE_SCOPED()
+	if (!m_pendingModel.empty()) {
+		SceneGraph::Model *model = ModelCache::RequestModel(m_pendingModel);
+		if (model) {
+			SetModel(model, m_pendingSkin.get(), m_pendingPattern);
+			m_pendingModel.clear();
+			m_pendingSkin.reset();
+		}
+	}
+
 	// Resizing a render target involves destroying the old one and creating a new one.
 	if (m_needsResize) CreateRenderTarget();
 	if (!m_renderTarget) return;
@@ -90,11 +109,13 @@ void ModelSpinner::Render()
 
 	r->SetLights(1, &m_light);
 
-	matrix4x4f rot = matrix4x4f::RotateXMatrix(m_rot.x);
-	rot.RotateY(m_rot.y);
-	const float dist = m_model->GetDrawClipRadius() / sinf(DEG2RAD(fov * 0.5f));
-	rot[14] = -dist;
-	m_model->Render(rot);
+	if (m_model) {
+		matrix4x4f rot = matrix4x4f::RotateXMatrix(m_rot.x);
+		rot.RotateY(m_rot.y);
+		const float dist = m_model->GetDrawClipRadius() / sinf(DEG2RAD(fov * 0.5f));
+		rot[14] = -dist;
+		m_model->Render(rot);
+	}
 	r->SetRenderTarget(0);
 }
 
@@ -8,6 +8,7 @@
 #include "scenegraph/ModelSkin.h"
 
 #include <memory>
+#include <string>
 
 // Forward declare this type from imgui.h
 using ImTextureID = void *;
@@ -37,6 +38,9 @@ namespace PiGUI {
 
 		// Set the ship we should be looking at.
 		void SetModel(SceneGraph::Model *model, SceneGraph::ModelSkin *skin, unsigned int pattern);
+		// Same, by name. The model is loaded in the background if need be,
+		// and the previous one (if any) stays up until it's ready.
+		void SetModel(const std::string &name, const SceneGraph::ModelSkin *skin, unsigned int pattern);
 
 		// Called to draw the model to the render target.
 		void Render();
@@ -63,6 +67,11 @@ namespace PiGUI {
 		std::unique_ptr<Shields> m_shields;
 		Graphics::Light m_light;
 
+		// The model to switch to once it has been loaded.
+		std::string m_pendingModel;
+		std::unique_ptr<SceneGraph::ModelSkin> m_pendingSkin;
+		unsigned int m_pendingPattern;
+
 		void CreateRenderTarget();
 		ImTextureID GetTextureID();
 
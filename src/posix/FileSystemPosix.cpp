@@ -6,6 +6,8 @@
 #include "libs/libs.h"
 #include "libs/utils.h"
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -187,6 +189,42 @@ namespace FileSystem {
 		return RefCountedPtr<FileData>(0);
 	}
 
+	class FileDataMapped : public FileData {
+	public:
+		FileDataMapped(const FileInfo &info, size_t size, void *data) :
+			FileData(info, size, static_cast<char *>(data)) {}
+		virtual ~FileDataMapped() { munmap(m_data, m_size); }
+	};
+
+	RefCountedPtr<FileData> FileSourceFS::MapFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const int fd = open(fullpath.c_str(), O_RDONLY);
+		if (fd == -1)
+			return RefCountedPtr<FileData>(0);
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+			close(fd);
+			return RefCountedPtr<FileData>(0);
+		}
+		// can't map an empty file
+		if (info.st_size == 0) {
+			close(fd);
+			return ReadFile(path);
+		}
+
+		void *data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		// the mapping stays valid after the descriptor is closed
+		close(fd);
+		if (data == MAP_FAILED)
+			return RefCountedPtr<FileData>(0);
+
+		Time::DateTime mtime;
+		interpret_stat(info, mtime);
+		return RefCountedPtr<FileData>(new FileDataMapped(MakeFileInfo(path, FileInfo::FT_FILE, mtime), size_t(info.st_size), data));
+	}
+
 	bool FileSourceFS::ReadDirectory(const std::string &path, std::vector<FileInfo> &output)
 	{
 		const std::string fulldirpath = JoinPathBelow(GetRoot(), path);
@@ -256,6 +294,19 @@ namespace FileSystem {
 		return make_directory_raw(fullpath);
 	}
 
+	bool FileSourceFS::RemoveFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		return unlink(fullpath.c_str()) == 0;
+	}
+
+	bool FileSourceFS::RenameFile(const std::string &from, const std::string &to)
+	{
+		const std::string fullfrom = JoinPathBelow(GetRoot(), from);
+		const std::string fullto = JoinPathBelow(GetRoot(), to);
+		return rename(fullfrom.c_str(), fullto.c_str()) == 0;
+	}
+
 	FILE *FileSourceFS::OpenReadStream(const std::string &path)
 	{
 		const std::string fullpath = JoinPathBelow(GetRoot(), path);
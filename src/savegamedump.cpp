@@ -1,11 +1,49 @@
 // Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
+#include "CborStream.h"
 #include "FileSystem.h"
 #include "GZipFormat.h"
 #include "Json.h"
+#include "JsonUtils.h"
+#include "LZ4Format.h"
 #include <SDL.h>
 
+// writes the item just read as JSON text, indented as Json::dump(2) does,
+// without building the whole save as a Json tree first
+static void DumpCbor(CborReader &reader, const CborReader::Item &item, FILE *out, int depth)
+{
+	const bool isMap = item.type == CborReader::MAP;
+	if (item.type != CborReader::ARRAY && !isMap) {
+		fputs(reader.ReadJson(item).dump().c_str(), out);
+		return;
+	}
+	if (depth >= CborReader::MAX_DEPTH)
+		throw CborError("CBOR data nested too deep");
+	const int indent = depth * 2;
+
+	CborReader::Item inner;
+	bool first = true;
+	fputc(isMap ? '{' : '[', out);
+	for (uint64_t i = 0; item.indefinite || i < item.count; i++) {
+		reader.Next(inner);
+		if (inner.type == CborReader::BREAK && item.indefinite)
+			break;
+		fprintf(out, "%s\n%*s", first ? "" : ",", indent + 2, "");
+		first = false;
+		if (isMap) {
+			if (inner.type != CborReader::STRING)
+				throw CborError("CBOR map key is not a string");
+			fprintf(out, "%s: ", Json(inner.str).dump().c_str());
+			reader.Next(inner);
+		}
+		DumpCbor(reader, inner, out, depth + 1);
+	}
+	if (!first)
+		fprintf(out, "\n%*s", indent, "");
+	fputc(isMap ? '}' : ']', out);
+}
+
 extern "C" int main(int argc, char **argv)
 {
 	if (argc < 2 || argc > 3) {
@@ -32,27 +70,44 @@ extern "C" int main(int argc, char **argv)
 	}
 
 	const auto compressed_data = file->AsByteRange();
-	Json rootNode;
+	std::string plain_data;
 	try {
-		const std::string plain_data = gzip::DecompressDeflateOrGZip(reinterpret_cast<const unsigned char *>(compressed_data.begin), compressed_data.Size());
+		plain_data = JsonUtils::DecompressSaveFile(compressed_data.begin, compressed_data.Size());
+	} catch (gzip::DecompressionFailedException) {
+		printf("Decompressing saved data failed - saved game is corrupt.\n");
+		return 3;
+	} catch (lz4::DecompressionFailedException &) {
+		printf("Decompressing saved data failed - saved game is corrupt.\n");
+		return 3;
+	}
+
+	// Allow loading files in JSON format as well as CBOR
+	Json rootNode;
+	if (!plain_data.empty() && plain_data[0] == '{') {
 		try {
-			// Allow loading files in JSON format as well as CBOR
-			if (plain_data[0] == '{')
-				rootNode = Json::parse(plain_data);
-			else
-				rootNode = Json::from_cbor(plain_data);
+			rootNode = Json::parse(plain_data);
 		} catch (Json::parse_error &e) {
 			printf("Saved game is not a valid JSON object: %s.\n", e.what());
 			return 2;
 		}
+	}
 
-		if (!rootNode.is_object()) {
+	CborReader reader(plain_data.data(), plain_data.size());
+	CborReader::Item root;
+	if (rootNode.is_null()) {
+		try {
+			reader.Next(root);
+		} catch (CborError &e) {
+			printf("Saved game is not valid CBOR: %s.\n", e.what());
+			return 2;
+		}
+		if (root.type != CborReader::MAP) {
 			printf("Saved game's root is not a JSON object.\n");
 			return 2;
 		}
-	} catch (gzip::DecompressionFailedException) {
-		printf("Decompressing saved data failed - saved game is corrupt.\n");
-		return 3;
+	} else if (!rootNode.is_object()) {
+		printf("Saved game's root is not a JSON object.\n");
+		return 2;
 	}
 
 	auto outFile = FileSystem::userFiles.OpenWriteStream(outname);
@@ -61,8 +116,18 @@ extern "C" int main(int argc, char **argv)
 		return 1;
 	}
 
-	fputs(rootNode.dump(2).c_str(), outFile);
+	int result = 0;
+	if (rootNode.is_object()) {
+		fputs(rootNode.dump(2).c_str(), outFile);
+	} else {
+		try {
+			DumpCbor(reader, root, outFile, 0);
+		} catch (CborError &e) {
+			printf("Saved game is not valid CBOR: %s.\n", e.what());
+			result = 2;
+		}
+	}
 	fclose(outFile);
 
-	return 0;
+	return result;
 }
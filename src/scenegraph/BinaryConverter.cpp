@@ -38,7 +38,8 @@ using namespace SceneGraph;
 // 5:	normal mapping
 // 6:	32-bit indicies
 // 6.1:	rewrote serialization, use lz4 compression instead of INFLATE/DEFLATE. Still compatible.
-const uint32_t SGM_VERSION = 6;
+// 7:	collision edge bounding boxes are no longer stored, they're rebuilt on load with the trees
+const uint32_t SGM_VERSION = 7;
 union SGM_STRING_VALUE {
 	char name[4];
 	uint32_t value;
@@ -73,7 +74,8 @@ public:
 
 BinaryConverter::BinaryConverter() :
 	BaseLoader(),
-	m_patternsUsed(false)
+	m_patternsUsed(false),
+	m_buildCollisionTrees(true)
 {
 	//register core loaders
 	RegisterLoader("Group", &Group::Load);
@@ -173,37 +175,76 @@ Model *BinaryConverter::Load(const std::string &filename)
 Model *BinaryConverter::Load(const std::string &name, RefCountedPtr<FileSystem::FileData> binfile)
 {
 	PROFILE_SCOPED()
-	Model *model(nullptr);
+	std::string data;
+	if (!Decompress(name, binfile->AsByteRange(), data))
+		return nullptr;
+	return CreateModel(name, data);
+}
+
+Model *BinaryConverter::Load(const ModelFile &file, bool buildCollisionTrees)
+{
+	PROFILE_SCOPED()
+	//curPath is used to find textures, patterns,
+	//possibly other data files for this model.
+	m_curPath = file.dir;
+	m_buildCollisionTrees = buildCollisionTrees;
+	Model *model = CreateModel(file.name, file.data);
+	m_buildCollisionTrees = true;
+	return model;
+}
+
+//static
+bool BinaryConverter::ReadModelFile(const FileSystem::FileInfo &info, ModelFile &file)
+{
+	PROFILE_SCOPED()
+	file.name = info.GetName();
+	file.dir = info.GetDir();
+	//Strip trailing slash
+	if (!file.dir.empty() && file.dir[file.dir.length() - 1] == '/')
+		file.dir = file.dir.substr(0, file.dir.length() - 1);
+
+	RefCountedPtr<FileSystem::FileData> binfile = info.Read();
+	return binfile.Valid() && Decompress(file.name, binfile->AsByteRange(), file.data);
+}
+
+//static
+bool BinaryConverter::Decompress(const std::string &name, const ByteRange &bin, std::string &data)
+{
+	PROFILE_SCOPED()
 	// decompress the loaded ByteRange in memory
-	const ByteRange bin = binfile->AsByteRange();
 	if (lz4::IsLZ4Format(bin.begin, bin.Size())) {
 		try {
-			std::string decompressedData = lz4::DecompressLZ4(bin.begin, bin.Size());
-			Output("decompressed model file %s (%.2f KB) -> %.2f KB\n", name.c_str(), binfile->GetSize() / 1024.f, decompressedData.size() / 1024.f);
-			Serializer::Reader rd(ByteRange(decompressedData.data(), decompressedData.size()));
-			model = CreateModel(name, rd);
+			data = lz4::DecompressLZ4(bin.begin, bin.Size());
 		} catch (std::runtime_error &e) {
 			Warning("Error loading SGM model: %s\n", e.what());
+			return false;
 		}
 	} else {
 		void *pDecompressedData;
 		size_t outSize(0);
 		{
 			PROFILE_SCOPED_DESC("tinfl_decompress_mem_to_heap")
-			pDecompressedData = tinfl_decompress_mem_to_heap(&bin[0], bin.Size(), &outSize, 0);
+			pDecompressedData = tinfl_decompress_mem_to_heap(bin.begin, bin.Size(), &outSize, 0);
 		}
-		Output("decompressed model file %s (%.2f KB) -> %.2f KB\n", name.c_str(), binfile->GetSize() / 1024.f, outSize / 1024.f);
-		if (pDecompressedData) {
-			// now parse in-memory representation as new ByteRange.
-			Serializer::Reader rd(ByteRange(static_cast<char *>(pDecompressedData), outSize));
-			model = CreateModel(name, rd);
-			mz_free(pDecompressedData);
-		} else {
+		if (!pDecompressedData)
 			Error("BinaryConverter failed to load old-style SGM called: %s", name.c_str());
-		}
+		data.assign(static_cast<char *>(pDecompressedData), outSize);
+		mz_free(pDecompressedData);
 	}
+	Output("decompressed model file %s (%.2f KB) -> %.2f KB\n", name.c_str(), bin.Size() / 1024.f, data.size() / 1024.f);
+	return true;
+}
 
-	return model;
+Model *BinaryConverter::CreateModel(const std::string &filename, const std::string &data)
+{
+	try {
+		// now parse in-memory representation as new ByteRange.
+		Serializer::Reader rd(ByteRange(data.data(), data.size()));
+		return CreateModel(filename, rd);
+	} catch (std::runtime_error &e) {
+		Warning("Error loading SGM model: %s\n", e.what());
+		return nullptr;
+	}
 }
 
 Model *BinaryConverter::Load(const std::string &shortname, const std::string &basepath)
@@ -265,7 +306,7 @@ Model *BinaryConverter::CreateModel(const std::string &filename, Serializer::Rea
 	m_model->m_root.Reset(root);
 
 	RefCountedPtr<CollMesh> collMesh(new CollMesh());
-	collMesh->Load(rd);
+	collMesh->Load(rd, m_buildCollisionTrees);
 	m_model->SetCollisionMesh(collMesh);
 	m_model->SetDrawClipRadius(rd.Float());
 
@@ -32,18 +32,34 @@ namespace SceneGraph {
 
 	class BinaryConverter : public BaseLoader {
 	public:
+		// a .sgm read and decompressed by ReadModelFile, for Load to turn
+		// into a model
+		struct ModelFile {
+			std::string name; // with the extension
+			std::string dir;
+			std::string data;
+		};
+
 		BinaryConverter();
 		void Save(const std::string &filename, Model *m);
 		void Save(const std::string &filename, const std::string &savepath, Model *m, const bool bInPlace);
 		Model *Load(const std::string &filename);
 		Model *Load(const std::string &filename, const std::string &path);
 		Model *Load(const std::string &filename, RefCountedPtr<FileSystem::FileData> binfile);
+		// buildCollisionTrees false leaves them to CollMesh::BuildTrees
+		Model *Load(const ModelFile &file, bool buildCollisionTrees = true);
+
+		// thread safe, so that many models can be read at once. false if
+		// the file couldn't be read or decompressed
+		static bool ReadModelFile(const FileSystem::FileInfo &info, ModelFile &file);
 
 		//if you implement any new node types, you must also register a loader function
 		//before calling Load.
 		void RegisterLoader(const std::string &typeName, const std::function<Node *(NodeDatabase &)> &);
 
 	private:
+		static bool Decompress(const std::string &name, const ByteRange &bin, std::string &data);
+		Model *CreateModel(const std::string &filename, const std::string &data);
 		Model *CreateModel(const std::string &filename, Serializer::Reader &);
 		void SaveMaterials(Serializer::Writer &, Model *m);
 		void LoadMaterials(Serializer::Reader &);
@@ -57,6 +73,7 @@ namespace SceneGraph {
 		static Label3D *LoadLabel3D(NodeDatabase &);
 
 		bool m_patternsUsed;
+		bool m_buildCollisionTrees;
 		std::map<std::string, std::function<Node *(NodeDatabase &)>> m_loaders;
 	};
 } // namespace SceneGraph
@@ -70,13 +70,12 @@ namespace SceneGraph {
 		Graphics::Renderer *r = RendererLocator::getRenderer();
 		if (r != nullptr) {
 			const size_t count = m_pixelSizes.size();
-			const size_t tsize = trans.size();
 
 			// transformation buffers
-			std::vector<std::vector<matrix4x4f>> transform;
+			std::vector<std::vector<matrix4x4f>> &transform = m_instTransforms;
 			transform.resize(count);
 			for (uint32_t i = 0; i < count; i++) {
-				transform[i].reserve(tsize);
+				transform[i].clear();
 			}
 
 			// seperate out the transformations
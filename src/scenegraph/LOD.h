@@ -26,6 +26,8 @@ namespace SceneGraph {
 	protected:
 		virtual ~LOD() {}
 		std::vector<unsigned int> m_pixelSizes; // same number as children
+		// instanced transforms by level, kept so rendering doesn't allocate
+		std::vector<std::vector<matrix4x4f>> m_instTransforms;
 	};
 
 } // namespace SceneGraph
@@ -146,6 +146,17 @@ namespace SceneGraph {
 		return m;
 	}
 
+	Model *Loader::LoadModel(const BinaryConverter::ModelFile &file, bool buildCollisionTrees)
+	{
+		PROFILE_SCOPED()
+		m_logMessages.clear();
+		SceneGraph::BinaryConverter bc;
+		m_model = bc.Load(file, buildCollisionTrees);
+		if (m_model)
+			ParseGunTags(m_model);
+		return m_model;
+	}
+
 	Model *Loader::LoadModel(const std::string &shortname, const std::string &basepath)
 	{
 		PROFILE_SCOPED()
@@ -7,6 +7,7 @@
  * Model loader using Assimp
  */
 #include "BaseLoader.h"
+#include "BinaryConverter.h"
 #include "CollisionGeometry.h"
 #include "StaticGeometry.h"
 #include "LoaderDefinitions.h"
@@ -32,6 +33,8 @@ namespace SceneGraph {
 		//find & attempt to load a model, based on filename (without path or .model suffix)
 		Model *LoadModel(const std::string &name);
 		Model *LoadModel(const std::string &name, const std::string &basepath);
+		//a .sgm already read by BinaryConverter::ReadModelFile, null if it can't be loaded
+		Model *LoadModel(const BinaryConverter::ModelFile &file, bool buildCollisionTrees = true);
 
 		const std::vector<std::string> &GetLogMessages() const { return m_logMessages; }
 
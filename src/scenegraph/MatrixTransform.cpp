@@ -52,7 +52,7 @@ namespace SceneGraph {
 		} else {
 			// m_transform is valid, modify all positions by it
 			const size_t transSize = trans.size();
-			std::vector<matrix4x4f> t;
+			std::vector<matrix4x4f> &t = m_instTransforms;
 			t.resize(transSize);
 			for (size_t tIdx = 0; tIdx < transSize; tIdx++) {
 				t[tIdx] = trans[tIdx] * m_transform;
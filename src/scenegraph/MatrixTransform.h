@@ -37,6 +37,8 @@ namespace SceneGraph {
 
 	private:
 		matrix4x4f m_transform;
+		// for the instanced Render, kept so rendering doesn't allocate
+		std::vector<matrix4x4f> m_instTransforms;
 	};
 } // namespace SceneGraph
 #endif
@@ -107,6 +107,11 @@ namespace SceneGraph {
 	void Model::Render(const matrix4x4f &trans, const RenderData *rd)
 	{
 		PROFILE_SCOPED()
+		Graphics::Renderer *r = RendererLocator::getRenderer();
+		// the materials are about to change, so whatever was recorded with
+		// them has to be drawn first
+		r->FlushDrawList();
+
 		//update color parameters (materials are shared by model instances)
 		if (m_curPattern) {
 			for (MaterialContainer::const_iterator it = m_materials.begin(); it != m_materials.end(); ++it) {
@@ -125,7 +130,7 @@ namespace SceneGraph {
 		//Override renderdata if this model is called from ModelNode
 		RenderData params = (rd != 0) ? (*rd) : m_renderData;
 
-		RendererLocator::getRenderer()->SetTransform(trans);
+		r->SetTransform(trans);
 
 		//using the entire model bounding radius for all nodes at the moment.
 		//BR could also be a property of Node.
@@ -138,8 +143,13 @@ namespace SceneGraph {
 		if (params.nodemask & MASK_IGNORE) {
 			m_root->Render(trans, &params);
 		} else {
+			// the solid pass is sorted to save state changes, blended
+			// geometry is drawn in order
+			const bool sorted = r->BeginDrawList();
 			params.nodemask = NODE_SOLID;
 			m_root->Render(trans, &params);
+			if (sorted)
+				r->FlushDrawList();
 			params.nodemask = NODE_TRANSPARENT;
 			m_root->Render(trans, &params);
 		}
@@ -156,6 +166,10 @@ namespace SceneGraph {
 	void Model::Render(const std::vector<matrix4x4f> &trans, const RenderData *rd)
 	{
 		PROFILE_SCOPED();
+		Graphics::Renderer *r = RendererLocator::getRenderer();
+		// the materials are about to change, so whatever was recorded with
+		// them has to be drawn first
+		r->FlushDrawList();
 
 		//update color parameters (materials are shared by model instances)
 		if (m_curPattern) {
@@ -186,8 +200,13 @@ namespace SceneGraph {
 		if (params.nodemask & MASK_IGNORE) {
 			m_root->Render(trans, &params);
 		} else {
+			// the solid pass is sorted to save state changes, blended
+			// geometry is drawn in order
+			const bool sorted = r->BeginDrawList();
 			params.nodemask = NODE_SOLID;
 			m_root->Render(trans, &params);
+			if (sorted)
+				r->FlushDrawList();
 			params.nodemask = NODE_TRANSPARENT;
 			m_root->Render(trans, &params);
 		}
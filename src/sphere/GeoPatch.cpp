@@ -18,6 +18,7 @@
 #include "libs/Sphere.h"
 #include "perlin.h"
 #include <algorithm>
+#include <cmath>
 #include <deque>
 
 #ifdef DEBUG_BOUNDING_SPHERES
@@ -26,6 +27,8 @@
 
 // tri edge lengths
 static const double GEOPATCH_SUBDIVIDE_AT_CAMDIST = 5.0;
+// share of its distance the camera has to move before a waiting job is re-prioritised
+static const double JOB_PRIORITY_CHANGE = 0.1;
 
 GeoPatch::GeoPatch(const RefCountedPtr<GeoPatchContext> &ctx, GeoSphere *gs,
 	const vector3d &v0_, const vector3d &v1_, const vector3d &v2_, const vector3d &v3_,
@@ -40,6 +43,7 @@ GeoPatch::GeoPatch(const RefCountedPtr<GeoPatchContext> &ctx, GeoSphere *gs,
 	m_depth(depth),
 	m_needUpdateVBOs(false),
 	m_PatchID(ID_),
+	m_jobPriority(0.0),
 	m_HasJobRequest(false)
 {
 
@@ -320,8 +324,18 @@ void GeoPatch::Render(const vector3d &campos, const matrix4x4d &modelView, const
 void GeoPatch::LODUpdate(const vector3d &campos, const Graphics::Frustum &frustum)
 {
 	// there should be no LOD update when we have active split requests
-	if (m_HasJobRequest)
+	if (m_HasJobRequest) {
+		// but keep the request's place in the queue in step with the camera.
+		// changing it makes the queue re-sort, so not for every little move
+		if (m_parent && m_job.HasJob()) {
+			const double priority = (campos - m_centroid).Length();
+			if (std::abs(priority - m_jobPriority) > m_jobPriority * JOB_PRIORITY_CHANGE) {
+				m_job.SetPriority(priority);
+				m_jobPriority = priority;
+			}
+		}
 		return;
+	}
 
 	bool canSplit = true;
 	bool canMerge = bool(m_kids[0]);
@@ -450,8 +464,9 @@ void GeoPatch::ReceiveHeightmap(const SSingleSplitResult *psr)
 	m_HasJobRequest = false;
 }
 
-void GeoPatch::ReceiveJobHandle(Job::Handle job)
+void GeoPatch::ReceiveJobHandle(Job::Handle job, double priority)
 {
 	assert(!m_job.HasJob());
 	m_job = static_cast<Job::Handle &&>(job);
+	m_jobPriority = priority;
 }
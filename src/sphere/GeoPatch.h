@@ -81,7 +81,8 @@ public:
 	void RequestSinglePatch();
 	void ReceiveHeightmaps(SQuadSplitResult *psr);
 	void ReceiveHeightmap(const SSingleSplitResult *psr);
-	void ReceiveJobHandle(Job::Handle job);
+	// priority is what the job was queued with
+	void ReceiveJobHandle(Job::Handle job, double priority);
 
 	inline bool HasHeightData() const { return !m_heights.empty(); }
 private:
@@ -106,6 +107,7 @@ private:
 
 	const GeoPatchID m_PatchID;
 	Job::Handle m_job;
+	double m_jobPriority; // last given to m_job
 	bool m_HasJobRequest;
 
 	std::unique_ptr<Graphics::Drawables::Sphere3D> m_boundsphere;
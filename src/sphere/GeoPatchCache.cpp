@@ -0,0 +1,330 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GeoPatchCache.h"
+
+#include "FileSystem.h"
+#include "GameConfSingleton.h"
+#include "GameConfig.h"
+#include "GeoPatchID.h"
+#include "LZ4Format.h"
+#include "galaxy/SystemPath.h"
+#include "jenkins/lookup3.h"
+#include "libs/stringUtils.h"
+#include "libs/utils.h"
+#include "profiler/Profiler.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+	const char CACHE_DIR[] = "geopatches";
+	const char INDEX_FILE[] = "geopatches/index";
+	const char ENTRY_EXT[] = ".patch";
+
+	const uint32_t MAGIC = 0x48435047; // "GPCH"
+	// bump when the layout of the entries changes
+	const uint32_t VERSION = 1;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		GeoPatchCache::Key key;
+		uint32_t numVerts;
+		uint32_t pad;
+	};
+
+	// index records, most recently used first
+	struct IndexRecord {
+		uint64_t hash;
+		uint64_t size;
+	};
+
+	struct Entry {
+		uint64_t hash;
+		uint64_t size;
+	};
+
+	std::mutex s_mutex;
+	bool s_enabled = false;
+	uint64_t s_budget = 0;
+	uint64_t s_totalSize = 0;
+	// most recently used at the front
+	std::list<Entry> s_lru;
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> s_entries;
+	std::atomic<uint32_t> s_tmpCounter(0);
+	uint32_t s_hits = 0;
+	uint32_t s_misses = 0;
+
+	uint64_t HashKey(const GeoPatchCache::Key &key)
+	{
+		uint32_t c = 0, b = 0;
+		lookup3_hashlittle2(&key, sizeof(key), &c, &b);
+		return (uint64_t(b) << 32) | c;
+	}
+
+	std::string EntryPath(uint64_t hash)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016" PRIx64 "%s", hash, ENTRY_EXT);
+		return FileSystem::JoinPath(CACHE_DIR, name);
+	}
+
+	// s_mutex must be held
+	void AddEntry(uint64_t hash, uint64_t size, bool mostRecent)
+	{
+		const auto it = s_lru.insert(mostRecent ? s_lru.begin() : s_lru.end(), Entry{ hash, size });
+		s_entries[hash] = it;
+		s_totalSize += size;
+	}
+
+	// s_mutex must be held
+	void RemoveEntry(uint64_t hash)
+	{
+		const auto it = s_entries.find(hash);
+		if (it == s_entries.end()) return;
+		s_totalSize -= it->second->size;
+		s_lru.erase(it->second);
+		s_entries.erase(it);
+		FileSystem::userFiles.RemoveFile(EntryPath(hash));
+	}
+
+	// s_mutex must be held
+	void Evict()
+	{
+		while (s_totalSize > s_budget && !s_lru.empty())
+			RemoveEntry(s_lru.back().hash);
+	}
+
+	void ReadIndex()
+	{
+		RefCountedPtr<FileSystem::FileData> index = FileSystem::userFiles.ReadFile(INDEX_FILE);
+		if (index) {
+			const size_t numRecords = index->GetSize() / sizeof(IndexRecord);
+			for (size_t i = 0; i < numRecords; i++) {
+				IndexRecord r;
+				memcpy(&r, index->GetData() + i * sizeof(IndexRecord), sizeof(r));
+				if (!s_entries.count(r.hash))
+					AddEntry(r.hash, r.size, false);
+			}
+		}
+
+		// the index is only written on exit, so make it agree with what is
+		// actually there: forget missing entries, adopt entries written
+		// since (at the cold end) and clear out half-written ones
+		std::vector<FileSystem::FileInfo> files;
+		FileSystem::userFiles.ReadDirectory(CACHE_DIR, files);
+		std::unordered_set<uint64_t> found;
+		for (const FileSystem::FileInfo &info : files) {
+			if (!info.IsFile()) continue;
+			const std::string name = info.GetName();
+			if (!stringUtils::ends_with(name, ENTRY_EXT)) {
+				if (name.find(".tmp") != std::string::npos)
+					FileSystem::userFiles.RemoveFile(info.GetPath());
+				continue;
+			}
+			const uint64_t hash = strtoull(name.c_str(), nullptr, 16);
+			found.insert(hash);
+			if (!s_entries.count(hash)) {
+				RefCountedPtr<FileSystem::FileData> data = FileSystem::userFiles.MapFile(info.GetPath());
+				if (data) AddEntry(hash, data->GetSize(), false);
+			}
+		}
+		for (auto it = s_lru.begin(); it != s_lru.end();) {
+			if (found.count(it->hash)) {
+				++it;
+				continue;
+			}
+			s_totalSize -= it->size;
+			s_entries.erase(it->hash);
+			it = s_lru.erase(it);
+		}
+	}
+
+	void WriteIndex()
+	{
+		FILE *f = FileSystem::userFiles.OpenWriteStream(INDEX_FILE);
+		if (!f) {
+			Output("GeoPatchCache: couldn't write the index\n");
+			return;
+		}
+		for (const Entry &e : s_lru) {
+			const IndexRecord r = { e.hash, e.size };
+			fwrite(&r, sizeof(r), 1, f);
+		}
+		fclose(f);
+	}
+} // namespace
+
+GeoPatchCache::Key::Key(const SystemPath &path, const GeoPatchID &patchID_, uint32_t depth_, uint32_t edgeLen_, uint64_t terrainHash_, uint32_t numPatches_)
+{
+	// the key is hashed and compared as bytes
+	static_assert(sizeof(Key) == 48, "GeoPatchCache::Key should have no padding");
+	memset(this, 0, sizeof(*this));
+	terrainHash = terrainHash_;
+	patchID = patchID_.GetID();
+	sectorX = path.sectorX;
+	sectorY = path.sectorY;
+	sectorZ = path.sectorZ;
+	systemIndex = path.systemIndex;
+	bodyIndex = path.bodyIndex;
+	depth = depth_;
+	edgeLen = edgeLen_;
+	numPatches = numPatches_;
+}
+
+void GeoPatchCache::Init()
+{
+	PROFILE_SCOPED()
+	std::lock_guard<std::mutex> lock(s_mutex);
+	const int sizeMB = GameConfSingleton::getInstance().Int("GeoPatchCacheSize");
+	s_enabled = GameConfSingleton::getInstance().Int("GeoPatchCache") != 0 && sizeMB > 0;
+	if (!s_enabled) return;
+
+	if (!FileSystem::userFiles.MakeDirectory(CACHE_DIR)) {
+		Output("GeoPatchCache: couldn't create '%s', the cache is disabled\n", CACHE_DIR);
+		s_enabled = false;
+		return;
+	}
+
+	s_budget = uint64_t(sizeMB) << 20;
+	ReadIndex();
+	Evict();
+	Output("GeoPatchCache: " SIZET_FMT " entries, %.1f of %d MB\n", s_lru.size(), double(s_totalSize) / (1 << 20), sizeMB);
+}
+
+void GeoPatchCache::Uninit()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_enabled) return;
+
+	WriteIndex();
+	Output("GeoPatchCache: %u hits, %u misses\n", s_hits, s_misses);
+	s_lru.clear();
+	s_entries.clear();
+	s_totalSize = 0;
+	s_hits = s_misses = 0;
+	s_enabled = false;
+}
+
+bool GeoPatchCache::IsEnabled()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_enabled;
+}
+
+bool GeoPatchCache::Load(const Key &key, std::vector<double> *heights, std::vector<vector3f> *normals, std::vector<Color3ub> *colors)
+{
+	PROFILE_SCOPED()
+	const uint64_t hash = HashKey(key);
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if (!s_enabled) return false;
+		const auto it = s_entries.find(hash);
+		if (it == s_entries.end()) {
+			s_misses++;
+			return false;
+		}
+		s_lru.splice(s_lru.begin(), s_lru, it->second);
+	}
+
+	const size_t numVerts = heights[0].size();
+	const size_t patchSize = numVerts * (sizeof(double) + sizeof(vector3f) + sizeof(Color3ub));
+
+	bool ok = false;
+	RefCountedPtr<FileSystem::FileData> file = FileSystem::userFiles.MapFile(EntryPath(hash));
+	if (file && file->GetSize() > sizeof(FileHeader)) {
+		FileHeader header;
+		memcpy(&header, file->GetData(), sizeof(header));
+		// a different key means a hash collision, so not ours either
+		if (header.magic == MAGIC && header.version == VERSION && header.numVerts == numVerts &&
+			memcmp(&header.key, &key, sizeof(Key)) == 0) {
+			try {
+				const std::string data = lz4::DecompressLZ4(file->GetData() + sizeof(header), file->GetSize() - sizeof(header));
+				if (data.size() == patchSize * key.numPatches) {
+					const char *p = data.data();
+					for (uint32_t i = 0; i < key.numPatches; i++) {
+						memcpy(heights[i].data(), p, numVerts * sizeof(double));
+						p += numVerts * sizeof(double);
+						memcpy(normals[i].data(), p, numVerts * sizeof(vector3f));
+						p += numVerts * sizeof(vector3f);
+						memcpy(colors[i].data(), p, numVerts * sizeof(Color3ub));
+						p += numVerts * sizeof(Color3ub);
+					}
+					ok = true;
+				}
+			} catch (lz4::DecompressionFailedException &) {
+			}
+		}
+	}
+	file.Reset();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	if (ok) {
+		s_hits++;
+	} else {
+		Output("GeoPatchCache: dropping bad entry %016" PRIx64 "\n", hash);
+		s_misses++;
+		RemoveEntry(hash);
+	}
+	return ok;
+}
+
+void GeoPatchCache::Store(const Key &key, const std::vector<double> *heights, const std::vector<vector3f> *normals, const std::vector<Color3ub> *colors)
+{
+	PROFILE_SCOPED()
+	const uint64_t hash = HashKey(key);
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		if (!s_enabled || s_entries.count(hash)) return;
+	}
+
+	const size_t numVerts = heights[0].size();
+	std::string data;
+	data.reserve(numVerts * (sizeof(double) + sizeof(vector3f) + sizeof(Color3ub)) * key.numPatches);
+	for (uint32_t i = 0; i < key.numPatches; i++) {
+		assert(heights[i].size() == numVerts && normals[i].size() == numVerts && colors[i].size() == numVerts);
+		data.append(reinterpret_cast<const char *>(heights[i].data()), numVerts * sizeof(double));
+		data.append(reinterpret_cast<const char *>(normals[i].data()), numVerts * sizeof(vector3f));
+		data.append(reinterpret_cast<const char *>(colors[i].data()), numVerts * sizeof(Color3ub));
+	}
+
+	size_t compressedSize = 0;
+	std::unique_ptr<char[]> compressed;
+	try {
+		compressed = lz4::CompressLZ4(data, 0, compressedSize);
+	} catch (lz4::CompressionFailedException &) {
+		return;
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.key = key;
+	header.numVerts = uint32_t(numVerts);
+
+	// written to a temporary first, so that a reader never maps half an entry
+	const std::string path = EntryPath(hash);
+	const std::string tmpPath = path + ".tmp" + std::to_string(s_tmpCounter++);
+	FILE *f = FileSystem::userFiles.OpenWriteStream(tmpPath);
+	if (!f) return;
+	bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		fwrite(compressed.get(), 1, compressedSize, f) == compressedSize;
+	written = (fclose(f) == 0) && written;
+	if (!written || !FileSystem::userFiles.RenameFile(tmpPath, path)) {
+		FileSystem::userFiles.RemoveFile(tmpPath);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	// another job may have stored the same patch meanwhile, that's fine
+	if (!s_enabled || s_entries.count(hash)) return;
+	AddEntry(hash, sizeof(header) + compressedSize, true);
+	Evict();
+}
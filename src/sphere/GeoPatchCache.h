@@ -0,0 +1,49 @@
+// Copyright © 2008-2019 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GEOPATCHCACHE_H
+#define _GEOPATCHCACHE_H
+
+#include "Color.h"
+#include "libs/vector3.h"
+
+#include <cstdint>
+#include <vector>
+
+class GeoPatchID;
+class SystemPath;
+
+// Keeps the heights, normals and colours of generated GeoPatches on disk,
+// so that coming back to a planet doesn't run the terrain fractals again.
+// Entries are LZ4 compressed, one file each, and the least recently used
+// ones are thrown out when the cache grows over its size in the config.
+//
+// Load and Store are called by the patch jobs and are thread safe.
+class GeoPatchCache {
+public:
+	// everything the generated data depends on
+	struct Key {
+		Key() = default;
+		Key(const SystemPath &path, const GeoPatchID &patchID, uint32_t depth, uint32_t edgeLen, uint64_t terrainHash, uint32_t numPatches);
+
+		uint64_t terrainHash;
+		uint64_t patchID;
+		int32_t sectorX, sectorY, sectorZ;
+		uint32_t systemIndex, bodyIndex;
+		uint32_t depth;
+		uint32_t edgeLen;
+		// 1 for a single patch, 4 for the kids of a quad split
+		uint32_t numPatches;
+	};
+
+	static void Init();
+	static void Uninit();
+	static bool IsEnabled();
+
+	// the arrays hold key.numPatches vectors, already sized for one patch.
+	// false if the patch isn't cached (or its entry turned out to be bad)
+	static bool Load(const Key &key, std::vector<double> *heights, std::vector<vector3f> *normals, std::vector<Color3ub> *colors);
+	static void Store(const Key &key, const std::vector<double> *heights, const std::vector<vector3f> *normals, const std::vector<Color3ub> *colors);
+};
+
+#endif /* _GEOPATCHCACHE_H */
@@ -3,6 +3,7 @@
 
 #include "GeoPatchJobs.h"
 
+#include "GeoPatchCache.h"
 #include "GeoSphere.h"
 #include "terrain/Terrain.h"
 
@@ -38,6 +39,11 @@ SBaseRequest::SBaseRequest(const vector3d &v0_, const vector3d &v1_, const vecto
 SBaseRequest::~SBaseRequest()
 {}
 
+GeoPatchCache::Key SBaseRequest::GetCacheKey(const uint32_t numPatches) const
+{
+	return GeoPatchCache::Key(sysPath, patchID, depth, edgeLen, pTerrain->GetGeneratorHash(), numPatches);
+}
+
 // ********************************************************************************
 // Overloaded PureJob class to handle generating the mesh for each patch
 // ********************************************************************************
@@ -101,8 +107,16 @@ void SinglePatchJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 
 	SSingleSplitRequest &srd = *mData;
 
-	// fill out the data
-	mData->GenerateMesh();
+	// fill out the data, from the disk cache if we've been here before
+	if (GeoPatchCache::IsEnabled()) {
+		const GeoPatchCache::Key key = srd.GetCacheKey(1);
+		if (!GeoPatchCache::Load(key, &srd.m_heights, &srd.m_normals, &srd.m_colors)) {
+			srd.GenerateMesh();
+			GeoPatchCache::Store(key, &srd.m_heights, &srd.m_normals, &srd.m_colors);
+		}
+	} else {
+		srd.GenerateMesh();
+	}
 
 	// add this patches data
 	SSingleSplitResult *sr = new SSingleSplitResult(srd.patchID.GetPatchFaceIdx(), srd.depth);
@@ -138,8 +152,6 @@ void QuadPatchJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 
 	SQuadSplitRequest &srd = *mData;
 
-	srd.GenerateBorderedData();
-
 	const vector3d v01 = (srd.v0 + srd.v1).Normalized();
 	const vector3d v12 = (srd.v1 + srd.v2).Normalized();
 	const vector3d v23 = (srd.v2 + srd.v3).Normalized();
@@ -160,14 +172,23 @@ void QuadPatchJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 		{ 0, srd.edgeLen - 1 }
 	};
 
+	// fill out the data, from the disk cache if we've been here before
+	const bool useCache = GeoPatchCache::IsEnabled();
+	const GeoPatchCache::Key key = useCache ? srd.GetCacheKey(4) : GeoPatchCache::Key();
+	if (!useCache || !GeoPatchCache::Load(key, srd.m_heights, srd.m_normals, srd.m_colors)) {
+		srd.GenerateBorderedData();
+		for (int i = 0; i < 4; i++) {
+			srd.GenerateSubPatchData(i,
+				vecs[i][0], vecs[i][1], vecs[i][2], vecs[i][3],
+				srd.edgeLen, offxy[i][0], offxy[i][1],
+				borderedEdgeLen);
+		}
+		if (useCache)
+			GeoPatchCache::Store(key, srd.m_heights, srd.m_normals, srd.m_colors);
+	}
+
 	SQuadSplitResult *sr = new SQuadSplitResult(srd.patchID.GetPatchFaceIdx(), srd.depth);
 	for (int i = 0; i < 4; i++) {
-		// fill out the data
-		srd.GenerateSubPatchData(i,
-			vecs[i][0], vecs[i][1], vecs[i][2], vecs[i][3],
-			srd.edgeLen, offxy[i][0], offxy[i][1],
-			borderedEdgeLen);
-
 		// add this patches data
 		sr->addResult(i, srd.m_heights[i], srd.m_normals[i], srd.m_colors[i],
 			vecs[i][0], vecs[i][1], vecs[i][2], vecs[i][3],
@@ -5,6 +5,7 @@
 #define _GEOPATCHJOBS_H
 
 #include "Color.h"
+#include "GeoPatchCache.h"
 #include "GeoPatchID.h"
 #include "JobQueue.h"
 #include "galaxy/SystemPath.h"
@@ -21,6 +22,7 @@ public:
 		Terrain *pTerrain_);
 	~SBaseRequest();
 	inline int NUMVERTICES(const int el) const { return el * el; }
+	GeoPatchCache::Key GetCacheKey(const uint32_t numPatches) const;
 
 	const vector3d v0, v1, v2, v3;
 	const vector3d centroid;
@@ -4,6 +4,7 @@
 #include "GeoSphere.h"
 
 #include "GeoPatch.h"
+#include "GeoPatchCache.h"
 #include "GeoPatchContext.h"
 #include "GeoPatchJobs.h"
 #include "Pi.h"
@@ -35,17 +36,21 @@ static const int detail_edgeLen[5] = {
 };
 
 static const double gs_targetPatchTriLength(100.0);
+// frames a split waits at most before it goes ahead of nearer ones queued since
+static const uint32_t gs_quadSplitDeadline(120);
 static std::vector<GeoSphere *> s_allGeospheres;
 
 void GeoSphere::Init(int detail)
 {
 	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[detail > 4 ? 4 : detail]));
+	GeoPatchCache::Init();
 }
 
 void GeoSphere::Uninit()
 {
 	assert(s_patchContext.Unique());
 	s_patchContext.Reset();
+	GeoPatchCache::Uninit();
 }
 
 static void print_info(const SystemBodyWrapper *sbodyw, const Terrain *terrain)
@@ -372,7 +377,13 @@ void GeoSphere::ProcessQuadSplitRequests()
 
 	for (auto iter : mQuadSplitRequests) {
 		SQuadSplitRequest *ssrd = iter.mpRequest;
-		iter.mpRequester->ReceiveJobHandle(Pi::GetAsyncJobQueue()->Queue(new QuadPatchJob(ssrd)));
+		// nearest patches first, also ahead of anything queued earlier that is
+		// further away. but not for ever, or while the camera moves the
+		// patches behind it would never be split
+		QuadPatchJob *job = new QuadPatchJob(ssrd);
+		job->SetPriority(iter.mDistance);
+		job->SetDeadline(gs_quadSplitDeadline);
+		iter.mpRequester->ReceiveJobHandle(Pi::GetAsyncJobQueue()->Queue(job), iter.mDistance);
 	}
 	mQuadSplitRequests.clear();
 }
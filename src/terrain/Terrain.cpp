@@ -8,6 +8,7 @@
 #include "perlin.h"
 #include "libs/utils.h"
 #include "galaxy/SystemBody.h"
+#include "jenkins/lookup3.h"
 #include "libs/FloatComparison.h"
 
 // static instancer. selects the best height and color classes for the body
@@ -634,6 +635,41 @@ void Terrain::SetFracDef(const unsigned int index, const double featureHeightMet
 	//Output("%d octaves\n", m_fracdef[index].octaves); //print
 }
 
+uint64_t Terrain::GetGeneratorHash() const
+{
+	// the colours all come from m_rand, so the seed stands in for them
+	std::string key;
+	auto add = [&key](const void *data, size_t size) { key.append(static_cast<const char *>(data), size); };
+	const uint32_t version = GENERATOR_VERSION;
+	add(&version, sizeof(version));
+	add(&m_seed, sizeof(m_seed));
+	key += GetHeightFractalName();
+	key += '\0';
+	key += GetColorFractalName();
+	key += '\0';
+	add(&m_sealevel, sizeof(m_sealevel));
+	add(&m_icyness, sizeof(m_icyness));
+	add(&m_volcanic, sizeof(m_volcanic));
+	add(&m_surfaceEffects, sizeof(m_surfaceEffects));
+	add(&m_maxHeight, sizeof(m_maxHeight));
+	add(&m_planetRadius, sizeof(m_planetRadius));
+	add(&m_minBody.m_aspectRatio, sizeof(m_minBody.m_aspectRatio));
+	add(&m_heightScaling, sizeof(m_heightScaling));
+	add(&m_minh, sizeof(m_minh));
+	add(&m_heightMapSizeX, sizeof(m_heightMapSizeX));
+	add(&m_heightMapSizeY, sizeof(m_heightMapSizeY));
+	for (const fracdef_t &def : m_fracdef) {
+		add(&def.amplitude, sizeof(def.amplitude));
+		add(&def.frequency, sizeof(def.frequency));
+		add(&def.lacunarity, sizeof(def.lacunarity));
+		add(&def.octaves, sizeof(def.octaves));
+	}
+
+	uint32_t c = 0, b = 0;
+	lookup3_hashlittle2(key.data(), key.size(), &c, &b);
+	return (uint64_t(b) << 32) | c;
+}
+
 double Terrain::BiCubicInterpolation(const vector3d &p) const
 {
 	double latitude = -asin(p.y);
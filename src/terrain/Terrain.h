@@ -55,6 +55,12 @@ public:
 
 	double BiCubicInterpolation(const vector3d &p) const;
 
+	// bump this when a change to the fractals changes what they generate
+	static const uint32_t GENERATOR_VERSION = 1;
+	// hash of everything the generated heights and colours depend on,
+	// so that they can be cached
+	uint64_t GetGeneratorHash() const;
+
 	void DebugDump() const;
 
 private:
@@ -204,6 +204,47 @@ namespace FileSystem {
 		}
 	}
 
+	class FileDataMapped : public FileData {
+	public:
+		FileDataMapped(const FileInfo &info, size_t size, void *data) :
+			FileData(info, size, static_cast<char *>(data)) {}
+		virtual ~FileDataMapped() { UnmapViewOfFile(m_data); }
+	};
+
+	RefCountedPtr<FileData> FileSourceFS::MapFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const std::wstring wfullpath = transcode_utf8_to_utf16(fullpath);
+		HANDLE filehandle = CreateFileW(wfullpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (filehandle == INVALID_HANDLE_VALUE)
+			return RefCountedPtr<FileData>(0);
+
+		LARGE_INTEGER large_size;
+		if (!GetFileSizeEx(filehandle, &large_size)) {
+			CloseHandle(filehandle);
+			return RefCountedPtr<FileData>(0);
+		}
+		// can't map an empty file
+		if (large_size.QuadPart == 0) {
+			CloseHandle(filehandle);
+			return ReadFile(path);
+		}
+
+		const Time::DateTime modtime = file_modtime_for_handle(filehandle);
+		HANDLE mapping = CreateFileMappingW(filehandle, 0, PAGE_READONLY, 0, 0, 0);
+		CloseHandle(filehandle);
+		if (!mapping)
+			return RefCountedPtr<FileData>(0);
+
+		// the view keeps the mapping alive
+		void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!data)
+			return RefCountedPtr<FileData>(0);
+
+		return RefCountedPtr<FileData>(new FileDataMapped(MakeFileInfo(path, FileInfo::FT_FILE, modtime), size_t(large_size.QuadPart), data));
+	}
+
 	bool FileSourceFS::ReadDirectory(const std::string &dirpath, std::vector<FileInfo> &output)
 	{
 		size_t output_head_size = output.size();
@@ -279,6 +320,19 @@ namespace FileSystem {
 		return _wfopen(wfullpath.c_str(), mode);
 	}
 
+	bool FileSourceFS::RemoveFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		return DeleteFileW(transcode_utf8_to_utf16(fullpath).c_str()) != 0;
+	}
+
+	bool FileSourceFS::RenameFile(const std::string &from, const std::string &to)
+	{
+		const std::wstring wfrom = transcode_utf8_to_utf16(JoinPathBelow(GetRoot(), from));
+		const std::wstring wto = transcode_utf8_to_utf16(JoinPathBelow(GetRoot(), to));
+		return MoveFileExW(wfrom.c_str(), wto.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+
 	FILE *FileSourceFS::OpenReadStream(const std::string &path)
 	{
 		const std::string fullpath = JoinPathBelow(GetRoot(), path);